@@ -27,6 +27,47 @@ class CIdentModule;
 
 CCore *g_Bouncer;
 
+#define IDENTFILEINTERVAL 60 /**< how often the "ident" file is re-read (in seconds) */
+
+/**
+ * GetIdentFile
+ *
+ * Returns the ident from the "ident" file or NULL if there is no such
+ * file. The file is read at most once every IDENTFILEINTERVAL seconds.
+ */
+static const char *GetIdentFile(void) {
+	static char IdentBuffer[50];
+	static bool Exists = false;
+	static time_t LastRead = 0;
+
+	if (LastRead != 0 && g_CurrentTime - LastRead < IDENTFILEINTERVAL) {
+		return Exists ? IdentBuffer : NULL;
+	}
+
+	LastRead = g_CurrentTime;
+
+	FILE *IdentFile = fopen("ident", "r");
+
+	if (IdentFile == NULL) {
+		Exists = false;
+
+		return NULL;
+	}
+
+	if (fgets(IdentBuffer, sizeof(IdentBuffer), IdentFile) == NULL) {
+		// TODO: error reply
+		IdentBuffer[0] = '\0';
+	} else {
+		IdentBuffer[strcspn(IdentBuffer, "\r\n")] = '\0';
+	}
+
+	fclose(IdentFile);
+
+	Exists = true;
+
+	return IdentBuffer;
+}
+
 class CIdentClient : public CConnection {
 public:
 	CIdentClient(SOCKET Client) : CConnection(Client) {
@@ -59,80 +100,40 @@ public:
 		LocalPort = atoi(dupLine);
 		free(dupLine);
 
-		if (LocalPort == 0 || RemotePort == 0) {
+		if (LocalPort <= 0 || LocalPort > 65535 || RemotePort <= 0 || RemotePort > 65535) {
 			g_Bouncer->Log("Received invalid ident-request.");
 
 			return;
 		}
 
-		int i = 0, LPort, RPort;
+		CIRCConnection *IRC;
 		const char *Ident;
-		hash_t<CUser *> *UserHash;
 
-		while ((UserHash = g_Bouncer->GetUsers()->Iterate(i++)) != NULL) {
-			CUser *User = UserHash->Value;
-			CIRCConnection *IRC = User->GetIRCConnection();
+		IRC = g_Bouncer->GetIdentSupport()->FindConnection(LocalPort, RemotePort, GetRemoteAddress());
 
-			if (IRC == NULL) {
-				continue;
-			}
-
-			sockaddr *LocalAddress = IRC->GetLocalAddress();
-			sockaddr *RemoteAddress = IRC->GetRemoteAddress();
+		if (IRC != NULL && IRC->GetOwner() != NULL) {
+			CUser *User = IRC->GetOwner();
 
-			if (LocalAddress == NULL || RemoteAddress == NULL || LocalAddress->sa_family != RemoteAddress->sa_family) {
-				continue;
-			}
+			Ident = User->GetIdent();
 
-			if (LocalAddress->sa_family == AF_INET) {
-				LPort = htons(((sockaddr_in *)LocalAddress)->sin_port);
-			} else {
-				LPort = htons(((sockaddr_in6 *)LocalAddress)->sin6_port);
+			if (Ident == NULL) {
+				Ident = User->GetUsername();
 			}
 
-			if (RemoteAddress->sa_family == AF_INET) {
-				RPort = htons(((sockaddr_in *)RemoteAddress)->sin_port);
-			} else {
-				RPort = htons(((sockaddr_in6 *)RemoteAddress)->sin6_port);
-			}
-
-			if (LPort == LocalPort && RPort == RemotePort) {
-				Ident = UserHash->Value->GetIdent();
-
-				if (Ident == NULL) {
-					Ident = UserHash->Name;
-				}
-
-				// 113 , 3559 : USERID : UNIX : shroud
-				WriteLine("%d , %d : USERID : UNIX : %s", LocalPort, RemotePort, Ident);
+			// 113 , 3559 : USERID : UNIX : shroud
+			WriteLine("%d , %d : USERID : UNIX : %s", LocalPort, RemotePort, Ident);
 
-				g_Bouncer->Log("Answered ident-request for %s", User->GetUsername());
+			g_Bouncer->Log("Answered ident-request for %s", User->GetUsername());
 
-				return;
-			}
+			return;
 		}
 
-		FILE *IdentFile = fopen("ident", "r");
-
-		if (IdentFile != NULL) {
-			char IdentBuffer[50];
-
-			if (fgets(IdentBuffer, sizeof(IdentBuffer), IdentFile) == NULL) {
-				// TODO: error reply
-				IdentBuffer[0] = '\0';
-			} else {
-				for (int i = strlen(IdentBuffer); i > 0; i--) {
-					if (IdentBuffer[i] == '\r' || IdentBuffer[i] == '\n') {
-						IdentBuffer[i] = '\0';
-					}
-				}
-			}
-
-			WriteLine("%d, %d : USERID : UNIX : %s", LocalPort, RemotePort, IdentBuffer);
+		Ident = GetIdentFile();
 
-			fclose(IdentFile);
+		if (Ident != NULL) {
+			WriteLine("%d, %d : USERID : UNIX : %s", LocalPort, RemotePort, Ident);
 
-			g_Bouncer->Log("Ident-request for unknown user. Returned ident from \"ident\" file: %s", IdentBuffer);
+			g_Bouncer->Log("Ident-request for unknown user. Returned ident from \"ident\" file: %s", Ident);
 		} else {
 			WriteLine("%d , %d : USERID : UNIX : %s", LocalPort, RemotePort, g_Bouncer->GetIdent());
 
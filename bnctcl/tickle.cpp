@@ -379,6 +379,10 @@ class CTclSupport : public CModuleImplementation {
 			return true;
 		return false;
 	}
+
+	const CModuleSubscription *GetSubscription(void) {
+		return &g_Subscription;
+	}
 public:
 	void RehashInterpreter(void) {
 		CallBinds(Type_PreRehash, NULL, NULL, 0, NULL);
@@ -403,93 +407,85 @@ void RehashInterpreter(void) {
 void CallBinds(binding_type_e type, const char* user, CClientConnection *client, int argc, const char** argv) {
 	Tcl_Obj** listv;
 	CUser *User = NULL;
+	CVector<unsigned int> Matches;
+	CVector<unsigned int> Generations;
 
 	int idx = 1;
 	Tcl_Obj* objv[3];
 	bool lazyConversionDone = false;
 
-	for (int i = 0; i < g_BindCount; i++) {
-		if (g_Binds[i].valid && g_Binds[i].type == type) {
-			Tcl_DString dsProc;
-
-			if (user && strcasecmp(g_Binds[i].user, user) != 0 && !strcasecmp(g_Binds[i].user, "*") == 0)
-				continue;
+	FindBinds(type, user, argc, argv, &Matches);
 
-			bool Match = false;
-
-			if (g_Binds[i].pattern == NULL || strcmp(g_Binds[i].pattern, "*") == 0)
-				Match = true;
-
-			if (!Match) {
-				for (int a = 0; a < argc; a++) {
-					if (strcasecmp(g_Binds[i].pattern, argv[a]) == 0) {
-					//if (g_Bouncer->Match(g_Binds[i].pattern, argv[a])) {
-						Match = true;
+	for (int m = 0; m < Matches.GetLength(); m++) {
+		Generations.Insert(g_Binds[Matches[m]].generation);
+	}
 
-						break;
-					}
-				}
-			}
+	for (int m = 0; m < Matches.GetLength(); m++) {
+		unsigned int i = Matches[m];
 
-			if (Match) {
-				if (!lazyConversionDone) {
-					if (user) {
-						Tcl_DString dsUser;
+		// a bind might match more than one argument
+		if (m > 0 && Matches[m - 1] == i)
+			continue;
 
-						Tcl_ExternalToUtfDString(g_Encoding, user ? user : "", -1, &dsUser);
-						objv[idx++] = Tcl_NewStringObj(Tcl_DStringValue(&dsUser), Tcl_DStringLength(&dsUser));
-						Tcl_DStringFree(&dsUser);
+		// previous binds might have removed this bind or replaced it
+		// with a bind which doesn't match this call
+		if (!g_Binds[i].valid || g_Binds[i].generation != Generations[m])
+			continue;
 
-						Tcl_IncrRefCount(objv[idx - 1]);
-					}
+		if (!lazyConversionDone) {
+			if (user) {
+				Tcl_DString dsUser;
 
-					if (argc) {
-						listv = (Tcl_Obj**)malloc(sizeof(Tcl_Obj*) * argc);
+				Tcl_ExternalToUtfDString(g_Encoding, user ? user : "", -1, &dsUser);
+				objv[idx++] = Tcl_NewStringObj(Tcl_DStringValue(&dsUser), Tcl_DStringLength(&dsUser));
+				Tcl_DStringFree(&dsUser);
 
-						for (int a = 0; a < argc; a++) {
-							Tcl_DString dsString;
+				Tcl_IncrRefCount(objv[idx - 1]);
+			}
 
-							Tcl_ExternalToUtfDString(g_Encoding, argv[a], -1, &dsString);
-							listv[a] = Tcl_NewStringObj(Tcl_DStringValue(&dsString), Tcl_DStringLength(&dsString));
-							Tcl_DStringFree(&dsString);
+			if (argc) {
+				listv = (Tcl_Obj**)malloc(sizeof(Tcl_Obj*) * argc);
 
-							Tcl_IncrRefCount(listv[a]);
-						}
+				for (int a = 0; a < argc; a++) {
+					Tcl_DString dsString;
 
-						objv[idx++] = Tcl_NewListObj(argc, listv);
-						Tcl_IncrRefCount(objv[idx - 1]);
+					Tcl_ExternalToUtfDString(g_Encoding, argv[a], -1, &dsString);
+					listv[a] = Tcl_NewStringObj(Tcl_DStringValue(&dsString), Tcl_DStringLength(&dsString));
+					Tcl_DStringFree(&dsString);
 
-						for (int a = 0; a < argc; a++) {
-							Tcl_DecrRefCount(listv[a]);
-						}
+					Tcl_IncrRefCount(listv[a]);
+				}
 
-						free(listv);
-					}
+				objv[idx++] = Tcl_NewListObj(argc, listv);
+				Tcl_IncrRefCount(objv[idx - 1]);
 
-					lazyConversionDone = true;
+				for (int a = 0; a < argc; a++) {
+					Tcl_DecrRefCount(listv[a]);
 				}
 
-				Tcl_ExternalToUtfDString(g_Encoding, g_Binds[i].proc, -1, &dsProc);
-				objv[0] = Tcl_NewStringObj(Tcl_DStringValue(&dsProc), Tcl_DStringLength(&dsProc));
-				Tcl_DStringFree(&dsProc);
+				free(listv);
+			}
 
-				Tcl_IncrRefCount(objv[0]);
+			lazyConversionDone = true;
+		}
 
-				if (User == NULL) {
-					User = g_Bouncer->GetUser(user);
-				}
+		// the proc might unbind itself
+		objv[0] = g_Binds[i].procobj;
+		Tcl_IncrRefCount(objv[0]);
 
-				if (User != NULL) {
-					setctx(user);
-				}
+		if (User == NULL) {
+			User = g_Bouncer->GetUser(user);
+		}
 
-				g_CurrentClient = client;
+		if (User != NULL) {
+			setctx(user);
+		}
 
-				Tcl_EvalObjv(g_Interp, idx, objv, TCL_EVAL_GLOBAL);
+		g_CurrentClient = client;
 
-				Tcl_DecrRefCount(objv[0]);
-			}
-		}
+		Tcl_EvalObjv(g_Interp, idx, objv, TCL_EVAL_GLOBAL);
+
+		Tcl_DecrRefCount(objv[0]);
 	}
 
 	if (lazyConversionDone) {
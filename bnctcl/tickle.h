@@ -49,10 +49,22 @@ typedef struct binding_s {
 	char* proc;
 	char* pattern;
 	char* user;
+	Tcl_Obj* procobj;
+	unsigned int generation;
 } binding_t;
 
+typedef struct binding_index_s {
+	CVector<unsigned int> wildcard;
+	CHashtable<CVector<unsigned int>*, false> patterns;
+} binding_index_t;
+
 extern binding_t* g_Binds;
 extern int g_BindCount;
+extern CModuleSubscription g_Subscription;
+
+void IndexBind(int idx);
+void UnindexBind(int idx);
+void FindBinds(binding_type_e type, const char* user, int argc, const char** argv, CVector<unsigned int>* result);
 
 class CTimer;
 
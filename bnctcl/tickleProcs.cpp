@@ -30,6 +30,10 @@ CClientConnection *g_CurrentClient = NULL;
 
 binding_t *g_Binds = NULL;
 int g_BindCount = 0;
+static unsigned int g_BindGeneration = 0;
+
+static CHashtable<binding_index_t*, false>* g_BindIndex[Type_ChannelSort + 1];
+CModuleSubscription g_Subscription;
 
 tcltimer_t **g_Timers = NULL;
 int g_TimerCount = 0;
@@ -268,6 +272,9 @@ int internalbind(const char* type, const char* proc, const char* pattern, const
 
 	Bind->valid = false;
 
+	// lets CallBinds() notice that a slot has been reused
+	Bind->generation = ++g_BindGeneration;
+
 	if (strcasecmp(type, "client") == 0)
 		Bind->type = Type_Client;
 	else if (strcasecmp(type, "server") == 0)
@@ -320,6 +327,16 @@ int internalbind(const char* type, const char* proc, const char* pattern, const
 	Bind->pattern = strdup(pattern);
 	Bind->user = strdup(user);
 
+	Tcl_DString dsProc;
+
+	Tcl_ExternalToUtfDString(g_Encoding, proc, -1, &dsProc);
+	Bind->procobj = Tcl_NewStringObj(Tcl_DStringValue(&dsProc), Tcl_DStringLength(&dsProc));
+	Tcl_DStringFree(&dsProc);
+
+	Tcl_IncrRefCount(Bind->procobj);
+
+	IndexBind(Bind - g_Binds);
+
 	return 1;
 }
 
@@ -382,6 +399,9 @@ int internalunbind(const char* type, const char* proc, const char* pattern, cons
 			&& (strcmp(pattern, g_Binds[i].pattern) == 0)
 			&& (strcasecmp(user, g_Binds[i].user) == 0)) {
 
+			UnindexBind(i);
+
+			Tcl_DecrRefCount(g_Binds[i].procobj);
 			free(g_Binds[i].proc);
 			free(g_Binds[i].pattern);
 			free(g_Binds[i].user);
@@ -392,6 +412,160 @@ int internalunbind(const char* type, const char* proc, const char* pattern, cons
 	return 1;
 }
 
+static void SubscribeBind(binding_t* Bind, bool Subscribe) {
+	subscription_type_t Types[Subscription_Count];
+	const char* Token = Bind->pattern;
+	int Count = 0;
+
+	if (Bind->type == Type_Server) {
+		Types[Count++] = Subscription_Server;
+	} else if (Bind->type == Type_Client) {
+		Types[Count++] = Subscription_Client;
+	} else if (Bind->type == Type_PreScript || Bind->type == Type_PostScript) {
+		// pre/post binds are called for every line
+		Types[Count++] = Subscription_Server;
+		Types[Count++] = Subscription_Client;
+		Token = NULL;
+	}
+
+	for (int i = 0; i < Count; i++) {
+		if (Subscribe) {
+			g_Subscription.Subscribe(Types[i], Token);
+		} else {
+			g_Subscription.Unsubscribe(Types[i], Token);
+		}
+	}
+}
+
+void IndexBind(int idx) {
+	binding_t* Bind = &g_Binds[idx];
+	CHashtable<binding_index_t*, false>* Users = g_BindIndex[Bind->type];
+
+	if (Users == NULL) {
+		Users = new CHashtable<binding_index_t*, false>();
+		Users->RegisterValueDestructor(DestroyObject<binding_index_t>);
+
+		g_BindIndex[Bind->type] = Users;
+	}
+
+	SubscribeBind(Bind, true);
+
+	binding_index_t* Index = Users->Get(Bind->user);
+
+	if (Index == NULL) {
+		Index = new binding_index_t;
+		Index->patterns.RegisterValueDestructor(DestroyObject<CVector<unsigned int> >);
+
+		Users->Add(Bind->user, Index);
+	}
+
+	if (strcmp(Bind->pattern, "*") == 0) {
+		Index->wildcard.Insert(idx);
+
+		return;
+	}
+
+	CVector<unsigned int>* List = Index->patterns.Get(Bind->pattern);
+
+	if (List == NULL) {
+		List = new CVector<unsigned int>();
+
+		Index->patterns.Add(Bind->pattern, List);
+	}
+
+	List->Insert(idx);
+}
+
+void UnindexBind(int idx) {
+	binding_t* Bind = &g_Binds[idx];
+	CHashtable<binding_index_t*, false>* Users = g_BindIndex[Bind->type];
+
+	SubscribeBind(Bind, false);
+
+	if (Users == NULL) {
+		return;
+	}
+
+	binding_index_t* Index = Users->Get(Bind->user);
+
+	if (Index == NULL) {
+		return;
+	}
+
+	// Remove(int) would remove the item at that position instead
+	if (strcmp(Bind->pattern, "*") == 0) {
+		Index->wildcard.Remove((unsigned int)idx);
+	} else {
+		CVector<unsigned int>* List = Index->patterns.Get(Bind->pattern);
+
+		if (List != NULL) {
+			List->Remove((unsigned int)idx);
+
+			if (List->GetLength() == 0) {
+				Index->patterns.Remove(Bind->pattern);
+			}
+		}
+	}
+
+	if (Index->wildcard.GetLength() == 0 && Index->patterns.GetLength() == 0) {
+		Users->Remove(Bind->user);
+	}
+}
+
+static void FindIndexedBinds(binding_index_t* Index, int argc, const char** argv, CVector<unsigned int>* result) {
+	for (int i = 0; i < Index->wildcard.GetLength(); i++) {
+		result->Insert(Index->wildcard[i]);
+	}
+
+	if (Index->patterns.GetLength() == 0) {
+		return;
+	}
+
+	for (int a = 0; a < argc; a++) {
+		CVector<unsigned int>* List = Index->patterns.Get(argv[a]);
+
+		if (List == NULL) {
+			continue;
+		}
+
+		for (int i = 0; i < List->GetLength(); i++) {
+			result->Insert((*List)[i]);
+		}
+	}
+}
+
+static int CmpBindIndex(const void* p1, const void* p2) {
+	return (int)*(const unsigned int*)p1 - (int)*(const unsigned int*)p2;
+}
+
+void FindBinds(binding_type_e type, const char* user, int argc, const char** argv, CVector<unsigned int>* result) {
+	CHashtable<binding_index_t*, false>* Users = g_BindIndex[type];
+	binding_index_t* Index;
+
+	if (Users == NULL) {
+		return;
+	}
+
+	if (user == NULL) {
+		int i = 0;
+
+		while (hash_t<binding_index_t*>* p = Users->Iterate(i++)) {
+			FindIndexedBinds(p->Value, argc, argv, result);
+		}
+	} else {
+		if ((Index = Users->Get(user)) != NULL) {
+			FindIndexedBinds(Index, argc, argv, result);
+		}
+
+		if (strcmp(user, "*") != 0 && (Index = Users->Get("*")) != NULL) {
+			FindIndexedBinds(Index, argc, argv, result);
+		}
+	}
+
+	// binds are called in the order in which they were added
+	qsort(result->GetList(), result->GetLength(), sizeof(unsigned int), CmpBindIndex);
+}
+
 const char* internalbinds(void) {
 	char** List = (char**)malloc(g_BindCount * sizeof(char*));
 	int n = 0;
@@ -787,7 +961,7 @@ const char* getchanprefix(const char* Channel, const char* Nick) {
 
 	static char outPref[2];
 
-	outPref[0] = IRC->GetHighestUserFlag(cNick->GetPrefixes());
+	outPref[0] = cNick->GetHighestPrefix();
 	outPref[1] = '\0';
 	
 	return outPref;
@@ -2162,6 +2336,17 @@ void bncsetsendq(int NewSize) {
 	g_Bouncer->SetSendqSize(NewSize);
 }
 
+int bncgetbacklogsize(void) {
+	return g_Bouncer->GetBacklogSize();
+}
+
+void bncsetbacklogsize(int NewSize) {
+	if (NewSize < 0)
+		throw "Invalid backlog size.";
+
+	g_Bouncer->SetBacklogSize(NewSize);
+}
+
 bool synthwho(const char *Channel, bool Simulate) {
 	CUser* Context = g_Bouncer->GetUser(g_Context);
 
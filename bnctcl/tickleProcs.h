@@ -153,6 +153,8 @@ bool bncvaliduser(const char *Name);
 
 int bncgetsendq(void);
 void bncsetsendq(int NewSize);
+int bncgetbacklogsize(void);
+void bncsetbacklogsize(int NewSize);
 
 void bncaddcommand(const char *Name, const char *Category, const char *Description, const char *HelpText = 0);
 void bncdeletecommand(const char *Name);
@@ -0,0 +1,243 @@
+/*******************************************************************************
+ * shroudBNC - an object-oriented framework for IRC                            *
+ * Copyright (C) 2005-2007,2010 Gunnar Beutner                                 *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or               *
+ * modify it under the terms of the GNU General Public License                 *
+ * as published by the Free Software Foundation; either version 2              *
+ * of the License, or (at your option) any later version.                      *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU General Public License for more details.                                *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License           *
+ * along with this program; if not, write to the Free Software                 *
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA. *
+ *******************************************************************************/
+
+#include "StdAfx.h"
+
+#define ADMISSIONREFILL 3 /**< the default number of seconds after which another connection is allowed */
+#define ADMISSIONPULSE 200 /**< the interval (in seconds) in which failed logins are expired */
+
+bool AdmissionTimer(time_t Now, void *Admission);
+
+/**
+ * GetAdmissionBurst
+ *
+ * Returns the number of connections an address may make at once
+ * (system.admissionburst), or 0 if the number of connections
+ * is not limited.
+ */
+static unsigned int GetAdmissionBurst(void) {
+	int Burst = CacheGetInteger(*g_Bouncer->GetConfigCache(), admissionburst);
+
+	return (Burst > 0) ? Burst : 0;
+}
+
+/**
+ * GetAdmissionRefill
+ *
+ * Returns the number of seconds after which an address may make
+ * another connection (system.admissionrefill).
+ */
+static unsigned int GetAdmissionRefill(void) {
+	int Refill = CacheGetInteger(*g_Bouncer->GetConfigCache(), admissionrefill);
+
+	return (Refill > 0) ? Refill : ADMISSIONREFILL;
+}
+
+/**
+ * CAdmission
+ *
+ * Constructs a new admission object.
+ */
+CAdmission::CAdmission(void) {
+	m_Addresses.RegisterValueDestructor(DestroyObject<admission_t>);
+	m_PulseTimer = new CTimer(ADMISSIONPULSE, true, AdmissionTimer, this);
+}
+
+/**
+ * ~CAdmission
+ *
+ * Destructs an admission object.
+ */
+CAdmission::~CAdmission(void) {
+	delete m_PulseTimer;
+}
+
+/**
+ * GetEntry
+ *
+ * Returns the admission state for an address and refills its tokens.
+ *
+ * @param Peer the address
+ * @param Create whether to create a new entry if there is none
+ */
+admission_t *CAdmission::GetEntry(const sockaddr *Peer, bool Create) {
+	const char *Key = IpToString(const_cast<sockaddr *>(Peer));
+	admission_t *Entry = m_Addresses.Get(Key);
+	unsigned int Burst = GetAdmissionBurst(), Refill = GetAdmissionRefill();
+	time_t Elapsed;
+
+	if (Entry == NULL) {
+		if (!Create) {
+			return NULL;
+		}
+
+		Entry = new admission_t;
+
+		if (AllocFailed(Entry)) {
+			return NULL;
+		}
+
+		Entry->BadLogins = 0;
+		Entry->Tokens = Burst;
+		Entry->Refilled = g_CurrentTime;
+		Entry->Refused = false;
+
+		if (IsError(m_Addresses.Add(Key, Entry))) {
+			delete Entry;
+
+			return NULL;
+		}
+
+		return Entry;
+	}
+
+	Elapsed = g_CurrentTime - Entry->Refilled;
+
+	if (Elapsed >= (time_t)Refill) {
+		Entry->Tokens = min(Burst, Entry->Tokens + Elapsed / Refill);
+		Entry->Refilled = g_CurrentTime - Elapsed % Refill;
+	}
+
+	return Entry;
+}
+
+/**
+ * Admit
+ *
+ * Checks whether a new connection from the specified address should be
+ * accepted. The number of connections is only limited if
+ * system.admissionburst is set.
+ *
+ * @param Peer the client's address
+ */
+bool CAdmission::Admit(const sockaddr *Peer) {
+	unsigned int Burst = GetAdmissionBurst();
+	admission_t *Entry = GetEntry(Peer, Burst != 0);
+	bool Blocked;
+
+	// don't lock out clients just because we're out of memory
+	if (Entry == NULL) {
+		return true;
+	}
+
+	Blocked = (Entry->BadLogins > 2);
+
+	if (Blocked || (Burst != 0 && Entry->Tokens == 0)) {
+		if (!Entry->Refused) {
+			g_Bouncer->Log("Refusing connections from %s (%s).", IpToString(const_cast<sockaddr *>(Peer)),
+				Blocked ? "too many failed logins" : "too many connections");
+		}
+
+		Entry->Refused = true;
+
+		return false;
+	}
+
+	if (Burst != 0) {
+		Entry->Tokens--;
+	}
+
+	Entry->Refused = false;
+
+	return true;
+}
+
+/**
+ * LogBadLogin
+ *
+ * Logs a failed login attempt.
+ *
+ * @param Peer the client's address
+ */
+void CAdmission::LogBadLogin(const sockaddr *Peer) {
+	admission_t *Entry = GetEntry(Peer, true);
+
+	if (Entry != NULL && Entry->BadLogins < 3) {
+		Entry->BadLogins++;
+	}
+}
+
+/**
+ * IsIpBlocked
+ *
+ * Checks whether the specified address is blocked because of failed logins.
+ *
+ * @param Peer the address
+ */
+bool CAdmission::IsIpBlocked(const sockaddr *Peer) const {
+	admission_t *Entry = m_Addresses.Get(IpToString(const_cast<sockaddr *>(Peer)));
+
+	return (Entry != NULL && Entry->BadLogins > 2);
+}
+
+/**
+ * Pulse
+ *
+ * Periodically expires failed logins and removes entries for addresses
+ * which have neither failed logins nor recent connections.
+ */
+void CAdmission::Pulse(void) {
+	CVector<char *> Unused;
+	hash_t<admission_t *> *Item;
+	unsigned int Burst = GetAdmissionBurst(), Refill = GetAdmissionRefill();
+	int i = 0;
+
+	while ((Item = m_Addresses.Iterate(i++)) != NULL) {
+		admission_t *Entry = Item->Value;
+
+		if (Entry->BadLogins > 0) {
+			Entry->BadLogins--;
+		}
+
+		if (Entry->BadLogins == 0 && (Entry->Tokens >= Burst ||
+				g_CurrentTime - Entry->Refilled >= (time_t)(Burst - Entry->Tokens) * Refill)) {
+			char *Key = strdup(Item->Name);
+
+			if (AllocFailed(Key)) {
+				break;
+			}
+
+			if (IsError(Unused.Insert(Key))) {
+				free(Key);
+
+				break;
+			}
+		}
+	}
+
+	for (i = 0; i < Unused.GetLength(); i++) {
+		m_Addresses.Remove(Unused[i]);
+
+		free(Unused[i]);
+	}
+}
+
+/**
+ * AdmissionTimer
+ *
+ * Thunks calls to the Pulse() function.
+ *
+ * @param Now the current time
+ * @param Admission a CAdmission object
+ */
+bool AdmissionTimer(time_t Now, void *Admission) {
+	((CAdmission *)Admission)->Pulse();
+
+	return true;
+}
@@ -0,0 +1,64 @@
+/*******************************************************************************
+ * shroudBNC - an object-oriented framework for IRC                            *
+ * Copyright (C) 2005-2007,2010 Gunnar Beutner                                 *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or               *
+ * modify it under the terms of the GNU General Public License                 *
+ * as published by the Free Software Foundation; either version 2              *
+ * of the License, or (at your option) any later version.                      *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU General Public License for more details.                                *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License           *
+ * along with this program; if not, write to the Free Software                 *
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA. *
+ *******************************************************************************/
+
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+class CTimer;
+
+/**
+ * admission_t
+ *
+ * Admission state for a client address.
+ */
+typedef struct admission_s {
+	unsigned int BadLogins; /**< the number of failed logins from this address */
+	unsigned int Tokens; /**< the number of connections which may be made right now */
+	time_t Refilled; /**< when Tokens was last refilled */
+	bool Refused; /**< whether the last connection was refused */
+} admission_t;
+
+/**
+ * CAdmission
+ *
+ * Decides whether new clients are accepted before any resources (DNS
+ * lookups, SSL sessions) are spent on them. Like CUser::IsIpBlocked()
+ * addresses are blocked after repeated failed logins, but for all users,
+ * and each address may only open a limited number of connections in a
+ * short time.
+ */
+class SBNCAPI CAdmission {
+	CHashtable<admission_t *, false> m_Addresses; /**< admission state by IP address */
+	CTimer *m_PulseTimer; /**< expires failed logins and unused entries */
+
+	admission_t *GetEntry(const sockaddr *Peer, bool Create);
+public:
+#ifndef SWIG
+	CAdmission(void);
+	~CAdmission(void);
+#endif /* SWIG */
+
+	bool Admit(const sockaddr *Peer);
+	void LogBadLogin(const sockaddr *Peer);
+	bool IsIpBlocked(const sockaddr *Peer) const;
+
+	void Pulse(void);
+};
+
+#endif /* ADMISSION_H */
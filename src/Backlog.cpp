@@ -0,0 +1,676 @@
+/*******************************************************************************
+ * shroudBNC - an object-oriented framework for IRC                            *
+ * Copyright (C) 2005-2007,2010 Gunnar Beutner                                 *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or               *
+ * modify it under the terms of the GNU General Public License                 *
+ * as published by the Free Software Foundation; either version 2              *
+ * of the License, or (at your option) any later version.                      *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU General Public License for more details.                                *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License           *
+ * along with this program; if not, write to the Free Software                 *
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA. *
+ *******************************************************************************/
+
+#include "StdAfx.h"
+
+#ifdef _WIN32
+#	define BACKLOGFILEMODE (_S_IREAD | _S_IWRITE)
+#else /* _WIN32 */
+#	define BACKLOGFILEMODE (S_IRUSR | S_IWUSR)
+#endif /* _WIN32 */
+
+/**
+ * DestroyBacklogChannel
+ *
+ * Frees a channel's record index.
+ *
+ * @param Channel the channel
+ */
+static void DestroyBacklogChannel(backlogchannel_t *Channel) {
+	free(Channel->Slots);
+	free(Channel);
+}
+
+/**
+ * IsValidRecord
+ *
+ * Checks whether a record's lengths match its data.
+ *
+ * @param Record the record
+ */
+static bool IsValidRecord(const backlogrecord_t *Record) {
+	size_t Length = (size_t)Record->ChannelLength + Record->SourceLength + Record->MessageLength + 3;
+
+	if (Length > sizeof(Record->Data)) {
+		return false;
+	}
+
+	return Record->Data[Record->ChannelLength] == '\0' &&
+		Record->Data[Record->ChannelLength + Record->SourceLength + 1] == '\0' &&
+		Record->Data[Length - 1] == '\0';
+}
+
+/**
+ * FormatBacklogTime
+ *
+ * Formats the timestamp for a backlog line. The last result is cached
+ * because most backlog lines share their timestamp with the previous one.
+ *
+ * @param Time the timestamp
+ */
+static const char *FormatBacklogTime(time_t Time) {
+	static time_t LastTime = 0;
+	static char LastTimeString[100];
+	tm MessageTm;
+
+	if (Time != LastTime || LastTime == 0) {
+		MessageTm = *localtime(&Time);
+
+#ifdef _WIN32
+		strftime(LastTimeString, sizeof(LastTimeString), "%#c" , &MessageTm);
+#else
+		strftime(LastTimeString, sizeof(LastTimeString), "%a %B %d %Y %H:%M:%S" , &MessageTm);
+#endif
+
+		LastTime = Time;
+	}
+
+	return LastTimeString;
+}
+
+/**
+ * CBacklog
+ *
+ * Constructs a backlog object and loads the backlog file if it exists.
+ *
+ * @param Filename the filename of the backlog
+ * @param Size the maximum number of lines
+ */
+CBacklog::CBacklog(const char *Filename, unsigned int Size) {
+	m_Filename = strdup(Filename);
+
+	if (AllocFailed(m_Filename)) {}
+
+	m_DesiredSize = (Size > 0) ? Size : 1;
+	m_Map = NULL;
+	m_MapLength = 0;
+	m_Header = NULL;
+	m_Records = NULL;
+	m_Failed = false;
+
+	m_Channels.RegisterValueDestructor(DestroyBacklogChannel);
+
+	if (m_Filename != NULL && Open() && m_Header->Size != m_DesiredSize) {
+		Rebuild(m_DesiredSize);
+	}
+}
+
+/**
+ * ~CBacklog
+ *
+ * Destructs a backlog object.
+ */
+CBacklog::~CBacklog(void) {
+	Close();
+
+	free(m_Filename);
+}
+
+/**
+ * Map
+ *
+ * Maps a backlog file and sets up the header and record pointers.
+ *
+ * @param File the file descriptor
+ * @param Length the length of the file
+ */
+bool CBacklog::Map(int File, size_t Length) {
+#ifndef _WIN32
+	m_Map = mmap(NULL, Length, PROT_READ | PROT_WRITE, MAP_SHARED, File, 0);
+
+	if (m_Map == MAP_FAILED) {
+		m_Map = NULL;
+	}
+#else /* _WIN32 */
+	HANDLE Mapping;
+
+	Mapping = CreateFileMapping((HANDLE)_get_osfhandle(File), NULL, PAGE_READWRITE, 0, 0, NULL);
+
+	if (Mapping != NULL) {
+		m_Map = MapViewOfFile(Mapping, FILE_MAP_WRITE, 0, 0, Length);
+
+		CloseHandle(Mapping);
+	}
+#endif /* _WIN32 */
+
+	if (m_Map == NULL) {
+		return false;
+	}
+
+	m_MapLength = Length;
+	m_Header = (backlogheader_t *)m_Map;
+	m_Records = (backlogrecord_t *)((char *)m_Map + BACKLOGRECORDSIZE);
+
+	return true;
+}
+
+/**
+ * Open
+ *
+ * Maps an existing backlog file and builds the channel index.
+ */
+bool CBacklog::Open(void) {
+	int File;
+	struct stat FileStat;
+	backlogheader_t Header;
+	bool Valid;
+
+	File = open(m_Filename, O_RDWR | O_BINARY);
+
+	if (File < 0) {
+		return false;
+	}
+
+	Valid = (fstat(File, &FileStat) == 0 && read(File, &Header, sizeof(Header)) == (int)sizeof(Header) &&
+		memcmp(Header.Magic, BACKLOGMAGIC, sizeof(Header.Magic)) == 0 &&
+		Header.RecordSize == BACKLOGRECORDSIZE && Header.Size > 0 &&
+		(uint64_t)FileStat.st_size == ((uint64_t)Header.Size + 1) * BACKLOGRECORDSIZE);
+
+	if (!Valid) {
+		g_Bouncer->Log("Ignoring invalid backlog file %s.", m_Filename);
+	}
+
+	if (!Valid || !Map(File, FileStat.st_size)) {
+		close(File);
+
+		return false;
+	}
+
+	close(File);
+
+	LoadIndex();
+
+	return true;
+}
+
+/**
+ * Create
+ *
+ * Creates an empty backlog file with m_DesiredSize records. All blocks are
+ * written so that a full disk cannot cause faults later on.
+ */
+bool CBacklog::Create(void) {
+	int File;
+	char Block[16 * BACKLOGRECORDSIZE];
+	backlogheader_t *Header = (backlogheader_t *)Block;
+	unsigned int Count, Written = 0;
+	bool Success = true;
+
+	File = open(m_Filename, O_RDWR | O_BINARY | O_CREAT | O_TRUNC, BACKLOGFILEMODE);
+
+	if (File < 0) {
+		return false;
+	}
+
+	memset(Block, 0, sizeof(Block));
+
+	memcpy(Header->Magic, BACKLOGMAGIC, sizeof(Header->Magic));
+	Header->RecordSize = BACKLOGRECORDSIZE;
+	Header->Size = m_DesiredSize;
+	Header->NextSequence = 1;
+
+	Success = (write(File, Block, BACKLOGRECORDSIZE) == BACKLOGRECORDSIZE);
+
+	memset(Block, 0, BACKLOGRECORDSIZE);
+
+	while (Success && Written < m_DesiredSize) {
+		Count = min(m_DesiredSize - Written, sizeof(Block) / BACKLOGRECORDSIZE);
+
+		Success = (write(File, Block, Count * BACKLOGRECORDSIZE) == (int)(Count * BACKLOGRECORDSIZE));
+
+		Written += Count;
+	}
+
+	if (!Success || !Map(File, ((size_t)m_DesiredSize + 1) * BACKLOGRECORDSIZE)) {
+		close(File);
+		unlink(m_Filename);
+
+		return false;
+	}
+
+	close(File);
+
+	return true;
+}
+
+/**
+ * Close
+ *
+ * Unmaps the backlog file and clears the channel index.
+ */
+void CBacklog::Close(void) {
+	if (m_Map != NULL) {
+#ifndef _WIN32
+		munmap(m_Map, m_MapLength);
+#else /* _WIN32 */
+		UnmapViewOfFile(m_Map);
+#endif /* _WIN32 */
+	}
+
+	m_Map = NULL;
+	m_MapLength = 0;
+	m_Header = NULL;
+	m_Records = NULL;
+
+	m_Channels.Clear();
+}
+
+/**
+ * LoadIndex
+ *
+ * Builds the channel index from the records in the file. Records which
+ * do not belong to the current ring are cleared.
+ */
+void CBacklog::LoadIndex(void) {
+	uint64_t Sequence, First, Next;
+	unsigned int Size = m_Header->Size, Slot;
+	backlogrecord_t *Record;
+
+	if (m_Header->NextSequence == 0) {
+		m_Header->NextSequence = 1;
+	}
+
+	Next = m_Header->NextSequence;
+	First = (Next > Size) ? Next - Size : 1;
+
+	for (Sequence = First; Sequence < Next; Sequence++) {
+		Slot = (unsigned int)(Sequence % Size);
+		Record = &m_Records[Slot];
+
+		if (Record->Sequence != Sequence || !IsValidRecord(Record)) {
+			Record->Sequence = 0;
+
+			continue;
+		}
+
+		if (!Append(GetChannel(Record->Data, true), Slot)) {
+			Record->Sequence = 0;
+		}
+	}
+}
+
+/**
+ * Rebuild
+ *
+ * Recreates the backlog file with a different number of records. The
+ * newest lines are kept.
+ *
+ * @param Size the new number of records
+ */
+void CBacklog::Rebuild(unsigned int Size) {
+	backlogrecord_t *Lines = NULL;
+	unsigned int Count = 0, OldSize, Slot;
+	uint64_t Sequence, First, Next;
+
+	if (m_Header != NULL) {
+		OldSize = m_Header->Size;
+		Next = m_Header->NextSequence;
+		First = (Next > OldSize) ? Next - OldSize : 1;
+
+		if (Next - First > Size) {
+			First = Next - Size;
+		}
+
+		Lines = (backlogrecord_t *)malloc((size_t)(Next - First + 1) * sizeof(backlogrecord_t));
+
+		if (!AllocFailed(Lines)) {
+			for (Sequence = First; Sequence < Next; Sequence++) {
+				Slot = (unsigned int)(Sequence % OldSize);
+
+				if (m_Records[Slot].Sequence == Sequence) {
+					Lines[Count++] = m_Records[Slot];
+				}
+			}
+		}
+	}
+
+	Close();
+
+	m_DesiredSize = Size;
+
+	if (Create()) {
+		for (unsigned int i = 0; i < Count; i++) {
+			Insert(Lines[i].Data, Lines[i].Data + Lines[i].ChannelLength + 1,
+				Lines[i].Data + Lines[i].ChannelLength + Lines[i].SourceLength + 2, (time_t)Lines[i].Time);
+		}
+	} else {
+		g_Bouncer->Log("Could not create backlog file %s.", m_Filename);
+
+		m_Failed = true;
+	}
+
+	free(Lines);
+}
+
+/**
+ * GetChannel
+ *
+ * Returns a channel's record index.
+ *
+ * @param Channel the channel
+ * @param Create whether to create the index if it does not exist
+ */
+backlogchannel_t *CBacklog::GetChannel(const char *Channel, bool Create) {
+	backlogchannel_t *Index;
+
+	Index = m_Channels.Get(Channel);
+
+	if (Index != NULL || !Create) {
+		return Index;
+	}
+
+	Index = (backlogchannel_t *)malloc(sizeof(backlogchannel_t));
+
+	if (AllocFailed(Index)) {
+		return NULL;
+	}
+
+	Index->Slots = NULL;
+	Index->Head = 0;
+	Index->Count = 0;
+	Index->Alloc = 0;
+
+	if (IsError(m_Channels.Add(Channel, Index))) {
+		free(Index);
+
+		return NULL;
+	}
+
+	return Index;
+}
+
+/**
+ * Append
+ *
+ * Appends a slot to a channel's record index.
+ *
+ * @param Index the channel's record index
+ * @param Slot the slot
+ */
+bool CBacklog::Append(backlogchannel_t *Index, unsigned int Slot) {
+	unsigned int *NewSlots, NewAlloc;
+
+	if (Index == NULL) {
+		return false;
+	}
+
+	if (Index->Count == Index->Alloc) {
+		NewAlloc = (Index->Alloc > 0) ? Index->Alloc * 2 : 16;
+		NewSlots = (unsigned int *)malloc(NewAlloc * sizeof(unsigned int));
+
+		if (AllocFailed(NewSlots)) {
+			return false;
+		}
+
+		for (unsigned int i = 0; i < Index->Count; i++) {
+			NewSlots[i] = Index->Slots[(Index->Head + i) % Index->Alloc];
+		}
+
+		free(Index->Slots);
+
+		Index->Slots = NewSlots;
+		Index->Head = 0;
+		Index->Alloc = NewAlloc;
+	}
+
+	Index->Slots[(Index->Head + Index->Count) % Index->Alloc] = Slot;
+	Index->Count++;
+
+	return true;
+}
+
+/**
+ * Evict
+ *
+ * Removes the record in the specified slot from its channel's index. The
+ * slot always holds the oldest record of the file and therefore also the
+ * oldest record of its channel.
+ *
+ * @param Slot the slot
+ */
+void CBacklog::Evict(unsigned int Slot) {
+	backlogrecord_t *Record = &m_Records[Slot];
+	backlogchannel_t *Index;
+
+	if (Record->Sequence == 0 || !IsValidRecord(Record)) {
+		return;
+	}
+
+	Index = m_Channels.Get(Record->Data);
+
+	if (Index == NULL || Index->Count == 0 || Index->Slots[Index->Head] != Slot) {
+		return;
+	}
+
+	Index->Head = (Index->Head + 1) % Index->Alloc;
+	Index->Count--;
+
+	if (Index->Count == 0) {
+		m_Channels.Remove(Record->Data);
+	}
+}
+
+/**
+ * Insert
+ *
+ * Stores a line in the next record. Lines which do not fit into a
+ * record (i.e. which are longer than the IRC protocol allows) are
+ * logged and discarded.
+ *
+ * @param Channel the channel
+ * @param Source the message source
+ * @param Message the message
+ * @param Time the time the message was received
+ */
+void CBacklog::Insert(const char *Channel, const char *Source, const char *Message, time_t Time) {
+	backlogrecord_t *Record;
+	uint64_t Sequence;
+	unsigned int Slot;
+	size_t ChannelLength, SourceLength, MessageLength, Space;
+
+	ChannelLength = strlen(Channel);
+	SourceLength = strlen(Source);
+	MessageLength = strlen(Message);
+	Space = sizeof(Record->Data) - 3;
+
+	if (ChannelLength > Space || SourceLength > Space - ChannelLength ||
+			MessageLength > Space - ChannelLength - SourceLength) {
+		g_Bouncer->Log("Line for channel %.50s is too long for the backlog file %s (%u bytes). Discarding it.",
+			Channel, m_Filename, (unsigned int)(ChannelLength + SourceLength + MessageLength));
+
+		return;
+	}
+
+	Sequence = m_Header->NextSequence;
+	Slot = (unsigned int)(Sequence % m_Header->Size);
+	Record = &m_Records[Slot];
+
+	Evict(Slot);
+
+	Record->Sequence = 0;
+	Record->Time = Time;
+	Record->ChannelLength = ChannelLength;
+	Record->SourceLength = SourceLength;
+	Record->MessageLength = MessageLength;
+	Record->Reserved = 0;
+
+	memcpy(Record->Data, Channel, ChannelLength + 1);
+	memcpy(Record->Data + ChannelLength + 1, Source, SourceLength);
+	Record->Data[ChannelLength + SourceLength + 1] = '\0';
+	memcpy(Record->Data + ChannelLength + SourceLength + 2, Message, MessageLength);
+	Record->Data[ChannelLength + SourceLength + MessageLength + 2] = '\0';
+
+	m_Header->NextSequence = Sequence + 1;
+
+	if (Append(GetChannel(Channel, true), Slot)) {
+		Record->Sequence = Sequence;
+	}
+}
+
+/**
+ * GetFilename
+ *
+ * Returns the filename of the backlog.
+ */
+const char *CBacklog::GetFilename(void) const {
+	return m_Filename;
+}
+
+/**
+ * SetSize
+ *
+ * Sets the maximum number of lines. Older lines are discarded if
+ * the backlog contains more lines.
+ *
+ * @param Size the maximum number of lines
+ */
+void CBacklog::SetSize(unsigned int Size) {
+	if (Size == 0) {
+		Size = 1;
+	}
+
+	m_DesiredSize = Size;
+	m_Failed = false;
+
+	if (m_Header != NULL && m_Header->Size != Size) {
+		Rebuild(Size);
+	}
+}
+
+/**
+ * GetSize
+ *
+ * Returns the maximum number of lines.
+ */
+unsigned int CBacklog::GetSize(void) const {
+	return m_DesiredSize;
+}
+
+/**
+ * AddLine
+ *
+ * Adds a line to a channel's backlog. The backlog file is created
+ * if necessary.
+ *
+ * @param Channel the channel
+ * @param Source the message source, i.e. nick!ident@host
+ * @param Message the message
+ */
+void CBacklog::AddLine(const char *Channel, const char *Source, const char *Message) {
+	if (m_Map == NULL) {
+		if (m_Failed || m_Filename == NULL) {
+			return;
+		}
+
+		if (!Create()) {
+			g_Bouncer->Log("Could not create backlog file %s.", m_Filename);
+
+			m_Failed = true;
+
+			return;
+		}
+	}
+
+	Insert(Channel, Source, Message, g_CurrentTime);
+}
+
+/**
+ * Play
+ *
+ * Sends a channel's backlog to a client. If Since is not 0 only lines
+ * which were received at or after that time are sent and nothing at
+ * all is sent if there are no such lines.
+ *
+ * @param Client the client
+ * @param Channel the channel
+ * @param Since the timestamp of the oldest line, or 0
+ */
+void CBacklog::Play(CClientConnection *Client, const char *Channel, time_t Since) {
+	backlogchannel_t *Index;
+	const backlogrecord_t *Record;
+	unsigned int First = 0, Last, Middle;
+
+	Index = (m_Map != NULL) ? m_Channels.Get(Channel) : NULL;
+
+	if (Index != NULL && Since != 0) {
+		Last = Index->Count;
+
+		while (First < Last) {
+			Middle = First + (Last - First) / 2;
+
+			if (m_Records[Index->Slots[(Index->Head + Middle) % Index->Alloc]].Time < Since) {
+				First = Middle + 1;
+			} else {
+				Last = Middle;
+			}
+		}
+	}
+
+	if (Since != 0 && (Index == NULL || First == Index->Count)) {
+		return;
+	}
+
+	Client->WriteLine(":-sBNC!bouncer@shroudbnc.info PRIVMSG %s :** Start of channel log.", Channel);
+
+	for (unsigned int i = First; Index != NULL && i < Index->Count; i++) {
+		Record = &m_Records[Index->Slots[(Index->Head + i) % Index->Alloc]];
+
+		Client->WriteLine(":%s PRIVMSG %s :(%s) %s", Record->Data + Record->ChannelLength + 1, Channel,
+			FormatBacklogTime((time_t)Record->Time), Record->Data + Record->ChannelLength + Record->SourceLength + 2);
+	}
+
+	Client->WriteLine(":-sBNC!bouncer@shroudbnc.info PRIVMSG %s :** End of channel log.", Channel);
+}
+
+/**
+ * Erase
+ *
+ * Erases a channel's backlog, or all channels' backlogs if Channel is NULL.
+ *
+ * @param Channel the channel, or NULL
+ */
+void CBacklog::Erase(const char *Channel) {
+	backlogchannel_t *Index;
+
+	if (m_Map == NULL) {
+		return;
+	}
+
+	if (Channel == NULL) {
+		for (unsigned int i = 0; i < m_Header->Size; i++) {
+			m_Records[i].Sequence = 0;
+		}
+
+		m_Channels.Clear();
+
+		return;
+	}
+
+	Index = m_Channels.Get(Channel);
+
+	if (Index == NULL) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < Index->Count; i++) {
+		m_Records[Index->Slots[(Index->Head + i) % Index->Alloc]].Sequence = 0;
+	}
+
+	m_Channels.Remove(Channel);
+}
@@ -0,0 +1,113 @@
+/*******************************************************************************
+ * shroudBNC - an object-oriented framework for IRC                            *
+ * Copyright (C) 2005-2007,2010 Gunnar Beutner                                 *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or               *
+ * modify it under the terms of the GNU General Public License                 *
+ * as published by the Free Software Foundation; either version 2              *
+ * of the License, or (at your option) any later version.                      *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU General Public License for more details.                                *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License           *
+ * along with this program; if not, write to the Free Software                 *
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA. *
+ *******************************************************************************/
+
+#ifndef BACKLOG_H
+#define BACKLOG_H
+
+#define BACKLOGMAGIC "sbncblg1" /**< identifies backlog files */
+#define BACKLOGRECORDSIZE 1024 /**< size of a backlog record (and the file header); an
+								IRC line is at most 510 bytes, so its channel, source
+								and message always fit into one record */
+
+/**
+ * backlogheader_s
+ *
+ * The header of a backlog file.
+ */
+typedef struct backlogheader_s {
+	char Magic[8]; /**< BACKLOGMAGIC */
+	uint32_t RecordSize; /**< BACKLOGRECORDSIZE */
+	uint32_t Size; /**< the number of records in the file */
+	uint64_t NextSequence; /**< the sequence number of the next record */
+} backlogheader_t;
+
+/**
+ * backlogrecord_s
+ *
+ * A line in the backlog file. The record is stored in the slot
+ * Sequence % Size.
+ */
+typedef struct backlogrecord_s {
+	uint64_t Sequence; /**< the record's sequence number, or 0 if the slot is unused */
+	int64_t Time; /**< the time this message was received */
+	uint16_t ChannelLength; /**< the length of the channel name */
+	uint16_t SourceLength; /**< the length of the message source */
+	uint16_t MessageLength; /**< the length of the message */
+	uint16_t Reserved;
+	char Data[BACKLOGRECORDSIZE - 24]; /**< "channel\0source\0message\0" */
+} backlogrecord_t;
+
+/**
+ * backlogchannel_s
+ *
+ * The records of a channel in chronological order, stored as
+ * a ring buffer of slot indices.
+ */
+typedef struct backlogchannel_s {
+	unsigned int *Slots; /**< the slot indices */
+	unsigned int Head; /**< the position of the oldest record in Slots */
+	unsigned int Count; /**< the number of records */
+	unsigned int Alloc; /**< the number of allocated items in Slots */
+} backlogchannel_t;
+
+/**
+ * CBacklog
+ *
+ * A user's channel backlog. The lines are kept in a ring of fixed-size
+ * records in a memory-mapped file so they survive restarts. The oldest
+ * line is overwritten once the file is full. The file is only created
+ * when the first line is added.
+ */
+class SBNCAPI CBacklog {
+	char *m_Filename; /**< the filename of the backlog */
+	unsigned int m_DesiredSize; /**< the number of records the file should have */
+	void *m_Map; /**< the mapped file, or NULL */
+	size_t m_MapLength; /**< the length of the mapping */
+	backlogheader_t *m_Header; /**< the file header */
+	backlogrecord_t *m_Records; /**< the records */
+	CHashtable<backlogchannel_t *, false> m_Channels; /**< the channels' records */
+	bool m_Failed; /**< whether the backlog file could not be created */
+
+	bool Map(int File, size_t Length);
+	bool Open(void);
+	bool Create(void);
+	void Close(void);
+	void LoadIndex(void);
+	void Rebuild(unsigned int Size);
+	backlogchannel_t *GetChannel(const char *Channel, bool Create);
+	bool Append(backlogchannel_t *Index, unsigned int Slot);
+	void Evict(unsigned int Slot);
+	void Insert(const char *Channel, const char *Source, const char *Message, time_t Time);
+public:
+#ifndef SWIG
+	CBacklog(const char *Filename, unsigned int Size);
+	virtual ~CBacklog(void);
+#endif /* SWIG */
+
+	const char *GetFilename(void) const;
+
+	void SetSize(unsigned int Size);
+	unsigned int GetSize(void) const;
+
+	void AddLine(const char *Channel, const char *Source, const char *Message);
+	void Play(CClientConnection *Client, const char *Channel, time_t Since);
+	void Erase(const char *Channel);
+};
+
+#endif /* BACKLOG_H */
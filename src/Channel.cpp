@@ -44,14 +44,13 @@ CChannel::CChannel(const char *Name, CIRCConnection *Owner) {
 
 	m_HasNames = false;
 	m_ModesValid = false;
+	memset(m_Modes, 0, sizeof(m_Modes));
 	m_KeepNicklist = true;
 
 	m_HasBans = false;
 	m_TempModes = NULL;
 
 	m_Banlist = new CBanlist(this);
-
-	m_BacklogCount = 0;
 }
 
 /**
@@ -66,16 +65,11 @@ CChannel::~CChannel() {
 	free(m_TopicNick);
 	free(m_TempModes);
 
-	for (int i = 0; i < m_Modes.GetLength(); i++) {
+	for (int i = 0; i < CHANMODESLOTS; i++) {
 		free(m_Modes[i].Parameter);
 	}
 
 	delete m_Banlist;
-
-	for (CListCursor<backlog_t> BacklogCursor(&m_Backlog); BacklogCursor.IsValid(); BacklogCursor.Proceed()) {
-		free(BacklogCursor->Source);
-		free(BacklogCursor->Message);
-	}
 }
 
 /**
@@ -103,7 +97,7 @@ RESULT<const char *> CChannel::GetChannelModes(void) {
 		RETURN(const char *, m_TempModes);
 	}
 
-	Size = m_Modes.GetLength() + 1024;
+	Size = CHANMODESLOTS + 1024;
 	m_TempModes = (char *)malloc(Size);
 
 	if (AllocFailed(m_TempModes)) {
@@ -112,7 +106,7 @@ RESULT<const char *> CChannel::GetChannelModes(void) {
 
 	strmcpy(m_TempModes, "+", Size);
 
-	for (i = 0; i < m_Modes.GetLength(); i++) {
+	for (i = 0; i < CHANMODESLOTS; i++) {
 		ModeType = GetOwner()->RequiresParameter(m_Modes[i].Mode);
 
 		if (m_Modes[i].Mode != '\0' && ModeType != 3) {
@@ -123,7 +117,7 @@ RESULT<const char *> CChannel::GetChannelModes(void) {
 		}
 	}
 
-	for (i = 0; i < m_Modes.GetLength(); i++) {
+	for (i = 0; i < CHANMODESLOTS; i++) {
 		ModeType = GetOwner()->RequiresParameter(m_Modes[i].Mode);
 
 		if (m_Modes[i].Mode != '\0' && m_Modes[i].Parameter && ModeType != 3) {
@@ -172,7 +166,7 @@ void CChannel::ParseModeChange(const char *Source, const char *Modes, int pargc,
 
 	const CVector<CModule *> *Modules = g_Bouncer->GetModules();
 
-	for (size_t i = 0; i < strlen(Modes); i++) {
+	for (size_t i = 0; Modes[i] != '\0'; i++) {
 		char Current = Modes[i];
 
 		if (Current == '+') {
@@ -244,12 +238,6 @@ void CChannel::ParseModeChange(const char *Source, const char *Modes, int pargc,
 		}
 
 		if (Flip) {
-			if (Slot != NULL) {
-				free(Slot->Parameter);
-			} else {
-				Slot = m_Modes.GetNew();
-			}
-
 			if (Slot == NULL) {
 				if (ModeType) {
 					p++;
@@ -258,6 +246,7 @@ void CChannel::ParseModeChange(const char *Source, const char *Modes, int pargc,
 				continue;
 			}
 
+			free(Slot->Parameter);
 			Slot->Mode = Current;
 
 			if (ModeType != 0 && p < pargc) {
@@ -283,18 +272,20 @@ void CChannel::ParseModeChange(const char *Source, const char *Modes, int pargc,
 /**
  * FindSlot
  *
- * Returns the slot for a channelmode.
+ * Returns the slot for a channelmode, or NULL if the mode cannot be stored.
+ * Lower-case modes come first so that GetChannelModes() lists them in the
+ * usual order.
  *
  * @param Mode the mode
  */
 chanmode_t *CChannel::FindSlot(char Mode) {
-	for (int i = 0; i < m_Modes.GetLength(); i++) {
-		if (m_Modes[i].Mode == Mode) {
-			return &m_Modes[i];
-		}
+	if (Mode >= 'a' && Mode <= 'z') {
+		return &m_Modes[Mode - 'a'];
+	} else if (Mode >= 'A' && Mode <= 'Z') {
+		return &m_Modes[Mode - 'A' + 26];
+	} else {
+		return NULL;
 	}
-
-	return NULL;
 }
 
 /**
@@ -442,6 +433,11 @@ void CChannel::AddUser(const char *Nick, const char *ModeChars) {
 
 	NickObj = new CNick(Nick, this);
 
+	if (NickObj != NULL && NickObj->GetNick() == NULL) {
+		delete NickObj;
+		NickObj = NULL;
+	}
+
 	if (AllocFailed(NickObj)) {
 		m_Nicks.Clear();
 
@@ -527,11 +523,11 @@ const CHashtable<CNick *, false> *CChannel::GetNames(void) const {
  * Clears all modes for the channel.
  */
 void CChannel::ClearModes(void) {
-	for (int i = 0; i < m_Modes.GetLength(); i++) {
+	for (int i = 0; i < CHANMODESLOTS; i++) {
 		free(m_Modes[i].Parameter);
 	}
 
-	m_Modes.Clear();
+	memset(m_Modes, 0, sizeof(m_Modes));
 }
 
 /**
@@ -581,6 +577,74 @@ bool CChannel::HasBans(void) const {
 	return m_HasBans;
 }
 
+/**
+ * SendTopicReply
+ *
+ * Sends the channel's topic (332 and 333 replies) to a client. The topic
+ * is requested from the IRC server if it is not known.
+ *
+ * @param Client the client
+ */
+void CChannel::SendTopicReply(CClientConnection *Client) {
+	CIRCConnection *IRC = GetOwner();
+
+	if (HasTopic() == 0) {
+		IRC->WriteLine("TOPIC %s", m_Name);
+
+		return;
+	}
+
+	if (m_Topic != NULL && *m_Topic != '\0') {
+		Client->WriteLine(":%s 332 %s %s :%s", IRC->GetServer(), IRC->GetCurrentNick(), m_Name, m_Topic);
+		Client->WriteLine(":%s 333 %s %s %s %d", IRC->GetServer(), IRC->GetCurrentNick(), m_Name, m_TopicNick, m_TopicStamp);
+	}
+}
+
+/**
+ * SendNamesReply
+ *
+ * Sends the channel's nicklist (353 and 366 replies) to a client. The
+ * nicklist is requested from the IRC server if it is not known.
+ *
+ * @param Client the client
+ */
+void CChannel::SendNamesReply(CClientConnection *Client) {
+	CIRCConnection *IRC = GetOwner();
+
+	if (!HasNames()) {
+		IRC->WriteLine("NAMES %s", m_Name);
+
+		return;
+	}
+
+	CReplyBuilder Reply(Client, ":%s 353 %s = %s :", IRC->GetServer(), IRC->GetCurrentNick(), m_Name);
+
+	int a = 0;
+
+	while (hash_t<CNick *> *NickHash = m_Nicks.Iterate(a++)) {
+		CNick *NickObj = NickHash->Value;
+		const char *Nick = NickObj->GetNick();
+
+		if (Nick == NULL) {
+			continue;
+		}
+
+		if (Client->GetNamesXSupport()) {
+			Reply.AppendItem(NickObj->GetPrefixes(), Nick);
+		} else {
+			char Prefix[2] = { NickObj->GetHighestPrefix(), '\0' };
+
+			Reply.AppendItem(Prefix, Nick);
+		}
+	}
+
+	if (Reply.HasText()) {
+		Reply.Send();
+	}
+
+	Client->WriteLine(":%s 366 %s %s :End of /NAMES list.", IRC->GetServer(), IRC->GetCurrentNick(), m_Name);
+}
+
 /**
  * SendWhoReply
  *
@@ -591,9 +655,7 @@ bool CChannel::HasBans(void) const {
  * @param Simulate determines whether to simulate the operation
  */
 bool CChannel::SendWhoReply(CClientConnection *Client, bool Simulate) const {
-	char CopyIdent[50];
-	char *Ident, *Host, *Site;
-	const char *Server, *Realname, *SiteTemp;
+	const char *Site, *Host, *Server, *Realname;
 
 	if (Client == NULL) {
 		return true;
@@ -603,29 +665,26 @@ bool CChannel::SendWhoReply(CClientConnection *Client, bool Simulate) const {
 		return false;
 	}
 
+	CReplyBuilder Reply(Client, ":%s 352 %s %s ", GetOwner()->GetServer(), GetOwner()->GetCurrentNick(), m_Name);
+
 	int a = 0;
 
 	while (hash_t<CNick *> *NickHash = GetNames()->Iterate(a++)) {
 		CNick *NickObj = NickHash->Value;
 
-		if ((SiteTemp = NickObj->GetSite()) == NULL) {
+		if ((Site = NickObj->GetSite()) == NULL) {
 			return false;
 		}
 
-		Site = const_cast<char *>(SiteTemp);
 		Host = strchr(Site, '@');
 
 		if (Host == NULL) {
-			free(Site);
-
 			return false;
 		}
 
-		strmcpy(CopyIdent, Site, min((size_t)(Host - Site + 1), sizeof(CopyIdent)));
-
-		Ident = CopyIdent;
-
-		Host++;
+		if (Simulate) {
+			continue;
+		}
 
 		Server = NickObj->GetServer();
 		if (Server == NULL) {
@@ -637,10 +696,16 @@ bool CChannel::SendWhoReply(CClientConnection *Client, bool Simulate) const {
 			Realname = "3 Unknown Client";
 		}
 
-		if (!Simulate) {
-			Client->WriteLine(":%s 352 %s %s %s %s %s %s H :%s", GetOwner()->GetServer(), GetOwner()->GetCurrentNick(),
-				m_Name, Ident, Host, Server, NickObj->GetNick(), Realname);
-		}
+		Reply.Append(Site, Host - Site);
+		Reply.Append(" ");
+		Reply.Append(Host + 1);
+		Reply.Append(" ");
+		Reply.Append(Server);
+		Reply.Append(" ");
+		Reply.Append(NickObj->GetNick());
+		Reply.Append(" H :");
+		Reply.Append(Realname);
+		Reply.Send();
 	}
 
 	if (!Simulate) {
@@ -698,70 +763,23 @@ int ChannelNameCompare(const void *p1, const void *p2) {
  *
  * Adds a line to the channel's backlog.
  *
- * @param Line the line
+ * @param Source the message source, i.e. nick!ident@host
+ * @param Message the message
  */
 void CChannel::AddBacklogLine(const char *Source, const char *Message) {
-	backlog_t Line;
-	char *dupSource, *dupMessage;
-
-	dupSource = strdup(Source);
-
-	if (AllocFailed(dupSource)) {
-		return;
-	}
-
-	dupMessage = strdup(Message);
-
-	if (AllocFailed(dupMessage)) {
-		free(dupSource);
-
-		return;
-	}
-
-	m_BacklogCount++;
-
-	if (m_BacklogCount > 50) {
-		link_t<backlog_t> *Head;
-
-		Head = m_Backlog.GetHead();
-
-		free(Head->Value.Source);
-		free(Head->Value.Message);
-
-		m_Backlog.Remove(Head);
-	}
-
-	Line.Time = g_CurrentTime;
-	Line.Source = dupSource;
-	Line.Message = dupMessage;
-
-	m_Backlog.Insert(Line);
+	GetUser()->GetBacklog()->AddLine(m_Name, Source, Message);
 }
 
 /**
  * PlayBacklog
  *
  * Plays back the backlog.
+ *
+ * @param Client the client
+ * @param Since the timestamp of the oldest line which is sent, or 0
  */
-void CChannel::PlayBacklog(CClientConnection *Client) {
-	char strMessageTime[100];
-	tm MessageTm;
-
-	Client->WriteLine(":-sBNC!bouncer@shroudbnc.info PRIVMSG %s :** Start of channel log.", m_Name);
-
-	for (CListCursor<backlog_t> BacklogCursor(&m_Backlog); BacklogCursor.IsValid(); BacklogCursor.Proceed()) {
-		MessageTm = *localtime(&(BacklogCursor->Time));
-
-#ifdef _WIN32
-		strftime(strMessageTime, sizeof(strMessageTime), "%#c" , &MessageTm);
-#else
-		strftime(strMessageTime, sizeof(strMessageTime), "%a %B %d %Y %H:%M:%S" , &MessageTm);
-#endif
-
-		Client->WriteLine(":%s PRIVMSG %s :(%s) %s", BacklogCursor->Source, m_Name, strMessageTime, BacklogCursor->Message);
-	}
-
-	Client->WriteLine(":-sBNC!bouncer@shroudbnc.info PRIVMSG %s :** End of channel log.", m_Name);
+void CChannel::PlayBacklog(CClientConnection *Client, time_t Since) {
+	GetUser()->GetBacklog()->Play(Client, m_Name, Since);
 }
 
 /**
@@ -770,14 +788,5 @@ void CChannel::PlayBacklog(CClientConnection *Client) {
  * Clears the backlog.
  */
 void CChannel::EraseBacklog(void) {
-	link_t<backlog_t> *Head;
-
-	while ((Head = m_Backlog.GetHead()) != NULL) {
-		free(Head->Value.Source);
-		free(Head->Value.Message);
-
-		m_Backlog.Remove(Head);
-	}
-
-	m_BacklogCount = 0;
+	GetUser()->GetBacklog()->Erase(m_Name);
 }
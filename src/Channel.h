@@ -20,6 +20,11 @@
 #ifndef CHANNEL_H
 #define CHANNEL_H
 
+/**
+ * The number of slots in a channel's mode table (one for each letter).
+ */
+#define CHANMODESLOTS 52
+
 /**
  * chanmode_s
  *
@@ -30,12 +35,6 @@ typedef struct chanmode_s {
 	char *Parameter; /**< the associated parameter, or NULL if there is none */
 } chanmode_t;
 
-typedef struct backlog_s {
-	time_t Time; /**< the time this message was received */
-	char *Source; /**< message source, i.e. nick!ident@host */
-	char *Message; /**< the message */
-} backlog_t;
-
 /* Forward declaration of some required classes */
 class CNick;
 class CBanlist;
@@ -57,7 +56,7 @@ private:
 	time_t m_Creation; /**< the time when the channel was created */
 	time_t m_Timestamp; /**< when the user joined the channel */
 
-	CVector<chanmode_t> m_Modes; /**< the channel modes */
+	chanmode_t m_Modes[CHANMODESLOTS]; /**< the channel modes, indexed by mode character */
 	bool m_ModesValid; /**< indicates whether the channelmodes are known */
 	char *m_TempModes; /**< string-representation of the channel modes, used
 							by GetChannelModes() */
@@ -74,10 +73,7 @@ private:
 	CBanlist *m_Banlist; /**< a list of bans for this channel */
 	bool m_HasBans; /**< indicates whether the banlist is known */
 
-	CList<backlog_t> m_Backlog; /** the backlog for this channel */
-	int m_BacklogCount; /** the number of backlog lines we've stored for this channel */
 
-	chanmode_t *AllocSlot(void);
 	chanmode_t *FindSlot(char Mode);
 
 public:
@@ -122,12 +118,14 @@ public:
 	void SetHasBans(void);
 	bool HasBans(void) const;
 
+	void SendTopicReply(CClientConnection *Client);
+	void SendNamesReply(CClientConnection *Client);
 	bool SendWhoReply(CClientConnection *Client, bool Simulate) const;
 
 	time_t GetJoinTimestamp(void) const;
 
 	void AddBacklogLine(const char *Source, const char *Message);
-	void PlayBacklog(CClientConnection *Client);
+	void PlayBacklog(CClientConnection *Client, time_t Since = 0);
 	void EraseBacklog(void);
 };
 
@@ -109,6 +109,149 @@ CClientConnection::~CClientConnection() {
 	delete m_DestroyClientTimer;
 }
 
+/**
+ * BncCommand
+ *
+ * Identifiers for the bouncer commands which are processed by ProcessBncCommand.
+ */
+enum BncCommand {
+	Bnc_Unknown = 0,
+	Bnc_Help,
+	Bnc_Lsmod,
+	Bnc_Insmod,
+	Bnc_Rmmod,
+	Bnc_GlobalUnset,
+	Bnc_GlobalSet,
+	Bnc_Unset,
+	Bnc_Set,
+	Bnc_SaveCert,
+	Bnc_ShowCert,
+	Bnc_DelCert,
+	Bnc_Die,
+	Bnc_AddUser,
+	Bnc_DelUser,
+	Bnc_Simul,
+	Bnc_Direct,
+	Bnc_Broadcast,
+	Bnc_Kill,
+	Bnc_Disconnect,
+	Bnc_Jump,
+	Bnc_Status,
+	Bnc_Impulse,
+	Bnc_Who,
+	Bnc_AddListener,
+	Bnc_DelListener,
+	Bnc_Listeners,
+	Bnc_Read,
+	Bnc_Erase,
+	Bnc_PlayMainLog,
+	Bnc_EraseMainLog,
+	Bnc_Admin,
+	Bnc_Unadmin,
+	Bnc_Suspend,
+	Bnc_Unsuspend,
+	Bnc_ResetPass,
+	Bnc_PartAll,
+	Bnc_Backlog,
+	Bnc_EraseBacklog
+};
+
+/**
+ * The bouncer commands which are processed by ProcessBncCommand.
+ */
+static const dispatchentry_t BncCommands[] = {
+	{ "help", Bnc_Help },
+	{ "lsmod", Bnc_Lsmod },
+	{ "insmod", Bnc_Insmod },
+	{ "rmmod", Bnc_Rmmod },
+	{ "globalunset", Bnc_GlobalUnset },
+	{ "globalset", Bnc_GlobalSet },
+	{ "unset", Bnc_Unset },
+	{ "set", Bnc_Set },
+#ifdef HAVE_LIBSSL
+	{ "savecert", Bnc_SaveCert },
+	{ "showcert", Bnc_ShowCert },
+	{ "delcert", Bnc_DelCert },
+#endif /* HAVE_LIBSSL */
+	{ "die", Bnc_Die },
+	{ "adduser", Bnc_AddUser },
+	{ "deluser", Bnc_DelUser },
+	{ "simul", Bnc_Simul },
+	{ "direct", Bnc_Direct },
+	{ "broadcast", Bnc_Broadcast },
+	{ "kill", Bnc_Kill },
+	{ "disconnect", Bnc_Disconnect },
+	{ "jump", Bnc_Jump },
+	{ "status", Bnc_Status },
+	{ "impulse", Bnc_Impulse },
+	{ "who", Bnc_Who },
+	{ "addlistener", Bnc_AddListener },
+	{ "dellistener", Bnc_DelListener },
+	{ "listeners", Bnc_Listeners },
+	{ "read", Bnc_Read },
+	{ "erase", Bnc_Erase },
+	{ "playmainlog", Bnc_PlayMainLog },
+	{ "erasemainlog", Bnc_EraseMainLog },
+	{ "admin", Bnc_Admin },
+	{ "unadmin", Bnc_Unadmin },
+	{ "suspend", Bnc_Suspend },
+	{ "unsuspend", Bnc_Unsuspend },
+	{ "resetpass", Bnc_ResetPass },
+	{ "partall", Bnc_PartAll },
+	{ "backlog", Bnc_Backlog },
+	{ "erasebacklog", Bnc_EraseBacklog },
+	{ NULL, Bnc_Unknown }
+};
+
+/**
+ * FormatSSLHandshakes
+ *
+ * Formats an SSL handshake histogram for the "status" command. Empty
+ * buckets are left out.
+ *
+ * @param Title the title of the histogram
+ * @param Buckets the histogram's buckets
+ */
+static char *FormatSSLHandshakes(const char *Title, const unsigned int *Buckets) {
+	unsigned int Total = 0, Limit = 250;
+	char *Out, *Previous;
+	int i, rc;
+
+	for (i = 0; i < SSLHANDSHAKEBUCKETS; i++) {
+		Total += Buckets[i];
+	}
+
+	rc = asprintf(&Out, "%s: %u", Title, Total);
+
+	if (RcFailed(rc)) {
+		return NULL;
+	}
+
+	for (i = 0; i < SSLHANDSHAKEBUCKETS; i++, Limit <<= 1) {
+		unsigned int Label;
+
+		if (Buckets[i] == 0) {
+			continue;
+		}
+
+		// the last bucket holds everything above the previous bucket's limit
+		Label = (i < SSLHANDSHAKEBUCKETS - 1) ? Limit : Limit >> 1;
+
+		Previous = Out;
+
+		rc = asprintf(&Out, "%s, %s%u%s: %u", Previous, (i < SSLHANDSHAKEBUCKETS - 1) ? "<" : ">=",
+			(Label < 1000) ? Label : Label / 1000, (Label < 1000) ? "us" : "ms", Buckets[i]);
+
+		free(Previous);
+
+		if (RcFailed(rc)) {
+			return NULL;
+		}
+	}
+
+	return Out;
+}
+
 /**
  * ProcessBncCommand
  *
@@ -123,7 +266,8 @@ bool CClientConnection::ProcessBncCommand(const char *Subcommand, int argc, cons
 	char *Out;
 	const CVector<CModule *> *Modules;
 	bool latchedRetVal = true;
-	int rc;
+	int rc, Command;
+	static CDispatchTable Commands(BncCommands);
 
 	Modules = g_Bouncer->GetModules();
 
@@ -153,7 +297,9 @@ bool CClientConnection::ProcessBncCommand(const char *Subcommand, int argc, cons
 		return false;
 	}
 
-	if (strcasecmp(Subcommand, "help") == 0) {
+	Command = Commands.Find(Subcommand);
+
+	if (Command == Bnc_Help) {
 		if (argc <= 1) {
 			SENDUSER("--The following commands are available to you--");
 			SENDUSER("--Used as '/sbnc <command>', or '/msg -sbnc <command>'");
@@ -263,7 +409,7 @@ bool CClientConnection::ProcessBncCommand(const char *Subcommand, int argc, cons
 		}
 	}
 
-	if (strcasecmp(Subcommand, "help") == 0) {
+	if (Command == Bnc_Help) {
 		if (argc <= 1) {
 			// show help
 			hash_t<command_t *> *Hash;
@@ -367,1140 +513,1386 @@ bool CClientConnection::ProcessBncCommand(const char *Subcommand, int argc, cons
 		return false;
 	}
 
-	if (strcasecmp(Subcommand, "lsmod") == 0 && GetOwner()->IsAdmin()) {
-		for (int i = 0; i < Modules->GetLength(); i++) {
-			rc = asprintf(&Out, "%d: %s", i + 1, (*Modules)[i]->GetFilename());
-
-			if (RcFailed(rc)) {
-				return false;
+	switch (Command) {
+		case Bnc_Lsmod: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
 			}
 
-			SENDUSER(Out);
-			free(Out);
-		}
-
-		SENDUSER("End of MODULES.");
+			for (int i = 0; i < Modules->GetLength(); i++) {
+				rc = asprintf(&Out, "%d: %s", i + 1, (*Modules)[i]->GetFilename());
 
-		return false;
-	} else if (strcasecmp(Subcommand, "insmod") == 0 && GetOwner()->IsAdmin()) {
-		if (argc < 2) {
-			SENDUSER("Syntax: INSMOD module-path");
-			return false;
-		}
-
-		RESULT<CModule *> ModuleResult = g_Bouncer->LoadModule(argv[1]);
-
-		if (!IsError(ModuleResult)) {
-			SENDUSER("Module was successfully loaded.");
-		} else {
-			rc = asprintf(&Out, "Module could not be loaded: %s", GETDESCRIPTION(ModuleResult));
-
-			if (RcFailed(rc)) {
-				SENDUSER("Module could not be loaded.");
+				if (RcFailed(rc)) {
+					return false;
+				}
 
-				return false;
+				SENDUSER(Out);
+				free(Out);
 			}
 
-			SENDUSER(Out);
-
-			free(Out);
-		}
+			SENDUSER("End of MODULES.");
 
-		return false;
-	} else if (strcasecmp(Subcommand, "rmmod") == 0 && GetOwner()->IsAdmin()) {
-		if (argc < 2) {
-			SENDUSER("Syntax: RMMOD module-id");
 			return false;
 		}
 
-		int Index = atoi(argv[1]);
-
-		if (Index == 0 || Index > Modules->GetLength()) {
-			SENDUSER("There is no such module.");
-		} else {
-			CModule *Module = (*Modules)[Index - 1];
+		case Bnc_Insmod: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
+			}
 
-			if (g_Bouncer->UnloadModule(Module)) {
-				SENDUSER("Done.");
-			} else {
-				SENDUSER("Failed to unload this module.");
+			if (argc < 2) {
+				SENDUSER("Syntax: INSMOD module-path");
+				return false;
 			}
-		}
 
-		return false;
-	} else if (strcasecmp(Subcommand, "globalunset") == 0 && GetOwner()->IsAdmin()) {
-		if (argc < 2) {
-			SENDUSER("Syntax: globalunset option");
-		} else {
-			if (NoticeUser) {
-				rc = asprintf(&Out, "SBNC GLOBALSET %s :", argv[1]);
+			RESULT<CModule *> ModuleResult = g_Bouncer->LoadModule(argv[1]);
+
+			if (!IsError(ModuleResult)) {
+				SENDUSER("Module was successfully loaded.");
 			} else {
-				rc = asprintf(&Out, "PRIVMSG -sBNC :GLOBALSET %s :", argv[1]);
-			}
+				rc = asprintf(&Out, "Module could not be loaded: %s", GETDESCRIPTION(ModuleResult));
 
-			if (!RcFailed(rc)) {
-				ParseLine(Out);
-				free(Out);
-			}
-		}
+				if (RcFailed(rc)) {
+					SENDUSER("Module could not be loaded.");
 
-		return false;
-	} else if (strcasecmp(Subcommand, "globalset") == 0 && GetOwner()->IsAdmin()) {
-		if (argc < 3) {
-			SENDUSER("Configurable settings:");
-			SENDUSER("--");
+					return false;
+				}
 
-			rc = asprintf(&Out, "defaultvhost - %s", g_Bouncer->GetDefaultVHost() ? g_Bouncer->GetDefaultVHost() : "Not set");
-			if (!RcFailed(rc)) {
 				SENDUSER(Out);
-				free(Out);
-			}
 
-			rc = asprintf(&Out, "motd - %s", g_Bouncer->GetMotd() ? g_Bouncer->GetMotd() : "Not set");
-			if (!RcFailed(rc)) {
-				SENDUSER(Out);
 				free(Out);
 			}
-		} else {
-			if (strcasecmp(argv[1], "defaultvhost") == 0) {
-				g_Bouncer->SetDefaultVHost(argv[2]);
-			} else if (strcasecmp(argv[1], "motd") == 0) {
-				ArgRejoinArray(argv, 2);
-				g_Bouncer->SetMotd(argv[2]);
-			} else {
-				SENDUSER("Unknown setting.");
-				return false;
-			}
 
-			SENDUSER("Done.");
+			return false;
 		}
 
-		return false;
-	} else if (strcasecmp(Subcommand, "unset") == 0) {
-		if (argc < 2) {
-			SENDUSER("Syntax: unset option");
-		} else {
-			if (NoticeUser) {
-				rc = asprintf(&Out, "SBNC SET %s :", argv[1]);
-			} else {
-				rc = asprintf(&Out, "PRIVMSG -sBNC :SET %s :", argv[1]);
+		case Bnc_Rmmod: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
 			}
 
-			if (!RcFailed(rc)) {
-				ParseLine(Out);
-				free(Out);
+			if (argc < 2) {
+				SENDUSER("Syntax: RMMOD module-id");
+				return false;
 			}
-		}
 
-		return false;
-	} else if (strcasecmp(Subcommand, "set") == 0) {
-		if (argc < 3) {
-			SENDUSER("Configurable settings:");
-			SENDUSER("--");
+			int Index = atoi(argv[1]);
 
-			SENDUSER("password - Set");
+			if (Index == 0 || Index > Modules->GetLength()) {
+				SENDUSER("There is no such module.");
+			} else {
+				CModule *Module = (*Modules)[Index - 1];
 
-			rc = asprintf(&Out, "vhost - %s", GetOwner()->GetVHost() ? GetOwner()->GetVHost() : "Default");
-			if (!RcFailed(rc)) {
-				SENDUSER(Out);
-				free(Out);
+				if (g_Bouncer->UnloadModule(Module)) {
+					SENDUSER("Done.");
+				} else {
+					SENDUSER("Failed to unload this module.");
+				}
 			}
 
-			if (GetOwner()->GetServer() != NULL) {
-				rc = asprintf(&Out, "server - [%s]:%d", GetOwner()->GetServer(), GetOwner()->GetPort());
-			} else {
-				Out = strdup("server - Not set");
+			return false;
+		}
 
-				rc = (Out == NULL) ? -1 : 0;
-			}
-			if (!RcFailed(rc)) {
-				SENDUSER(Out);
-				free(Out);
+		case Bnc_GlobalUnset: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
 			}
 
-			rc = asprintf(&Out, "serverpass - %s", GetOwner()->GetServerPassword() ? "Set" : "Not set");
-			if (!RcFailed(rc)) {
-				SENDUSER(Out);
-				free(Out);
-			}
+			if (argc < 2) {
+				SENDUSER("Syntax: globalunset option");
+			} else {
+				if (NoticeUser) {
+					rc = asprintf(&Out, "SBNC GLOBALSET %s :", argv[1]);
+				} else {
+					rc = asprintf(&Out, "PRIVMSG -sBNC :GLOBALSET %s :", argv[1]);
+				}
 
-			rc = asprintf(&Out, "realname - %s", GetOwner()->GetRealname());
-			if (!RcFailed(rc)) {
-				SENDUSER(Out);
-				free(Out);
+				if (!RcFailed(rc)) {
+					ParseLine(Out);
+					free(Out);
+				}
 			}
 
-			rc = asprintf(&Out, "awaynick - %s", GetOwner()->GetAwayNick() ? GetOwner()->GetAwayNick() : "Not set");
-			if (!RcFailed(rc)) {
-				SENDUSER(Out);
-				free(Out);
-			}
+			return false;
+		}
 
-			rc = asprintf(&Out, "away - %s", GetOwner()->GetAwayText() ? GetOwner()->GetAwayText() : "Not set");
-			if (!RcFailed(rc)) {
-				SENDUSER(Out);
-				free(Out);
+		case Bnc_GlobalSet: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
 			}
 
-			rc = asprintf(&Out, "awaymessage - %s", GetOwner()->GetAwayMessage() ? GetOwner()->GetAwayMessage() : "Not set");
-			if (!RcFailed(rc)) {
-				SENDUSER(Out);
-				free(Out);
-			}
+			if (argc < 3) {
+				SENDUSER("Configurable settings:");
+				SENDUSER("--");
 
-			rc = asprintf(&Out, "usequitasaway - %s", GetOwner()->GetUseQuitReason() ? "On" : "Off");
-			if (!RcFailed(rc)) {
-				SENDUSER(Out);
-				free(Out);
-			}
+				rc = asprintf(&Out, "defaultvhost - %s", g_Bouncer->GetDefaultVHost() ? g_Bouncer->GetDefaultVHost() : "Not set");
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
+				}
 
-#ifdef HAVE_LIBSSL
-			rc = asprintf(&Out, "ssl - %s", GetOwner()->GetSSL() ? "On" : "Off");
-			if (!RcFailed(rc)) {
-				SENDUSER(Out);
-				free(Out);
-			}
-#endif /* HAVE_LIBSSL */
+				rc = asprintf(&Out, "motd - %s", g_Bouncer->GetMotd() ? g_Bouncer->GetMotd() : "Not set");
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
+				}
 
-			const char *AutoModes = GetOwner()->GetAutoModes();
-			bool ValidAutoModes = AutoModes && *AutoModes;
-			const char *DropModes = GetOwner()->GetDropModes();
-			bool ValidDropModes = DropModes && *DropModes;
+				rc = asprintf(&Out, "backlogsize - %u", g_Bouncer->GetBacklogSize());
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
+				}
+			} else {
+				if (strcasecmp(argv[1], "defaultvhost") == 0) {
+					g_Bouncer->SetDefaultVHost(argv[2]);
+				} else if (strcasecmp(argv[1], "motd") == 0) {
+					ArgRejoinArray(argv, 2);
+					g_Bouncer->SetMotd(argv[2]);
+				} else if (strcasecmp(argv[1], "backlogsize") == 0) {
+					if (atoi(argv[2]) < 0) {
+						SENDUSER("The backlog size must not be negative.");
 
-			const char *AutoModesPrefix = "+", *DropModesPrefix = "-";
+						return false;
+					}
 
-			if (!ValidAutoModes || (AutoModes && (*AutoModes == '+' || *AutoModes == '-'))) {
-				AutoModesPrefix = "";
-			}
+					g_Bouncer->SetBacklogSize(atoi(argv[2]));
+				} else {
+					SENDUSER("Unknown setting.");
+					return false;
+				}
 
-			if (!ValidDropModes || (DropModes && (*DropModes == '-' || *DropModes == '+'))) {
-				DropModesPrefix = "";
+				SENDUSER("Done.");
 			}
 
-			rc = asprintf(&Out, "automodes - %s%s", AutoModesPrefix, ValidAutoModes ? AutoModes : "Not set");
-			if (!RcFailed(rc)) {
-				SENDUSER(Out);
-				free(Out);
-			}
+			return false;
+		}
 
-			rc = asprintf(&Out, "dropmodes - %s%s", DropModesPrefix, ValidDropModes ? DropModes : "Not set");
-			if (!RcFailed(rc)) {
-				SENDUSER(Out);
-				free(Out);
-			}
+		case Bnc_Unset: {
+			if (argc < 2) {
+				SENDUSER("Syntax: unset option");
+			} else {
+				if (NoticeUser) {
+					rc = asprintf(&Out, "SBNC SET %s :", argv[1]);
+				} else {
+					rc = asprintf(&Out, "PRIVMSG -sBNC :SET %s :", argv[1]);
+				}
 
-			if (GetOwner()->IsAdmin()) {
-				rc = asprintf(&Out, "sysnotices - %s", GetOwner()->GetSystemNotices() ? "On" : "Off");
 				if (!RcFailed(rc)) {
-					SENDUSER(Out);
+					ParseLine(Out);
 					free(Out);
 				}
 			}
 
-			const char *AutoBacklog = GetOwner()->GetAutoBacklog();
-
-			rc = asprintf(&Out, "autobacklog - %s", GetOwner()->GetAutoBacklog() ? GetOwner()->GetAutoBacklog() : "Off");
-			if (!RcFailed(rc)) {
-				SENDUSER(Out);
-				free(Out);
-			}
-		} else {
-			if (strcasecmp(argv[1], "server") == 0) {
-				if (argc > 3) {
-					GetOwner()->UnmarkQuitted();
-
-					GetOwner()->SetPort(atoi(argv[3]));
-					GetOwner()->SetServer(argv[2]);
-				} else if (argc > 2) {
-					GetOwner()->UnmarkQuitted();
-
-					// the order of the SetServer/SetPort had some importance
-					// i wonder what it was... hm
-					if (strlen(argv[2]) == 0) {
-						GetOwner()->SetServer(NULL);
-						GetOwner()->SetPort(6667);
-					} else {
-						char *ServerStr = NULL;
-						const char *PortStr = strchr(argv[2], ':');
-						unsigned int Port = 6667;
-
-						// Check whether there's a second colon and ignore 'port' if there
-						// isn't because it's most likely an IPv6 address instead.
-						if (PortStr != NULL && strrchr(argv[2], ':') == PortStr) {
-							PortStr++;
-
-							Port = atoi(PortStr);
+			return false;
+		}
 
-							if (Port == 0) {
-								Port = 6667;
-							}
+		case Bnc_Set: {
+			if (argc < 3) {
+				SENDUSER("Configurable settings:");
+				SENDUSER("--");
 
-							ServerStr = strdup(argv[2]);
+				SENDUSER("password - Set");
 
-							if (ServerStr != NULL) {
-								ServerStr[PortStr - argv[2] - 1] = '\0';
-							}
-						}
+				rc = asprintf(&Out, "vhost - %s", GetOwner()->GetVHost() ? GetOwner()->GetVHost() : "Default");
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
+				}
 
-						GetOwner()->SetPort(Port);
-						GetOwner()->SetServer((ServerStr != NULL) ? ServerStr : argv[2]);
-						
-						free(ServerStr);
-					}
+				if (GetOwner()->GetServer() != NULL) {
+					rc = asprintf(&Out, "server - [%s]:%d", GetOwner()->GetServer(), GetOwner()->GetPort());
 				} else {
-					SENDUSER("Syntax: /sbnc set server host port");
+					Out = strdup("server - Not set");
 
-					return false;
+					rc = (Out == NULL) ? -1 : 0;
 				}
-			} else if (strcasecmp(argv[1], "realname") == 0) {
-				ArgRejoinArray(argv, 2);
-				GetOwner()->SetRealname(argv[2]);
-			} else if (strcasecmp(argv[1], "awaynick") == 0) {
-				GetOwner()->SetAwayNick(argv[2]);
-			} else if (strcasecmp(argv[1], "away") == 0) {
-				ArgRejoinArray(argv, 2);
-				GetOwner()->SetAwayText(argv[2]);
-			} else if (strcasecmp(argv[1], "awaymessage") == 0) {
-				ArgRejoinArray(argv, 2);
-				GetOwner()->SetAwayMessage(argv[2]);
-			} else if (strcasecmp(argv[1], "vhost") == 0) {
-				GetOwner()->SetVHost(argv[2]);
-			} else if (strcasecmp(argv[1], "serverpass") == 0) {
-				GetOwner()->SetServerPassword(argv[2]);
-			} else if (strcasecmp(argv[1], "password") == 0) {
-				if (strlen(argv[2]) < 6 || argc > 3 || strchr(argv[2], ':') != NULL) {
-					SENDUSER("Your password is too short or contains invalid characters.");
-					return false;
-				} else {
-					GetOwner()->SetPassword(argv[2]);
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
 				}
-			} else if (strcasecmp(argv[1], "usequitasaway") == 0) {
-				if (strcasecmp(argv[2], "on") == 0) {
-					GetOwner()->SetUseQuitReason(true);
-				} else if (strcasecmp(argv[2], "off") == 0) {
-					GetOwner()->SetUseQuitReason(false);
-				} else {
-					SENDUSER("Value must be either 'on' or 'off'.");
 
-					return false;
+				rc = asprintf(&Out, "serverpass - %s", GetOwner()->GetServerPassword() ? "Set" : "Not set");
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
 				}
-			} else if (strcasecmp(argv[1], "automodes") == 0) {
-				ArgRejoinArray(argv, 2);
-				GetOwner()->SetAutoModes(argv[2]);
-			} else if (strcasecmp(argv[1], "dropmodes") == 0) {
-				ArgRejoinArray(argv, 2);
-				GetOwner()->SetDropModes(argv[2]);
-			} else if (strcasecmp(argv[1], "ssl") == 0) {
-				if (strcasecmp(argv[2], "on") == 0) {
-					GetOwner()->SetSSL(true);
-				} else if (strcasecmp(argv[2], "off") == 0) {
-					GetOwner()->SetSSL(false);
-				} else {
-					SENDUSER("Value must be either 'on' or 'off'.");
 
-					return false;
+				rc = asprintf(&Out, "realname - %s", GetOwner()->GetRealname());
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
 				}
-			} else if (strcasecmp(argv[1], "sysnotices") == 0) {
-				if (strcasecmp(argv[2], "on") == 0) {
-					GetOwner()->SetSystemNotices(true);
-				} else if (strcasecmp(argv[2], "off") == 0) {
-					GetOwner()->SetSystemNotices(false);
-				} else {
-					SENDUSER("Value must be either 'on' or 'off'.");
 
-					return false;
+				rc = asprintf(&Out, "awaynick - %s", GetOwner()->GetAwayNick() ? GetOwner()->GetAwayNick() : "Not set");
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
 				}
-			} else if (strcasecmp(argv[1], "autobacklog") == 0) {
-				if (strcasecmp(argv[2], "on") == 0 || strcasecmp(argv[2], "off") == 0) {
-					GetOwner()->SetAutoBacklog(argv[2]);
-				} else {
-					SENDUSER("Value must be either 'on' or 'off'.");
 
-					return false;
+				rc = asprintf(&Out, "away - %s", GetOwner()->GetAwayText() ? GetOwner()->GetAwayText() : "Not set");
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
 				}
-			} else {
-				SENDUSER("Unknown setting.");
-				return false;
-			}
 
-			SENDUSER("Done.");
-		}
+				rc = asprintf(&Out, "awaymessage - %s", GetOwner()->GetAwayMessage() ? GetOwner()->GetAwayMessage() : "Not set");
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
+				}
 
-		return false;
-#ifdef HAVE_LIBSSL
-	} else if (strcasecmp(Subcommand, "savecert") == 0) {
-		if (!IsSSL()) {
-			SENDUSER("Error: You are not using an SSL-encrypted connection.");
-		} else if (GetPeerCertificate() == NULL) {
-			SENDUSER("Error: You are not using a client certificate.");
-		} else {
-			GetOwner()->AddClientCertificate(GetPeerCertificate());
+				rc = asprintf(&Out, "usequitasaway - %s", GetOwner()->GetUseQuitReason() ? "On" : "Off");
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
+				}
 
-			SENDUSER("Your certificate was stored and will be used for public key authentication.");
-		}
+				if (GetOwner()->GetFloodRate() != 0) {
+					rc = asprintf(&Out, "floodrate - %u bytes/s", GetOwner()->GetFloodRate());
+				} else {
+					Out = strdup("floodrate - Default");
 
-		return false;
-	} else if (strcasecmp(Subcommand, "showcert") == 0) {
-		char Buffer[300];
-		const CVector<X509 *> *Certificates;
-		X509_NAME *name;
-		bool First = true;
+					rc = (Out == NULL) ? -1 : 0;
+				}
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
+				}
+
+				rc = asprintf(&Out, "floodburst - %u bytes", GetOwner()->GetFloodBurst());
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
+				}
+
+#ifdef HAVE_LIBSSL
+				rc = asprintf(&Out, "ssl - %s", GetOwner()->GetSSL() ? "On" : "Off");
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
+				}
+#endif /* HAVE_LIBSSL */
+
+				const char *AutoModes = GetOwner()->GetAutoModes();
+				bool ValidAutoModes = AutoModes && *AutoModes;
+				const char *DropModes = GetOwner()->GetDropModes();
+				bool ValidDropModes = DropModes && *DropModes;
 
-		Certificates = GetOwner()->GetClientCertificates();
+				const char *AutoModesPrefix = "+", *DropModesPrefix = "-";
 
-		for (int i = 0; i < Certificates->GetLength(); i++) {
-			X509 *Certificate = (*Certificates)[i];
+				if (!ValidAutoModes || (AutoModes && (*AutoModes == '+' || *AutoModes == '-'))) {
+					AutoModesPrefix = "";
+				}
+
+				if (!ValidDropModes || (DropModes && (*DropModes == '-' || *DropModes == '+'))) {
+					DropModesPrefix = "";
+				}
+
+				rc = asprintf(&Out, "automodes - %s%s", AutoModesPrefix, ValidAutoModes ? AutoModes : "Not set");
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
+				}
+
+				rc = asprintf(&Out, "dropmodes - %s%s", DropModesPrefix, ValidDropModes ? DropModes : "Not set");
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
+				}
+
+				if (GetOwner()->IsAdmin()) {
+					rc = asprintf(&Out, "sysnotices - %s", GetOwner()->GetSystemNotices() ? "On" : "Off");
+					if (!RcFailed(rc)) {
+						SENDUSER(Out);
+						free(Out);
+					}
+				}
+
+				const char *AutoBacklog = GetOwner()->GetAutoBacklog();
 
-			if (First == false) {
-				SENDUSER("---");
+				rc = asprintf(&Out, "autobacklog - %s", GetOwner()->GetAutoBacklog() ? GetOwner()->GetAutoBacklog() : "Off");
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
+				}
 			} else {
-				First = false;
-			}
+				if (strcasecmp(argv[1], "server") == 0) {
+					if (argc > 3) {
+						GetOwner()->UnmarkQuitted();
+
+						GetOwner()->SetPort(atoi(argv[3]));
+						GetOwner()->SetServer(argv[2]);
+					} else if (argc > 2) {
+						GetOwner()->UnmarkQuitted();
+
+						// the order of the SetServer/SetPort had some importance
+						// i wonder what it was... hm
+						if (strlen(argv[2]) == 0) {
+							GetOwner()->SetServer(NULL);
+							GetOwner()->SetPort(6667);
+						} else {
+							char *ServerStr = NULL;
+							const char *PortStr = strchr(argv[2], ':');
+							unsigned int Port = 6667;
+
+							// Check whether there's a second colon and ignore 'port' if there
+							// isn't because it's most likely an IPv6 address instead.
+							if (PortStr != NULL && strrchr(argv[2], ':') == PortStr) {
+								PortStr++;
+
+								Port = atoi(PortStr);
+
+								if (Port == 0) {
+									Port = 6667;
+								}
 
-			rc = asprintf(&Out, "Client Certificate #%d", i + 1);
-			if (!RcFailed(rc)) {
-				SENDUSER(Out);
-				free(Out);
-			}
+								ServerStr = strdup(argv[2]);
 
-			name = X509_get_issuer_name(Certificate);
-			X509_NAME_oneline(name, Buffer, sizeof(Buffer));
+								if (ServerStr != NULL) {
+									ServerStr[PortStr - argv[2] - 1] = '\0';
+								}
+							}
 
-			rc = asprintf(&Out, "issuer: %s", Buffer);
-			if (!RcFailed(rc)) {
-				SENDUSER(Out);
-				free(Out);
-			}
+							GetOwner()->SetPort(Port);
+							GetOwner()->SetServer((ServerStr != NULL) ? ServerStr : argv[2]);
+						
+							free(ServerStr);
+						}
+					} else {
+						SENDUSER("Syntax: /sbnc set server host port");
 
-			name = X509_get_subject_name(Certificate);
-			X509_NAME_oneline(name, Buffer, sizeof(Buffer));
+						return false;
+					}
+				} else if (strcasecmp(argv[1], "realname") == 0) {
+					ArgRejoinArray(argv, 2);
+					GetOwner()->SetRealname(argv[2]);
+				} else if (strcasecmp(argv[1], "awaynick") == 0) {
+					GetOwner()->SetAwayNick(argv[2]);
+				} else if (strcasecmp(argv[1], "away") == 0) {
+					ArgRejoinArray(argv, 2);
+					GetOwner()->SetAwayText(argv[2]);
+				} else if (strcasecmp(argv[1], "awaymessage") == 0) {
+					ArgRejoinArray(argv, 2);
+					GetOwner()->SetAwayMessage(argv[2]);
+				} else if (strcasecmp(argv[1], "vhost") == 0) {
+					GetOwner()->SetVHost(argv[2]);
+				} else if (strcasecmp(argv[1], "serverpass") == 0) {
+					GetOwner()->SetServerPassword(argv[2]);
+				} else if (strcasecmp(argv[1], "password") == 0) {
+					if (strlen(argv[2]) < 6 || argc > 3 || strchr(argv[2], ':') != NULL) {
+						SENDUSER("Your password is too short or contains invalid characters.");
+						return false;
+					} else {
+						GetOwner()->SetPassword(argv[2]);
+					}
+				} else if (strcasecmp(argv[1], "usequitasaway") == 0) {
+					if (strcasecmp(argv[2], "on") == 0) {
+						GetOwner()->SetUseQuitReason(true);
+					} else if (strcasecmp(argv[2], "off") == 0) {
+						GetOwner()->SetUseQuitReason(false);
+					} else {
+						SENDUSER("Value must be either 'on' or 'off'.");
 
-			rc = asprintf(&Out, "subject: %s", Buffer);
-			if (!RcFailed(rc)) {
-				SENDUSER(Out);
-				free(Out);
-			}
-		}
+						return false;
+					}
+				} else if (strcasecmp(argv[1], "floodrate") == 0) {
+					if (strcasecmp(argv[2], "default") == 0) {
+						GetOwner()->SetFloodRate(0);
+					} else if (atoi(argv[2]) > 0) {
+						GetOwner()->SetFloodRate(atoi(argv[2]));
+					} else {
+						SENDUSER("Value must be either 'default' or a positive number.");
 
-		SENDUSER("End of CERTIFICATES.");
+						return false;
+					}
+				} else if (strcasecmp(argv[1], "floodburst") == 0) {
+					if (atoi(argv[2]) < 0) {
+						SENDUSER("Value must be a positive number.");
 
-		return false;
-	} else if (strcasecmp(Subcommand, "delcert") == 0) {
-		int id;
+						return false;
+					}
 
-		if (argc < 2) {
-			SENDUSER("Syntax: delcert ID");
-			
-			return false;
-		}
+					GetOwner()->SetFloodBurst(atoi(argv[2]));
+				} else if (strcasecmp(argv[1], "automodes") == 0) {
+					ArgRejoinArray(argv, 2);
+					GetOwner()->SetAutoModes(argv[2]);
+				} else if (strcasecmp(argv[1], "dropmodes") == 0) {
+					ArgRejoinArray(argv, 2);
+					GetOwner()->SetDropModes(argv[2]);
+				} else if (strcasecmp(argv[1], "ssl") == 0) {
+					if (strcasecmp(argv[2], "on") == 0) {
+						GetOwner()->SetSSL(true);
+					} else if (strcasecmp(argv[2], "off") == 0) {
+						GetOwner()->SetSSL(false);
+					} else {
+						SENDUSER("Value must be either 'on' or 'off'.");
 
-		id = atoi(argv[1]);
+						return false;
+					}
+				} else if (strcasecmp(argv[1], "sysnotices") == 0) {
+					if (strcasecmp(argv[2], "on") == 0) {
+						GetOwner()->SetSystemNotices(true);
+					} else if (strcasecmp(argv[2], "off") == 0) {
+						GetOwner()->SetSystemNotices(false);
+					} else {
+						SENDUSER("Value must be either 'on' or 'off'.");
 
-		X509 *Certificate;
-		const CVector<X509 *> *Certificates = GetOwner()->GetClientCertificates();
+						return false;
+					}
+				} else if (strcasecmp(argv[1], "autobacklog") == 0) {
+					if (strcasecmp(argv[2], "on") == 0 || strcasecmp(argv[2], "off") == 0) {
+						GetOwner()->SetAutoBacklog(argv[2]);
+					} else {
+						SENDUSER("Value must be either 'on' or 'off'.");
 
-		if (id <= 0 || id > Certificates->GetLength()) {
-			Certificate = NULL;
-		} else {
-			Certificate = (*Certificates)[id - 1];
-		}
+						return false;
+					}
+				} else {
+					SENDUSER("Unknown setting.");
+					return false;
+				}
 
-		if (Certificate != NULL) {
-			if (GetOwner()->RemoveClientCertificate(Certificate)) {
 				SENDUSER("Done.");
+			}
+
+			return false;
+		}
+#ifdef HAVE_LIBSSL
+		case Bnc_SaveCert: {
+			if (!IsSSL()) {
+				SENDUSER("Error: You are not using an SSL-encrypted connection.");
+			} else if (GetPeerCertificate() == NULL) {
+				SENDUSER("Error: You are not using a client certificate.");
 			} else {
-				SENDUSER("An error occured while removing the certificate.");
+				GetOwner()->AddClientCertificate(GetPeerCertificate());
+
+				SENDUSER("Your certificate was stored and will be used for public key authentication.");
 			}
-		} else {
-			SENDUSER("The ID you specified is not valid. Use the SHOWCERT command to get a list of valid IDs.");
+
+			return false;
 		}
 
-		return false;
-#endif /* HAVE_LIBSSL */
-	} else if (strcasecmp(Subcommand, "die") == 0 && GetOwner()->IsAdmin()) {
-		g_Bouncer->Log("Shutdown requested by %s", GetOwner()->GetUsername());
-		g_Bouncer->Shutdown();
+		case Bnc_ShowCert: {
+			char Buffer[300];
+			const CVector<X509 *> *Certificates;
+			X509_NAME *name;
+			bool First = true;
 
-		return false;
-	} else if (strcasecmp(Subcommand, "adduser") == 0 && GetOwner()->IsAdmin()) {
-		const char *Password;
+			Certificates = GetOwner()->GetClientCertificates();
 
-		if (argc < 2) {
-			SENDUSER("Syntax: ADDUSER username [password]");
-			return false;
-		} else if (argc < 3) {
-			char RandomPassword[10];
-			const char RandomPasswordChars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+			for (int i = 0; i < Certificates->GetLength(); i++) {
+				X509 *Certificate = (*Certificates)[i];
+
+				if (First == false) {
+					SENDUSER("---");
+				} else {
+					First = false;
+				}
+
+				rc = asprintf(&Out, "Client Certificate #%d", i + 1);
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
+				}
+
+				name = X509_get_issuer_name(Certificate);
+				X509_NAME_oneline(name, Buffer, sizeof(Buffer));
+
+				rc = asprintf(&Out, "issuer: %s", Buffer);
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
+				}
 
-			RandomPassword[9] = '\0';
+				name = X509_get_subject_name(Certificate);
+				X509_NAME_oneline(name, Buffer, sizeof(Buffer));
 
-			for (unsigned int i = 0; i < 9; i++) {
-				RandomPassword[i] = RandomPasswordChars[rand() % (sizeof(RandomPasswordChars) - 1)];
+				rc = asprintf(&Out, "subject: %s", Buffer);
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
+				}
 			}
 
-			Password = RandomPassword;
-		} else {
-			Password = argv[2];
+			SENDUSER("End of CERTIFICATES.");
+
+			return false;
 		}
 
-		if (g_Bouncer->GetUser(argv[1]) != NULL) {
-			SENDUSER("The specified username is already in use.");
+		case Bnc_DelCert: {
+			int id;
+
+			if (argc < 2) {
+				SENDUSER("Syntax: delcert ID");
+			
+				return false;
+			}
+
+			id = atoi(argv[1]);
+
+			X509 *Certificate;
+			const CVector<X509 *> *Certificates = GetOwner()->GetClientCertificates();
+
+			if (id <= 0 || id > Certificates->GetLength()) {
+				Certificate = NULL;
+			} else {
+				Certificate = (*Certificates)[id - 1];
+			}
+
+			if (Certificate != NULL) {
+				if (GetOwner()->RemoveClientCertificate(Certificate)) {
+					SENDUSER("Done.");
+				} else {
+					SENDUSER("An error occured while removing the certificate.");
+				}
+			} else {
+				SENDUSER("The ID you specified is not valid. Use the SHOWCERT command to get a list of valid IDs.");
+			}
 
 			return false;
 		}
+#endif /* HAVE_LIBSSL */
+		case Bnc_Die: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
+			}
 
-		if (!g_Bouncer->IsValidUsername(argv[1])) {
-			SENDUSER("Could not create user: The username must be alpha-numeric.");
+			g_Bouncer->Log("Shutdown requested by %s", GetOwner()->GetUsername());
+			g_Bouncer->Shutdown();
 
 			return false;
 		}
 
-		g_Bouncer->CreateUser(argv[1], Password);
+		case Bnc_AddUser: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
+			}
 
-		if (argc < 3) {
-			rc = asprintf(&Out, "The new user's password is \"%s\".", Password);
+			const char *Password;
 
-			if (RcFailed(rc)) {
+			if (argc < 2) {
+				SENDUSER("Syntax: ADDUSER username [password]");
 				return false;
+			} else if (argc < 3) {
+				char RandomPassword[10];
+				const char RandomPasswordChars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+				RandomPassword[9] = '\0';
+
+				for (unsigned int i = 0; i < 9; i++) {
+					RandomPassword[i] = RandomPasswordChars[rand() % (sizeof(RandomPasswordChars) - 1)];
+				}
+
+				Password = RandomPassword;
+			} else {
+				Password = argv[2];
 			}
 
-			SENDUSER(Out);
+			if (g_Bouncer->GetUser(argv[1]) != NULL) {
+				SENDUSER("The specified username is already in use.");
 
-			free(Out);
-		}
+				return false;
+			}
 
-		SENDUSER("Done.");
+			if (!g_Bouncer->IsValidUsername(argv[1])) {
+				SENDUSER("Could not create user: The username must be alpha-numeric.");
 
-		return false;
-	} else if (strcasecmp(Subcommand, "deluser") == 0 && GetOwner()->IsAdmin()) {
-		if (argc < 2) {
-			SENDUSER("Syntax: DELUSER username");
-			return false;
-		}
+				return false;
+			}
 
-		if (strcasecmp(argv[1], GetOwner()->GetUsername()) == 0) {
-			SENDUSER("You cannot remove yourself.");
+			g_Bouncer->CreateUser(argv[1], Password);
 
-			return false;
-		}
+			if (argc < 3) {
+				rc = asprintf(&Out, "The new user's password is \"%s\".", Password);
+
+				if (RcFailed(rc)) {
+					return false;
+				}
 
-		RESULT<bool> Result = g_Bouncer->RemoveUser(argv[1]);
+				SENDUSER(Out);
+
+				free(Out);
+			}
 
-		if (IsError(Result)) {
-			SENDUSER(GETDESCRIPTION(Result));
-		} else {
 			SENDUSER("Done.");
-		}
 
-		return false;
-	} else if (strcasecmp(Subcommand, "simul") == 0 && GetOwner()->IsAdmin()) {
-		if (argc < 3) {
-			SENDUSER("Syntax: SIMUL username :command");
 			return false;
 		}
 
-		CUser *User = g_Bouncer->GetUser(argv[1]);
+		case Bnc_DelUser: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
+			}
 
-		if (User) {
-			ArgRejoinArray(argv, 2);
-			User->Simulate(argv[2], this);
+			if (argc < 2) {
+				SENDUSER("Syntax: DELUSER username");
+				return false;
+			}
 
-			SENDUSER("Done.");
-		} else {
-			rc = asprintf(&Out, "No such user: %s", argv[1]);
-			if (!RcFailed(rc)) {
-				SENDUSER(Out);
-				free(Out);
+			if (strcasecmp(argv[1], GetOwner()->GetUsername()) == 0) {
+				SENDUSER("You cannot remove yourself.");
+
+				return false;
+			}
+
+			RESULT<bool> Result = g_Bouncer->RemoveUser(argv[1]);
+
+			if (IsError(Result)) {
+				SENDUSER(GETDESCRIPTION(Result));
+			} else {
+				SENDUSER("Done.");
 			}
-		}
 
-		return false;
-	} else if (strcasecmp(Subcommand, "direct") == 0) {
-		if (argc < 2) {
-			SENDUSER("Syntax: DIRECT :command");
 			return false;
 		}
 
-		CIRCConnection *IRC = GetOwner()->GetIRCConnection();
+		case Bnc_Simul: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
+			}
+
+			if (argc < 3) {
+				SENDUSER("Syntax: SIMUL username :command");
+				return false;
+			}
 
-		ArgRejoinArray(argv, 1);
-		IRC->WriteLine("%s", argv[1]);
+			CUser *User = g_Bouncer->GetUser(argv[1]);
+
+			if (User) {
+				ArgRejoinArray(argv, 2);
+				User->Simulate(argv[2], this);
+
+				SENDUSER("Done.");
+			} else {
+				rc = asprintf(&Out, "No such user: %s", argv[1]);
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
+				}
+			}
 
-		return false;
-	} else if (strcasecmp(Subcommand, "broadcast") == 0 && GetOwner()->IsAdmin()) {
-		if (argc < 2) {
-			SENDUSER("Syntax: BROADCAST :text");
 			return false;
 		}
 
-		ArgRejoinArray(argv, 1);
-		g_Bouncer->GlobalNotice(argv[1]);
-		return false;
-	} else if (strcasecmp(Subcommand, "kill") == 0 && GetOwner()->IsAdmin()) {
-		if (argc < 2) {
-			SENDUSER("Syntax: KILL username [reason]");
+		case Bnc_Direct: {
+			if (argc < 2) {
+				SENDUSER("Syntax: DIRECT :command");
+				return false;
+			}
+
+			CIRCConnection *IRC = GetOwner()->GetIRCConnection();
+
+			ArgRejoinArray(argv, 1);
+			IRC->WriteLine("%s", argv[1]);
+
 			return false;
 		}
 
-		CUser *User = g_Bouncer->GetUser(argv[1]);
+		case Bnc_Broadcast: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
+			}
 
-		const char *Reason = "No reason specified.";
+			if (argc < 2) {
+				SENDUSER("Syntax: BROADCAST :text");
+				return false;
+			}
 
-		if (argc >= 3) {
-			ArgRejoinArray(argv, 2);
-			Reason = argv[2];
+			ArgRejoinArray(argv, 1);
+			g_Bouncer->GlobalNotice(argv[1]);
+			return false;
 		}
 
-		rc = asprintf(&Out, "You were disconnected from the bouncer. (Requested by %s: %s)", GetOwner()->GetUsername(), Reason);
+		case Bnc_Kill: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
+			}
+
+			if (argc < 2) {
+				SENDUSER("Syntax: KILL username [reason]");
+				return false;
+			}
+
+			CUser *User = g_Bouncer->GetUser(argv[1]);
+
+			const char *Reason = "No reason specified.";
+
+			if (argc >= 3) {
+				ArgRejoinArray(argv, 2);
+				Reason = argv[2];
+			}
+
+			rc = asprintf(&Out, "You were disconnected from the bouncer. (Requested by %s: %s)", GetOwner()->GetUsername(), Reason);
+
+			if (RcFailed(rc)) {
+				return false;
+			}
+
+			if (User != NULL && User->GetClientConnectionMultiplexer() != NULL) {
+				User->GetClientConnectionMultiplexer()->Kill(Out);
+				SENDUSER("Done.");
+			} else {
+				SENDUSER("There is no such user or that user is not currently logged in.");
+			}
+
+			free(Out);
 
-		if (RcFailed(rc)) {
 			return false;
 		}
 
-		if (User != NULL && User->GetClientConnectionMultiplexer() != NULL) {
-			User->GetClientConnectionMultiplexer()->Kill(Out);
-			SENDUSER("Done.");
-		} else {
-			SENDUSER("There is no such user or that user is not currently logged in.");
-		}
+		case Bnc_Disconnect: {
+			CUser *User;
 
-		free(Out);
+			if (GetOwner()->IsAdmin() && argc >= 2) {
+				User = g_Bouncer->GetUser(argv[1]);
+			} else {
+				User = GetOwner();
+			}
 
-		return false;
-	} else if (strcasecmp(Subcommand, "disconnect") == 0) {
-		CUser *User;
+			if (User == NULL) {
+				SENDUSER("There is no such user.");
+				return false;
+			}
 
-		if (GetOwner()->IsAdmin() && argc >= 2) {
-			User = g_Bouncer->GetUser(argv[1]);
-		} else {
-			User = GetOwner();
-		}
+			CIRCConnection *IRC = User->GetIRCConnection();
+
+			User->MarkQuitted(true);
+
+			if (IRC == NULL) {
+				if (User == GetOwner()) {
+					SENDUSER("You are not connected to a server.");
+				} else {
+					SENDUSER("The user is not connected to a server.");
+				}
+
+				return false;
+			}
+
+			IRC->Kill("Requested.");
+
+			SENDUSER("Done.");
 
-		if (User == NULL) {
-			SENDUSER("There is no such user.");
 			return false;
 		}
 
-		CIRCConnection *IRC = User->GetIRCConnection();
+		case Bnc_Jump: {
+			if (GetOwner()->GetIRCConnection()) {
+				GetOwner()->GetIRCConnection()->Kill("Reconnecting");
 
-		User->MarkQuitted(true);
+				GetOwner()->SetIRCConnection(NULL);
+			}
 
-		if (IRC == NULL) {
-			if (User == GetOwner()) {
-				SENDUSER("You are not connected to a server.");
+			if (GetOwner()->GetServer() == NULL) {
+				SENDUSER("Cannot reconnect: You haven't set a server yet.");
 			} else {
-				SENDUSER("The user is not connected to a server.");
+				GetOwner()->ScheduleReconnect(5);
 			}
 
 			return false;
 		}
 
-		IRC->Kill("Requested.");
+		case Bnc_Status: {
+			rc = asprintf(&Out, "Username: %s", GetOwner()->GetUsername());
+			if (!RcFailed(rc)) {
+				SENDUSER(Out);
+				free(Out);
+			}
 
-		SENDUSER("Done.");
+			rc = asprintf(&Out, "This is shroudBNC %s", g_Bouncer->GetBouncerVersion());
+			if (!RcFailed(rc)) {
+				SENDUSER(Out);
+				free(Out);
+			}
 
-		return false;
-	} else if (strcasecmp(Subcommand, "jump") == 0) {
-		if (GetOwner()->GetIRCConnection()) {
-			GetOwner()->GetIRCConnection()->Kill("Reconnecting");
+			rc = asprintf(&Out, "You are %san admin.", GetOwner()->IsAdmin() ? "" : "not ");
+			if (!RcFailed(rc)) {
+				SENDUSER(Out);
+				free(Out);
+			}
 
-			GetOwner()->SetIRCConnection(NULL);
-		}
+			rc = asprintf(&Out, "Client: sendq: %d, recvq: %d", (int)GetSendqSize(), (int)GetRecvqSize());
+			if (!RcFailed(rc)) {
+				SENDUSER(Out);
+				free(Out);
+			}
 
-		if (GetOwner()->GetServer() == NULL) {
-			SENDUSER("Cannot reconnect: You haven't set a server yet.");
-		} else {
-			GetOwner()->ScheduleReconnect(5);
-		}
+			CIRCConnection *IRC = GetOwner()->GetIRCConnection();
 
-		return false;
-	} else if (strcasecmp(Subcommand, "status") == 0) {
-		rc = asprintf(&Out, "Username: %s", GetOwner()->GetUsername());
-		if (!RcFailed(rc)) {
-			SENDUSER(Out);
-			free(Out);
-		}
+			if (IRC) {
+				rc = asprintf(&Out, "IRC: sendq: %d, recvq: %d", (int)IRC->GetSendqSize(), (int)IRC->GetRecvqSize());
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
+				}
 
-		rc = asprintf(&Out, "This is shroudBNC %s", g_Bouncer->GetBouncerVersion());
-		if (!RcFailed(rc)) {
-			SENDUSER(Out);
-			free(Out);
-		}
+				SENDUSER("Channels:");
 
-		rc = asprintf(&Out, "You are %san admin.", GetOwner()->IsAdmin() ? "" : "not ");
-		if (!RcFailed(rc)) {
-			SENDUSER(Out);
-			free(Out);
-		}
+				int a = 0;
 
-		rc = asprintf(&Out, "Client: sendq: %d, recvq: %d", (int)GetSendqSize(), (int)GetRecvqSize());
-		if (!RcFailed(rc)) {
-			SENDUSER(Out);
-			free(Out);
-		}
+				while (hash_t<CChannel *> *Chan = IRC->GetChannels()->Iterate(a++)) {
+					SENDUSER(Chan->Name);
+				}
 
-		CIRCConnection *IRC = GetOwner()->GetIRCConnection();
+				SENDUSER("End of CHANNELS.");
+			}
 
-		if (IRC) {
-			rc = asprintf(&Out, "IRC: sendq: %d, recvq: %d", (int)IRC->GetSendqSize(), (int)IRC->GetRecvqSize());
+			rc = asprintf(&Out, "IRC Uptime: %d seconds", GetOwner()->GetIRCUptime());
 			if (!RcFailed(rc)) {
 				SENDUSER(Out);
 				free(Out);
 			}
 
-			SENDUSER("Channels:");
+			if (GetOwner()->IsAdmin()) {
+				const dnscachestats_t *Stats = CDnsCache::GetStats();
+				unsigned int Lookups = Stats->Hits + Stats->Coalesced + Stats->Misses;
 
-			int a = 0;
+				rc = asprintf(&Out, "DNS cache: %d entries, %u hits (%u negative), %u coalesced, %u misses, %u%% hit rate",
+					CDnsCache::GetCount(), Stats->Hits, Stats->NegativeHits, Stats->Coalesced, Stats->Misses,
+					Lookups ? (unsigned int)((Stats->Hits + Stats->Coalesced) * 100ULL / Lookups) : 0);
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
+				}
 
-			while (hash_t<CChannel *> *Chan = IRC->GetChannels()->Iterate(a++)) {
-				SENDUSER(Chan->Name);
+				const sslhandshakestats_t *Inbound = CConnection::GetSSLHandshakeStats(Role_Server);
+				const sslhandshakestats_t *Outbound = CConnection::GetSSLHandshakeStats(Role_Client);
+				const char *Titles[] = {
+					"SSL handshakes with clients (full)", "SSL handshakes with clients (resumed)",
+					"SSL handshakes with IRC servers (full)", "SSL handshakes with IRC servers (resumed)"
+				};
+				const unsigned int *Histograms[] = {
+					Inbound->Full, Inbound->Resumed, Outbound->Full, Outbound->Resumed
+				};
+
+				for (int i = 0; i < 4; i++) {
+					Out = FormatSSLHandshakes(Titles[i], Histograms[i]);
+
+					if (Out != NULL) {
+						SENDUSER(Out);
+						free(Out);
+					}
+				}
 			}
 
-			SENDUSER("End of CHANNELS.");
+			return false;
 		}
 
-		rc = asprintf(&Out, "IRC Uptime: %d seconds", GetOwner()->GetIRCUptime());
-		if (!RcFailed(rc)) {
-			SENDUSER(Out);
-			free(Out);
-		}
+		case Bnc_Impulse: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
+			}
 
-		return false;
-	} else if (strcasecmp(Subcommand, "impulse") == 0 && GetOwner()->IsAdmin()) {
-		if (argc < 2) {
-			SENDUSER("Syntax: impulse command");
+			if (argc < 2) {
+				SENDUSER("Syntax: impulse command");
+
+				return false;
+			}
+
+			const char *Reply = g_Bouncer->DebugImpulse(atoi(argv[1]));
+
+			if (Reply != NULL) {
+				SENDUSER(Reply);
+			} else {
+				SENDUSER("No return value.");
+			}
 
 			return false;
 		}
 
-		const char *Reply = g_Bouncer->DebugImpulse(atoi(argv[1]));
-
-		if (Reply != NULL) {
-			SENDUSER(Reply);
-		} else {
-			SENDUSER("No return value.");
-		}
+		case Bnc_Who: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
+			}
 
-		return false;
-	} else if (strcasecmp(Subcommand, "who") == 0 && GetOwner()->IsAdmin()) {
-		char **Keys = g_Bouncer->GetUsers()->GetSortedKeys();
-		int Count = g_Bouncer->GetUsers()->GetLength();
+			char **Keys = g_Bouncer->GetUsers()->GetSortedKeys();
+			int Count = g_Bouncer->GetUsers()->GetLength();
 
-		for (int i = 0; i < Count; i++) {
-			const char *Server, *ClientAddr;
-			CUser *User = g_Bouncer->GetUser(Keys[i]);
+			for (int i = 0; i < Count; i++) {
+				const char *Server, *ClientAddr;
+				CUser *User = g_Bouncer->GetUser(Keys[i]);
 
-			if (User == NULL) {
-				continue;
-			}
+				if (User == NULL) {
+					continue;
+				}
 
-			if (User->GetIRCConnection()) {
-				Server = User->GetIRCConnection()->GetServer();
-			} else {
-				Server = NULL;
-			}
+				if (User->GetIRCConnection()) {
+					Server = User->GetIRCConnection()->GetServer();
+				} else {
+					Server = NULL;
+				}
 
-			if (User->GetPrimaryClientConnection() != NULL) {
-				ClientAddr = User->GetPrimaryClientConnection()->GetPeerName();
-			} else {
-				ClientAddr = NULL;
-			}
+				if (User->GetPrimaryClientConnection() != NULL) {
+					ClientAddr = User->GetPrimaryClientConnection()->GetPeerName();
+				} else {
+					ClientAddr = NULL;
+				}
 
-			const char *LastSeen;
-			tm SeenTm;
-			time_t SeenTime;
-			char strSeenTime[100];
+				const char *LastSeen;
+				tm SeenTm;
+				time_t SeenTime;
+				char strSeenTime[100];
 
-			if (User->GetLastSeen() == 0) {
-				LastSeen = "Never";
-			} else if (User->GetPrimaryClientConnection() != NULL) {
-				LastSeen = "Now";
-			} else {
-				SeenTime = User->GetLastSeen();
-				SeenTm = *localtime(&SeenTime);
+				if (User->GetLastSeen() == 0) {
+					LastSeen = "Never";
+				} else if (User->GetPrimaryClientConnection() != NULL) {
+					LastSeen = "Now";
+				} else {
+					SeenTime = User->GetLastSeen();
+					SeenTm = *localtime(&SeenTime);
 
 #ifdef _WIN32
-				strftime(strSeenTime, sizeof(strSeenTime), "%#c" , &SeenTm);
+					strftime(strSeenTime, sizeof(strSeenTime), "%#c" , &SeenTm);
 #else
-				strftime(strSeenTime, sizeof(strSeenTime), "%a %B %d %Y %H:%M:%S" , &SeenTm);
+					strftime(strSeenTime, sizeof(strSeenTime), "%a %B %d %Y %H:%M:%S" , &SeenTm);
 #endif
 
-				LastSeen = strSeenTime;
-			}
+					LastSeen = strSeenTime;
+				}
 
-			CIRCConnection *IRC = User->GetIRCConnection();
+				CIRCConnection *IRC = User->GetIRCConnection();
 
-			rc = asprintf(&Out, "%s%s%s%s(%s)@%s [%s] [Last seen: %s] :%s",
-				User->IsLocked() ? "!" : "",
-				User->IsAdmin() ? "@" : "",
-				ClientAddr ? "*" : "",
-				User->GetUsername(),
-				IRC ? (IRC->GetCurrentNick() ? IRC->GetCurrentNick() : "<none>") : User->GetNick(),
-				ClientAddr ? ClientAddr : "",
-				Server ? Server : "",
-				LastSeen,
-				User->GetRealname());
+				rc = asprintf(&Out, "%s%s%s%s(%s)@%s [%s] [Last seen: %s] :%s",
+					User->IsLocked() ? "!" : "",
+					User->IsAdmin() ? "@" : "",
+					ClientAddr ? "*" : "",
+					User->GetUsername(),
+					IRC ? (IRC->GetCurrentNick() ? IRC->GetCurrentNick() : "<none>") : User->GetNick(),
+					ClientAddr ? ClientAddr : "",
+					Server ? Server : "",
+					LastSeen,
+					User->GetRealname());
 
-			if (!RcFailed(rc)) {
-				SENDUSER(Out);
-				free(Out);
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
+				}
 			}
-		}
 
-		free(Keys);
+			free(Keys);
 
-		SENDUSER("End of USERS.");
+			SENDUSER("End of USERS.");
 
-		return false;
-	} else if (strcasecmp(Subcommand, "addlistener") == 0 && GetOwner()->IsAdmin()) {
-		if (argc < 2) {
+			return false;
+		}
+
+		case Bnc_AddListener: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
+			}
+
+			if (argc < 2) {
 #ifdef USESSL
-			SENDUSER("Syntax: addlistener <port> [address] [ssl]");
+				SENDUSER("Syntax: addlistener <port> [address] [ssl]");
 #else
-			SENDUSER("Syntax: addlistener <port> [address]");
+				SENDUSER("Syntax: addlistener <port> [address]");
 #endif
 
-			return false;
-		}
+				return false;
+			}
 
-		unsigned int Port = atoi(argv[1]);
+			unsigned int Port = atoi(argv[1]);
 
-		if (Port <= 1024 || Port >= 65534) {
-			SENDUSER("You did not specify a valid port.");
+			if (Port <= 1024 || Port >= 65534) {
+				SENDUSER("You did not specify a valid port.");
 
-			return false;
-		}
+				return false;
+			}
 
-		const char *Address = NULL;
+			const char *Address = NULL;
 
-		if (argc > 2) {
-			Address = argv[2];
-		}
+			if (argc > 2) {
+				Address = argv[2];
+			}
 
-		bool SSL = false;
+			bool SSL = false;
 
 #ifdef USESSL
-		if (argc > 3) {
-			if (atoi(argv[3]) != 0 || strcasecmp(argv[3], "ssl") == 0) {
-				SSL = true;
+			if (argc > 3) {
+				if (atoi(argv[3]) != 0 || strcasecmp(argv[3], "ssl") == 0) {
+					SSL = true;
+				}
 			}
-		}
 #endif
 
-		RESULT<bool> Result = g_Bouncer->AddAdditionalListener(Port, Address, SSL);
+			RESULT<bool> Result = g_Bouncer->AddAdditionalListener(Port, Address, SSL);
+
+			if (IsError(Result)) {
+				SENDUSER(GETDESCRIPTION(Result));
 
-		if (IsError(Result)) {
-			SENDUSER(GETDESCRIPTION(Result));
+				return false;
+			}
+
+			SENDUSER("Done.");
 
 			return false;
 		}
 
-		SENDUSER("Done.");
+		case Bnc_DelListener: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
+			}
 
-		return false;
-	} else if (strcasecmp(Subcommand, "dellistener") == 0 && GetOwner()->IsAdmin()) {
-		if (argc < 2) {
-			SENDUSER("Syntax: dellistener <port>");
+			if (argc < 2) {
+				SENDUSER("Syntax: dellistener <port>");
 
-			return false;
-		}
+				return false;
+			}
 
-		RESULT<bool> Result = g_Bouncer->RemoveAdditionalListener(atoi(argv[1]));
+			RESULT<bool> Result = g_Bouncer->RemoveAdditionalListener(atoi(argv[1]));
 
-		if (Result) {
-			SENDUSER("Done.");
-		} else {
-			SENDUSER("There is no such listener.");
-		}
+			if (Result) {
+				SENDUSER("Done.");
+			} else {
+				SENDUSER("There is no such listener.");
+			}
 
-		return false;
-	} else if (strcasecmp(Subcommand, "listeners") == 0 && GetOwner()->IsAdmin()) {
-		if (g_Bouncer->GetMainListener() != NULL) {
-			rc = asprintf(&Out, "Main listener: port %d", g_Bouncer->GetMainListener()->GetPort());
-		} else {
-			Out = strdup("Main listener: none");
-			rc = (Out == NULL) ? -1 : 0;
+			return false;
 		}
 
-		if (!RcFailed(rc)) {
-			SENDUSER(Out);
-			free(Out);
-		}
+		case Bnc_Listeners: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
+			}
+
+			if (g_Bouncer->GetMainListener() != NULL) {
+				rc = asprintf(&Out, "Main listener: port %d", g_Bouncer->GetMainListener()->GetPort());
+			} else {
+				Out = strdup("Main listener: none");
+				rc = (Out == NULL) ? -1 : 0;
+			}
+
+			if (!RcFailed(rc)) {
+				SENDUSER(Out);
+				free(Out);
+			}
 
 #ifdef USESSL
-		if (g_Bouncer->GetMainSSLListener() != NULL) {
-			rc = asprintf(&Out, "Main SSL listener: port %d", g_Bouncer->GetMainSSLListener()->GetPort());
-		} else {
-			Out = strdup("Main SSL listener: none");
-			rc = (Out == NULL) ? -1 : 0;
-		}
+			if (g_Bouncer->GetMainSSLListener() != NULL) {
+				rc = asprintf(&Out, "Main SSL listener: port %d", g_Bouncer->GetMainSSLListener()->GetPort());
+			} else {
+				Out = strdup("Main SSL listener: none");
+				rc = (Out == NULL) ? -1 : 0;
+			}
 
-		if (!RcFailed(rc)) {
-			SENDUSER(Out);
-			free(Out);
-		}
+			if (!RcFailed(rc)) {
+				SENDUSER(Out);
+				free(Out);
+			}
 #endif
 
-		SENDUSER("---");
-		SENDUSER("Additional listeners:");
+			SENDUSER("---");
+			SENDUSER("Additional listeners:");
 
-		CVector<additionallistener_t> *Listeners = g_Bouncer->GetAdditionalListeners();
+			CVector<additionallistener_t> *Listeners = g_Bouncer->GetAdditionalListeners();
 
-		for (int i = 0; i < Listeners->GetLength(); i++) {
+			for (int i = 0; i < Listeners->GetLength(); i++) {
 #ifdef USESSL
-			if ((*Listeners)[i].SSL) {
-				if ((*Listeners)[i].BindAddress != NULL) {
-					rc = asprintf(&Out, "Port: %d (SSL, bound to %s)", (*Listeners)[i].Port, (*Listeners)[i].BindAddress);
+				if ((*Listeners)[i].SSL) {
+					if ((*Listeners)[i].BindAddress != NULL) {
+						rc = asprintf(&Out, "Port: %d (SSL, bound to %s)", (*Listeners)[i].Port, (*Listeners)[i].BindAddress);
+					} else {
+						rc = asprintf(&Out, "Port: %d (SSL)", (*Listeners)[i].Port);
+					}
 				} else {
-					rc = asprintf(&Out, "Port: %d (SSL)", (*Listeners)[i].Port);
-				}
-			} else {
 #endif
-				if ((*Listeners)[i].BindAddress != NULL) {
-					rc = asprintf(&Out, "Port: %d (bound to %s)", (*Listeners)[i].Port, (*Listeners)[i].BindAddress);
-				} else {
-					rc = asprintf(&Out, "Port: %d", (*Listeners)[i].Port);
-				}
+					if ((*Listeners)[i].BindAddress != NULL) {
+						rc = asprintf(&Out, "Port: %d (bound to %s)", (*Listeners)[i].Port, (*Listeners)[i].BindAddress);
+					} else {
+						rc = asprintf(&Out, "Port: %d", (*Listeners)[i].Port);
+					}
 #ifdef USESSL
-			}
+				}
 #endif
-			if (!RcFailed(rc)) {
-				SENDUSER(Out);
-				free(Out);
+				if (!RcFailed(rc)) {
+					SENDUSER(Out);
+					free(Out);
+				}
 			}
-		}
 
-		SENDUSER("End of LISTENERS.");
+			SENDUSER("End of LISTENERS.");
 
-		return false;
-	} else if (strcasecmp(Subcommand, "read") == 0) {
-		GetOwner()->GetLog()->PlayToUser(this, NoticeUser ? Log_Notice : Log_Message);
+			return false;
+		}
 
-		if (!GetOwner()->GetLog()->IsEmpty()) {
-			if (NoticeUser) {
-				RealNotice("End of LOG. Use '/sbnc erase' to remove this log.");
+		case Bnc_Read: {
+			GetOwner()->GetLog()->PlayToUser(this, NoticeUser ? Log_Notice : Log_Message);
+
+			if (!GetOwner()->GetLog()->IsEmpty()) {
+				if (NoticeUser) {
+					RealNotice("End of LOG. Use '/sbnc erase' to remove this log.");
+				} else {
+					Privmsg("End of LOG. Use '/msg -sBNC erase' to remove this log.");
+				}
 			} else {
-				Privmsg("End of LOG. Use '/msg -sBNC erase' to remove this log.");
+				SENDUSER("Your personal log is empty.");
 			}
-		} else {
-			SENDUSER("Your personal log is empty.");
-		}
 
-		return false;
-	} else if (strcasecmp(Subcommand, "erase") == 0) {
-		if (GetOwner()->GetLog()->IsEmpty()) {
-			SENDUSER("Your personal log is empty.");
-		} else {
-			GetOwner()->GetLog()->Clear();
-			SENDUSER("Done.");
+			return false;
 		}
 
-		return false;
-	} else if (strcasecmp(Subcommand, "playmainlog") == 0 && GetOwner()->IsAdmin()) {
-		g_Bouncer->GetLog()->PlayToUser(this, NoticeUser ? Log_Notice : Log_Message);
-
-		if (!g_Bouncer->GetLog()->IsEmpty()) {
-			if (NoticeUser) {
-				RealNotice("End of LOG. Use /sbnc erasemainlog to remove this log.");
+		case Bnc_Erase: {
+			if (GetOwner()->GetLog()->IsEmpty()) {
+				SENDUSER("Your personal log is empty.");
 			} else {
-				Privmsg("End of LOG. Use /msg -sBNC erasemainlog to remove this log.");
+				GetOwner()->GetLog()->Clear();
+				SENDUSER("Done.");
 			}
-		} else {
-			SENDUSER("The main log is empty.");
+
+			return false;
 		}
 
-		return false;
-	} else if (strcasecmp(Subcommand, "erasemainlog") == 0 && GetOwner()->IsAdmin()) {
-		g_Bouncer->GetLog()->Clear();
-		g_Bouncer->Log("User %s erased the main log", GetOwner()->GetUsername());
-		SENDUSER("Done.");
+		case Bnc_PlayMainLog: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
+			}
 
-		return false;
-	} else if (strcasecmp(Subcommand, "admin") == 0 && GetOwner()->IsAdmin()) {
-		if (argc < 2) {
-			SENDUSER("Syntax: ADMIN username");
+			g_Bouncer->GetLog()->PlayToUser(this, NoticeUser ? Log_Notice : Log_Message);
+
+			if (!g_Bouncer->GetLog()->IsEmpty()) {
+				if (NoticeUser) {
+					RealNotice("End of LOG. Use /sbnc erasemainlog to remove this log.");
+				} else {
+					Privmsg("End of LOG. Use /msg -sBNC erasemainlog to remove this log.");
+				}
+			} else {
+				SENDUSER("The main log is empty.");
+			}
 
 			return false;
 		}
 
-		CUser *User = g_Bouncer->GetUser(argv[1]);
-
-		if (User) {
-			User->SetAdmin(true);
+		case Bnc_EraseMainLog: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
+			}
 
+			g_Bouncer->GetLog()->Clear();
+			g_Bouncer->Log("User %s erased the main log", GetOwner()->GetUsername());
 			SENDUSER("Done.");
-		} else {
-			SENDUSER("There's no such user.");
-		}
-
-		return false;
-	} else if (strcasecmp(Subcommand, "unadmin") == 0 && GetOwner()->IsAdmin()) {
-		if (argc < 2) {
-			SENDUSER("Syntax: UNADMIN username");
 
 			return false;
 		}
 
-		CUser *User = g_Bouncer->GetUser(argv[1]);
-		
-		if (User) {
-			User->SetAdmin(false);
+		case Bnc_Admin: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
+			}
 
-			SENDUSER("Done.");
-		} else {
-			SENDUSER("There's no such user.");
-		}
+			if (argc < 2) {
+				SENDUSER("Syntax: ADMIN username");
 
-		return false;
-	} else if (strcasecmp(Subcommand, "suspend") == 0 && GetOwner()->IsAdmin()) {
-		if (argc < 2) {
-			SENDUSER("Syntax: SUSPEND username :reason");
+				return false;
+			}
+
+			CUser *User = g_Bouncer->GetUser(argv[1]);
+
+			if (User) {
+				User->SetAdmin(true);
+
+				SENDUSER("Done.");
+			} else {
+				SENDUSER("There's no such user.");
+			}
 
 			return false;
 		}
 
-		CUser *User = g_Bouncer->GetUser(argv[1]);
+		case Bnc_Unadmin: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
+			}
 
-		if (User) {
-			User->Lock();
+			if (argc < 2) {
+				SENDUSER("Syntax: UNADMIN username");
 
-			if (User->GetClientConnectionMultiplexer() != NULL) {
-				User->GetClientConnectionMultiplexer()->Kill("Your account has been suspended.");
+				return false;
 			}
 
-			if (User->GetIRCConnection() != NULL) {
-				User->GetIRCConnection()->Kill("Requested.");
+			CUser *User = g_Bouncer->GetUser(argv[1]);
+		
+			if (User) {
+				User->SetAdmin(false);
+
+				SENDUSER("Done.");
+			} else {
+				SENDUSER("There's no such user.");
 			}
 
-			User->MarkQuitted(true);
+			return false;
+		}
 
-			if (argc > 2) {
-				ArgRejoinArray(argv, 2);
-				User->SetSuspendReason(argv[2]);
-			} else {
-				User->SetSuspendReason("Suspended.");
+		case Bnc_Suspend: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
 			}
 
-			g_Bouncer->Log("User %s has been suspended.", User->GetUsername());
+			if (argc < 2) {
+				SENDUSER("Syntax: SUSPEND username :reason");
 
-			SENDUSER("Done.");
-		} else {
-			SENDUSER("There's no such fnord.");
-		}
+				return false;
+			}
 
-		return false;
-	} else if (strcasecmp(Subcommand, "unsuspend") == 0 && GetOwner()->IsAdmin()) {
-		if (argc < 2) {
-			SENDUSER("Syntax: UNSUSPEND username");
+			CUser *User = g_Bouncer->GetUser(argv[1]);
 
-			return false;
-		}
+			if (User) {
+				User->Lock();
 
-		CUser *User = g_Bouncer->GetUser(argv[1]);
-		
-		if (User) {
-			User->Unlock();
+				if (User->GetClientConnectionMultiplexer() != NULL) {
+					User->GetClientConnectionMultiplexer()->Kill("Your account has been suspended.");
+				}
 
-			g_Bouncer->Log("User %s has been unsuspended.", User->GetUsername());
+				if (User->GetIRCConnection() != NULL) {
+					User->GetIRCConnection()->Kill("Requested.");
+				}
 
-			User->SetSuspendReason(NULL);
+				User->MarkQuitted(true);
 
-			SENDUSER("Done.");
-		} else {
-			SENDUSER("There's no such user.");
-		}
+				if (argc > 2) {
+					ArgRejoinArray(argv, 2);
+					User->SetSuspendReason(argv[2]);
+				} else {
+					User->SetSuspendReason("Suspended.");
+				}
 
-		return false;
-	} else if (strcasecmp(Subcommand, "resetpass") == 0 && GetOwner()->IsAdmin()) {
-		if (argc < 3) {
-			SENDUSER("Syntax: RESETPASS username new-password");
+				g_Bouncer->Log("User %s has been suspended.", User->GetUsername());
+
+				SENDUSER("Done.");
+			} else {
+				SENDUSER("There's no such fnord.");
+			}
 
 			return false;
 		}
 
-		CUser *User = g_Bouncer->GetUser(argv[1]);
+		case Bnc_Unsuspend: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
+			}
+
+			if (argc < 2) {
+				SENDUSER("Syntax: UNSUSPEND username");
+
+				return false;
+			}
+
+			CUser *User = g_Bouncer->GetUser(argv[1]);
 		
-		if (User) {
-			User->SetPassword(argv[2]);
+			if (User) {
+				User->Unlock();
 
-			SENDUSER("Done.");
-		} else {
-			SENDUSER("There's no such user.");
-		}
+				g_Bouncer->Log("User %s has been unsuspended.", User->GetUsername());
 
-		return false;
-	} else if (strcasecmp(Subcommand, "partall") == 0) {
-		if (GetOwner()->GetIRCConnection()) {
-			const char *Channels = GetOwner()->GetConfigChannels();
+				User->SetSuspendReason(NULL);
 
-			if (Channels != NULL) {
-				GetOwner()->GetIRCConnection()->WriteLine("PART %s", Channels);
+				SENDUSER("Done.");
+			} else {
+				SENDUSER("There's no such user.");
 			}
+
+			return false;
 		}
 
-		GetOwner()->SetConfigChannels(NULL);
+		case Bnc_ResetPass: {
+			if (!GetOwner()->IsAdmin()) {
+				break;
+			}
 
-		SENDUSER("Done.");
+			if (argc < 3) {
+				SENDUSER("Syntax: RESETPASS username new-password");
 
-		return false;
-	} else if (strcasecmp(Subcommand, "backlog") == 0) {
-		if (argc < 2) {
-			SENDUSER("Syntax: BACKLOG #channel");
+				return false;
+			}
 
-			return false;
-		}
+			CUser *User = g_Bouncer->GetUser(argv[1]);
+		
+			if (User) {
+				User->SetPassword(argv[2]);
 
-		if (GetOwner()->GetIRCConnection() == NULL) {
-			SENDUSER("You need to be connected to an IRC server for this command to work.");
+				SENDUSER("Done.");
+			} else {
+				SENDUSER("There's no such user.");
+			}
 
 			return false;
 		}
 
-		CChannel *Channel = GetOwner()->GetIRCConnection()->GetChannel(argv[1]);
+		case Bnc_PartAll: {
+			if (GetOwner()->GetIRCConnection()) {
+				const char *Channels = GetOwner()->GetConfigChannels();
+
+				if (Channels != NULL) {
+					GetOwner()->GetIRCConnection()->WriteLine("PART %s", Channels);
+				}
+			}
+
+			GetOwner()->SetConfigChannels(NULL);
 
-		if (Channel == NULL) {
-			SENDUSER("You are not on the channel you specified.");
+			SENDUSER("Done.");
 
 			return false;
 		}
 
-		Channel->PlayBacklog(this);
+		case Bnc_Backlog: {
+			if (argc < 2) {
+				SENDUSER("Syntax: BACKLOG #channel");
+
+				return false;
+			}
 
-		SENDUSER("Done.");
+			if (GetOwner()->GetIRCConnection() == NULL) {
+				SENDUSER("You need to be connected to an IRC server for this command to work.");
 
-		return false;
-	} else if (strcasecmp(Subcommand, "erasebacklog") == 0) {
-		CIRCConnection *IRC;
+				return false;
+			}
+
+			CChannel *Channel = GetOwner()->GetIRCConnection()->GetChannel(argv[1]);
+
+			if (Channel == NULL) {
+				SENDUSER("You are not on the channel you specified.");
+
+				return false;
+			}
 
-		IRC = GetOwner()->GetIRCConnection();
+			Channel->PlayBacklog(this);
 
-		if (IRC == NULL) {
-			SENDUSER("You need to be connected to an IRC server for this command to work.");
+			SENDUSER("Done.");
 
 			return false;
 		}
 
-		if (argc >= 2) {
-			CChannel *Channel = GetOwner()->GetIRCConnection()->GetChannel(argv[1]);
+		case Bnc_EraseBacklog: {
+			CIRCConnection *IRC;
 
-			if (Channel == NULL) {
-				SENDUSER("You are not on the channel you specified.");
+			IRC = GetOwner()->GetIRCConnection();
+
+			if (IRC == NULL) {
+				SENDUSER("You need to be connected to an IRC server for this command to work.");
 
 				return false;
 			}
 
-			Channel->EraseBacklog();
-		} else {
-			int a = 0;
+			if (argc >= 2) {
+				CChannel *Channel = GetOwner()->GetIRCConnection()->GetChannel(argv[1]);
+
+				if (Channel == NULL) {
+					SENDUSER("You are not on the channel you specified.");
+
+					return false;
+				}
+
+				Channel->EraseBacklog();
+			} else {
+				int a = 0;
 
-			while (hash_t<CChannel *> *Chan = IRC->GetChannels()->Iterate(a++)) {
-				Chan->Value->EraseBacklog();
+				while (hash_t<CChannel *> *Chan = IRC->GetChannels()->Iterate(a++)) {
+					Chan->Value->EraseBacklog();
+				}
 			}
-		}
 
-		SENDUSER("Done.");
+			SENDUSER("Done.");
 
-		return false;
+			return false;
+		}
 	}
 
 	if (NoticeUser) {
@@ -1512,6 +1904,62 @@ bool CClientConnection::ProcessBncCommand(const char *Subcommand, int argc, cons
 	return false;
 }
 
+/**
+ * ClientCommand
+ *
+ * Identifiers for the client commands which are processed by ParseLineArgV.
+ */
+enum ClientCommand {
+	Client_Unknown = 0,
+	Client_Nick,
+	Client_Pass,
+	Client_User,
+	Client_Quit,
+	Client_Join,
+	Client_Whois,
+	Client_Privmsg,
+	Client_Notice,
+	Client_Userhost,
+	Client_Ping,
+	Client_Pong,
+	Client_Protoctl,
+	Client_Sbnc,
+	Client_Synth,
+	Client_Mode,
+	Client_Topic,
+	Client_Names,
+	Client_Who,
+	Client_Version,
+	Client_Ison
+};
+
+/**
+ * The client commands which are processed by ParseLineArgV.
+ */
+static const dispatchentry_t ClientCommands[] = {
+	{ "NICK", Client_Nick },
+	{ "PASS", Client_Pass },
+	{ "USER", Client_User },
+	{ "QUIT", Client_Quit },
+	{ "JOIN", Client_Join },
+	{ "WHOIS", Client_Whois },
+	{ "PRIVMSG", Client_Privmsg },
+	{ "NOTICE", Client_Notice },
+	{ "USERHOST", Client_Userhost },
+	{ "PING", Client_Ping },
+	{ "PONG", Client_Pong },
+	{ "PROTOCTL", Client_Protoctl },
+	{ "SBNC", Client_Sbnc },
+	{ "SYNTH", Client_Synth },
+	{ "MODE", Client_Mode },
+	{ "TOPIC", Client_Topic },
+	{ "NAMES", Client_Names },
+	{ "WHO", Client_Who },
+	{ "VERSION", Client_Version },
+	{ "ISON", Client_Ison },
+	{ NULL, Client_Unknown }
+};
+
 /**
  * ParseLineArgV
  *
@@ -1523,6 +1971,7 @@ bool CClientConnection::ProcessBncCommand(const char *Subcommand, int argc, cons
 bool CClientConnection::ParseLineArgV(int argc, const char **argv) {
 	char *Out;
 	int rc;
+	static CDispatchTable Commands(ClientCommands);
 
 	if (argc == 0) {
 		return false;
@@ -1530,6 +1979,10 @@ bool CClientConnection::ParseLineArgV(int argc, const char **argv) {
 
 	m_LastResponse = g_CurrentTime;
 
+	if (GetOwner() != NULL) {
+		GetOwner()->FlushAttachReplayChannels(this, argc - 1, argv + 1);
+	}
+
 	const CVector<CModule *> *Modules = g_Bouncer->GetModules();
 
 	for (int i = 0; i < Modules->GetLength(); i++) {
@@ -1538,502 +1991,531 @@ bool CClientConnection::ParseLineArgV(int argc, const char **argv) {
 		}
 	}
 
-	const char *Command = argv[0];
+	int Command = Commands.Find(argv[0]);
 
 	if (GetOwner() == NULL) {
-		if (strcasecmp(Command, "nick") == 0 && argc > 1) {
-			const char *Nick = argv[1];
-
-			if (m_Nick != NULL) {
-				if (strcmp(m_Nick, Nick) != 0) {
-					WriteLine(":%s!ident@sbnc NICK :%s", m_Nick, Nick);
+		switch (Command) {
+			case Client_Nick: {
+				if (argc < 2) {
+					break;
 				}
-			}
-
-			free(m_Nick);
-			m_Nick = strdup(Nick);
 
-			if (m_Username != NULL && m_Password != NULL) {
-				ValidateUser();
-			} else if (m_Username != NULL) {
-				WriteUnformattedLine(":shroudbnc.info NOTICE AUTH :*** This server requires a "
-					"password. Use /QUOTE PASS thepassword to supply a password now.");
-			}
-		} else if (strcasecmp(Command, "pass") == 0) {
-			if (argc < 2) {
-				WriteLine(":shroudbnc.info 461 %s :Not enough parameters", m_Nick);
-			} else {
-				const char *ColonPtr = strchr(argv[1], ':');
+				const char *Nick = argv[1];
 
-				if (ColonPtr != NULL) {
-					free(m_Username);
+				if (m_Nick != NULL) {
+					if (strcmp(m_Nick, Nick) != 0) {
+						WriteLine(":%s!ident@sbnc NICK :%s", m_Nick, Nick);
+					}
+				}
 
-					m_Username = strdup(argv[1]);
-					m_Username[ColonPtr - argv[1]] = '\0';
+				free(m_Nick);
+				m_Nick = strdup(Nick);
 
-					free(m_Password);
-					m_Password = strdup(ColonPtr + 1);
-				} else{
-					free(m_Password);
-					m_Password = strdup(argv[1]);
+				if (m_Username != NULL && m_Password != NULL) {
+					ValidateUser();
+				} else if (m_Username != NULL) {
+					WriteUnformattedLine(":shroudbnc.info NOTICE AUTH :*** This server requires a "
+						"password. Use /QUOTE PASS thepassword to supply a password now.");
 				}
-			}
 
-			if (m_Nick != NULL && m_Username != NULL && m_Password != NULL) {
-				ValidateUser();
+				break;
 			}
 
-			return false;
-		} else if (strcasecmp(Command, "user") == 0 && argc > 1) {
-			if (m_Username && m_Nick) {
-				WriteLine(":shroudbnc.info 462 %s :You may not reregister", m_Nick);
-			} else {
-				if (!argv[1]) {
+			case Client_Pass: {
+				if (argc < 2) {
 					WriteLine(":shroudbnc.info 461 %s :Not enough parameters", m_Nick);
 				} else {
-					const char *Username = argv[1];
+					const char *ColonPtr = strchr(argv[1], ':');
 
-					if (m_Username == NULL) {
-						m_Username = strdup(Username);
+					if (ColonPtr != NULL) {
+						free(m_Username);
+
+						m_Username = strdup(argv[1]);
+						m_Username[ColonPtr - argv[1]] = '\0';
+
+						free(m_Password);
+						m_Password = strdup(ColonPtr + 1);
+					} else{
+						free(m_Password);
+						m_Password = strdup(argv[1]);
 					}
 				}
+
+				if (m_Nick != NULL && m_Username != NULL && m_Password != NULL) {
+					ValidateUser();
+				}
+
+				return false;
 			}
 
-			bool ValidSSLCert = false;
+			case Client_User: {
+				if (argc < 2) {
+					break;
+				}
+
+				if (m_Username && m_Nick) {
+					WriteLine(":shroudbnc.info 462 %s :You may not reregister", m_Nick);
+				} else {
+					if (!argv[1]) {
+						WriteLine(":shroudbnc.info 461 %s :Not enough parameters", m_Nick);
+					} else {
+						const char *Username = argv[1];
 
-			if (m_Nick != NULL && m_Username != NULL) {
-				if (m_Password != NULL || GetPeerCertificate() != NULL) {
-					ValidSSLCert = ValidateUser();
+						if (m_Username == NULL) {
+							m_Username = strdup(Username);
+						}
+					}
 				}
 
-				if (m_Password == NULL && !ValidSSLCert) {
-					WriteUnformattedLine(":shroudbnc.info NOTICE AUTH :*** This server requires "
-						"a password. Use /QUOTE PASS thepassword to supply a password now.");
+				bool ValidSSLCert = false;
+
+				if (m_Nick != NULL && m_Username != NULL) {
+					if (m_Password != NULL || GetPeerCertificate() != NULL) {
+						ValidSSLCert = ValidateUser();
+					}
+
+					if (m_Password == NULL && !ValidSSLCert) {
+						WriteUnformattedLine(":shroudbnc.info NOTICE AUTH :*** This server requires "
+							"a password. Use /QUOTE PASS thepassword to supply a password now.");
+					}
 				}
+
+				return false;
 			}
 
-			return false;
-		} else if (strcasecmp(Command, "quit") == 0) {
-			Kill("*** Thanks for flying with shroudBNC. :)");
+			case Client_Quit: {
+				Kill("*** Thanks for flying with shroudBNC. :)");
 
-			return false;
+				return false;
+			}
 		}
 	}
 
 	if (GetOwner() != NULL) {
-		if (strcasecmp(Command, "quit") == 0) {
-			char *QuitReason;
-			bool QuitAsAway = GetOwner()->GetUseQuitReason();
+		switch (Command) {
+			case Client_Quit: {
+				char *QuitReason;
+				bool QuitAsAway = GetOwner()->GetUseQuitReason();
+
+				if (argc > 1 && argv[1][0] != '\0') {
+					if (QuitAsAway) {
+						GetOwner()->SetAwayText(argv[1]);
+					}
 
-			if (argc > 1 && argv[1][0] != '\0') {
-				if (QuitAsAway) {
-					GetOwner()->SetAwayText(argv[1]);
+					rc = asprintf(&QuitReason, "Quit: %s", argv[1]);
+				} else {
+					rc = asprintf(&QuitReason, "Quit");
 				}
 
-				rc = asprintf(&QuitReason, "Quit: %s", argv[1]);
-			} else {
-				rc = asprintf(&QuitReason, "Quit");
-			}
+				if (!RcFailed(rc)) {
+					SetQuitReason(QuitReason);
 
-			if (!RcFailed(rc)) {
-				SetQuitReason(QuitReason);
+					free(QuitReason);
+				}
 
-				free(QuitReason);
+				Kill("*** Thanks for flying with shroudBNC. :)");
+				return false;
 			}
 
-			Kill("*** Thanks for flying with shroudBNC. :)");
-			return false;
-		} else if (strcasecmp(Command, "nick") == 0) {
-			if (argc >= 2) {
-				free(m_Nick);
-				m_Nick = strdup(argv[1]);
+			case Client_Nick: {
+				if (argc >= 2) {
+					free(m_Nick);
+					m_Nick = strdup(argv[1]);
+
+					GetOwner()->SetNick(argv[1]);
+				}
 
-				GetOwner()->SetNick(argv[1]);
+				break;
 			}
-		} else if (argc > 1 && strcasecmp(Command, "join") == 0) {
-			CIRCConnection *IRC;
-			const char *Key;
 
-			if (argc > 2 && strchr(argv[0], ',') == NULL && strchr(argv[1], ',') == NULL) {
-				GetOwner()->GetKeyring()->SetKey(argv[1], argv[2]);
-			} else if (GetOwner()->GetKeyring() != NULL && (Key = GetOwner()->GetKeyring()->GetKey(argv[1])) != NULL && (IRC = GetOwner()->GetIRCConnection()) != NULL) {
-				IRC->WriteLine("JOIN %s %s", argv[1], Key);
+			case Client_Join: {
+				if (argc < 2) {
+					break;
+				}
 
-				return false;
-			}
-		} else if (strcasecmp(Command, "whois") == 0) {
-			if (argc >= 2) {
-				const char *Nick = argv[1];
+				CIRCConnection *IRC;
+				const char *Key;
 
-				if (strcasecmp("-sbnc", Nick) == 0) {
-					WriteLine(":shroudbnc.info 311 %s -sBNC core shroudbnc.info * :shroudBNC", m_Nick);
-					WriteLine(":shroudbnc.info 312 %s -sBNC shroudbnc.info :shroudBNC IRC Proxy", m_Nick);
-					WriteLine(":shroudbnc.info 318 %s -sBNC :End of /WHOIS list.", m_Nick);
+				if (argc > 2 && strchr(argv[0], ',') == NULL && strchr(argv[1], ',') == NULL) {
+					GetOwner()->GetKeyring()->SetKey(argv[1], argv[2]);
+				} else if (GetOwner()->GetKeyring() != NULL && (Key = GetOwner()->GetKeyring()->GetKey(argv[1])) != NULL && (IRC = GetOwner()->GetIRCConnection()) != NULL) {
+					IRC->WriteLine("JOIN %s %s", argv[1], Key);
 
 					return false;
 				}
-			}
-		} else if (argc > 2 && strcasecmp(Command, "privmsg") == 0 && strcasecmp(argv[1], "-sbnc") == 0) {
-			tokendata_t Tokens;
-			
-			Tokens = ArgTokenize2(argv[2]);
 
-			const char **Arr = ArgToArray2(Tokens);
+				break;
+			}
 
-			ProcessBncCommand(Arr[0], ArgCount2(Tokens), Arr, false);
+			case Client_Whois: {
+				if (argc >= 2) {
+					const char *Nick = argv[1];
 
-			ArgFreeArray(Arr);
+					if (strcasecmp("-sbnc", Nick) == 0) {
+						WriteLine(":shroudbnc.info 311 %s -sBNC core shroudbnc.info * :shroudBNC", m_Nick);
+						WriteLine(":shroudbnc.info 312 %s -sBNC shroudbnc.info :shroudBNC IRC Proxy", m_Nick);
+						WriteLine(":shroudbnc.info 318 %s -sBNC :End of /WHOIS list.", m_Nick);
 
-			return false;
-		} else if (argc > 2 && strcasecmp(Command, "privmsg") == 0) {
-			CVector<client_t> *Clients = GetOwner()->GetClientConnections();
-			const char *Site;
-			char *Hostmask;
+						return false;
+					}
+				}
 
-			if (GetOwner()->GetIRCConnection() == NULL) {
-				return false;
+				break;
 			}
 
-			Site = GetOwner()->GetIRCConnection()->GetSite();
-
-			rc = asprintf(&Hostmask, "%s!%s", GetOwner()->GetNick(), Site ? Site : "unknown@unknown.host");
+			case Client_Privmsg: {
+				if (argc < 3) {
+					break;
+				}
 
-			if (RcFailed(rc)) {
-				free(Hostmask);
+				if (strcasecmp(argv[1], "-sbnc") == 0) {
+					tokendata_t Tokens;
+			
+					Tokens = ArgTokenize2(argv[2]);
 
-				return false;
-			}
+					const char **Arr = ArgToArray2(Tokens);
 
-			if (strcasecmp(GetOwner()->GetNick(), argv[1]) == 0) {
-				WriteLine(":%s PRIVMSG %s :%s", Hostmask, GetOwner()->GetNick(), argv[2]);
-				free(Hostmask);
+					ProcessBncCommand(Arr[0], ArgCount2(Tokens), Arr, false);
 
-				return false;
-			}
+					ArgFreeArray(Arr);
 
-			CChannel *Channel = GetOwner()->GetIRCConnection()->GetChannel(argv[1]);
+					return false;
+				}
 
-			if (Channel != NULL) {
-				Channel->AddBacklogLine(Hostmask, argv[2]);
-			}
+				CVector<client_t> *Clients = GetOwner()->GetClientConnections();
+				const char *Site;
+				char *Hostmask;
 
-			for (int i = 0; i < Clients->GetLength(); i++) {
-				if ((*Clients)[i].Client != this) {
-					if (Channel == NULL) {
-						(*Clients)[i].Client->WriteLine(":%s!%s PRIVMSG %s :-> %s", argv[1],
-							Site ? Site : "unknown@unknown.host", GetOwner()->GetNick(), argv[2]);
-					} else {
-						(*Clients)[i].Client->WriteLine(":%s PRIVMSG %s :%s", Hostmask, argv[1], argv[2]);
-					}
+				if (GetOwner()->GetIRCConnection() == NULL) {
+					return false;
 				}
-			}
-
-			free(Hostmask);
-		} else if (argc > 2 && strcasecmp(Command, "notice") == 0) {
-			const char *Site;
 
-			if (GetOwner()->GetIRCConnection() == NULL) {
-				return false;
-			}
+				Site = GetOwner()->GetIRCConnection()->GetSite();
 
-			Site = GetOwner()->GetIRCConnection()->GetSite();
+				rc = asprintf(&Hostmask, "%s!%s", GetOwner()->GetNick(), Site ? Site : "unknown@unknown.host");
 
-			if (strcasecmp(GetOwner()->GetNick(), argv[1]) == 0) {
-				WriteLine(":%s!%s NOTICE %s :%s", GetOwner()->GetNick(), Site ? Site : "unknown@unknown.host", GetOwner()->GetNick(), argv[2]);
+				if (RcFailed(rc)) {
+					free(Hostmask);
 
-				return false;
-			}
-		} else if (strcasecmp(Command, "userhost") == 0) {
-			if (argc == 2 && strcasecmp(argv[1], m_Nick) == 0) {
-				const char *Server, *Ident;
-				CIRCConnection *IRC;
+					return false;
+				}
 
-				IRC = GetOwner()->GetIRCConnection();
+				if (strcasecmp(GetOwner()->GetNick(), argv[1]) == 0) {
+					WriteLine(":%s PRIVMSG %s :%s", Hostmask, GetOwner()->GetNick(), argv[2]);
+					free(Hostmask);
 
-				if (IRC != NULL) {
-					Server = IRC->GetServer();
-				} else {
-					Server = "bouncer";
+					return false;
 				}
 
-				Ident = GetOwner()->GetIdent();
+				CChannel *Channel = GetOwner()->GetIRCConnection()->GetChannel(argv[1]);
+
+				if (Channel != NULL) {
+					Channel->AddBacklogLine(Hostmask, argv[2]);
+				}
 
-				if (Ident == NULL) {
-					Ident = GetOwner()->GetUsername();
+				for (int i = 0; i < Clients->GetLength(); i++) {
+					if ((*Clients)[i].Client != this) {
+						if (Channel == NULL) {
+							(*Clients)[i].Client->WriteLine(":%s!%s PRIVMSG %s :-> %s", argv[1],
+								Site ? Site : "unknown@unknown.host", GetOwner()->GetNick(), argv[2]);
+						} else {
+							(*Clients)[i].Client->WriteLine(":%s PRIVMSG %s :%s", Hostmask, argv[1], argv[2]);
+						}
+					}
 				}
 
-				WriteLine(":%s 302 %s :%s=+%s@%s", Server, m_Nick, m_Nick, Ident, m_PeerName);
+				free(Hostmask);
 
-				return false;
+				break;
 			}
-		} else if (argc > 1 && strcasecmp(Command, "ping") == 0) {
-			if (GetOwner()->GetIRCConnection() == NULL) {
-				WriteLine(":shroudbnc.info PONG :%s", argv[1]);
 
-				return false;
-			}
-		} else if (strcasecmp(Command, "protoctl") == 0) {
-			if (argc > 1 && strcasecmp(argv[1], "namesx") == 0) {
-				m_NamesXSupport = true;
+			case Client_Notice: {
+				if (argc < 3) {
+					break;
+				}
 
-				return false;
-			}
-		} else if (strcasecmp(Command, "sbnc") == 0) {
-			return ProcessBncCommand(argv[1], argc - 1, &argv[1], true);
-		} else if (strcasecmp(Command, "synth") == 0) {
-			if (argc < 2) {
-				Privmsg("Syntax: SYNTH command parameter");
-				Privmsg("supported commands are: mode, topic, names, version, version-forcereply, who");
+				const char *Site;
 
-				return false;
-			}
+				if (GetOwner()->GetIRCConnection() == NULL) {
+					return false;
+				}
 
-			if (strcasecmp(argv[1], "mode") == 0 && argc > 2) {
-				CIRCConnection *IRC = GetOwner()->GetIRCConnection();
+				Site = GetOwner()->GetIRCConnection()->GetSite();
 
-				if (IRC) {
-					CChannel *Chan = IRC->GetChannel(argv[2]);
+				if (strcasecmp(GetOwner()->GetNick(), argv[1]) == 0) {
+					WriteLine(":%s!%s NOTICE %s :%s", GetOwner()->GetNick(), Site ? Site : "unknown@unknown.host", GetOwner()->GetNick(), argv[2]);
 
-					if (argc == 3) {
-						if (Chan && Chan->AreModesValid()) {
-							WriteLine(":%s 324 %s %s %s", IRC->GetServer(), IRC->GetCurrentNick(), argv[2], (const char *)Chan->GetChannelModes());
-							WriteLine(":%s 329 %s %s %d", IRC->GetServer(), IRC->GetCurrentNick(), argv[2], Chan->GetCreationTime());
-						} else
-							IRC->WriteLine("MODE %s", argv[2]);
-					} else if (argc == 4 && strcmp(argv[3],"+b") == 0) {
-						if (Chan && Chan->HasBans()) {
-							CBanlist *Bans = Chan->GetBanlist();
+					return false;
+				}
 
-							int i = 0; 
+				break;
+			}
 
-							while (const hash_t<ban_t *> *BanHash = Bans->Iterate(i++)) {
-								ban_t *Ban = BanHash->Value;
+			case Client_Userhost: {
+				if (argc == 2 && strcasecmp(argv[1], m_Nick) == 0) {
+					const char *Server, *Ident;
+					CIRCConnection *IRC;
 
-								WriteLine(":%s 367 %s %s %s %s %d", IRC->GetServer(), IRC->GetCurrentNick(), argv[2], Ban->Mask, Ban->Nick, Ban->Timestamp);
-							}
+					IRC = GetOwner()->GetIRCConnection();
 
-							WriteLine(":%s 368 %s %s :End of Channel Ban List", IRC->GetServer(), IRC->GetCurrentNick(), argv[2]);
-						} else
-							IRC->WriteLine("MODE %s +b", argv[2]);
+					if (IRC != NULL) {
+						Server = IRC->GetServer();
+					} else {
+						Server = "bouncer";
 					}
-				}
-			} else if (strcasecmp(argv[1], "topic") == 0 && argc > 2) {
-				CIRCConnection *IRC = GetOwner()->GetIRCConnection();
 
-				if (IRC) {
-					CChannel *Chan = IRC->GetChannel(argv[2]);
+					Ident = GetOwner()->GetIdent();
 
-					if (Chan && Chan->HasTopic() != 0) {
-						if (Chan->GetTopic() && *(Chan->GetTopic())) {
-							WriteLine(":%s 332 %s %s :%s", IRC->GetServer(), IRC->GetCurrentNick(), argv[2], Chan->GetTopic());
-							WriteLine(":%s 333 %s %s %s %d", IRC->GetServer(), IRC->GetCurrentNick(), argv[2], Chan->GetTopicNick(), Chan->GetTopicStamp());
-						}
-					} else {
-						IRC->WriteLine("TOPIC %s", argv[2]);
+					if (Ident == NULL) {
+						Ident = GetOwner()->GetUsername();
 					}
-				}
-			} else if (strcasecmp(argv[1], "names") == 0 && argc > 2) {
-				CIRCConnection *IRC = GetOwner()->GetIRCConnection();
 
-				if (IRC) {
-					CChannel *Chan = IRC->GetChannel(argv[2]);
+					WriteLine(":%s 302 %s :%s=+%s@%s", Server, m_Nick, m_Nick, Ident, m_PeerName);
 
-					if (Chan && Chan->HasNames() != 0) {
-						char *Nicks = (char *)malloc(1);
-						Nicks[0] = '\0';
+					return false;
+				}
 
-						const CHashtable<CNick *, false> *H = Chan->GetNames();
+				break;
+			}
 
-						int a = 0;
+			case Client_Ping: {
+				if (argc < 2) {
+					break;
+				}
 
-						while (hash_t<CNick *> *NickHash = H->Iterate(a++)) {
-							size_t Size;
-							CNick *NickObj = NickHash->Value;
+				if (GetOwner()->GetIRCConnection() == NULL) {
+					WriteLine(":shroudbnc.info PONG :%s", argv[1]);
 
-							const char *Prefix = NickObj->GetPrefixes();
-							const char *Nick = NickObj->GetNick();
+					return false;
+				}
 
-							const char *outPref;
-							char outPrefTemp[2] = { IRC->GetHighestUserFlag(Prefix), '\0' };
+				break;
+			}
 
-							if (m_NamesXSupport) {
-								if (Prefix != NULL) {
-									outPref = Prefix;
-								} else {
-									outPref = "";
-								}
-							} else {
-								outPref = outPrefTemp;
-							}
+			case Client_Protoctl: {
+				if (argc > 1 && strcasecmp(argv[1], "namesx") == 0) {
+					m_NamesXSupport = true;
 
-							if (Nick == NULL) {
-								continue;
-							}
+					return false;
+				}
 
-							Size = (Nicks ? strlen(Nicks) : 0) + strlen(outPref) + strlen(Nick) + 2;
-							Nicks = (char *)realloc(Nicks, Size);
+				break;
+			}
 
-							if (Nicks == NULL) {
-								Kill("CClientConnection::ParseLineArgV: realloc() failed. Please reconnect.");
+			case Client_Sbnc: {
+				return ProcessBncCommand(argv[1], argc - 1, &argv[1], true);
+			}
 
-								return false;
-							}
+			case Client_Synth: {
+				if (argc < 2) {
+					Privmsg("Syntax: SYNTH command parameter");
+					Privmsg("supported commands are: mode, topic, names, version, version-forcereply, who");
 
-							if (Nicks[0] != '\0') {
-								strmcat(Nicks, " ", Size);
-							}
+					return false;
+				}
 
-							strmcat(Nicks, outPref, Size);
-							strmcat(Nicks, Nick, Size);
+				if (strcasecmp(argv[1], "mode") == 0 && argc > 2) {
+					CIRCConnection *IRC = GetOwner()->GetIRCConnection();
 
-							if (strlen(Nicks) > 400) {
-								WriteLine(":%s 353 %s = %s :%s", IRC->GetServer(), IRC->GetCurrentNick(), argv[2], Nicks);
+					if (IRC) {
+						CChannel *Chan = IRC->GetChannel(argv[2]);
 
-								Nicks = (char *)realloc(Nicks, 1);
+						if (argc == 3) {
+							if (Chan && Chan->AreModesValid()) {
+								WriteLine(":%s 324 %s %s %s", IRC->GetServer(), IRC->GetCurrentNick(), argv[2], (const char *)Chan->GetChannelModes());
+								WriteLine(":%s 329 %s %s %d", IRC->GetServer(), IRC->GetCurrentNick(), argv[2], Chan->GetCreationTime());
+							} else
+								IRC->WriteLine("MODE %s", argv[2]);
+						} else if (argc == 4 && strcmp(argv[3],"+b") == 0) {
+							if (Chan && Chan->HasBans()) {
+								CBanlist *Bans = Chan->GetBanlist();
 
-								if (Nicks == NULL) {
-									Kill("CClientConnection::ParseLineArgV: realloc() failed. Please reconnect.");
+								int i = 0; 
 
-									return false;
+								while (const hash_t<ban_t *> *BanHash = Bans->Iterate(i++)) {
+									ban_t *Ban = BanHash->Value;
+
+									WriteLine(":%s 367 %s %s %s %s %d", IRC->GetServer(), IRC->GetCurrentNick(), argv[2], Ban->Mask, Ban->Nick, Ban->Timestamp);
 								}
 
-								*Nicks = '\0';
-							}
+								WriteLine(":%s 368 %s %s :End of Channel Ban List", IRC->GetServer(), IRC->GetCurrentNick(), argv[2]);
+							} else
+								IRC->WriteLine("MODE %s +b", argv[2]);
 						}
+					}
+				} else if (strcasecmp(argv[1], "topic") == 0 && argc > 2) {
+					CIRCConnection *IRC = GetOwner()->GetIRCConnection();
+
+					if (IRC) {
+						CChannel *Chan = IRC->GetChannel(argv[2]);
 
-						if (a) {
-							WriteLine(":%s 353 %s = %s :%s", IRC->GetServer(), IRC->GetCurrentNick(), argv[2], Nicks);
+						if (Chan) {
+							Chan->SendTopicReply(this);
+						} else {
+							IRC->WriteLine("TOPIC %s", argv[2]);
 						}
+					}
+				} else if (strcasecmp(argv[1], "names") == 0 && argc > 2) {
+					CIRCConnection *IRC = GetOwner()->GetIRCConnection();
 
-						free(Nicks);
+					if (IRC) {
+						CChannel *Chan = IRC->GetChannel(argv[2]);
 
-						WriteLine(":%s 366 %s %s :End of /NAMES list.", IRC->GetServer(), IRC->GetCurrentNick(), argv[2]);
-					} else {
-						IRC->WriteLine("NAMES %s", argv[2]);
+						if (Chan) {
+							Chan->SendNamesReply(this);
+						} else {
+							IRC->WriteLine("NAMES %s", argv[2]);
+						}
 					}
-				}
-			} else if (strcasecmp(argv[1], "who") == 0 && argc > 2) {
-				CIRCConnection *IRC = GetOwner()->GetIRCConnection();
+				} else if (strcasecmp(argv[1], "who") == 0 && argc > 2) {
+					CIRCConnection *IRC = GetOwner()->GetIRCConnection();
 
-				if (IRC) {
-					CChannel *Channel = IRC->GetChannel(argv[2]);
+					if (IRC) {
+						CChannel *Channel = IRC->GetChannel(argv[2]);
 
-					if (Channel && g_CurrentTime - GetOwner()->GetLastSeen() < 300 && Channel->SendWhoReply(this, true)) {
-						Channel->SendWhoReply(this, false);
-					} else {
-						IRC->WriteLine("WHO %s", argv[2]);
+						if (Channel && g_CurrentTime - GetOwner()->GetLastSeen() < 300 && Channel->SendWhoReply(this, true)) {
+							Channel->SendWhoReply(this, false);
+						} else {
+							IRC->WriteLine("WHO %s", argv[2]);
+						}
 					}
-				}
-			} else if ((strcasecmp(argv[1], "version") == 0 || strcasecmp(argv[1], "version-forcereply") == 0) && argc >= 2) {
-				CIRCConnection *IRC = GetOwner()->GetIRCConnection();
+				} else if ((strcasecmp(argv[1], "version") == 0 || strcasecmp(argv[1], "version-forcereply") == 0) && argc >= 2) {
+					CIRCConnection *IRC = GetOwner()->GetIRCConnection();
 
-				if (IRC != NULL) {
-					const char *ServerVersion = IRC->GetServerVersion();
-					const char *ServerFeat = IRC->GetServerFeat();
+					if (IRC != NULL) {
+						const char *ServerVersion = IRC->GetServerVersion();
+						const char *ServerFeat = IRC->GetServerFeat();
 
-					if (ServerVersion != NULL && ServerFeat != NULL) {
-						WriteLine(":%s 351 %s %s %s :%s", IRC->GetServer(), IRC->GetCurrentNick(), ServerVersion, IRC->GetServer(), ServerFeat);
-					} else if (strcasecmp(argv[1], "version-forcereply") != 0) {
-						IRC->WriteLine("VERSION");
+						if (ServerVersion != NULL && ServerFeat != NULL) {
+							WriteLine(":%s 351 %s %s %s :%s", IRC->GetServer(), IRC->GetCurrentNick(), ServerVersion, IRC->GetServer(), ServerFeat);
+						} else if (strcasecmp(argv[1], "version-forcereply") != 0) {
+							IRC->WriteLine("VERSION");
 
-						return false;
-					}
+							return false;
+						}
 
-					char *Feats = (char *)malloc(1);
-					Feats[0] = '\0';
+						char *Feats = (char *)malloc(1);
+						Feats[0] = '\0';
 
-					int a = 0, i = 0;
+						int a = 0, i = 0;
 
-					while (hash_t<char *> *Feat = IRC->GetISupportAll()->Iterate(i++)) {
-						size_t Size;
-						char *Name = Feat->Name;
-						char *Value = Feat->Value;
+						while (hash_t<char *> *Feat = IRC->GetISupportAll()->Iterate(i++)) {
+							size_t Size;
+							char *Name = Feat->Name;
+							char *Value = Feat->Value;
 
-						Size = (Feats ? strlen(Feats) : 0) + strlen(Name) + 1 + strlen(Value) + 2;
-						Feats = (char *)realloc(Feats, Size);
+							Size = (Feats ? strlen(Feats) : 0) + strlen(Name) + 1 + strlen(Value) + 2;
+							Feats = (char *)realloc(Feats, Size);
 
-						if (Feats == NULL) {
-							Kill("CClientConnection::ParseLineArgV: realloc() failed. Please reconnect.");
+							if (Feats == NULL) {
+								Kill("CClientConnection::ParseLineArgV: realloc() failed. Please reconnect.");
 
-							return false;
-						}
+								return false;
+							}
 
 
-						if (Feats[0] != '\0') {
-							strmcat(Feats, " ", Size);
-						}
+							if (Feats[0] != '\0') {
+								strmcat(Feats, " ", Size);
+							}
 
-						strmcat(Feats, Name, Size);
+							strmcat(Feats, Name, Size);
 
-						if (Value != NULL && Value[0] != '\0') {
-							strmcat(Feats, "=", Size);
-							strmcat(Feats, Value, Size);
-						}
+							if (Value != NULL && Value[0] != '\0') {
+								strmcat(Feats, "=", Size);
+								strmcat(Feats, Value, Size);
+							}
 
-						if (++a == 11) {
-							WriteLine(":%s 005 %s %s :are supported by this server", IRC->GetServer(), IRC->GetCurrentNick(), Feats);
+							if (++a == 11) {
+								WriteLine(":%s 005 %s %s :are supported by this server", IRC->GetServer(), IRC->GetCurrentNick(), Feats);
 
-							Feats = (char *)realloc(Feats, 1);
+								Feats = (char *)realloc(Feats, 1);
 
-							if (Feats == NULL) {
-								Kill("CClientConnection::ParseLineArgV: realloc() failed. Please reconnect.");
+								if (Feats == NULL) {
+									Kill("CClientConnection::ParseLineArgV: realloc() failed. Please reconnect.");
 
-								return false;
+									return false;
 					
+								}
+
+								*Feats = '\0';
+								a = 0;
 							}
+						}
 
-							*Feats = '\0';
-							a = 0;
+						if (a > 0) {
+							WriteLine(":%s 005 %s %s :are supported by this server", IRC->GetServer(), IRC->GetCurrentNick(), Feats);
 						}
+
+						free(Feats);
+					}
+				}
+
+				return false;
+			}
+
+			case Client_Mode:
+			case Client_Topic:
+			case Client_Names:
+			case Client_Who: {
+				if (argc == 2 || ((Command == Client_Mode && argc == 3) && strcmp(argv[2],"+b") == 0)) {
+					if (argc == 2) {
+						rc = asprintf(&Out, "SYNTH %s :%s", argv[0], argv[1]);
+					} else {
+						rc = asprintf(&Out, "SYNTH %s %s :%s", argv[0], argv[1], argv[2]);
 					}
 
-					if (a > 0) {
-						WriteLine(":%s 005 %s %s :are supported by this server", IRC->GetServer(), IRC->GetCurrentNick(), Feats);
+					if (!RcFailed(rc)) {
+						ParseLine(Out);
+						free(Out);
 					}
 
-					free(Feats);
+					return false;
 				}
+
+				break;
 			}
 
-			return false;
-		} else if (strcasecmp(Command, "mode") == 0 || strcasecmp(Command, "topic") == 0 ||
-				strcasecmp(Command, "names") == 0 || strcasecmp(Command, "who") == 0) {
-			if (argc == 2 || ((strcasecmp(Command, "mode") == 0 && argc == 3) && strcmp(argv[2],"+b") == 0)) {
-				if (argc == 2) {
-					rc = asprintf(&Out, "SYNTH %s :%s", argv[0], argv[1]);
-				} else {
-					rc = asprintf(&Out, "SYNTH %s %s :%s", argv[0], argv[1], argv[2]);
+			case Client_Version: {
+				if (argc > 2) {
+					break;
 				}
 
-				if (!RcFailed(rc)) {
-					ParseLine(Out);
-					free(Out);
+				ParseLine("SYNTH VERSION");
+
+				return false;
+			}
+
+			case Client_Pong: {
+				if (argc < 2 || strcasecmp(argv[1], "sbnc") != 0) {
+					break;
 				}
 
 				return false;
 			}
-		} else if (strcasecmp(Command, "version") == 0 && argc <= 2) {
-			ParseLine("SYNTH VERSION");
 
-			return false;
-		} else if (strcasecmp(Command, "pong") == 0 && argc > 1 && strcasecmp(argv[1], "sbnc") == 0) {
-			return false;
-		} else if (strcasecmp(Command, "ison") == 0 && GetUser()->GetIRCConnection() == NULL) {
-			for (int i = 1; i < argc; i++) {
-				if (strcasecmp(argv[i], "-sbnc") == 0) {
-					CIRCConnection *IRC = GetOwner()->GetIRCConnection();
-					const char *Server, *Nick;
+			case Client_Ison: {
+				if (GetUser()->GetIRCConnection() != NULL) {
+					break;
+				}
 
-					if (IRC != NULL) {
-						Server = IRC->GetServer();
-						Nick = IRC->GetCurrentNick();
-					} else {
-						Server = "shroudbnc.info";
-						Nick = GetNick();
-					}
+				for (int i = 1; i < argc; i++) {
+					if (strcasecmp(argv[i], "-sbnc") == 0) {
+						CIRCConnection *IRC = GetOwner()->GetIRCConnection();
+						const char *Server, *Nick;
+
+						if (IRC != NULL) {
+							Server = IRC->GetServer();
+							Nick = IRC->GetCurrentNick();
+						} else {
+							Server = "shroudbnc.info";
+							Nick = GetNick();
+						}
 
-					WriteLine(":%s 303 %s :-sBNC", Server, Nick);
+						WriteLine(":%s 303 %s :-sBNC", Server, Nick);
+					}
 				}
+
+				break;
 			}
 		}
 	}
@@ -2055,15 +2537,12 @@ void CClientConnection::ParseLine(const char *Line) {
 
 	bool ReturnValue;
 	tokendata_t Args;
-	const char **argv, **real_argv;
+	const char *real_argv[33], **argv;
 	int argc;
 
 	Args = ArgTokenize2(Line);
-	argv = real_argv = ArgToArray2(Args);
-
-	if (AllocFailed(argv)) {
-		return;
-	}
+	ArgToArray2(Args, real_argv);
+	argv = real_argv;
 
 	argc = ArgCount2(Args);
 
@@ -2080,8 +2559,6 @@ void CClientConnection::ParseLine(const char *Line) {
 		ReturnValue = true;
 	}
 
-	ArgFreeArray(real_argv);
-
 	if (GetOwner() != NULL && ReturnValue) {
 		CIRCConnection *IRC = GetOwner()->GetIRCConnection();
 
@@ -2165,6 +2642,10 @@ bool CClientConnection::ValidateUser(void) {
 	if ((m_Password || Force) && User && !Blocked && Valid) {
 		User->Attach(this);
 	} else {
+		if (User == NULL || !Blocked) {
+			g_Bouncer->GetAdmission()->LogBadLogin(Remote);
+		}
+
 		if (User != NULL) {
 			if (!Blocked) {
 				User->LogBadLogin(Remote);
@@ -2367,6 +2848,28 @@ int CClientConnection::Read(bool DontProcess) {
 void CClientConnection::WriteUnformattedLine(const char *Line) {
 	CConnection::WriteUnformattedLine(Line);
 
+	CheckSendQ();
+}
+
+/**
+ * WriteSharedLine
+ *
+ * Sends a shared line to the client.
+ *
+ * @param Line the line
+ */
+void CClientConnection::WriteSharedLine(shared_line_t *Line) {
+	CConnection::WriteSharedLine(Line);
+
+	CheckSendQ();
+}
+
+/**
+ * CheckSendQ
+ *
+ * Disconnects the client if its sendq has grown too large.
+ */
+void CClientConnection::CheckSendQ(void) {
 	if (GetOwner() != NULL && !GetOwner()->IsAdmin() && GetSendqSize() > g_Bouncer->GetSendqSize() * 1024) {
 		FlushSendQ();
 		CConnection::WriteUnformattedLine("");
@@ -2554,6 +3057,16 @@ const char *CClientConnection::GetQuitReason(void) const {
 	return m_QuitReason;
 }
 
+/**
+ * GetNamesXSupport
+ *
+ * Returns whether the client has enabled NAMESX (i.e. wants to see all
+ * prefixes in NAMES replies).
+ */
+bool CClientConnection::GetNamesXSupport(void) const {
+	return m_NamesXSupport;
+}
+
 void CClientConnection::Error(int ErrorCode) {
 	char *ErrorMsg = NULL;
 
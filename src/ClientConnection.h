@@ -81,6 +81,7 @@ private:
 	virtual const char *GetClassName(void) const;
 	bool ParseLineArgV(int argc, const char **argv);
 	bool ProcessBncCommand(const char *Subcommand, int argc, const char **argv, bool NoticeUser);
+	void CheckSendQ(void);
 
 	CClientConnection();
 
@@ -112,7 +113,10 @@ public:
 	virtual void SetQuitReason(const char *Reason);
 	virtual const char *GetQuitReason(void) const;
 
+	bool GetNamesXSupport(void) const;
+
 	virtual void WriteUnformattedLine(const char *Line);
+	virtual void WriteSharedLine(shared_line_t *Line);
 };
 
 #ifdef SBNC
@@ -135,6 +139,17 @@ class SBNCAPI CFakeClient : public CClientConnection {
 	virtual void WriteUnformattedLine(const char *Line) {
 		m_Queue.WriteUnformattedLine(Line);
 	}
+
+	/**
+	 * WriteSharedLine
+	 *
+	 * Re-implementation of CClientConnection::WriteSharedLine.
+	 *
+	 * @param Line the line
+	 */
+	virtual void WriteSharedLine(shared_line_t *Line) {
+		m_Queue.WriteSharedLine(Line);
+	}
 public:
 	/**
 	 * CFakeClient
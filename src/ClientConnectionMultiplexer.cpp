@@ -91,10 +91,28 @@ void CClientConnectionMultiplexer::RealNotice(const char *Text) {
 
 void CClientConnectionMultiplexer::WriteUnformattedLine(const char *Line) {
 	CVector<client_t> *Clients = GetOwner()->GetClientConnections();
+	shared_line_t *SharedLine;
+
+	if (Clients->GetLength() == 0) {
+		return;
+	} else if (Clients->GetLength() == 1) {
+		(*Clients)[0].Client->WriteUnformattedLine(Line);
+
+		return;
+	}
+
+	// the line is copied once and queued for all clients
+	SharedLine = CFIFOBuffer::CreateSharedLine(Line);
+
+	if (SharedLine == NULL) {
+		return;
+	}
 
 	for (int i = 0; i < Clients->GetLength(); i++) {
-		(*Clients)[i].Client->WriteUnformattedLine(Line);
+		(*Clients)[i].Client->WriteSharedLine(SharedLine);
 	}
+
+	CFIFOBuffer::ReleaseSharedLine(SharedLine);
 }
 
 void CClientConnectionMultiplexer::Shutdown(void) {
@@ -19,13 +19,37 @@
 
 #include "StdAfx.h"
 
+/**
+ * ConfigFlushTimer
+ *
+ * Writes changed settings to disk.
+ *
+ * @param Now the current time
+ * @param Cookie the configuration object
+ */
+bool ConfigFlushTimer(time_t Now, void *Cookie) {
+	CConfig *Config = (CConfig *)Cookie;
+	RESULT<bool> Result;
+
+	Config->m_FlushTimer = NULL;
+
+	Result = Config->Flush();
+
+	if (IsError(Result)) {
+		g_Bouncer->Log("Could not save config file %s: %s", Config->GetFilename(),
+			GETDESCRIPTION(Result));
+	}
+
+	return false;
+}
+
 /**
  * CConfig
  *
- * Constructs a new configuration object and loads the given filename
- * if specified. If you specify NULL as the filename, a volatile
- * configuration object is constructed. Changes made to such an object
- * are not stored to disk.
+ * Constructs a new configuration object for the given filename. The file
+ * is not read until one of the settings is accessed for the first time. If
+ * you specify NULL as the filename, a volatile configuration object is
+ * constructed. Changes made to such an object are not stored to disk.
  *
  * @param Filename the filename of the configuration file, can be NULL
  */
@@ -33,6 +57,10 @@ CConfig::CConfig(const char *Filename, CUser *Owner) {
 	SetOwner(Owner);
 
 	m_WriteLock = false;
+	m_FlushTimer = NULL;
+	m_JournalEntries = 0;
+	m_NeedsCompaction = false;
+	m_Loaded = false;
 
 	m_Settings.RegisterValueDestructor(FreeString);
 
@@ -42,70 +70,106 @@ CConfig::CConfig(const char *Filename, CUser *Owner) {
 		if (AllocFailed(m_Filename)) {
 			g_Bouncer->Fatal();
 		}
+
+		int rc = asprintf(&m_JournalFilename, "%s.journal", Filename);
+
+		if (RcFailed(rc)) {
+			g_Bouncer->Fatal();
+		}
 	} else {
 		m_Filename = NULL;
+		m_JournalFilename = NULL;
 	}
-
-	Reload();
 }
 
 /**
  * ParseConfig
  *
- * Parses a configuration file. Valid lines of the configuration file
- * have this syntax:
+ * Parses a configuration file or a journal. Valid lines have this syntax:
  *
  * setting=value
+ *
+ * Journals may also contain lines which consist of only a setting's name,
+ * these remove the setting. Incomplete lines at the end of a journal
+ * (e.g. after a crash) are ignored. The file is read in one piece and
+ * split into settings in-place.
+ *
+ * @param Filename the file
+ * @param Journal whether the file is a journal
  */
-bool CConfig::ParseConfig(void) {
-	const size_t LineLength = 131072;
-	char *Line;
-	char *dupEq;
+bool CConfig::ParseConfig(const char *Filename, bool Journal) {
+	char *Buffer, *Line, *LineEnd, *Next, *End, *Eq, *dupEq;
 	FILE *ConfigFile;
+	long Size;
 
-	if (m_Filename == NULL) {
+	ConfigFile = fopen(Filename, "rb");
+
+	if (ConfigFile == NULL) {
 		return false;
 	}
 
-	Line = (char *)malloc(LineLength);
+	if (fseek(ConfigFile, 0, SEEK_END) != 0 || (Size = ftell(ConfigFile)) < 0 ||
+			fseek(ConfigFile, 0, SEEK_SET) != 0) {
+		fclose(ConfigFile);
 
-	if (AllocFailed(Line)) {
 		return false;
 	}
 
-	ConfigFile = fopen(m_Filename, "r");
+	// one extra byte so the last line can be terminated in-place
+	Buffer = (char *)malloc(Size + 1);
 
-	if (ConfigFile == NULL) {
-		free(Line);
+	if (AllocFailed(Buffer)) {
+		fclose(ConfigFile);
 
 		return false;
 	}
 
+	Size = (long)fread(Buffer, 1, Size, ConfigFile);
+
+	fclose(ConfigFile);
+
 	m_WriteLock = true;
 
-	while (feof(ConfigFile) == 0) {
-		if (fgets(Line, LineLength, ConfigFile) == NULL) {
-			break;
-		}
+	End = Buffer + Size;
 
-		if (strlen(Line) == 0) {
-			continue;
-		}
+	for (Line = Buffer; Line < End; Line = Next) {
+		LineEnd = (char *)memchr(Line, '\n', End - Line);
+
+		if (LineEnd == NULL) {
+			if (Journal) {
+				// the journal can't be appended to until the incomplete line is gone
+				m_NeedsCompaction = true;
+
+				break;
+			}
 
-		if (Line[strlen(Line) - 1] == '\n') {
-			Line[strlen(Line) - 1] = '\0';
+			LineEnd = End;
 		}
 
-		if (Line[strlen(Line) - 1] == '\r') {
-			Line[strlen(Line) - 1] = '\0';
+		Next = LineEnd + 1;
+
+		if (LineEnd > Line && LineEnd[-1] == '\r') {
+			LineEnd--;
 		}
 
-		char *Eq = strchr(Line, '=');
+		*LineEnd = '\0';
+
+		Eq = (char *)memchr(Line, '=', LineEnd - Line);
+
+		if (Journal) {
+			m_JournalEntries++;
+
+			if (Eq == NULL) {
+				m_Settings.Remove(Line);
+
+				continue;
+			}
+		}
 
 		if (Eq != NULL) {
-			*Eq = '\0';
+			*Eq++ = '\0';
 
-			dupEq = strdup(++Eq);
+			dupEq = (char *)malloc(LineEnd - Eq + 1);
 
 			if (AllocFailed(dupEq)) {
 				if (g_Bouncer != NULL) {
@@ -115,6 +179,8 @@ bool CConfig::ParseConfig(void) {
 				}
 			}
 
+			memcpy(dupEq, Eq, LineEnd - Eq + 1);
+
 			if (m_Settings.Add(Line, dupEq) == false) {
 				g_Bouncer->Log("CHashtable::Add failed. Config could not be parsed"
 					" (%s, %s).", Line, Eq);
@@ -124,22 +190,49 @@ bool CConfig::ParseConfig(void) {
 		}
 	}
 
-	fclose(ConfigFile);
-
 	m_WriteLock = false;
 
-	free(Line);
+	free(Buffer);
 
 	return true;
 }
 
+/**
+ * Load
+ *
+ * Reads the configuration file and its journal unless that has already
+ * happened.
+ */
+void CConfig::Load(void) {
+	if (m_Loaded) {
+		return;
+	}
+
+	m_Loaded = true;
+
+	if (m_Filename != NULL) {
+		// new configuration files are written in full on the first flush
+		m_NeedsCompaction = !ParseConfig(m_Filename, false);
+
+		ParseConfig(m_JournalFilename, true);
+	}
+}
+
 /**
  * ~CConfig
  *
  * Destructs the configuration object.
  */
 CConfig::~CConfig() {
+	RESULT<bool> Result = Flush();
+
+	if (IsError(Result) && g_Bouncer != NULL) {
+		g_Bouncer->Log("Could not save config file %s: %s", m_Filename,
+			GETDESCRIPTION(Result));
+	}
+
 	free(m_Filename);
+	free(m_JournalFilename);
 }
 
 /**
@@ -151,6 +244,8 @@ CConfig::~CConfig() {
  * @param Setting the configuration setting
  */
 RESULT<const char *> CConfig::ReadString(const char *Setting) const {
+	const_cast<CConfig *>(this)->Load();
+
 	const char *Value = m_Settings.Get(Setting);
 
 	if (Value != NULL && Value[0] != '\0') {
@@ -169,6 +264,8 @@ RESULT<const char *> CConfig::ReadString(const char *Setting) const {
  * @param Setting the configuration setting
  */
 RESULT<int> CConfig::ReadInteger(const char *Setting) const {
+	const_cast<CConfig *>(this)->Load();
+
 	const char *Value = m_Settings.Get(Setting);
 
 	if (Value != NULL) {
@@ -205,8 +302,12 @@ RESULT<bool> CConfig::WriteString(const char *Setting, const char *Value) {
 
 	THROWIFERROR(bool, ReturnValue);
 
-	if (!m_WriteLock && IsError(Persist())) {
-		g_Bouncer->Fatal();
+	if (!m_WriteLock && m_Filename != NULL) {
+		if (IsError(m_Dirty.Add(Setting, true))) {
+			g_Bouncer->Fatal();
+		}
+
+		ScheduleFlush();
 	}
 
 	RETURN(bool, true);
@@ -308,6 +409,107 @@ RESULT<bool> CConfig::Persist(void) const {
 	RETURN(bool, true);
 }
 
+/**
+ * AppendJournal
+ *
+ * Appends the settings which have been changed since the last flush to
+ * the journal.
+ */
+RESULT<bool> CConfig::AppendJournal(void) {
+	FILE *Journal;
+	const char *Value;
+	int i = 0;
+
+	Journal = fopen(m_JournalFilename, "a");
+
+	if (Journal == NULL) {
+		THROW(bool, Generic_Unknown, "Could not open journal file.");
+	}
+
+	SetPermissions(m_JournalFilename, S_IRUSR | S_IWUSR);
+
+	while (hash_t<bool> *DirtyHash = m_Dirty.Iterate(i++)) {
+		Value = m_Settings.Get(DirtyHash->Name);
+
+		if (Value != NULL) {
+			fprintf(Journal, "%s=%s\n", DirtyHash->Name, Value);
+		} else {
+			fprintf(Journal, "%s\n", DirtyHash->Name);
+		}
+
+		m_JournalEntries++;
+	}
+
+	if (fclose(Journal) != 0) {
+		THROW(bool, Generic_Unknown, "Could not write journal file.");
+	}
+
+	m_Dirty.Clear();
+
+	RETURN(bool, true);
+}
+
+/**
+ * Flush
+ *
+ * Writes changed settings to disk. The configuration file is rewritten
+ * (and the journal is removed) once the journal has grown larger than the
+ * configuration file itself.
+ */
+RESULT<bool> CConfig::Flush(void) {
+	RESULT<bool> Result;
+	unsigned int Threshold;
+
+	if (m_FlushTimer != NULL) {
+		m_FlushTimer->Destroy();
+		m_FlushTimer = NULL;
+	}
+
+	if (m_Filename == NULL || (m_Dirty.GetLength() == 0 && !m_NeedsCompaction)) {
+		RETURN(bool, true);
+	}
+
+	Threshold = m_Settings.GetLength();
+
+	if (Threshold < CONFIGJOURNALSIZE) {
+		Threshold = CONFIGJOURNALSIZE;
+	}
+
+	if (!m_NeedsCompaction && m_JournalEntries + m_Dirty.GetLength() <= Threshold) {
+		return AppendJournal();
+	}
+
+	Result = Persist();
+
+	THROWIFERROR(bool, Result);
+
+	unlink(m_JournalFilename);
+
+	m_Dirty.Clear();
+	m_JournalEntries = 0;
+	m_NeedsCompaction = false;
+
+	RETURN(bool, true);
+}
+
+/**
+ * ScheduleFlush
+ *
+ * Makes sure that changed settings are written to disk within
+ * CONFIGFLUSHDELAY seconds.
+ */
+void CConfig::ScheduleFlush(void) {
+	if (m_FlushTimer != NULL) {
+		return;
+	}
+
+	m_FlushTimer = new CTimer(CONFIGFLUSHDELAY, false, ConfigFlushTimer, this);
+
+	if (AllocFailed(m_FlushTimer)) {
+		g_Bouncer->Fatal();
+	}
+}
+
 /**
  * GetFilename
  *
@@ -326,6 +528,8 @@ const char *CConfig::GetFilename(void) const {
  * @param Index specifies the index of the setting which is to be returned
  */
 hash_t<char *> *CConfig::Iterate(int Index) const {
+	const_cast<CConfig *>(this)->Load();
+
 	return m_Settings.Iterate(Index);
 }
 
@@ -335,11 +539,18 @@ hash_t<char *> *CConfig::Iterate(int Index) const {
  * Reloads all settings from disk.
  */
 void CConfig::Reload(void) {
-	m_Settings.Clear();
+	RESULT<bool> Result = Flush();
 
-	if (m_Filename != NULL) {
-		ParseConfig();
+	if (IsError(Result)) {
+		g_Bouncer->Log("Could not save config file %s: %s", m_Filename,
+			GETDESCRIPTION(Result));
 	}
+
+	m_Settings.Clear();
+	m_JournalEntries = 0;
+	m_Loaded = false;
+
+	Load();
 }
 
 /**
@@ -348,6 +559,8 @@ void CConfig::Reload(void) {
  * Returns the number of items in the config.
  */
 unsigned int CConfig::GetLength(void) const {
+	const_cast<CConfig *>(this)->Load();
+
 	return m_Settings.GetLength();
 }
 
@@ -358,6 +571,8 @@ unsigned int CConfig::GetLength(void) const {
  * Returns the hashtable which is used for caching the settings.
  */
 CHashtable<char *, false> *CConfig::GetInnerHashtable(void) {
+	Load();
+
 	return &m_Settings;
 }
 
@@ -20,21 +20,44 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#define CONFIGFLUSHDELAY 3 /**< number of seconds after which changed
+							    settings are written to the journal */
+#define CONFIGJOURNALSIZE 128 /**< minimum number of journal entries before
+							      the configuration file is compacted */
+
 /**
  * CConfig
  *
- * Represents a shroudBNC configuration file
+ * Represents a shroudBNC configuration file. Changed settings are collected
+ * and periodically appended to a journal ("<filename>.journal") which is
+ * merged into the configuration file once it grows too large.
  */
 class SBNCAPI CConfig : public CObject<CConfig, CUser> {
+#ifndef SWIG
+	friend bool ConfigFlushTimer(time_t Now, void *Cookie);
+#endif /* SWIG */
+
 private:
 	CHashtable<char *, false> m_Settings; /**< the settings */
 
 	char *m_Filename; /**< the filename of the config */
+	char *m_JournalFilename; /**< the filename of the journal */
 	bool m_WriteLock; /**< marks whether the configuration file should be
 						   updated when settings are added/removed */
 
-	bool ParseConfig(void);
+	CHashtable<bool, false> m_Dirty; /**< settings which have not been written
+										  to disk yet */
+	CTimer *m_FlushTimer; /**< used for writing changed settings to disk */
+	unsigned int m_JournalEntries; /**< the number of entries in the journal */
+	bool m_NeedsCompaction; /**< whether the configuration file has to be
+								 rewritten on the next flush */
+	bool m_Loaded; /**< whether the file has been read */
+
+	bool ParseConfig(const char *Filename, bool Journal);
+	void Load(void);
 	RESULT<bool> Persist(void) const;
+	RESULT<bool> AppendJournal(void);
+	void ScheduleFlush(void);
 
 public:
 #ifndef SWIG
@@ -59,6 +82,8 @@ public:
 	virtual unsigned int GetLength(void) const;
 
 	virtual bool CanUseCache(void);
+
+	virtual RESULT<bool> Flush(void);
 };
 
 #endif /* CONFIG_H */
@@ -20,10 +20,13 @@
 #include "StdAfx.h"
 
 #define BLOCKSIZE 4096
+#define SENDSEGMENTS 64
 
 IMPL_DNSEVENTPROXY(CConnection, AsyncDnsFinished);
 IMPL_DNSEVENTPROXY(CConnection, AsyncBindIpDnsFinished);
 
+sslhandshakestats_t CConnection::m_SSLHandshakeStats[2];
+
 /**
  * CConnection
  *
@@ -112,6 +115,9 @@ void CConnection::InitConnection(SOCKET Client, bool SSL) {
 	m_InboundTrafficReset = g_CurrentTime;
 	m_InboundTraffic = 0;
 
+	m_SSLSessionKey = NULL;
+	m_SSLHandshakeTime = 0;
+
 #ifdef HAVE_LIBSSL
 	m_HasSSL = SSL;
 	m_SSL = NULL;
@@ -139,11 +145,13 @@ void CConnection::InitConnection(SOCKET Client, bool SSL) {
  */
 CConnection::~CConnection(void) {
 	g_Bouncer->UnregisterSocket(m_Socket);
+	g_Bouncer->CancelDestroy(this);
 
 	delete m_DnsQuery;
 	delete m_BindDnsQuery;
 
 	free(m_BindIpCache);
+	free(m_SSLSessionKey);
 
 	if (m_Socket != INVALID_SOCKET) {
 		shutdown(m_Socket, SD_BOTH);
@@ -158,6 +166,13 @@ CConnection::~CConnection(void) {
 
 #ifdef HAVE_LIBSSL
 	if (IsSSL() && m_SSL != NULL) {
+		// IRC servers and clients often just close the connection without
+		// sending a close_notify alert; OpenSSL would otherwise consider the
+		// session to be broken and refuse to resume it
+		if (SSL_is_init_finished(m_SSL)) {
+			SSL_set_shutdown(m_SSL, SSL_get_shutdown(m_SSL) | SSL_SENT_SHUTDOWN);
+		}
+
 		SSL_free(m_SSL);
 	}
 #endif
@@ -197,6 +212,17 @@ void CConnection::InitSocket(void) {
 			//SSL_set_fd(m_SSL, m_Socket);
 
 			if (GetRole() == Role_Client) {
+				SSL_SESSION *Session = NULL;
+
+				if (m_SSLSessionKey != NULL) {
+					Session = g_Bouncer->GetSSLSession(m_SSLSessionKey);
+				}
+
+				// try to resume the last session with this server
+				if (Session != NULL) {
+					SSL_set_session(m_SSL, Session);
+				}
+
 				SSL_set_connect_state(m_SSL);
 			} else {
 				SSL_set_accept_state(m_SSL);
@@ -264,8 +290,14 @@ int CConnection::Read(bool DontProcess) {
 
 #ifdef HAVE_LIBSSL
 	if (IsSSL()) {
+		int64_t HandshakeStart = SSL_is_init_finished(m_SSL) ? 0 : GetCurrentTimeUs();
+
 		ReadResult = SSL_read(m_SSL, Buffer, BufferSize);
 
+		if (HandshakeStart != 0) {
+			AccountSSLHandshake(HandshakeStart);
+		}
+
 		if (ReadResult < 0) {
 			switch (SSL_get_error(m_SSL, ReadResult)) {
 				case SSL_ERROR_WANT_WRITE:
@@ -347,24 +379,69 @@ int CConnection::Write(void) {
 	Size = m_SendQ->GetSize();
 
 	if (Size > 0) {
+		const char *Segments[SENDSEGMENTS];
+		size_t Sizes[SENDSEGMENTS];
+		int Count;
 		int WriteResult;
 
+		Count = m_SendQ->GetSegments(Segments, Sizes, SENDSEGMENTS);
+
 #ifdef HAVE_LIBSSL
 		if (IsSSL()) {
-			WriteResult = SSL_write(m_SSL, m_SendQ->Peek(), Size);
-
-			if (WriteResult == -1) {
-				switch (SSL_get_error(m_SSL, WriteResult)) {
-					case SSL_ERROR_WANT_WRITE:
-					case SSL_ERROR_WANT_READ:
-						return 0;
-					default:
+			int64_t HandshakeStart = SSL_is_init_finished(m_SSL) ? 0 : GetCurrentTimeUs();
+
+			WriteResult = 0;
+
+			// there is no scatter/gather variant of SSL_write(), so the
+			// segments are written one at a time
+			for (int i = 0; i < Count; i++) {
+				int SegmentResult = SSL_write(m_SSL, Segments[i], Sizes[i]);
+
+				if (HandshakeStart != 0) {
+					AccountSSLHandshake(HandshakeStart);
+					HandshakeStart = 0;
+				}
+
+				if (SegmentResult <= 0) {
+					if (WriteResult > 0) {
 						break;
+					}
+
+					if (SegmentResult == -1) {
+						switch (SSL_get_error(m_SSL, SegmentResult)) {
+							case SSL_ERROR_WANT_WRITE:
+							case SSL_ERROR_WANT_READ:
+								return 0;
+							default:
+								break;
+						}
+					}
+
+					WriteResult = SegmentResult;
+
+					break;
+				}
+
+				WriteResult += SegmentResult;
+
+				if ((size_t)SegmentResult < Sizes[i]) {
+					break;
 				}
 			}
 		} else {
 #endif
-			WriteResult = send(m_Socket, m_SendQ->Peek(), Size, 0);
+#ifndef _WIN32
+			iovec Vectors[SENDSEGMENTS];
+
+			for (int i = 0; i < Count; i++) {
+				Vectors[i].iov_base = (void *)Segments[i];
+				Vectors[i].iov_len = Sizes[i];
+			}
+
+			WriteResult = writev(m_Socket, Vectors, Count);
+#else
+			WriteResult = send(m_Socket, Segments[0], Sizes[0], 0);
+#endif
 #ifdef HAVE_LIBSSL
 		}
 #endif
@@ -376,7 +453,7 @@ int CConnection::Write(void) {
 				m_Traffic->AddOutbound(WriteResult);
 			}
 
-			m_SendQ->Read(WriteResult);
+			m_SendQ->Consume(WriteResult);
 		} else if (WriteResult < 0) {
 			Shutdown();
 		}
@@ -389,9 +466,11 @@ int CConnection::Write(void) {
 		}
 #endif
 
+		// the socket is closed in the destructor; closing it here would
+		// silently remove it from epoll sets and the main loop would never
+		// notice that the connection is gone
 		if (m_Socket != INVALID_SOCKET) {
 			shutdown(m_Socket, SD_BOTH);
-			closesocket(m_Socket);
 		}
 	}
 
@@ -404,35 +483,24 @@ int CConnection::Write(void) {
  * Processes the data which is in the recvq.
  */
 void CConnection::ProcessBuffer(void) {
-	char *RecvQ, *Line;
-	size_t Size;
-	
-	Line = RecvQ = m_RecvQ->Peek();
-
-	Size = m_RecvQ->GetSize();
-
-	for (unsigned int i = 0; i < Size; i++) {
-		if (RecvQ[i] == '\n' || (RecvQ[i] == '\r' && Size > i + 1 && RecvQ[i + 1] == '\n')) {
-			char *dupLine = (char *)malloc(&(RecvQ[i]) - Line + 1);
-
-			if (AllocFailed(dupLine)) {
-				return;
-			}
+	char *Line;
+	size_t Length;
 
-			memcpy(dupLine, Line, &(RecvQ[i]) - Line);
-			dupLine[&(RecvQ[i]) - Line] = '\0';
+	// lines are terminated in-place and removed from the recvq before they
+	// are parsed, so ParseLine() can safely call ProcessBuffer() again
+	while ((Line = m_RecvQ->PeekLine(&Length)) != NULL) {
+		Line[Length] = '\0';
 
-			if (dupLine[0] != '\0') {
- 				ParseLine(dupLine);
-			}
+		if (Length > 0 && Line[Length - 1] == '\r') {
+			Line[Length - 1] = '\0';
+		}
 
-			free(dupLine);
+		m_RecvQ->Consume(Length + 1);
 
-			Line = &RecvQ[i + 1];
+		if (Line[0] != '\0') {
+			ParseLine(Line);
 		}
 	}
-
-	m_RecvQ->Read(Line - RecvQ);
 }
 
 /**
@@ -480,7 +548,9 @@ bool CConnection::ReadLine(char **Out) {
 			return false;
 		}
 
-		strmcpy(*Out, m_RecvQ->Read(NewPtr - old_recvq), Size);
+		strmcpy(*Out, old_recvq, Size);
+
+		m_RecvQ->Consume(NewPtr - old_recvq);
 
 		return true;
 	} else {
@@ -498,6 +568,21 @@ bool CConnection::ReadLine(char **Out) {
  */
 void CConnection::WriteUnformattedLine(const char *Line) {
 	m_SendQ->WriteUnformattedLine(Line);
+
+	g_Bouncer->UpdateSocketEvents(m_Socket);
+}
+
+/**
+ * WriteSharedLine
+ *
+ * Writes a shared line for the connection without copying it.
+ *
+ * @param Line the line
+ */
+void CConnection::WriteSharedLine(shared_line_t *Line) {
+	m_SendQ->WriteSharedLine(Line);
+
+	g_Bouncer->UpdateSocketEvents(m_Socket);
 }
 
 /**
@@ -655,6 +740,8 @@ void CConnection::Shutdown(void) {
  */
 void CConnection::Timeout(int TimeLeft) {
 	m_Timeout = g_CurrentTime + TimeLeft;
+
+	g_Bouncer->ScheduleDestroy(this);
 }
 
 /**
@@ -693,6 +780,8 @@ const char *CConnection::GetClassName(void) const {
  */
 void CConnection::FlushSendQ(void) {
 	m_SendQ->Flush();
+
+	g_Bouncer->UpdateSocketEvents(m_Socket);
 }
 
 /**
@@ -787,6 +876,18 @@ void CConnection::AsyncConnect(void) {
 
 		m_Socket = SocketAndConnectResolved(Remote, Bind);
 
+		if (IsSSL() && m_Socket != INVALID_SOCKET) {
+			int rc;
+
+			free(m_SSLSessionKey);
+
+			rc = asprintf(&m_SSLSessionKey, "%s/%d", IpToString(Remote), m_PortCache);
+
+			if (RcFailed(rc)) {
+				m_SSLSessionKey = NULL;
+			}
+		}
+
 		free(m_HostAddr);
 		m_HostAddr = NULL;
 
@@ -804,6 +905,7 @@ void CConnection::AsyncConnect(void) {
 			Error(ErrorCode);
 
 			m_LatchedDestruction = true;
+			g_Bouncer->ScheduleDestroy(this);
 		} else {
 			InitSocket();
 		}
@@ -823,6 +925,7 @@ void CConnection::AsyncDnsFinished(hostent *Response) {
 		// dns query (bind ip) in the queue which would get destroyed in the
 		// destructor; this causes a crash in the StartMainLoop() function
 		m_LatchedDestruction = true;
+		g_Bouncer->ScheduleDestroy(this);
 	} else {
 		int Size;
 
@@ -834,6 +937,7 @@ void CConnection::AsyncDnsFinished(hostent *Response) {
 			Size = sizeof(in6_addr);
 		} else {
 			m_LatchedDestruction = true;
+			g_Bouncer->ScheduleDestroy(this);
 
 			return;
 		}
@@ -842,6 +946,7 @@ void CConnection::AsyncDnsFinished(hostent *Response) {
 
 		if (AllocFailed(m_HostAddr)) {
 			m_LatchedDestruction = true;
+			g_Bouncer->ScheduleDestroy(this);
 
 			return;
 		}
@@ -974,6 +1079,8 @@ void CConnection::SetSendQ(CFIFOBuffer *Buffer) {
 	if (m_SendQ == NULL) {
 		m_SendQ = new CFIFOBuffer();
 	}
+
+	g_Bouncer->UpdateSocketEvents(m_Socket);
 }
 
 /**
@@ -1015,3 +1122,50 @@ void CConnection::SetSSLObject(void *SSLObject) {
 	m_SSL = (SSL *)SSLObject;
 #endif
 }
+
+/**
+ * AccountSSLHandshake
+ *
+ * Adds the time since Start to the time which was spent on the SSL
+ * handshake and updates the handshake histograms once the handshake
+ * is complete.
+ *
+ * @param Start when the SSL call was started (in microseconds)
+ */
+void CConnection::AccountSSLHandshake(int64_t Start) {
+#ifdef HAVE_LIBSSL
+	sslhandshakestats_t *Stats;
+	int64_t Limit = 250;
+	int Bucket;
+
+	m_SSLHandshakeTime += GetCurrentTimeUs() - Start;
+
+	if (!SSL_is_init_finished(m_SSL)) {
+		return;
+	}
+
+	for (Bucket = 0; Bucket < SSLHANDSHAKEBUCKETS - 1 && m_SSLHandshakeTime >= Limit; Bucket++) {
+		Limit <<= 1;
+	}
+
+	Stats = &m_SSLHandshakeStats[(GetRole() == Role_Client) ? 1 : 0];
+
+	if (SSL_session_reused(m_SSL)) {
+		Stats->Resumed[Bucket]++;
+	} else {
+		Stats->Full[Bucket]++;
+	}
+#endif
+}
+
+/**
+ * GetSSLHandshakeStats
+ *
+ * Returns the SSL handshake histograms for connections with the
+ * specified role.
+ *
+ * @param Role Role_Server for client connections, Role_Client for IRC connections
+ */
+const sslhandshakestats_t *CConnection::GetSSLHandshakeStats(connection_role_e Role) {
+	return &m_SSLHandshakeStats[(Role == Role_Client) ? 1 : 0];
+}
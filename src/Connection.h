@@ -35,6 +35,20 @@ enum connection_role_e {
 	Role_Client
 };
 
+#define SSLHANDSHAKEBUCKETS 10 /**< the number of buckets in the handshake histograms */
+
+/**
+ * sslhandshakestats_t
+ *
+ * Histograms of the CPU time spent on SSL handshakes. Bucket i counts
+ * handshakes which took less than 250 << i microseconds, the last bucket
+ * counts all slower handshakes.
+ */
+typedef struct sslhandshakestats_s {
+	unsigned int Full[SSLHANDSHAKEBUCKETS]; /**< handshakes which created a new session */
+	unsigned int Resumed[SSLHANDSHAKEBUCKETS]; /**< handshakes which resumed a session */
+} sslhandshakestats_t;
+
 /**
  * CConnection
  *
@@ -44,6 +58,7 @@ class SBNCAPI CConnection : public CSocketEvents {
 #ifndef SWIG
 	friend class CCore;
 	friend class CUser;
+	friend int SSLNewClientSession(SSL *Connection, SSL_SESSION *Session);
 #endif /* SWIG */
 protected:
 	virtual void ParseLine(const char *Line);
@@ -93,7 +108,13 @@ private:
 	time_t m_InboundTrafficReset; /**< when the inbound traffic was last reset */
 	size_t m_InboundTraffic; /**< inbound traffic (in bytes) since last reset */
 
+	char *m_SSLSessionKey; /**< the key for storing this connection's SSL session */
+	int64_t m_SSLHandshakeTime; /**< time spent on the SSL handshake so far (in microseconds) */
+
+	static sslhandshakestats_t m_SSLHandshakeStats[2]; /**< handshake histograms for inbound and outbound connections */
+
 	void InitConnection(SOCKET Client, bool SSL);
+	void AccountSSLHandshake(int64_t Start);
 
 	virtual const char *GetClassName(void) const;
 public:
@@ -108,6 +129,7 @@ public:
 
 	virtual void WriteUnformattedLine(const char *Line);
 	virtual void WriteLine(const char *Format, ...);
+	virtual void WriteSharedLine(shared_line_t *Line);
 	virtual bool ReadLine(char **Out);
 
 	connection_role_e GetRole(void) const;
@@ -141,6 +163,8 @@ public:
 	void SetRecvQ(CFIFOBuffer *Buffer);
 	void SetSSLObject(void *SSLObject);
 
+	static const sslhandshakestats_t *GetSSLHandshakeStats(connection_role_e Role);
+
 	// should really be "protected"
 	virtual int Read(bool DontProcess = false);
 	virtual int Write(void);
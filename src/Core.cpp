@@ -25,7 +25,13 @@ time_t g_CurrentTime; /**< current time (updated in main loop) */
 
 #ifdef HAVE_LIBSSL
 int SSLVerifyCertificate(int preverify_ok, X509_STORE_CTX *x509ctx);
+int SSLNewClientSession(SSL *Connection, SSL_SESSION *Session);
+static void DestroySSLSession(SSL_SESSION *Session);
 int g_SSLCustomIndex; /**< custom SSL index */
+
+#define SSLDEFAULTCIPHERS "ECDHE+AESGCM:ECDHE+CHACHA20:ECDHE:DEFAULT:!aNULL:!eNULL:!RC4:!MD5" /**< ECDHE ciphers are preferred */
+#define SSLSESSIONCACHESIZE 4096 /**< the maximum number of sessions in the server-side session cache */
+#define SSLSESSIONTIMEOUT 3600 /**< how long SSL sessions can be resumed (in seconds) */
 #endif
 
 time_t g_LastReconnect = 0; /**< time of the last reconnect */
@@ -74,7 +80,19 @@ CCore::CCore(CConfig *Config, int argc, char **argv) {
 
 	m_PollFds.Preallocate(SFD_SETSIZE);
 
-	m_Log = new CLog("sbnc.log", true);
+	m_SocketIndex = (link_t<socket_t> **)calloc(SFD_SETSIZE, sizeof(link_t<socket_t> *));
+	m_DirtySockets = (socket_t **)malloc(SFD_SETSIZE * sizeof(socket_t *));
+	m_DirtySocketCount = 0;
+	m_FreePollFds = (int *)malloc(SFD_SETSIZE * sizeof(int));
+	m_FreePollFdCount = 0;
+
+	if (m_SocketIndex == NULL || m_DirtySockets == NULL || m_FreePollFds == NULL) {
+		printf("Socket index could not be allocated. Shutting down.");
+
+		exit(EXIT_FAILURE);
+	}
+
+	m_Log = new CLog("sbnc.log", true, true);
 
 	if (m_Log == NULL) {
 		printf("Log system could not be initialized. Shutting down.");
@@ -87,12 +105,29 @@ CCore::CCore(CConfig *Config, int argc, char **argv) {
 
 	g_Bouncer = this;
 
+	m_Poller = CreatePoller(&m_PollFds);
+
+	if (AllocFailed(m_Poller)) {
+		Fatal();
+	}
+
+	Log("Using %s for socket events.", m_Poller->GetName());
+
 	m_Config = Config;
 
 	m_Args.SetList(argv, argc);
 
 	m_Ident = new CIdentSupport();
 
+#ifdef HAVE_LIBSSL
+	m_SSLSessions.RegisterValueDestructor(DestroySSLSession);
+#endif
+	m_Admission = new CAdmission();
+
+	if (AllocFailed(m_Admission)) {
+		Fatal();
+	}
+
 	m_Config = new CConfig("sbnc.conf", NULL);
 	CacheInitialize(m_ConfigCache, m_Config, "system.");
 
@@ -175,6 +210,10 @@ CCore::~CCore(void) {
 		delete User->Value;
 	}
 
+	delete m_Admission;
+
+	m_Config->Flush();
+
 	CTimer::DestroyAllTimers();
 
 	delete m_Log;
@@ -185,6 +224,12 @@ CCore::~CCore(void) {
 	UnlockPidFile();
 
 	UninitializeSocket();
+
+	delete m_Poller;
+
+	free(m_SocketIndex);
+	free(m_DirtySockets);
+	free(m_FreePollFds);
 }
 
 /**
@@ -269,6 +314,40 @@ void CCore::StartMainLoop(bool ShouldDaemonize) {
 	SSL_CTX_set_mode(m_SSLContext, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
 	SSL_CTX_set_mode(m_SSLClientContext, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
 
+	SetSSLCiphers(m_SSLContext, "system.sslciphers");
+	SetSSLCiphers(m_SSLClientContext, "system.sslclientciphers");
+
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+	// connections which are closed without a close_notify alert would
+	// otherwise invalidate their session
+	SSL_CTX_set_options(m_SSLContext, SSL_OP_IGNORE_UNEXPECTED_EOF);
+	SSL_CTX_set_options(m_SSLClientContext, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+
+	// clients can resume sessions either from the session cache or
+	// with session tickets
+	SSL_CTX_set_options(m_SSLContext, SSL_OP_CIPHER_SERVER_PREFERENCE);
+	SSL_CTX_clear_options(m_SSLContext, SSL_OP_NO_TICKET);
+	SSL_CTX_set_session_cache_mode(m_SSLContext, SSL_SESS_CACHE_SERVER);
+	SSL_CTX_set_session_id_context(m_SSLContext, (const unsigned char *)"shroudBNC", strlen("shroudBNC"));
+	SSL_CTX_sess_set_cache_size(m_SSLContext, SSLSESSIONCACHESIZE);
+	SSL_CTX_set_timeout(m_SSLContext, SSLSESSIONTIMEOUT);
+
+#ifdef SSL_CTX_set_ecdh_auto
+	SSL_CTX_set_ecdh_auto(m_SSLContext, 1);
+#elif defined(NID_X9_62_prime256v1) && !defined(OPENSSL_NO_ECDH)
+	EC_KEY *Curve = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+
+	if (Curve != NULL) {
+		SSL_CTX_set_tmp_ecdh(m_SSLContext, Curve);
+		EC_KEY_free(Curve);
+	}
+#endif
+
+	// sessions for IRC connections are stored per server by SSLNewClientSession()
+	SSL_CTX_set_session_cache_mode(m_SSLClientContext, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(m_SSLClientContext, SSLNewClientSession);
+
 	g_SSLCustomIndex = SSL_get_ex_new_index(0, (void *)"CConnection*", NULL, NULL, NULL);
 
 	if (!SSL_CTX_use_PrivateKey_file(m_SSLContext, BuildPathConfig("sbnc.key"), SSL_FILETYPE_PEM)) {
@@ -377,7 +456,8 @@ void CCore::StartMainLoop(bool ShouldDaemonize) {
 	time_t Last = 0;
 
 	while (GetStatus() == Status_Running || --m_ShutdownLoop) {
-		time_t Now, Best = 0, SleepInterval = 0;
+		time_t Now, Best = 0;
+		int64_t BestMs, SleepMs, DnsMs;
 
 #if defined(_WIN32) && defined(_DEBUG)
 		DWORD TickCount = GetTickCount();
@@ -385,21 +465,20 @@ void CCore::StartMainLoop(bool ShouldDaemonize) {
 
 		time(&Now);
 
-		i = 0;
-		while (hash_t<CUser *> *UserHash = m_Users.Iterate(i++)) {
-			CIRCConnection *IRC;
+		// connections which are to be destroyed add themselves to
+		// m_PendingDestroy, so the users only have to be visited when
+		// shutting down
+		if (GetStatus() != Status_Running) {
+			i = 0;
+			while (hash_t<CUser *> *UserHash = m_Users.Iterate(i++)) {
+				CIRCConnection *IRC;
 
-			if ((IRC = UserHash->Value->GetIRCConnection()) != NULL) {
-				if (GetStatus() != Status_Running) {
+				if ((IRC = UserHash->Value->GetIRCConnection()) != NULL) {
 					Log("Closing connection for user %s", UserHash->Name);
 					IRC->Kill("Shutting down.");
 
 					UserHash->Value->SetIRCConnection(NULL);
 				}
-
-				if (IRC->ShouldDestroy()) {
-					IRC->Destroy();
-				}
 			}
 		}
 
@@ -413,9 +492,11 @@ void CCore::StartMainLoop(bool ShouldDaemonize) {
 
 		g_CurrentTime = Now;
 
-		Best = CTimer::GetNextCall();
+		BestMs = CTimer::GetNextCallMs();
+
+		if (BestMs <= GetCurrentTimeMs()) {
+			Best = (time_t)(BestMs / 1000);
 
-		if (Best <= g_CurrentTime) {
 #ifdef _DEBUG
 			if (g_CurrentTime - 1 > Best) {
 #else
@@ -426,27 +507,15 @@ void CCore::StartMainLoop(bool ShouldDaemonize) {
 
 			CTimer::CallTimers();
 
-			Best = CTimer::GetNextCall();
+			BestMs = CTimer::GetNextCallMs();
 		}
 
-		SleepInterval = Best - g_CurrentTime;
+		SleepMs = BestMs - GetCurrentTimeMs();
 
-		DnsSocketCookie *DnsCookie = CDnsQuery::RegisterSockets();
+		DnsMs = CDnsQuery::GetTimeoutMs();
 
-		for (CListCursor<socket_t> SocketCursor(&m_OtherSockets); SocketCursor.IsValid(); SocketCursor.Proceed()) {
-			if (SocketCursor->PollFd->fd == INVALID_SOCKET) {
-				continue;
-			}
-
-			if (SocketCursor->Events->ShouldDestroy()) {
-				SocketCursor->Events->Destroy();
-			} else {
-				SocketCursor->PollFd->events = POLLIN | POLLERR;
-
-				if (SocketCursor->Events->HasQueuedData()) {
-					SocketCursor->PollFd->events |= POLLOUT;
-				}
-			}
+		if (DnsMs != -1 && DnsMs < SleepMs) {
+			SleepMs = DnsMs;
 		}
 
 		bool ModulesBusy = false;
@@ -457,27 +526,28 @@ void CCore::StartMainLoop(bool ShouldDaemonize) {
 	                }
 	        }
 
-		if (SleepInterval <= 0 || GetStatus() != Status_Running || ModulesBusy) {
-			SleepInterval = 1;
-		}
+		DestroyPendingObjects();
+		UpdateDirtySockets();
 
-		if (GetStatus() != Status_Running && SleepInterval > 3) {
-			SleepInterval = 3;
+		if (SleepMs < 0) {
+			SleepMs = 0;
 		}
 
-		timeval interval = { (long)SleepInterval, 0 };
+		if ((GetStatus() != Status_Running || ModulesBusy) && SleepMs > 1000) {
+			SleepMs = 1000;
+		}
 
 		time(&Last);
 
 #ifdef _DEBUG
-		//printf("poll: %d seconds\n", SleepInterval);
+		//printf("poll: %d milliseconds\n", (int)SleepMs);
 #endif
 
 #if defined(_WIN32) && defined(_DEBUG)
 		DWORD TimeDiff = GetTickCount();
 #endif
 
-		int ready = poll(m_PollFds.GetList(), m_PollFds.GetLength(), interval.tv_sec * 1000);
+		int ready = m_Poller->Poll((int)SleepMs);
 
 #if defined(_WIN32) && defined(_DEBUG)
 		TickCount += GetTickCount() - TimeDiff;
@@ -486,15 +556,30 @@ void CCore::StartMainLoop(bool ShouldDaemonize) {
 		time(&g_CurrentTime);
 
 		if (ready > 0) {
-			for (CListCursor<socket_t> SocketCursor(&m_OtherSockets); SocketCursor.IsValid(); SocketCursor.Proceed()) {
-				pollfd *PollFd = SocketCursor->PollFd;
-				CSocketEvents *Events = SocketCursor->Events;
+			for (int j = 0; j < ready; j++) {
+				socket_t *Socket = m_Poller->GetReadySocket(j);
+
+				// the socket might have been unregistered by an earlier event
+				if (Socket == NULL) {
+					continue;
+				}
+
+				pollfd *PollFd = Socket->PollFd;
+				CSocketEvents *Events = Socket->Events;
 
 				if (PollFd->fd != INVALID_SOCKET) {
 					if (PollFd->revents & (POLLERR|POLLHUP|POLLNVAL)) {
 						int ErrorCode;
 						socklen_t ErrorCodeLength = sizeof(ErrorCode);
 
+						// fetching SO_ERROR would clear the error before the
+						// object gets to see it
+						if (Events->ReadsOwnErrors()) {
+							Events->Destroy();
+
+							continue;
+						}
+
 						ErrorCode = 0;
 
 						if (getsockopt(PollFd->fd, SOL_SOCKET, SO_ERROR, (char *)&ErrorCode, &ErrorCodeLength) != -1) {
@@ -520,11 +605,21 @@ void CCore::StartMainLoop(bool ShouldDaemonize) {
 
 							continue;
 						}
+
+						if (m_Poller->GetReadySocket(j) == NULL) {
+							continue;
+						}
 					}
 
 					if (PollFd->revents & POLLOUT) {
 						Events->Write();
 					}
+
+					// reading and writing might have changed whether
+					// the object has data for the socket
+					if (m_Poller->GetReadySocket(j) != NULL) {
+						MarkSocketDirty(Socket);
+					}
 				}
 			}
 		} else if (ready == -1) {
@@ -550,14 +645,16 @@ void CCore::StartMainLoop(bool ShouldDaemonize) {
 				int code = poll(&pfd, 1, 0);
 
 				if (code == -1) {
-					SocketCursor->Events->Error(-1);
+					if (!SocketCursor->Events->ReadsOwnErrors()) {
+						SocketCursor->Events->Error(-1);
+					}
+
 					SocketCursor->Events->Destroy();
 				}
 			}
 		}
 
 		CDnsQuery::ProcessTimeouts();
-		CDnsQuery::UnregisterSockets(DnsCookie);
 
 #if defined(_WIN32) && defined(_DEBUG)
 		DWORD Ticks = GetTickCount() - TickCount;
@@ -655,6 +752,24 @@ const char *CCore::GetIdent(void) const {
 	}
 }
 
+/**
+ * GetIdentSupport
+ *
+ * Returns the ident support object.
+ */
+CIdentSupport *CCore::GetIdentSupport(void) {
+	return m_Ident;
+}
+
+/**
+ * GetAdmission
+ *
+ * Returns the object which decides whether new clients are accepted.
+ */
+CAdmission *CCore::GetAdmission(void) {
+	return m_Admission;
+}
+
 /**
  * GetModules
  *
@@ -791,17 +906,13 @@ void CCore::RegisterSocket(SOCKET Socket, CSocketEvents *EventInterface) {
 	pollfd *PollFd = NULL;
 	pollfd NewPollFd;
 	bool NewStruct = true;
-	int i;
+	link_t<socket_t> **Bucket;
 
 	UnregisterSocket(Socket);
 
-	for (i = 0; i < m_PollFds.GetLength(); i++) {
-		if (m_PollFds.Get(i).fd == INVALID_SOCKET) {
-			PollFd = m_PollFds.GetAddressOf(i);
-			NewStruct = false;
-
-			break;
-		}
+	if (m_FreePollFdCount > 0) {
+		PollFd = m_PollFds.GetAddressOf(m_FreePollFds[--m_FreePollFdCount]);
+		NewStruct = false;
 	}
 
 	if (NewStruct) {
@@ -809,7 +920,7 @@ void CCore::RegisterSocket(SOCKET Socket, CSocketEvents *EventInterface) {
 	}
 
 	PollFd->fd = Socket;
-	PollFd->events = 0;
+	PollFd->events = POLLIN | POLLERR;
 	PollFd->revents = 0;
 
 	if (NewStruct) {
@@ -827,13 +938,27 @@ void CCore::RegisterSocket(SOCKET Socket, CSocketEvents *EventInterface) {
 	// later on
 	SocketStruct.PollFd = PollFd;
 	SocketStruct.Events = EventInterface;
+	SocketStruct.DirtyIndex = -1;
 
 	/* TODO: can we safely recover from this situation? return value maybe? */
-	if (!m_OtherSockets.Insert(SocketStruct)) {
+	RESULT<link_t<socket_t> *> Link = m_OtherSockets.Insert(SocketStruct);
+
+	if (IsError(Link)) {
 		Log("Insert() failed.");
 
 		Fatal();
 	}
+
+	Bucket = &m_SocketIndex[(unsigned long)Socket % SFD_SETSIZE];
+	Link.GetResult()->Value.NextInBucket = *Bucket;
+	*Bucket = Link.GetResult();
+
+	if (!m_Poller->Add(&(Link.GetResult()->Value))) {
+		Log("Could not add socket %d to the %s poller.", Socket, m_Poller->GetName());
+	}
+
+	// the object might already have data for the socket
+	MarkSocketDirty(&(Link.GetResult()->Value));
 }
 
 /**
@@ -844,18 +969,190 @@ void CCore::RegisterSocket(SOCKET Socket, CSocketEvents *EventInterface) {
  * @param Socket the socket
  */
 void CCore::UnregisterSocket(SOCKET Socket) {
-	for (CListCursor<socket_t> SocketCursor(&m_OtherSockets); SocketCursor.IsValid(); SocketCursor.Proceed()) {
-		if (SocketCursor->PollFd->fd == Socket) {
-			SocketCursor->PollFd->fd = INVALID_SOCKET;
-			SocketCursor->PollFd->events = 0;
+	link_t<socket_t> **Bucket, *Link;
+	socket_t *Value;
+
+	if (Socket == INVALID_SOCKET) {
+		return;
+	}
+
+	for (Bucket = &m_SocketIndex[(unsigned long)Socket % SFD_SETSIZE]; *Bucket != NULL; Bucket = &((*Bucket)->Value.NextInBucket)) {
+		if ((*Bucket)->Value.PollFd->fd == Socket) {
+			break;
+		}
+	}
+
+	Link = *Bucket;
+
+	if (Link == NULL) {
+		return;
+	}
+
+	*Bucket = Link->Value.NextInBucket;
+
+	Value = &(Link->Value);
+
+	if (Value->DirtyIndex != -1) {
+		m_DirtySockets[Value->DirtyIndex] = m_DirtySockets[--m_DirtySocketCount];
+		m_DirtySockets[Value->DirtyIndex]->DirtyIndex = Value->DirtyIndex;
+	}
+
+	m_Poller->Remove(Value);
+
+	m_FreePollFds[m_FreePollFdCount++] = Value->PollFd - m_PollFds.GetList();
+
+	Value->PollFd->fd = INVALID_SOCKET;
+	Value->PollFd->events = 0;
 
-			SocketCursor.Remove();
+	m_OtherSockets.Remove(Link);
+}
+
+/**
+ * FindSocket
+ *
+ * Returns the registered socket for a descriptor, or NULL if the
+ * descriptor has not been registered.
+ *
+ * @param Socket the socket
+ */
+link_t<socket_t> *CCore::FindSocket(SOCKET Socket) const {
+	link_t<socket_t> *Link;
+
+	if (Socket == INVALID_SOCKET) {
+		return NULL;
+	}
+
+	for (Link = m_SocketIndex[(unsigned long)Socket % SFD_SETSIZE]; Link != NULL; Link = Link->Value.NextInBucket) {
+		if (Link->Value.PollFd->fd == Socket) {
+			return Link;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * UpdateSocketEvents
+ *
+ * Tells the main loop that the result of the socket's HasQueuedData()
+ * function might have changed. The events are updated before the next
+ * poll.
+ *
+ * @param Socket the socket
+ */
+void CCore::UpdateSocketEvents(SOCKET Socket) {
+	link_t<socket_t> *Link = FindSocket(Socket);
+
+	if (Link != NULL) {
+		MarkSocketDirty(&(Link->Value));
+	}
+}
+
+/**
+ * MarkSocketDirty
+ *
+ * Adds a socket to the list of sockets whose events have to be updated.
+ *
+ * @param Socket the socket
+ */
+void CCore::MarkSocketDirty(socket_t *Socket) {
+	if (Socket->DirtyIndex != -1) {
+		return;
+	}
+
+	// each registered socket has its own entry in m_PollFds, so there
+	// can't be more than SFD_SETSIZE dirty sockets
+	Socket->DirtyIndex = m_DirtySocketCount;
+	m_DirtySockets[m_DirtySocketCount++] = Socket;
+}
+
+/**
+ * UpdateDirtySockets
+ *
+ * Updates the events for sockets which have been marked as dirty.
+ */
+void CCore::UpdateDirtySockets(void) {
+	for (int i = 0; i < m_DirtySocketCount; i++) {
+		socket_t *Socket = m_DirtySockets[i];
+		short Events = POLLIN | POLLERR;
+
+		Socket->DirtyIndex = -1;
+
+		if (Socket->Events->HasQueuedData()) {
+			Events |= POLLOUT;
+		}
+
+		// only tell the poller about sockets whose events have changed
+		if (Socket->PollFd->events != Events) {
+			m_Poller->Modify(Socket, Events);
+		}
+	}
+
+	m_DirtySocketCount = 0;
+}
+
+/**
+ * ScheduleDestroy
+ *
+ * Tells the main loop to destroy an object once its ShouldDestroy()
+ * function returns true.
+ *
+ * @param Object the object
+ */
+void CCore::ScheduleDestroy(CSocketEvents *Object) {
+	for (int i = 0; i < m_PendingDestroy.GetLength(); i++) {
+		if (m_PendingDestroy[i] == Object) {
+			return;
+		}
+	}
+
+	if (!m_PendingDestroy.Insert(Object)) {
+		Log("Insert() failed. Object could not be scheduled for destruction.");
+	}
+}
+
+/**
+ * CancelDestroy
+ *
+ * Removes an object from the list of objects which are waiting to be
+ * destroyed. This must be called when such an object is destroyed by
+ * some other means.
+ *
+ * @param Object the object
+ */
+void CCore::CancelDestroy(CSocketEvents *Object) {
+	for (int i = 0; i < m_PendingDestroy.GetLength(); i++) {
+		if (m_PendingDestroy[i] == Object) {
+			m_PendingDestroy.Remove(i);
 
 			return;
 		}
 	}
 }
 
+/**
+ * DestroyPendingObjects
+ *
+ * Destroys the scheduled objects whose ShouldDestroy() function
+ * returns true.
+ */
+void CCore::DestroyPendingObjects(void) {
+	int i = 0;
+
+	while (i < m_PendingDestroy.GetLength()) {
+		CSocketEvents *Object = m_PendingDestroy[i];
+
+		if (Object->ShouldDestroy()) {
+			// Remove() moves the last entry to this index
+			m_PendingDestroy.Remove(i);
+
+			Object->Destroy();
+		} else {
+			i++;
+		}
+	}
+}
+
 /**
  * CreateListener
  *
@@ -1105,7 +1402,7 @@ RESULT<bool> CCore::RemoveUser(const char *Username, bool RemoveConfig) {
 	RESULT<bool> Result;
 	CUser *User;
 	char *UsernameCopy;
-	char *ConfigCopy = NULL, *LogCopy = NULL;
+	char *ConfigCopy = NULL, *JournalCopy = NULL, *LogCopy = NULL, *BacklogCopy = NULL;
 	
 	User = GetUser(Username);
 
@@ -1122,6 +1419,13 @@ RESULT<bool> CCore::RemoveUser(const char *Username, bool RemoveConfig) {
 	if (RemoveConfig) {
 		ConfigCopy = strdup(User->GetConfig()->GetFilename());
 		LogCopy = strdup(User->GetLog()->GetFilename());
+		BacklogCopy = strdup(User->GetBacklog()->GetFilename());
+
+		int rc = asprintf(&JournalCopy, "%s.journal", ConfigCopy);
+
+		if (RcFailed(rc)) {
+			JournalCopy = NULL;
+		}
 	}
 
 	delete User;
@@ -1142,10 +1446,20 @@ RESULT<bool> CCore::RemoveUser(const char *Username, bool RemoveConfig) {
 	if (RemoveConfig) {
 		unlink(ConfigCopy);
 		unlink(LogCopy);
+
+		if (BacklogCopy != NULL) {
+			unlink(BacklogCopy);
+		}
+
+		if (JournalCopy != NULL) {
+			unlink(JournalCopy);
+		}
 	}
 
 	free(ConfigCopy);
+	free(JournalCopy);
 	free(LogCopy);
+	free(BacklogCopy);
 
 	UpdateUserConfig();
 
@@ -1429,6 +1743,41 @@ void CCore::SetSendqSize(size_t NewSize) {
 	CacheSetInteger(m_ConfigCache, sendq, NewSize);
 }
 
+/**
+ * GetBacklogSize
+ *
+ * Returns the maximum number of channel backlog lines per user.
+ */
+unsigned int CCore::GetBacklogSize(void) const {
+	int Size = CacheGetInteger(m_ConfigCache, backlogsize);
+
+	if (Size <= 0) {
+		return DEFAULT_BACKLOGSIZE;
+	} else {
+		return Size;
+	}
+}
+
+/**
+ * SetBacklogSize
+ *
+ * Sets the maximum number of channel backlog lines per user.
+ *
+ * @param NewSize the new number of lines, or 0 for the default
+ */
+void CCore::SetBacklogSize(unsigned int NewSize) {
+	int i = 0;
+
+	CacheSetInteger(m_ConfigCache, backlogsize, NewSize);
+
+	while (hash_t<CUser *> *User = m_Users.Iterate(i++)) {
+		// backlogs which haven't been opened yet will use the new size
+		if (User->Value->m_Backlog != NULL) {
+			User->Value->m_Backlog->SetSize(GetBacklogSize());
+		}
+	}
+}
+
 /**
  * GetMotd
  *
@@ -1478,6 +1827,74 @@ SSL_CTX *CCore::GetSSLClientContext(void) {
 	return m_SSLClientContext;
 }
 
+/**
+ * SetSSLCiphers
+ *
+ * Sets the cipher list for an SSL context from the config. The default
+ * list is used if the setting is empty or invalid.
+ *
+ * @param Context the SSL context
+ * @param Setting the name of the setting
+ */
+void CCore::SetSSLCiphers(SSL_CTX *Context, const char *Setting) {
+#ifdef HAVE_LIBSSL
+	const char *Ciphers = m_Config->ReadString(Setting);
+
+	if (Ciphers != NULL && SSL_CTX_set_cipher_list(Context, Ciphers)) {
+		return;
+	}
+
+	if (Ciphers != NULL) {
+		Log("Invalid cipher list in %s: %s", Setting, Ciphers);
+	}
+
+	SSL_CTX_set_cipher_list(Context, SSLDEFAULTCIPHERS);
+#endif
+}
+
+/**
+ * GetSSLSession
+ *
+ * Returns the last SSL session for an outbound connection, or NULL if
+ * there is none or if it has expired.
+ *
+ * @param Key the key of the connection (remote address and port)
+ */
+SSL_SESSION *CCore::GetSSLSession(const char *Key) {
+#ifdef HAVE_LIBSSL
+	SSL_SESSION *Session = m_SSLSessions.Get(Key);
+
+	if (Session != NULL && SSL_SESSION_get_time(Session) + SSL_SESSION_get_timeout(Session) < g_CurrentTime) {
+		m_SSLSessions.Remove(Key);
+
+		return NULL;
+	}
+
+	return Session;
+#else
+	return NULL;
+#endif
+}
+
+/**
+ * SetSSLSession
+ *
+ * Stores the SSL session for an outbound connection. The session's
+ * reference is taken over.
+ *
+ * @param Key the key of the connection (remote address and port)
+ * @param Session the session
+ */
+void CCore::SetSSLSession(const char *Key, SSL_SESSION *Session) {
+	m_SSLSessions.Remove(Key);
+
+	if (IsError(m_SSLSessions.Add(Key, Session))) {
+#ifdef HAVE_LIBSSL
+		SSL_SESSION_free(Session);
+#endif
+	}
+}
+
 /**
  * GetSSLCustomIndex
  *
@@ -1510,6 +1927,38 @@ int SSLVerifyCertificate(int preverify_ok, X509_STORE_CTX *x509ctx) {
 		return 0;
 	}
 }
+
+/**
+ * SSLNewClientSession
+ *
+ * Called by OpenSSL when a new session was negotiated for an IRC
+ * connection.
+ *
+ * @param Connection the SSL connection
+ * @param Session the new session
+ */
+int SSLNewClientSession(SSL *Connection, SSL_SESSION *Session) {
+	CConnection *Ptr = (CConnection *)SSL_get_ex_data(Connection, g_SSLCustomIndex);
+
+	if (Ptr == NULL || Ptr->m_SSLSessionKey == NULL) {
+		return 0;
+	}
+
+	g_Bouncer->SetSSLSession(Ptr->m_SSLSessionKey, Session);
+
+	return 1;
+}
+
+/**
+ * DestroySSLSession
+ *
+ * Value destructor for the session cache.
+ *
+ * @param Session the session
+ */
+static void DestroySSLSession(SSL_SESSION *Session) {
+	SSL_SESSION_free(Session);
+}
 #endif
 
 /**
@@ -21,6 +21,7 @@
 #define CORE_H
 
 #define DEFAULT_SENDQ (10 * 1024)
+#define DEFAULT_BACKLOGSIZE 2048
 
 class CConfig;
 class CUser;
@@ -29,10 +30,12 @@ class CClientListener;
 class CClientConnection;
 class CIRCConnection;
 class CIdentSupport;
+class CAdmission;
 class CModule;
 class CConnection;
 class CTimer;
 class CFakeClient;
+class CPoller;
 struct CSocketEvents;
 struct sockaddr_in;
 
@@ -46,13 +49,17 @@ DEFINE_CACHE(System)
 	DEFINE_OPTION_INT(port);
 	DEFINE_OPTION_INT(sslport);
 	DEFINE_OPTION_INT(sendq);
+	DEFINE_OPTION_INT(backlogsize);
 	DEFINE_OPTION_INT(md5);
 	DEFINE_OPTION_INT(interval);
+	DEFINE_OPTION_INT(admissionburst);
+	DEFINE_OPTION_INT(admissionrefill);
 
 	DEFINE_OPTION_STRING(vhost);
 	DEFINE_OPTION_STRING(users);
 	DEFINE_OPTION_STRING(ip);
 	DEFINE_OPTION_STRING(motd);
+	DEFINE_OPTION_STRING(floodpenalties);
 END_DEFINE_CACHE
 
 /**
@@ -63,6 +70,8 @@ END_DEFINE_CACHE
 typedef struct socket_s {
 	pollfd *PollFd	; /**< the underlying socket object */
 	CSocketEvents *Events; /**< the event interface for this socket */
+	link_t<struct socket_s> *NextInBucket; /**< the next socket in the same bucket of the socket index */
+	int DirtyIndex; /**< the index in the list of sockets whose events have to be updated, or -1 */
 } socket_t;
 
 /**
@@ -109,6 +118,10 @@ class SBNCAPI CCore {
 	CHashtable<CUser *, false> m_Users; /**< the bouncer users */
 	CVector<CModule *> m_Modules; /**< currently loaded modules */
 	mutable CList<socket_t> m_OtherSockets; /**< a list of active sockets */
+	link_t<socket_t> **m_SocketIndex; /**< active sockets by descriptor (SFD_SETSIZE buckets) */
+	socket_t **m_DirtySockets; /**< sockets whose events have to be updated before polling */
+	int m_DirtySocketCount; /**< number of entries in m_DirtySockets */
+	CVector<CSocketEvents *> m_PendingDestroy; /**< objects which are waiting to be destroyed */
 	CList<CTimer *> m_Timers; /**< a list of active timers */
 
 	time_t m_Startup; /**< TS when the bouncer was started */
@@ -116,6 +129,7 @@ class SBNCAPI CCore {
 	CLog *m_Log; /**< the bouncer's main log */
 
 	CIdentSupport *m_Ident; /**< ident support interface */
+	CAdmission *m_Admission; /**< admission limits for new clients */
 
 	bool m_LoadingModules; /**< are we currently loading modules? */
 	bool m_LoadingListeners; /**< are we currently loading listeners */
@@ -126,17 +140,26 @@ class SBNCAPI CCore {
 
 	SSL_CTX *m_SSLContext; /**< SSL context for client listeners */
 	SSL_CTX *m_SSLClientContext; /**< SSL context for IRC connections */
+	CHashtable<SSL_SESSION *, false> m_SSLSessions; /**< SSL sessions for IRC connections by server address */
 
 	CVector<additionallistener_t> m_AdditionalListeners; /**< a list of additional listeners */
 
 	CVector<CUser *> m_AdminUsers; /**< cached list of admin users */
 
 	CVector<pollfd> m_PollFds; /**< pollfd structures */
+	int *m_FreePollFds; /**< indexes of unused entries in m_PollFds */
+	int m_FreePollFdCount; /**< number of entries in m_FreePollFds */
+	CPoller *m_Poller; /**< the socket readiness backend */
 
 	sbnc_status_t m_Status; /**< shroudBNC's current status */
 
 	void UpdateModuleConfig(void);
 	void UpdateUserConfig(void);
+
+	link_t<socket_t> *FindSocket(SOCKET Socket) const;
+	void MarkSocketDirty(socket_t *Socket);
+	void UpdateDirtySockets(void);
+	void DestroyPendingObjects(void);
 	void UnlockPidFile(void);
 	void WritePidFile(void);
 	bool MakeConfig(void);
@@ -148,6 +171,8 @@ class SBNCAPI CCore {
 	void UninitializeAdditionalListeners(void);
 	void UpdateAdditionalListeners(void);
 
+	void SetSSLCiphers(SSL_CTX *Context, const char *Setting);
+
 	bool Daemonize(void);
 public:
 #ifndef SWIG
@@ -169,11 +194,18 @@ public:
 
 	void SetIdent(const char *Ident);
 	const char *GetIdent(void) const;
+#ifndef SWIG
+	CIdentSupport *GetIdentSupport(void);
+	CAdmission *GetAdmission(void);
+#endif /* SWIG */
 
 	CConfig *GetConfig(void);
 
 	void RegisterSocket(SOCKET Socket, CSocketEvents *EventInterface);
 	void UnregisterSocket(SOCKET Socket);
+	void UpdateSocketEvents(SOCKET Socket);
+	void ScheduleDestroy(CSocketEvents *Object);
+	void CancelDestroy(CSocketEvents *Object);
 
 	SOCKET CreateListener(unsigned int Port, const char *BindIp = NULL, int Family = AF_INET) const;
 
@@ -206,6 +238,9 @@ public:
 	size_t GetSendqSize(void) const;
 	void SetSendqSize(size_t NewSize);
 
+	unsigned int GetBacklogSize(void) const;
+	void SetBacklogSize(unsigned int NewSize);
+
 	const char *GetMotd(void) const;
 	void SetMotd(const char *Motd);
 
@@ -216,6 +251,10 @@ public:
 	SSL_CTX *GetSSLContext(void) ;
 	SSL_CTX *GetSSLClientContext(void);
 	int GetSSLCustomIndex(void) const;
+#ifndef SWIG
+	SSL_SESSION *GetSSLSession(const char *Key);
+	void SetSSLSession(const char *Key, SSL_SESSION *Session);
+#endif /* SWIG */
 
 	const char *DebugImpulse(int impulse);
 
@@ -0,0 +1,113 @@
+/*******************************************************************************
+ * shroudBNC - an object-oriented framework for IRC                            *
+ * Copyright (C) 2005-2007,2010 Gunnar Beutner                                 *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or               *
+ * modify it under the terms of the GNU General Public License                 *
+ * as published by the Free Software Foundation; either version 2              *
+ * of the License, or (at your option) any later version.                      *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU General Public License for more details.                                *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License           *
+ * along with this program; if not, write to the Free Software                 *
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA. *
+ *******************************************************************************/
+
+#include "StdAfx.h"
+
+/**
+ * NumericFromName
+ *
+ * Returns the numeric for a three-digit command name or -1 if the
+ * name is not a numeric.
+ *
+ * @param Name the command
+ */
+static inline int NumericFromName(const char *Name) {
+	if (Name[0] >= '0' && Name[0] <= '9' && Name[1] >= '0' && Name[1] <= '9' &&
+			Name[2] >= '0' && Name[2] <= '9' && Name[3] == '\0') {
+		return (Name[0] - '0') * 100 + (Name[1] - '0') * 10 + (Name[2] - '0');
+	} else {
+		return -1;
+	}
+}
+
+/**
+ * CDispatchTable
+ *
+ * Constructs a dispatch table.
+ *
+ * @param Entries the commands, terminated by an entry whose Name is NULL
+ */
+CDispatchTable::CDispatchTable(const dispatchentry_t *Entries) {
+	unsigned int Slot;
+	int Numeric, Count = 0;
+
+	memset(m_Slots, 0, sizeof(m_Slots));
+	memset(m_Numerics, 0, sizeof(m_Numerics));
+
+	for (; Entries->Name != NULL; Entries++) {
+		Numeric = NumericFromName(Entries->Name);
+
+		if (Numeric != -1) {
+			m_Numerics[Numeric] = Entries->Id;
+
+			continue;
+		}
+
+		Count++;
+
+		// keep the table at most half full so that lookups stay short
+		assert(Count <= DISPATCHSLOTS / 2);
+
+		Slot = Hash(Entries->Name, false) & (DISPATCHSLOTS - 1);
+
+		while (m_Slots[Slot].Name != NULL) {
+			Slot = (Slot + 1) & (DISPATCHSLOTS - 1);
+		}
+
+		m_Slots[Slot].Name = Entries->Name;
+		m_Slots[Slot].HashValue = Hash(Entries->Name, false);
+		m_Slots[Slot].Id = Entries->Id;
+	}
+}
+
+/**
+ * Find
+ *
+ * Returns the identifier for a command or 0 if the command is unknown.
+ *
+ * @param Name the command
+ */
+int CDispatchTable::Find(const char *Name) const {
+	hashvalue_t HashValue;
+	unsigned int Slot;
+	int Numeric;
+
+	if (Name == NULL) {
+		return 0;
+	}
+
+	Numeric = NumericFromName(Name);
+
+	if (Numeric != -1) {
+		return m_Numerics[Numeric];
+	}
+
+	HashValue = Hash(Name, false);
+	Slot = HashValue & (DISPATCHSLOTS - 1);
+
+	while (m_Slots[Slot].Name != NULL) {
+		if (m_Slots[Slot].HashValue == HashValue && strcasecmp(m_Slots[Slot].Name, Name) == 0) {
+			return m_Slots[Slot].Id;
+		}
+
+		Slot = (Slot + 1) & (DISPATCHSLOTS - 1);
+	}
+
+	return 0;
+}
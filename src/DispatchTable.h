@@ -0,0 +1,66 @@
+/*******************************************************************************
+ * shroudBNC - an object-oriented framework for IRC                            *
+ * Copyright (C) 2005-2007,2010 Gunnar Beutner                                 *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or               *
+ * modify it under the terms of the GNU General Public License                 *
+ * as published by the Free Software Foundation; either version 2              *
+ * of the License, or (at your option) any later version.                      *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU General Public License for more details.                                *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License           *
+ * along with this program; if not, write to the Free Software                 *
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA. *
+ *******************************************************************************/
+
+#ifndef DISPATCHTABLE_H
+#define DISPATCHTABLE_H
+
+#define DISPATCHSLOTS 128 /**< number of slots for named commands, must be a power of two */
+#define DISPATCHNUMERICS 1000 /**< numeric commands are looked up directly */
+
+/**
+ * dispatchentry_s
+ *
+ * A command and the identifier it is dispatched to.
+ */
+typedef struct dispatchentry_s {
+	const char *Name; /**< the command, e.g. "PRIVMSG" or "433" */
+	int Id; /**< the command's identifier, must not be 0 */
+} dispatchentry_t;
+
+/**
+ * dispatchslot_s
+ *
+ * A slot in a dispatch table's table of named commands.
+ */
+typedef struct dispatchslot_s {
+	const char *Name; /**< the command, or NULL if the slot is unused */
+	hashvalue_t HashValue; /**< the hash value of the command */
+	int Id; /**< the command's identifier */
+} dispatchslot_t;
+
+/**
+ * CDispatchTable
+ *
+ * Maps command names to identifiers which can be used in a switch
+ * statement. Three-digit numerics are looked up in an array, other
+ * commands in an open-addressed table which is built once from a
+ * static list of commands. Command names are case-insensitive.
+ */
+class SBNCAPI CDispatchTable {
+	dispatchslot_t m_Slots[DISPATCHSLOTS]; /**< the named commands */
+	int m_Numerics[DISPATCHNUMERICS]; /**< the numerics' identifiers */
+public:
+#ifndef SWIG
+	CDispatchTable(const dispatchentry_t *Entries);
+#endif /* SWIG */
+
+	int Find(const char *Name) const;
+};
+
+#endif /* DISPATCHTABLE_H */
@@ -0,0 +1,489 @@
+/*******************************************************************************
+ * shroudBNC - an object-oriented framework for IRC                            *
+ * Copyright (C) 2005-2007,2010 Gunnar Beutner                                 *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or               *
+ * modify it under the terms of the GNU General Public License                 *
+ * as published by the Free Software Foundation; either version 2              *
+ * of the License, or (at your option) any later version.                      *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU General Public License for more details.                                *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License           *
+ * along with this program; if not, write to the Free Software                 *
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA. *
+ *******************************************************************************/
+
+#include "StdAfx.h"
+
+#ifndef C_IN
+#	define C_IN 1
+#endif /* C_IN */
+
+#ifndef T_A
+#	define T_A 1
+#endif /* T_A */
+
+#ifndef T_AAAA
+#	define T_AAAA 28
+#endif /* T_AAAA */
+
+#define DNSCACHEMAXENTRIES 4096 /**< the maximum number of cache entries */
+#define DNSCACHEMAXTTL 3600 /**< upper limit for the TTL of positive results */
+#define DNSCACHENEGATIVETTL 60 /**< how long names which do not exist are cached */
+#define DNSCACHEPTRTTL 600 /**< TTL for reverse lookups (c-ares does not report one) */
+#define DNSCACHEMAXADDRTTLS 32 /**< the maximum number of TTLs which are parsed per reply */
+
+/**
+ * dnscacheentry_t
+ *
+ * A DNS cache entry.
+ */
+typedef struct dnscacheentry_s {
+	char *Name; /**< the name which is being resolved (forward lookups only) */
+	int Family; /**< the address family which is currently being queried */
+	bool Pending; /**< whether the query is still in progress */
+	int InUse; /**< how many deliveries of the entry's result are in progress */
+	int Status; /**< the status of the query */
+	hostent *Response; /**< the response, or NULL if the query failed */
+	time_t Expires; /**< when the result expires */
+	CVector<DnsEventCookie *> *Waiters; /**< the queries which wait for the result */
+} dnscacheentry_t;
+
+CHashtable<dnscacheentry_t *, false> CDnsCache::m_Entries;
+dnscachestats_t CDnsCache::m_Stats;
+
+/**
+ * CopyHostEnt
+ *
+ * Creates a copy of a hostent structure (without its aliases) which can
+ * be freed with a single call to free().
+ *
+ * @param Source the hostent structure
+ */
+static hostent *CopyHostEnt(const hostent *Source) {
+	hostent *Copy;
+	char **Pointers, *Data;
+	const char *Name;
+	size_t Count = 0, NameLength;
+
+	while (Source->h_addr_list[Count] != NULL) {
+		Count++;
+	}
+
+	Name = (Source->h_name != NULL) ? Source->h_name : "";
+	NameLength = strlen(Name) + 1;
+
+	Copy = (hostent *)malloc(sizeof(hostent) + sizeof(char *) * (Count + 2) +
+		Count * Source->h_length + NameLength);
+
+	if (AllocFailed(Copy)) {
+		return NULL;
+	}
+
+	Pointers = (char **)(Copy + 1);
+	Data = (char *)(Pointers + Count + 2);
+
+	Copy->h_addrtype = Source->h_addrtype;
+	Copy->h_length = Source->h_length;
+	Copy->h_aliases = Pointers;
+	Copy->h_aliases[0] = NULL;
+	Copy->h_addr_list = Pointers + 1;
+
+	for (size_t i = 0; i < Count; i++) {
+		Copy->h_addr_list[i] = Data;
+		memcpy(Data, Source->h_addr_list[i], Source->h_length);
+		Data += Source->h_length;
+	}
+
+	Copy->h_addr_list[Count] = NULL;
+
+	Copy->h_name = Data;
+	memcpy(Data, Name, NameLength);
+
+	return Copy;
+}
+
+/**
+ * FreeDnsCacheEntry
+ *
+ * Frees a DNS cache entry.
+ *
+ * @param Entry the entry
+ */
+static void FreeDnsCacheEntry(dnscacheentry_t *Entry) {
+	free(Entry->Name);
+	free(Entry->Response);
+	delete Entry->Waiters;
+	free(Entry);
+}
+
+/**
+ * DnsCacheNameCallback
+ *
+ * Called by c-ares when a forward lookup has finished.
+ *
+ * @param Cookie the cache entry
+ * @param Status the status of the dns query
+ * @param Timeouts the number of timeouts that occured while querying the dns servers
+ * @param Buffer the dns reply
+ * @param Length the length of the reply
+ */
+void DnsCacheNameCallback(void *Cookie, int Status, int Timeouts, unsigned char *Buffer, int Length) {
+	dnscacheentry_t *Entry = (dnscacheentry_t *)Cookie;
+	hostent *HostEntity = NULL;
+	int Count = DNSCACHEMAXADDRTTLS;
+	int Ttl = DNSCACHEMAXTTL;
+
+	if (Status == ARES_SUCCESS) {
+		if (Entry->Family == AF_INET6) {
+			ares_addr6ttl Ttls[DNSCACHEMAXADDRTTLS];
+
+			Status = ares_parse_aaaa_reply(Buffer, Length, &HostEntity, Ttls, &Count);
+
+			for (int i = 0; Status == ARES_SUCCESS && i < Count; i++) {
+				Ttl = min(Ttl, Ttls[i].ttl);
+			}
+		} else {
+			ares_addrttl Ttls[DNSCACHEMAXADDRTTLS];
+
+			Status = ares_parse_a_reply(Buffer, Length, &HostEntity, Ttls, &Count);
+
+			for (int i = 0; Status == ARES_SUCCESS && i < Count; i++) {
+				Ttl = min(Ttl, Ttls[i].ttl);
+			}
+		}
+	}
+
+	// like ares_gethostbyname() we fall back to A records when there
+	// are no usable AAAA records
+	if ((Status == ARES_ENODATA || Status == ARES_EBADRESP || Status == ARES_ETIMEOUT) &&
+			Entry->Family == AF_INET6) {
+		if (HostEntity != NULL) {
+			ares_free_hostent(HostEntity);
+		}
+
+		Entry->Family = AF_INET;
+		CDnsCache::Search(Entry);
+
+		return;
+	}
+
+	CDnsCache::Complete(Entry, Status, HostEntity, max(Ttl, 0));
+
+	if (HostEntity != NULL) {
+		ares_free_hostent(HostEntity);
+	}
+}
+
+/**
+ * DnsCacheAddressCallback
+ *
+ * Called by c-ares when a reverse lookup has finished.
+ *
+ * @param Cookie the cache entry
+ * @param Status the status of the dns query
+ * @param Timeouts the number of timeouts that occured while querying the dns servers
+ * @param HostEntity the response for the dns query (can be NULL)
+ */
+void DnsCacheAddressCallback(void *Cookie, int Status, int Timeouts, hostent *HostEntity) {
+	CDnsCache::Complete((dnscacheentry_t *)Cookie, Status, HostEntity, DNSCACHEPTRTTL);
+}
+
+/**
+ * GetHostByName
+ *
+ * Looks up a hostname. Entries from the hosts file are not cached.
+ *
+ * @param Host the hostname
+ * @param Family the address family (AF_INET or AF_INET6)
+ * @param Cookie the query's cookie
+ */
+void CDnsCache::GetHostByName(const char *Host, int Family, DnsEventCookie *Cookie) {
+	dnscacheentry_t *Entry;
+	hostent *HostEntity;
+	char *Key;
+	int rc;
+
+	if (ares_gethostbyname_file(CDnsQuery::GetDnsChannel(), Host, Family, &HostEntity) == ARES_SUCCESS) {
+		GenericDnsQueryCallback(Cookie, ARES_SUCCESS, 0, HostEntity);
+		ares_free_hostent(HostEntity);
+
+		return;
+	}
+
+	rc = asprintf(&Key, "%s/%s", (Family == AF_INET6) ? "AAAA" : "A", Host);
+
+	if (RcFailed(rc)) {
+		GenericDnsQueryCallback(Cookie, ARES_ENOMEM, 0, NULL);
+
+		return;
+	}
+
+	Entry = Lookup(Key, Cookie);
+
+	free(Key);
+
+	if (Entry == NULL) {
+		return;
+	}
+
+	Entry->Name = strdup(Host);
+
+	if (AllocFailed(Entry->Name)) {
+		Complete(Entry, ARES_ENOMEM, NULL, 0);
+
+		return;
+	}
+
+	Entry->Family = Family;
+	Search(Entry);
+}
+
+/**
+ * GetHostByAddr
+ *
+ * Looks up the hostname for an address.
+ *
+ * @param Address the address
+ * @param Cookie the query's cookie
+ */
+void CDnsCache::GetHostByAddr(const sockaddr *Address, DnsEventCookie *Cookie) {
+	dnscacheentry_t *Entry;
+	const void *IpAddr;
+	char *Key;
+	int rc;
+
+#ifdef HAVE_IPV6
+	if (Address->sa_family == AF_INET) {
+#endif /* HAVE_IPV6 */
+		IpAddr = &(((const sockaddr_in *)Address)->sin_addr);
+#ifdef HAVE_IPV6
+	} else {
+		IpAddr = &(((const sockaddr_in6 *)Address)->sin6_addr);
+	}
+#endif /* HAVE_IPV6 */
+
+	rc = asprintf(&Key, "PTR/%s", IpToString(const_cast<sockaddr *>(Address)));
+
+	if (RcFailed(rc)) {
+		GenericDnsQueryCallback(Cookie, ARES_ENOMEM, 0, NULL);
+
+		return;
+	}
+
+	Entry = Lookup(Key, Cookie);
+
+	free(Key);
+
+	if (Entry == NULL) {
+		return;
+	}
+
+	ares_gethostbyaddr(CDnsQuery::GetDnsChannel(), IpAddr, INADDR_LEN(Address->sa_family),
+		Address->sa_family, DnsCacheAddressCallback, Entry);
+}
+
+/**
+ * Lookup
+ *
+ * Answers a lookup from the cache or adds the query to a pending
+ * lookup. Otherwise an entry for a new lookup is returned which the
+ * caller has to resolve.
+ *
+ * @param Key the cache key
+ * @param Cookie the query's cookie
+ */
+dnscacheentry_t *CDnsCache::Lookup(const char *Key, DnsEventCookie *Cookie) {
+	dnscacheentry_t *Entry = m_Entries.Get(Key);
+
+	// entries which are currently being delivered are never re-queried,
+	// so that their response stays valid for the remaining callbacks
+	if (Entry != NULL && !Entry->Pending && (Entry->Expires > g_CurrentTime || Entry->InUse > 0)) {
+		m_Stats.Hits++;
+
+		if (Entry->Response == NULL) {
+			m_Stats.NegativeHits++;
+		}
+
+		Entry->InUse++;
+		GenericDnsQueryCallback(Cookie, Entry->Status, 0, Entry->Response);
+		Entry->InUse--;
+
+		return NULL;
+	}
+
+	if (Entry != NULL && Entry->Pending) {
+		m_Stats.Coalesced++;
+
+		if (IsError(Entry->Waiters->Insert(Cookie))) {
+			GenericDnsQueryCallback(Cookie, ARES_ENOMEM, 0, NULL);
+		}
+
+		return NULL;
+	}
+
+	if (Entry == NULL) {
+		Prune();
+
+		Entry = (dnscacheentry_t *)malloc(sizeof(dnscacheentry_t));
+
+		if (AllocFailed(Entry)) {
+			GenericDnsQueryCallback(Cookie, ARES_ENOMEM, 0, NULL);
+
+			return NULL;
+		}
+
+		memset(Entry, 0, sizeof(dnscacheentry_t));
+
+		if (IsError(m_Entries.Add(Key, Entry))) {
+			free(Entry);
+			GenericDnsQueryCallback(Cookie, ARES_ENOMEM, 0, NULL);
+
+			return NULL;
+		}
+	}
+
+	Entry->Waiters = new CVector<DnsEventCookie *>();
+
+	if (AllocFailed(Entry->Waiters) || IsError(Entry->Waiters->Insert(Cookie))) {
+		delete Entry->Waiters;
+		Entry->Waiters = NULL;
+
+		GenericDnsQueryCallback(Cookie, ARES_ENOMEM, 0, NULL);
+
+		return NULL;
+	}
+
+	m_Stats.Misses++;
+	Entry->Pending = true;
+
+	return Entry;
+}
+
+/**
+ * Search
+ *
+ * Sends the dns query for a forward lookup.
+ *
+ * @param Entry the cache entry
+ */
+void CDnsCache::Search(dnscacheentry_t *Entry) {
+	ares_search(CDnsQuery::GetDnsChannel(), Entry->Name, C_IN,
+		(Entry->Family == AF_INET6) ? T_AAAA : T_A, DnsCacheNameCallback, Entry);
+}
+
+/**
+ * Complete
+ *
+ * Stores the result of a lookup and passes it on to the waiting queries.
+ *
+ * @param Entry the cache entry
+ * @param Status the status of the lookup
+ * @param Response the response (can be NULL)
+ * @param Ttl how long a successful response may be cached (in seconds)
+ */
+void CDnsCache::Complete(dnscacheentry_t *Entry, int Status, const hostent *Response, int Ttl) {
+	CVector<DnsEventCookie *> *Waiters = Entry->Waiters;
+
+	free(Entry->Response);
+	Entry->Response = NULL;
+
+	if (Status == ARES_SUCCESS && Response != NULL) {
+		Entry->Response = CopyHostEnt(Response);
+
+		if (Entry->Response == NULL) {
+			Status = ARES_ENOMEM;
+		}
+	} else if (Status == ARES_SUCCESS) {
+		Status = ARES_ENODATA;
+	}
+
+	if (Status == ARES_SUCCESS) {
+		Entry->Expires = g_CurrentTime + Ttl;
+	} else if (Status == ARES_ENOTFOUND || Status == ARES_ENODATA) {
+		Entry->Expires = g_CurrentTime + DNSCACHENEGATIVETTL;
+	} else {
+		Entry->Expires = g_CurrentTime;
+	}
+
+	free(Entry->Name);
+	Entry->Name = NULL;
+
+	Entry->Status = Status;
+	Entry->Pending = false;
+	Entry->Waiters = NULL;
+
+	Entry->InUse++;
+
+	for (int i = 0; i < Waiters->GetLength(); i++) {
+		GenericDnsQueryCallback((*Waiters)[i], Entry->Status, 0, Entry->Response);
+	}
+
+	Entry->InUse--;
+
+	delete Waiters;
+}
+
+/**
+ * Prune
+ *
+ * Makes room for a new entry when the cache is full. Expired entries are
+ * removed first; if that isn't enough all entries which are not in use
+ * are dropped.
+ */
+void CDnsCache::Prune(void) {
+	for (int Pass = 0; Pass < 2 && m_Entries.GetLength() >= DNSCACHEMAXENTRIES; Pass++) {
+		CVector<char *> Keys;
+		hash_t<dnscacheentry_t *> *Item;
+		int i = 0;
+
+		while ((Item = m_Entries.Iterate(i++)) != NULL) {
+			dnscacheentry_t *Entry = Item->Value;
+
+			if (Entry->Pending || Entry->InUse > 0 || (Pass == 0 && Entry->Expires > g_CurrentTime)) {
+				continue;
+			}
+
+			char *Key = strdup(Item->Name);
+
+			if (AllocFailed(Key)) {
+				break;
+			}
+
+			if (IsError(Keys.Insert(Key))) {
+				free(Key);
+
+				break;
+			}
+		}
+
+		for (i = 0; i < Keys.GetLength(); i++) {
+			FreeDnsCacheEntry(m_Entries.Get(Keys[i]));
+			m_Entries.Remove(Keys[i]);
+
+			free(Keys[i]);
+		}
+	}
+}
+
+/**
+ * GetCount
+ *
+ * Returns the number of cache entries.
+ */
+int CDnsCache::GetCount(void) {
+	return m_Entries.GetLength();
+}
+
+/**
+ * GetStats
+ *
+ * Returns the cache's hit/miss counters.
+ */
+const dnscachestats_t *CDnsCache::GetStats(void) {
+	return &m_Stats;
+}
@@ -0,0 +1,66 @@
+/*******************************************************************************
+ * shroudBNC - an object-oriented framework for IRC                            *
+ * Copyright (C) 2005-2007,2010 Gunnar Beutner                                 *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or               *
+ * modify it under the terms of the GNU General Public License                 *
+ * as published by the Free Software Foundation; either version 2              *
+ * of the License, or (at your option) any later version.                      *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU General Public License for more details.                                *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License           *
+ * along with this program; if not, write to the Free Software                 *
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA. *
+ *******************************************************************************/
+
+#ifndef DNSCACHE_H
+#define DNSCACHE_H
+
+#ifndef SWIG
+/**
+ * dnscachestats_t
+ *
+ * Counters for the DNS cache.
+ */
+typedef struct dnscachestats_s {
+	unsigned int Hits; /**< lookups which were answered from the cache */
+	unsigned int NegativeHits; /**< cache hits for names which do not exist */
+	unsigned int Coalesced; /**< lookups which joined a pending query */
+	unsigned int Misses; /**< lookups which had to query the dns servers */
+} dnscachestats_t;
+
+struct dnscacheentry_s;
+
+/**
+ * CDnsCache
+ *
+ * Caches the results of forward and reverse dns lookups for CDnsQuery.
+ * Positive results are kept as long as their TTL allows, names which
+ * do not exist are cached for a short while and lookups for a name which
+ * is already being resolved share the pending query.
+ */
+class SBNCAPI CDnsCache {
+	friend void DnsCacheNameCallback(void *Cookie, int Status, int Timeouts, unsigned char *Buffer, int Length);
+	friend void DnsCacheAddressCallback(void *Cookie, int Status, int Timeouts, hostent *HostEntity);
+
+	static CHashtable<struct dnscacheentry_s *, false> m_Entries; /**< cache entries by query type and name */
+	static dnscachestats_t m_Stats; /**< hit/miss counters */
+
+	static struct dnscacheentry_s *Lookup(const char *Key, DnsEventCookie *Cookie);
+	static void Search(struct dnscacheentry_s *Entry);
+	static void Complete(struct dnscacheentry_s *Entry, int Status, const hostent *Response, int Ttl);
+	static void Prune(void);
+public:
+	static void GetHostByName(const char *Host, int Family, DnsEventCookie *Cookie);
+	static void GetHostByAddr(const sockaddr *Address, DnsEventCookie *Cookie);
+
+	static int GetCount(void);
+	static const dnscachestats_t *GetStats(void);
+};
+#endif /* SWIG */
+
+#endif /* DNSCACHE_H */
@@ -20,6 +20,7 @@
 #include "StdAfx.h"
 
 ares_channel CDnsQuery::m_DnsChannel; /**< ares channel object */
+CVector<CDnsSocket *> CDnsQuery::m_DnsSockets;
 
 /**
  * GenericDnsQueryCallback
@@ -35,12 +36,14 @@ ares_channel CDnsQuery::m_DnsChannel; /**< ares channel object */
 void GenericDnsQueryCallback(void *CookieRaw, int Status, int Timeouts, hostent *HostEntity) {
 	DnsEventCookie *Cookie = (DnsEventCookie *)CookieRaw;
 
-	if (Cookie->Query == NULL) {
-		return;
-	}
+	if (Cookie->Query != NULL) {
+		Cookie->Query->AsyncDnsEvent(Status, HostEntity);
 
-	Cookie->Query->AsyncDnsEvent(Status, HostEntity);
-	Cookie->Query->m_PendingQueries--;
+		// the callback might have destroyed the query
+		if (Cookie->Query != NULL) {
+			Cookie->Query->m_PendingQueries--;
+		}
+	}
 
 	Cookie->RefCount--;
 
@@ -49,6 +52,54 @@ void GenericDnsQueryCallback(void *CookieRaw, int Status, int Timeouts, hostent
 	}
 }
 
+/**
+ * GenericDnsSocketCallback
+ *
+ * Called by c-ares whenever it opens or closes a socket or when it wants
+ * to be notified about other events for the socket.
+ *
+ * @param Cookie not used
+ * @param Socket the socket
+ * @param Readable whether c-ares wants to be notified when the socket is readable
+ * @param Writable whether c-ares wants to be notified when the socket is writable
+ */
+void GenericDnsSocketCallback(void *Cookie, ares_socket_t Socket, int Readable, int Writable) {
+	CVector<CDnsSocket *> *Sockets = &CDnsQuery::m_DnsSockets;
+	CDnsSocket *DnsSocket = NULL;
+	int i;
+
+	for (i = 0; i < Sockets->GetLength(); i++) {
+		if ((*Sockets)[i]->GetSocket() == (SOCKET)Socket) {
+			DnsSocket = (*Sockets)[i];
+
+			break;
+		}
+	}
+
+	if (!Readable && !Writable) {
+		if (DnsSocket != NULL) {
+			Sockets->Remove(i);
+
+			DnsSocket->Close();
+		}
+
+		return;
+	}
+
+	if (DnsSocket != NULL) {
+		DnsSocket->Update(Writable != 0);
+
+		return;
+	}
+
+	// ctor takes care of registering the socket
+	DnsSocket = new CDnsSocket((SOCKET)Socket, Writable != 0);
+
+	if (AllocFailed(DnsSocket) || IsError(Sockets->Insert(DnsSocket))) {
+		g_Bouncer->Fatal();
+	}
+}
+
 /**
  * CDnsQuery
  *
@@ -78,7 +129,9 @@ CDnsQuery::CDnsQuery(void *EventInterface, DnsEventFunction EventFunction, int T
 		ares_options Options;
 
 		Options.timeout = m_Timeout;
-		ares_init_options(&m_DnsChannel, &Options, ARES_OPT_TIMEOUT);
+		Options.sock_state_cb = GenericDnsSocketCallback;
+		Options.sock_state_cb_data = NULL;
+		ares_init_options(&m_DnsChannel, &Options, ARES_OPT_TIMEOUT | ARES_OPT_SOCK_STATE_CB);
 	}
 }
 
@@ -101,6 +154,7 @@ CDnsQuery::~CDnsQuery(void) {
  *
  * Asynchronously performs the task of the "gethostbyname" function
  * and calls the callback function once the operation has completed.
+ * Results are cached by CDnsCache.
  *
  * @param Host the hostname
  * @param Family the address family (AF_INET or AF_INET6)
@@ -144,7 +198,7 @@ void CDnsQuery::GetHostByName(const char *Host, int Family) {
 
 	m_PendingQueries++;
 	m_EventCookie->RefCount++;
-	ares_gethostbyname(m_DnsChannel, Host, Family, GenericDnsQueryCallback, m_EventCookie);
+	CDnsCache::GetHostByName(Host, Family, m_EventCookie);
 }
 
 /**
@@ -152,26 +206,14 @@ void CDnsQuery::GetHostByName(const char *Host, int Family) {
  *
  * Asynchronously performs the task of the "gethostbyaddr" function
  * and calls the callback function once the operation has completed.
+ * Results are cached by CDnsCache.
  *
  * @param Address the address for which the hostname should be looked up
  */
 void CDnsQuery::GetHostByAddr(sockaddr *Address) {
-	void *IpAddr;
-
-#ifdef HAVE_IPV6
-	if (Address->sa_family == AF_INET) {
-#endif /* HAVE_IPV6 */
-		IpAddr = &(((sockaddr_in *)Address)->sin_addr);
-#ifdef HAVE_IPV6
-	} else {
-		IpAddr = &(((sockaddr_in6 *)Address)->sin6_addr);
-	}
-#endif /* HAVE_IPV6 */
-
 	m_PendingQueries++;
 	m_EventCookie->RefCount++;
-	ares_gethostbyaddr(m_DnsChannel, IpAddr, INADDR_LEN(Address->sa_family),
-		Address->sa_family, GenericDnsQueryCallback, m_EventCookie);
+	CDnsCache::GetHostByAddr(Address, m_EventCookie);
 }
 
 /**
@@ -190,87 +232,35 @@ void CDnsQuery::AsyncDnsEvent(int Status, hostent *Response) {
 }
 
 /**
- * RegisterSockets
- *
- * Registers all DNS sockets and returns a cookie that can be used to
- * unregister the sockets later on - or NULL if no sockets were registered.
+ * GetTimeoutMs
  *
- * @return DnsSocketCookie a cookie
+ * Returns the number of milliseconds until c-ares has to process
+ * timeouts for its pending queries, or -1 if there are no pending
+ * queries.
  */
-DnsSocketCookie *CDnsQuery::RegisterSockets() {
-	SOCKET Sockets[ARES_GETSOCK_MAXNUM];
-	int Bitmask, Count = 0;
-	DnsSocketCookie *Cookie;
+int64_t CDnsQuery::GetTimeoutMs(void) {
+	timeval Timeout, *Result;
 
 	if (m_DnsChannel == NULL) {
-		return NULL;
-	}
-
-	Bitmask = ares_getsock(m_DnsChannel, Sockets, sizeof(Sockets) / sizeof(*Sockets));
-
-	Cookie = new DnsSocketCookie;
-
-	if (AllocFailed(Cookie)) {
-		g_Bouncer->Fatal();
-	}
-
-	for (int i = 0; i < (int)(sizeof(Sockets) / sizeof(*Sockets)); i++) {
-		if (!ARES_GETSOCK_READABLE(Bitmask, i) && !ARES_GETSOCK_WRITABLE(Bitmask, i)) {
-			continue;
-		}
-
-		Count++;
-		// ctor takes care of registering the socket
-#ifdef _MSC_VER
-#	pragma warning( push )
-#	pragma warning( disable : 4800 )
-#endif /* _MSC_VER */
-		Cookie->Sockets[Count - 1] = new CDnsSocket(Sockets[i], ARES_GETSOCK_WRITABLE(Bitmask, i));
-#ifdef _MSC_VER
-#	pragma warning( pop ) 
-#endif /* _MSC_VER */
-	}
-
-	if (Count == 0) {
-		delete Cookie;
-
-		return NULL;
-	}
-
-	Cookie->Count = Count;
-
-	return Cookie;
-}
-
-/**
- * UnregisterSockets
- *
- * Unregisters a set of DNS sockets.
- *
- * @param Cookie a cookie returned by RegisterSockets
- */
-void CDnsQuery::UnregisterSockets(DnsSocketCookie *Cookie) {
-	if (Cookie == NULL) {
-		return;
+		return -1;
 	}
 
-	for (int i = 0; i < Cookie->Count; i++) {
-		// dtor takes care of un-registering the socket
-		Cookie->Sockets[i]->Destroy();
+	Result = ares_timeout(m_DnsChannel, NULL, &Timeout);
 
-		delete Cookie->Sockets[i];
+	if (Result == NULL) {
+		return -1;
 	}
 
-	delete Cookie;
+	return (int64_t)Result->tv_sec * 1000 + (Result->tv_usec + 999) / 1000;
 }
 
 /**
  * ProcessTimeouts
  *
- * Processes timeouts for the DNS sockets.
+ * Processes timeouts for the DNS sockets once they are due.
  */
 void CDnsQuery::ProcessTimeouts(void) {
-	if (m_DnsChannel != NULL) {
+	if (GetTimeoutMs() == 0) {
 		ares_process_fd(m_DnsChannel, ARES_SOCKET_BAD, ARES_SOCKET_BAD);
 	}
 }
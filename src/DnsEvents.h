@@ -36,6 +36,8 @@ typedef struct {
 	CDnsQuery *Query;
 } DnsEventCookie;
 
+void GenericDnsQueryCallback(void *Cookie, int Status, int Timeouts, hostent *HostEntity);
+
 /**
  * CDnsQuery
  *
@@ -43,8 +45,10 @@ typedef struct {
  */
 class SBNCAPI CDnsQuery {
 	friend void GenericDnsQueryCallback(void *Cookie, int Status, int Timeouts, hostent *HostEntity);
+	friend void GenericDnsSocketCallback(void *Cookie, ares_socket_t Socket, int Readable, int Writable);
 	friend bool DestroyDnsChannelTimer(time_t Now, void *Cookie);
 	friend class CDnsSocket;
+	friend class CDnsCache;
 
 	DnsEventCookie *m_EventCookie;
 	void *m_EventObject; /**< the object used for callbacks */
@@ -53,6 +57,7 @@ class SBNCAPI CDnsQuery {
 	unsigned int m_PendingQueries; /**< number of pending queries */
 
 	static ares_channel m_DnsChannel; /**< the ares channel object */
+	static CVector<CDnsSocket *> m_DnsSockets; /**< the sockets which are currently used by c-ares */
 
 	void AsyncDnsEvent(int Status, hostent *Response);
 	static ares_channel GetDnsChannel(void);
@@ -63,8 +68,7 @@ public:
 	void GetHostByName(const char *Host, int Family = AF_INET);
 	void GetHostByAddr(sockaddr *Address);
 
-	static DnsSocketCookie *RegisterSockets(void);
-	static void UnregisterSockets(DnsSocketCookie *Cookie);
+	static int64_t GetTimeoutMs(void);
 	static void ProcessTimeouts(void);
 };
 
@@ -22,12 +22,38 @@
 CDnsSocket::CDnsSocket(SOCKET Socket, bool Outbound) {
 	m_Socket = Socket;
 	m_Outbound = Outbound;
+	m_Registered = true;
+	m_Processing = false;
+	m_Closed = false;
 
 	g_Bouncer->RegisterSocket(m_Socket, this);
 }
 
+// called by the main loop when an error occurred for the socket: c-ares reads
+// the error itself and closes the socket through GenericDnsSocketCallback()
 void CDnsSocket::Destroy(void) {
-	g_Bouncer->UnregisterSocket(m_Socket);
+	m_Processing = true;
+	ares_process_fd(CDnsQuery::GetDnsChannel(), m_Socket, m_Socket);
+	m_Processing = false;
+
+	if (m_Closed) {
+		delete this;
+	}
+}
+
+// called by GenericDnsSocketCallback() when c-ares has closed the socket
+void CDnsSocket::Close(void) {
+	if (m_Registered) {
+		g_Bouncer->UnregisterSocket(m_Socket);
+
+		m_Registered = false;
+	}
+
+	m_Closed = true;
+
+	if (!m_Processing) {
+		delete this;
+	}
 }
 
 int CDnsSocket::Read(bool DontProcess) {
@@ -53,6 +79,26 @@ bool CDnsSocket::ShouldDestroy(void) const {
 	return false;
 }
 
+bool CDnsSocket::ReadsOwnErrors(void) const {
+	return true;
+}
+
 const char *CDnsSocket::GetClassName(void) const {
 	return "CDnsSocket";
 }
+
+SOCKET CDnsSocket::GetSocket(void) const {
+	return m_Socket;
+}
+
+void CDnsSocket::Update(bool Outbound) {
+	m_Outbound = Outbound;
+
+	if (!m_Registered) {
+		g_Bouncer->RegisterSocket(m_Socket, this);
+
+		m_Registered = true;
+	} else {
+		g_Bouncer->UpdateSocketEvents(m_Socket);
+	}
+}
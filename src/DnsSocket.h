@@ -20,14 +20,24 @@
 #ifndef DNSSOCKET_H
 #define DNSSOCKET_H
 
+/**
+ * CDnsSocket
+ *
+ * A socket which is used by c-ares. These are created and destroyed
+ * by CDnsQuery as c-ares opens and closes its sockets.
+ */
 class CDnsSocket : public CSocketEvents {
 private:
         SOCKET m_Socket;
         bool m_Outbound;
+        bool m_Registered;
+        bool m_Processing;
+        bool m_Closed;
 public:
         CDnsSocket(SOCKET Socket, bool Outbound);
 
         void Destroy(void);
+        void Close(void);
 
         int Read(bool DontProcess = false);
         int Write(void);
@@ -36,12 +46,11 @@ public:
         bool HasQueuedData(void) const;
         bool ShouldDestroy(void) const;
 
+        bool ReadsOwnErrors(void) const;
         const char *GetClassName(void) const;
-};
 
-typedef struct {
-        CDnsSocket *Sockets[ARES_GETSOCK_MAXNUM];
-	int Count;
-} DnsSocketCookie;
+        SOCKET GetSocket(void) const;
+        void Update(bool Outbound);
+};
 
 #endif /* DNSSOCKET_H */
@@ -19,15 +19,24 @@
 
 #include "StdAfx.h"
 
+#define SHAREDDATA(Line) ((char *)((Line) + 1))
+#define BLOCKDATA(Block) ((Block)->Shared != NULL ? SHAREDDATA((Block)->Shared) : (char *)((Block) + 1))
+
+static fifo_block_t *g_BlockPool = NULL; /**< unused blocks */
+static int g_BlockPoolSize = 0; /**< the number of blocks in the pool */
+static fifo_block_t *g_SharedBlockPool = NULL; /**< unused blocks for shared lines */
+static int g_SharedBlockPoolSize = 0; /**< the number of blocks in the shared pool */
+
 /**
  * CFIFOBuffer
  *
  * Constructs a new fifo buffer.
  */
 CFIFOBuffer::CFIFOBuffer() {
-	m_Buffer = NULL;
-	m_BufferSize = 0;
-	m_Offset = 0;
+	m_Head = NULL;
+	m_Tail = NULL;
+	m_Retired = NULL;
+	m_Size = 0;
 }
 
 /**
@@ -36,77 +45,268 @@ CFIFOBuffer::CFIFOBuffer() {
  * Destructs a fifo buffer.
  */
 CFIFOBuffer::~CFIFOBuffer() {
-	free(m_Buffer);
+	Flush();
 }
 
 /**
- * ResizeBuffer
+ * AllocateBlock
  *
- * Resizes a buffer. The new size of the buffer will be a multiple
- * of BLOCKSIZE. NULL is returned if the buffer could not be successfully
- * resized.
+ * Allocates a new block. Blocks of the default size are taken from the
+ * block pool if possible. NULL is returned if the block could not be
+ * allocated.
  *
- * @param Buffer the buffer which is to be resized
- * @param OldSize the old size of the buffer
- * @param NewSize the new size of the buffer
+ * @param Capacity the number of bytes the block should be able to hold
  */
-void *CFIFOBuffer::ResizeBuffer(void *Buffer, size_t OldSize, size_t NewSize) {
-	if (OldSize != 0) {
-		OldSize += BLOCKSIZE - (OldSize % BLOCKSIZE);
+fifo_block_t *CFIFOBuffer::AllocateBlock(size_t Capacity) {
+	fifo_block_t *Block;
+
+	if (Capacity <= BLOCKSIZE && g_BlockPool != NULL) {
+		Block = g_BlockPool;
+		g_BlockPool = Block->Next;
+		g_BlockPoolSize--;
+	} else {
+		if (Capacity < BLOCKSIZE) {
+			Capacity = BLOCKSIZE;
+		}
+
+		Block = (fifo_block_t *)malloc(sizeof(fifo_block_t) + Capacity);
+
+		if (AllocFailed(Block)) {
+			return NULL;
+		}
+
+		Block->Capacity = Capacity;
 	}
 
-	size_t CeilNewSize = NewSize + BLOCKSIZE - (NewSize % BLOCKSIZE);
+	Block->Next = NULL;
+	Block->Shared = NULL;
+	Block->Offset = 0;
+	Block->Length = 0;
 
-	size_t OldBlocks = OldSize / BLOCKSIZE;
-	size_t NewBlocks = CeilNewSize / BLOCKSIZE;
+	return Block;
+}
 
-	if (NewBlocks != OldBlocks) {
-		if (NewSize == 0) {
-			free(Buffer);
+/**
+ * AllocateSharedBlock
+ *
+ * Allocates a block which refers to a shared line. NULL is returned if the
+ * block could not be allocated.
+ *
+ * @param Line the shared line
+ */
+fifo_block_t *CFIFOBuffer::AllocateSharedBlock(shared_line_t *Line) {
+	fifo_block_t *Block;
 
+	if (g_SharedBlockPool != NULL) {
+		Block = g_SharedBlockPool;
+		g_SharedBlockPool = Block->Next;
+		g_SharedBlockPoolSize--;
+	} else {
+		Block = (fifo_block_t *)malloc(sizeof(fifo_block_t));
+
+		if (AllocFailed(Block)) {
 			return NULL;
+		}
+	}
+
+	Line->RefCount++;
+
+	// nothing can be appended to this block
+	Block->Next = NULL;
+	Block->Shared = Line;
+	Block->Offset = 0;
+	Block->Length = Line->Length;
+	Block->Capacity = Line->Length;
+
+	return Block;
+}
+
+/**
+ * ReleaseBlock
+ *
+ * Returns a block to the block pool or frees it if the pool is full.
+ *
+ * @param Block the block
+ */
+void CFIFOBuffer::ReleaseBlock(fifo_block_t *Block) {
+	if (Block == NULL) {
+		return;
+	}
+
+	if (Block->Shared != NULL) {
+		ReleaseSharedLine(Block->Shared);
+
+		if (g_SharedBlockPoolSize < BLOCKPOOLSIZE) {
+			Block->Next = g_SharedBlockPool;
+			g_SharedBlockPool = Block;
+			g_SharedBlockPoolSize++;
 		} else {
-			return realloc(Buffer, NewBlocks * BLOCKSIZE);
+			free(Block);
 		}
+
+		return;
+	}
+
+	if (Block->Capacity == BLOCKSIZE && g_BlockPoolSize < BLOCKPOOLSIZE) {
+		Block->Next = g_BlockPool;
+		g_BlockPool = Block;
+		g_BlockPoolSize++;
 	} else {
-		return Buffer;
+		free(Block);
 	}
 }
 
 /**
- * Optimize
+ * Grow
+ *
+ * Appends empty blocks to the buffer so that at least the specified number of
+ * bytes can be written to it. Returns the first block which has room for new
+ * data or NULL if the blocks could not be allocated.
  *
- * Optimizes the memory usage of a buffer.
+ * @param Size the number of bytes
  */
-void CFIFOBuffer::Optimize(void) {
-	char *NewBuffer;
+fifo_block_t *CFIFOBuffer::Grow(size_t Size) {
+	fifo_block_t *First = NULL, *Last = NULL, *Block;
+	size_t Room = 0;
 
-	if (m_Offset == 0 || m_Offset < m_BufferSize / 5) {
-		return;
+	if (m_Tail != NULL) {
+		Room = m_Tail->Capacity - m_Tail->Length;
 	}
 
-	if (m_BufferSize - m_Offset <= 0) {
-		free(m_Buffer);
+	while (Room < Size) {
+		Block = AllocateBlock(BLOCKSIZE);
 
-		m_Buffer = NULL;
-		m_BufferSize = 0;
-		m_Offset = 0;
+		if (Block == NULL) {
+			while (First != NULL) {
+				Block = First->Next;
+				ReleaseBlock(First);
+				First = Block;
+			}
 
-		return;
+			return NULL;
+		}
+
+		if (Last == NULL) {
+			First = Block;
+		} else {
+			Last->Next = Block;
+		}
+
+		Last = Block;
+		Room += Block->Capacity;
+	}
+
+	if (First == NULL) {
+		return m_Tail;
+	}
+
+	if (m_Tail == NULL) {
+		m_Head = First;
+	} else {
+		m_Tail->Next = First;
 	}
 
-	NewBuffer = (char *)ResizeBuffer(NULL, 0, m_BufferSize - m_Offset);
+	Block = (m_Tail != NULL && m_Tail->Length < m_Tail->Capacity) ? m_Tail : First;
 
-	if (AllocFailed(NewBuffer)) {
-		return;
+	m_Tail = Last;
+
+	return Block;
+}
+
+/**
+ * Append
+ *
+ * Copies data into a chain of blocks which has previously been allocated
+ * using Grow(). Returns the block which further data should be
+ * appended to.
+ *
+ * @param Block the first block which has room for the data
+ * @param Data the data
+ * @param Size the number of bytes
+ */
+fifo_block_t *CFIFOBuffer::Append(fifo_block_t *Block, const char *Data, size_t Size) {
+	while (Size > 0) {
+		size_t Amount = Block->Capacity - Block->Length;
+
+		if (Amount == 0) {
+			Block = Block->Next;
+
+			continue;
+		}
+
+		if (Amount > Size) {
+			Amount = Size;
+		}
+
+		memcpy(BLOCKDATA(Block) + Block->Length, Data, Amount);
+		Block->Length += Amount;
+
+		Data += Amount;
+		Size -= Amount;
+	}
+
+	return Block;
+}
+
+/**
+ * Linearize
+ *
+ * Makes sure that the specified number of bytes at the beginning of
+ * the buffer are stored in a single block and returns a pointer to them.
+ * NULL is returned if the data could not be moved into a single block.
+ * Shared lines are always copied so that callers can modify the data.
+ *
+ * @param Size the number of bytes
+ */
+char *CFIFOBuffer::Linearize(size_t Size) {
+	fifo_block_t *Block, *Next;
+	size_t Copied = 0;
+
+	if (Size > m_Size) {
+		Size = m_Size;
+	}
+
+	if (m_Head->Shared == NULL && m_Head->Length - m_Head->Offset >= Size) {
+		return BLOCKDATA(m_Head) + m_Head->Offset;
+	}
+
+	Block = AllocateBlock(Size);
+
+	if (Block == NULL) {
+		return NULL;
 	}
 
-	memcpy(NewBuffer, m_Buffer + m_Offset, m_BufferSize - m_Offset);
+	while (Copied < Size) {
+		size_t Amount = m_Head->Length - m_Head->Offset;
 
-	free(m_Buffer);
-	m_Buffer = NewBuffer;
-	m_BufferSize -= m_Offset;
-	m_Offset = 0;
+		if (Amount > Size - Copied) {
+			Amount = Size - Copied;
+		}
+
+		memcpy(BLOCKDATA(Block) + Copied, BLOCKDATA(m_Head) + m_Head->Offset, Amount);
+		m_Head->Offset += Amount;
+		Copied += Amount;
+
+		if (m_Head->Offset == m_Head->Length && m_Head->Next != NULL) {
+			Next = m_Head->Next;
+			ReleaseBlock(m_Head);
+			m_Head = Next;
+		}
+	}
+
+	Block->Length = Size;
+
+	if (m_Head->Offset == m_Head->Length) {
+		// all of the data was moved into the new block
+		ReleaseBlock(m_Head);
+		m_Head = NULL;
+		m_Tail = Block;
+	}
+
+	Block->Next = m_Head;
+	m_Head = Block;
+
+	return BLOCKDATA(Block);
 }
 
 /**
@@ -115,25 +315,88 @@ void CFIFOBuffer::Optimize(void) {
  * Returns the size of the buffer.
  */
 size_t CFIFOBuffer::GetSize(void) const {
-	return m_BufferSize - m_Offset;
+	return m_Size;
+}
+
+/**
+ * GetSegments
+ *
+ * Retrieves pointers to the buffer's data without copying it. Returns
+ * the number of segments which were stored in Data and Sizes.
+ *
+ * @param Data an array which receives pointers to the data
+ * @param Sizes an array which receives the size of each segment
+ * @param Count the number of elements in the arrays
+ */
+int CFIFOBuffer::GetSegments(const char **Data, size_t *Sizes, int Count) const {
+	int i = 0;
+
+	for (fifo_block_t *Block = m_Head; Block != NULL && i < Count; Block = Block->Next) {
+		if (Block->Length == Block->Offset) {
+			continue;
+		}
+
+		Data[i] = BLOCKDATA(Block) + Block->Offset;
+		Sizes[i] = Block->Length - Block->Offset;
+		i++;
+	}
+
+	return i;
 }
 
 /**
  * Peek
  *
  * Returns a pointer to the buffer's data without advancing the read pointer (or
- * NULL if there is no data left in the buffer).
+ * NULL if there is no data left in the buffer). The data has to be moved into
+ * a single block if it currently spans multiple blocks.
  */
-char *CFIFOBuffer::Peek(void) const {
-	if (GetSize() == 0) {
+char *CFIFOBuffer::Peek(void) {
+	if (m_Size == 0) {
 		return NULL;
 	} else {
-		return m_Buffer + m_Offset;
+		return Linearize(m_Size);
+	}
+}
+
+/**
+ * PeekLine
+ *
+ * Returns a pointer to the first line in the buffer (or NULL if the buffer
+ * does not contain a complete line yet) without advancing the read pointer.
+ * Lines are returned in-place, only a line which spans multiple blocks is
+ * moved into a single block.
+ *
+ * @param Length receives the length of the line, excluding the '\n'
+ */
+char *CFIFOBuffer::PeekLine(size_t *Length) {
+	size_t Offset = 0;
+	char *End;
+
+	for (fifo_block_t *Block = m_Head; Block != NULL; Block = Block->Next) {
+		size_t Amount = Block->Length - Block->Offset;
+
+		End = (char *)memchr(BLOCKDATA(Block) + Block->Offset, '\n', Amount);
+
+		if (End != NULL) {
+			*Length = Offset + (End - (BLOCKDATA(Block) + Block->Offset));
+
+			if (Block == m_Head && m_Head->Shared == NULL) {
+				return BLOCKDATA(m_Head) + m_Head->Offset;
+			}
+
+			return Linearize(*Length + 1);
+		}
+
+		Offset += Amount;
 	}
+
+	return NULL;
 }
 
 /**
- * Reads and returns the specified amount of bytes from the buffer.
+ * Reads and returns the specified amount of bytes from the buffer. The returned
+ * pointer is valid until the buffer is modified.
  *
  * @param Bytes the number of bytes which should be read from the buffer.
  *              If this value is greater than the size of the buffer,
@@ -142,19 +405,66 @@ char *CFIFOBuffer::Peek(void) const {
 char *CFIFOBuffer::Read(size_t Bytes) {
 	char *ReturnValue;
 
-	Optimize();
+	if (m_Size == 0) {
+		return NULL;
+	}
 
-	ReturnValue = m_Buffer + m_Offset;
+	ReturnValue = Linearize(Bytes);
 
-	if (Bytes > GetSize()) {
-		m_Offset += GetSize();
-	} else {
-		m_Offset += Bytes;
+	if (ReturnValue == NULL) {
+		return NULL;
 	}
 
+	Consume(Bytes);
+
 	return ReturnValue;
 }
 
+/**
+ * Consume
+ *
+ * Removes the specified amount of bytes from the beginning of the buffer.
+ *
+ * @param Bytes the number of bytes
+ */
+void CFIFOBuffer::Consume(size_t Bytes) {
+	if (Bytes > m_Size) {
+		Bytes = m_Size;
+	}
+
+	m_Size -= Bytes;
+
+	while (Bytes > 0) {
+		size_t Amount = m_Head->Length - m_Head->Offset;
+
+		if (Bytes < Amount) {
+			m_Head->Offset += Bytes;
+
+			break;
+		}
+
+		Bytes -= Amount;
+
+		if (m_Head->Next == NULL && m_Head->Shared == NULL) {
+			// keep the last block around for new data
+			m_Head->Offset = 0;
+			m_Head->Length = 0;
+
+			break;
+		}
+
+		// the block is kept until the next block is consumed so that the
+		// pointer returned by Read() remains valid
+		ReleaseBlock(m_Retired);
+		m_Retired = m_Head;
+		m_Head = m_Head->Next;
+
+		if (m_Head == NULL) {
+			m_Tail = NULL;
+		}
+	}
+}
+
 /**
  * Write
  *
@@ -164,18 +474,20 @@ char *CFIFOBuffer::Read(size_t Bytes) {
  * @param Size the number of bytes which should be written
  */
 RESULT<bool> CFIFOBuffer::Write(const char *Data, size_t Size) {
-	char *tempBuffer;
+	fifo_block_t *Block;
 
-	tempBuffer = (char *)ResizeBuffer(m_Buffer, m_BufferSize,
-		m_BufferSize + Size);
+	if (Size == 0) {
+		RETURN(bool, true);
+	}
+
+	Block = Grow(Size);
 
-	if (AllocFailed(tempBuffer)) {
-		THROW(bool, Generic_OutOfMemory, "ResizeBuffer() failed.");
+	if (Block == NULL) {
+		THROW(bool, Generic_OutOfMemory, "Grow() failed.");
 	}
 
-	m_Buffer = tempBuffer;
-	memcpy(m_Buffer + m_BufferSize, Data, Size);
-	m_BufferSize += Size;
+	Append(Block, Data, Size);
+	m_Size += Size;
 
 	RETURN(bool, true);
 }
@@ -189,27 +501,111 @@ RESULT<bool> CFIFOBuffer::Write(const char *Data, size_t Size) {
  */
 RESULT<bool> CFIFOBuffer::WriteUnformattedLine(const char *Line) {
 	size_t Length = strlen(Line);
+	fifo_block_t *Block;
 
-	char *tempBuffer = (char *)ResizeBuffer(m_Buffer, m_BufferSize,
-		m_BufferSize + Length + 2);
+	Block = Grow(Length + 2);
 
-	if (AllocFailed(tempBuffer)) {
-		THROW(bool, Generic_OutOfMemory, "ResizeBuffer() failed.");
+	if (Block == NULL) {
+		THROW(bool, Generic_OutOfMemory, "Grow() failed.");
 	}
 
-	m_Buffer = tempBuffer;
-	memcpy(m_Buffer + m_BufferSize, Line, Length);
-	memcpy(m_Buffer + m_BufferSize + Length, "\r\n", 2);
-	m_BufferSize += Length + 2;
+	Block = Append(Block, Line, Length);
+	Append(Block, "\r\n", 2);
+	m_Size += Length + 2;
 
 	RETURN(bool, true);
 }
 
+/**
+ * WriteSharedLine
+ *
+ * Queues a shared line without copying its data. The buffer holds a
+ * reference to the line until the line has been consumed.
+ *
+ * @param Line the shared line
+ */
+RESULT<bool> CFIFOBuffer::WriteSharedLine(shared_line_t *Line) {
+	fifo_block_t *Block;
+
+	Block = AllocateSharedBlock(Line);
+
+	if (Block == NULL) {
+		THROW(bool, Generic_OutOfMemory, "AllocateSharedBlock() failed.");
+	}
+
+	if (m_Tail == NULL) {
+		m_Head = Block;
+	} else {
+		m_Tail->Next = Block;
+	}
+
+	m_Tail = Block;
+	m_Size += Line->Length;
+
+	RETURN(bool, true);
+}
+
+/**
+ * CreateSharedLine
+ *
+ * Creates a shared line which can be queued in fifo buffers using
+ * WriteSharedLine(). The caller holds the first reference and has to
+ * release it using ReleaseSharedLine(). NULL is returned if the line
+ * could not be allocated.
+ *
+ * @param Line the line (without CRLF)
+ */
+shared_line_t *CFIFOBuffer::CreateSharedLine(const char *Line) {
+	size_t Length = strlen(Line);
+	shared_line_t *SharedLine;
+
+	SharedLine = (shared_line_t *)malloc(sizeof(shared_line_t) + Length + 2);
+
+	if (AllocFailed(SharedLine)) {
+		return NULL;
+	}
+
+	SharedLine->RefCount = 1;
+	SharedLine->Length = Length + 2;
+
+	memcpy(SHAREDDATA(SharedLine), Line, Length);
+	memcpy(SHAREDDATA(SharedLine) + Length, "\r\n", 2);
+
+	return SharedLine;
+}
+
+/**
+ * ReleaseSharedLine
+ *
+ * Releases a reference to a shared line.
+ *
+ * @param Line the shared line
+ */
+void CFIFOBuffer::ReleaseSharedLine(shared_line_t *Line) {
+	Line->RefCount--;
+
+	if (Line->RefCount == 0) {
+		free(Line);
+	}
+}
+
 /**
  * Flush
  *
  * Removes all data which is currently stored in the buffer.
  */
 void CFIFOBuffer::Flush(void) {
-	Read(GetSize());
+	fifo_block_t *Next;
+
+	while (m_Head != NULL) {
+		Next = m_Head->Next;
+		ReleaseBlock(m_Head);
+		m_Head = Next;
+	}
+
+	ReleaseBlock(m_Retired);
+
+	m_Tail = NULL;
+	m_Retired = NULL;
+	m_Size = 0;
 }
@@ -21,20 +21,54 @@
 #define FIFOBUFFER_H
 
 #define BLOCKSIZE 4096
+#define BLOCKPOOLSIZE 256
+
+/**
+ * shared_line_t
+ *
+ * An immutable, reference-counted line (including the trailing CRLF) which
+ * can be queued in several fifo buffers without being copied. The data
+ * follows the structure.
+ */
+typedef struct shared_line_s {
+	unsigned int RefCount; /**< the number of references */
+	size_t Length; /**< the length of the data */
+} shared_line_t;
+
+/**
+ * fifo_block_t
+ *
+ * A block of data in a fifo buffer.
+ */
+typedef struct fifo_block_s {
+	struct fifo_block_s *Next; /**< the next block */
+	shared_line_t *Shared; /**< the shared line this block refers to, or NULL
+							    if the data follows the block */
+	size_t Offset; /**< the number of bytes which have already been read */
+	size_t Length; /**< the number of bytes which have been written */
+	size_t Capacity; /**< the size of the block's data */
+} fifo_block_t;
 
 /**
  * CFIFOBuffer
  *
- * A fifo buffer.
+ * A fifo buffer. Data is stored in a chain of fixed-size blocks so that
+ * neither writing nor reading data has to move the data which is already
+ * in the buffer. Blocks can also refer to shared lines.
  */
 class SBNCAPI CFIFOBuffer {
-	char *m_Buffer; /**< the fifo buffer's data */
-	size_t m_BufferSize; /**< the size of the buffer */
-	size_t m_Offset; /**< the number of unused bytes at the
-								beginning of the buffer */
+	fifo_block_t *m_Head; /**< the first block, data is read from this block */
+	fifo_block_t *m_Tail; /**< the last block, data is appended to this block */
+	fifo_block_t *m_Retired; /**< the most recently consumed block */
+	size_t m_Size; /**< the number of bytes in the buffer */
 
-	void *ResizeBuffer(void *Buffer, size_t OldSize, size_t NewSize);
-	inline void Optimize(void);
+	static fifo_block_t *AllocateBlock(size_t Capacity);
+	static fifo_block_t *AllocateSharedBlock(shared_line_t *Line);
+	static void ReleaseBlock(fifo_block_t *Block);
+
+	fifo_block_t *Grow(size_t Size);
+	static fifo_block_t *Append(fifo_block_t *Block, const char *Data, size_t Size);
+	char *Linearize(size_t Size);
 public:
 #ifndef SWIG
 	CFIFOBuffer();
@@ -42,13 +76,20 @@ public:
 #endif /* SWIG */
 
 	size_t GetSize(void) const;
+	int GetSegments(const char **Data, size_t *Sizes, int Count) const;
 
-	char *Peek(void) const;
+	char *Peek(void);
+	char *PeekLine(size_t *Length);
 	char *Read(size_t Bytes);
+	void Consume(size_t Bytes);
 	void Flush(void);
 
 	RESULT<bool> Write(const char *Data, size_t Size);
 	RESULT<bool> WriteUnformattedLine(const char *Line);
+	RESULT<bool> WriteSharedLine(shared_line_t *Line);
+
+	static shared_line_t *CreateSharedLine(const char *Line);
+	static void ReleaseSharedLine(shared_line_t *Line);
 };
 
 #endif /* FIFOBUFFER_H */
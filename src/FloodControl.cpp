@@ -19,32 +19,224 @@
 
 #include "StdAfx.h"
 
+/**
+ * flood_penalty_t
+ *
+ * The additional cost (in bytes) of a command when the token bucket is used.
+ */
+typedef struct flood_penalty_s {
+	const char *Command; /**< the command */
+	size_t Penalty; /**< the penalty */
+} flood_penalty_t;
+
+/**
+ * Commands which cause more work for the IRC server than their size
+ * suggests. Most ircds use similar penalties. These can be replaced
+ * using system.floodpenalties.
+ */
+static const flood_penalty_t g_FloodPenalties[] = {
+	{ "JOIN", 64 },
+	{ "PART", 64 },
+	{ "MODE", 64 },
+	{ "KICK", 64 },
+	{ "TOPIC", 64 },
+	{ "INVITE", 64 },
+	{ "WHOIS", 64 },
+	{ "WHO", 128 },
+	{ "NAMES", 128 },
+	{ "LIST", 256 },
+	{ NULL, 0 }
+};
+
+static flood_penalty_t *g_ConfiguredPenalties = NULL; /**< penalties from system.floodpenalties */
+
+/**
+ * ParseFloodPenalties
+ *
+ * Parses a list of penalties in the form "COMMAND:penalty,...". Invalid
+ * entries are logged and ignored. The result is allocated as a single
+ * block.
+ *
+ * @param Setting the list of penalties
+ */
+static flood_penalty_t *ParseFloodPenalties(const char *Setting) {
+	flood_penalty_t *Penalties;
+	size_t Count = 2, Length = strlen(Setting);
+	char *Copy, *Entry, *Next, *Colon, *End;
+	int i = 0;
+
+	for (const char *p = Setting; *p != '\0'; p++) {
+		if (*p == ',') {
+			Count++;
+		}
+	}
+
+	// the command names are stored behind the array
+	Penalties = (flood_penalty_t *)malloc(Count * sizeof(flood_penalty_t) + Length + 1);
+
+	if (AllocFailed(Penalties)) {
+		return NULL;
+	}
+
+	Copy = (char *)(Penalties + Count);
+	memcpy(Copy, Setting, Length + 1);
+
+	for (Entry = Copy; Entry != NULL; Entry = Next) {
+		Next = strchr(Entry, ',');
+
+		if (Next != NULL) {
+			*Next++ = '\0';
+		}
+
+		Colon = strchr(Entry, ':');
+
+		if (Colon == NULL || Colon == Entry) {
+			g_Bouncer->Log("Ignoring invalid entry \"%s\" in system.floodpenalties.", Entry);
+
+			continue;
+		}
+
+		*Colon = '\0';
+
+		Penalties[i].Command = Entry;
+		Penalties[i].Penalty = strtoul(Colon + 1, &End, 10);
+
+		if (*End != '\0' || End == Colon + 1) {
+			g_Bouncer->Log("Ignoring invalid penalty for %s in system.floodpenalties.", Entry);
+
+			continue;
+		}
+
+		i++;
+	}
+
+	Penalties[i].Command = NULL;
+	Penalties[i].Penalty = 0;
+
+	return Penalties;
+}
+
+/**
+ * GetFloodPenalties
+ *
+ * Returns the command penalties. system.floodpenalties is only parsed
+ * the first time this function is called.
+ */
+static const flood_penalty_t *GetFloodPenalties(void) {
+	static bool Parsed = false;
+	const char *Setting;
+
+	if (!Parsed) {
+		Parsed = true;
+
+		Setting = CacheGetString(*g_Bouncer->GetConfigCache(), floodpenalties);
+
+		if (Setting != NULL && Setting[0] != '\0') {
+			g_ConfiguredPenalties = ParseFloodPenalties(Setting);
+		}
+	}
+
+	return (g_ConfiguredPenalties != NULL) ? g_ConfiguredPenalties : g_FloodPenalties;
+}
+
+/**
+ * GetFloodCost
+ *
+ * Returns the cost (in bytes) of sending a line to the IRC server.
+ *
+ * @param Line the line
+ * @param Length the length of the line
+ */
+static size_t GetFloodCost(const char *Line, size_t Length) {
+	size_t Cost = Length + 2;
+	const char *Space = strchr(Line, ' ');
+	size_t CommandLength = (Space != NULL) ? (size_t)(Space - Line) : Length;
+
+	for (const flood_penalty_t *Penalty = GetFloodPenalties(); Penalty->Command != NULL; Penalty++) {
+		if (strlen(Penalty->Command) == CommandLength && strncasecmp(Penalty->Command, Line, CommandLength) == 0) {
+			return Cost + Penalty->Penalty;
+		}
+	}
+
+	return Cost;
+}
+
+/**
+ * FloodWakeupTimer
+ *
+ * Wakes up the main loop when the token bucket has enough tokens
+ * for the next item.
+ *
+ * @param Now the current time
+ * @param Cookie the flood control object
+ */
+bool FloodWakeupTimer(time_t Now, void *Cookie) {
+	CFloodControl *FloodControl = (CFloodControl *)Cookie;
+
+	FloodControl->m_WakeupTimer = NULL;
+	FloodControl->Wakeup();
+
+	return false;
+}
+
 /**
  * CFloodControl
  *
  * Constructs a new flood control object.
+ *
+ * @param Owner the connection which sends the items
  */
-CFloodControl::CFloodControl(void) {
+CFloodControl::CFloodControl(CConnection *Owner) {
+	m_Owner = Owner;
 	m_BytesSent = 0;
 	m_Enabled = true;
 	m_Plugged = false;
+
+	m_Rate = 0;
+	m_Burst = FLOODBYTES;
+	m_Tokens = 0;
+	m_LastRefill = 0;
+	m_WakeupTimer = NULL;
+}
+
+/**
+ * ~CFloodControl
+ *
+ * Destructs a flood control object.
+ */
+CFloodControl::~CFloodControl(void) {
+	if (m_WakeupTimer != NULL) {
+		m_WakeupTimer->Destroy();
+	}
 }
 
 /**
  * AttachInputQueue
  *
- * Attaches a queue to this flood control object.
+ * Attaches a queue to this flood control object. The queues are kept
+ * sorted by their priority.
  *
  * @param Queue the new queue
  * @param Priority the priority of the queue (the highest priority is 0)
  */
 void CFloodControl::AttachInputQueue(CQueue *Queue, int Priority) {
 	irc_queue_t IrcQueue;
+	int i;
 
 	IrcQueue.Queue = Queue;
 	IrcQueue.Priority = Priority;
 
-	m_Queues.Insert(IrcQueue);
+	if (IsError(m_Queues.Insert(IrcQueue))) {
+		return;
+	}
+
+	Queue->m_FloodControl = this;
+
+	for (i = m_Queues.GetLength() - 1; i > 0 && m_Queues[i - 1].Priority > Priority; i--) {
+		m_Queues[i] = m_Queues[i - 1];
+	}
+
+	m_Queues[i] = IrcQueue;
 }
 
 /**
@@ -55,25 +247,20 @@ void CFloodControl::AttachInputQueue(CQueue *Queue, int Priority) {
  * @param Peek determines whether to actually remove the item
  */
 RESULT<char *> CFloodControl::DequeueItem(bool Peek) {
-	int LowestPriority = 100;
-	irc_queue_t *ThatQueue = NULL;
+	irc_queue_t *ThatQueue;
+	size_t Length;
 
 	if (m_Enabled && m_Plugged) {
 		RETURN(char *, NULL);
 	}
 
-	for (int i = 0; i < m_Queues.GetLength(); i++) {
-		if (m_Queues[i].Priority < LowestPriority && m_Queues[i].Queue->GetLength() > 0) {
-			LowestPriority = m_Queues[i].Priority;
-			ThatQueue = &m_Queues[i];
-		}
-	}
+	ThatQueue = GetNextQueue();
 
 	if (ThatQueue == NULL) {
 		RETURN(char *, NULL);
 	}
 
-	RESULT<const char *> PeekItem = ThatQueue->Queue->PeekItem();
+	RESULT<const char *> PeekItem = ThatQueue->Queue->PeekItem(&Length);
 
 	if (IsError(PeekItem)) {
 		g_Bouncer->Log("PeekItem() failed.");
@@ -85,7 +272,15 @@ RESULT<char *> CFloodControl::DequeueItem(bool Peek) {
 		RETURN(char *, const_cast<char *>((const char *)PeekItem));
 	}
 
-	if (m_Enabled && m_BytesSent + strlen(PeekItem) + 2 + strlen(FLOODMSG) + 2 > FLOODBYTES) {
+	if (m_Enabled && m_Rate != 0) {
+		size_t Cost = GetFloodCost(PeekItem, Length);
+
+		if (!HasTokens(Cost)) {
+			RETURN(char *, NULL);
+		}
+
+		m_Tokens -= (int64_t)Cost * 1000;
+	} else if (m_Enabled && m_BytesSent + Length + 2 + strlen(FLOODMSG) + 2 > FLOODBYTES) {
 		Plug();
 
 		RETURN(char *, strdup(FLOODMSG));
@@ -95,11 +290,74 @@ RESULT<char *> CFloodControl::DequeueItem(bool Peek) {
 
 	THROWIFERROR(char *, Item);
 
-	m_BytesSent += strlen(Item) + 2;
+	m_BytesSent += Length + 2;
 
 	RETURN(char *, Item);
 }
 
+/**
+ * GetNextQueue
+ *
+ * Returns the queue which contains the next item or NULL if all
+ * queues are empty.
+ */
+irc_queue_t *CFloodControl::GetNextQueue(void) {
+	// the queues are sorted by their priority
+	for (int i = 0; i < m_Queues.GetLength(); i++) {
+		if (m_Queues[i].Queue->GetLength() > 0) {
+			return &m_Queues[i];
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * HasTokens
+ *
+ * Refills the token bucket and checks whether there are enough tokens for
+ * an item. If there aren't the main loop is woken up once there are.
+ *
+ * @param Cost the item's cost (in bytes)
+ */
+bool CFloodControl::HasTokens(size_t Cost) {
+	int64_t Now = GetCurrentTimeMs();
+	int64_t Capacity = (int64_t)m_Burst * 1000;
+	int64_t Required;
+
+	if (Now > m_LastRefill) {
+		m_Tokens += (Now - m_LastRefill) * m_Rate;
+		m_LastRefill = Now;
+	}
+
+	if (m_Tokens > Capacity) {
+		m_Tokens = Capacity;
+	}
+
+	// items which are larger than the bucket can be sent when it is full
+	Required = (int64_t)Cost * 1000;
+
+	if (Required > Capacity) {
+		Required = Capacity;
+	}
+
+	if (m_Tokens >= Required) {
+		return true;
+	}
+
+	if (m_WakeupTimer == NULL) {
+		m_WakeupTimer = new CTimer(0, false, FloodWakeupTimer, this);
+
+		if (AllocFailed(m_WakeupTimer)) {
+			return false;
+		}
+	}
+
+	m_WakeupTimer->RescheduleMs(Now + (Required - m_Tokens + m_Rate - 1) / m_Rate);
+
+	return false;
+}
+
 /**
  * GetQueueSize
  *
@@ -107,10 +365,28 @@ RESULT<char *> CFloodControl::DequeueItem(bool Peek) {
  * could be immediately retrieved using DequeueItem().
  */
 int CFloodControl::GetQueueSize(void) {
-	if (m_Plugged)
+	if (m_Plugged) {
 		return 0;
-	else
-		return (GetRealLength() > 0);
+	}
+
+	if (m_Enabled && m_Rate != 0) {
+		irc_queue_t *Queue = GetNextQueue();
+		size_t Length;
+
+		if (Queue == NULL) {
+			return 0;
+		}
+
+		RESULT<const char *> PeekItem = Queue->Queue->PeekItem(&Length);
+
+		if (IsError(PeekItem)) {
+			return 0;
+		}
+
+		return HasTokens(GetFloodCost(PeekItem, Length)) ? 1 : 0;
+	}
+
+	return (GetRealLength() > 0);
 }
 
 /**
@@ -156,6 +432,8 @@ void CFloodControl::Plug(void) {
 void CFloodControl::Unplug(void) {
 	m_BytesSent = 0;
 	m_Plugged = false;
+
+	Wakeup();
 }
 
 /**
@@ -174,4 +452,70 @@ void CFloodControl::Enable(void) {
  */
 void CFloodControl::Disable(void) {
 	m_Enabled = false;
+
+	Wakeup();
+}
+
+/**
+ * SetTokenBucket
+ *
+ * Configures the token bucket. A rate of 0 restores the default
+ * (FLOODMSG-based) flood control.
+ *
+ * @param Rate the refill rate (in bytes per second)
+ * @param Burst the number of bytes which can be sent at once
+ */
+void CFloodControl::SetTokenBucket(unsigned int Rate, unsigned int Burst) {
+	if (Burst == 0) {
+		Burst = FLOODBYTES;
+	}
+
+	if (Rate != 0 && m_Rate == 0) {
+		// start with a full bucket
+		m_Tokens = (int64_t)Burst * 1000;
+		m_LastRefill = GetCurrentTimeMs();
+	}
+
+	m_Rate = Rate;
+	m_Burst = Burst;
+	m_Plugged = false;
+	m_BytesSent = 0;
+
+	if (m_Rate == 0 && m_WakeupTimer != NULL) {
+		m_WakeupTimer->Destroy();
+		m_WakeupTimer = NULL;
+	}
+
+	Wakeup();
+}
+
+/**
+ * GetRate
+ *
+ * Returns the token bucket's refill rate (or 0 if the token bucket
+ * is not used).
+ */
+unsigned int CFloodControl::GetRate(void) const {
+	return m_Rate;
+}
+
+/**
+ * GetBurst
+ *
+ * Returns the token bucket's size.
+ */
+unsigned int CFloodControl::GetBurst(void) const {
+	return m_Burst;
+}
+
+/**
+ * Wakeup
+ *
+ * Tells the main loop that the owner's socket might have become writable
+ * because items were queued or the flood limits have changed.
+ */
+void CFloodControl::Wakeup(void) {
+	if (m_Owner != NULL) {
+		g_Bouncer->UpdateSocketEvents(m_Owner->GetSocket());
+	}
 }
@@ -36,19 +36,41 @@ typedef struct queue_s {
 /**
  * CFloodControl
  *
- * A queue which tries to avoid "Excess Flood" errors.
+ * A queue which tries to avoid "Excess Flood" errors. By default the queue
+ * is plugged after FLOODBYTES bytes and unplugged when the server replies to
+ * FLOODMSG. Alternatively a token bucket can be used which allows up to
+ * "burst" bytes to be sent at once and is refilled at "rate" bytes per
+ * second.
  */
 class SBNCAPI CFloodControl {
+#ifndef SWIG
+	friend bool FloodWakeupTimer(time_t Now, void *Cookie);
+#endif /* SWIG */
+
 	CVector<irc_queue_t> m_Queues; /**< a list of queues which have been
 								attached to this object */
 	size_t m_BytesSent; /**< the number of bytes which have recently been sent */
 	bool m_Enabled; /**< determines whether this object is delaying the output */
 	bool m_Plugged; /**< determines whether the queue is plugged */
 
+	unsigned int m_Rate; /**< the token bucket's refill rate (bytes per second),
+						  0 if the token bucket is not used */
+	unsigned int m_Burst; /**< the token bucket's size (in bytes) */
+	int64_t m_Tokens; /**< the number of tokens in the bucket (in 1/1000 bytes) */
+	int64_t m_LastRefill; /**< the time when the bucket was last refilled (in ms) */
+	CTimer *m_WakeupTimer; /**< used for waking up the main loop when
+							enough tokens are available */
+	CConnection *m_Owner; /**< the connection which sends the items */
+
 	void ScheduleItem(void);
+	irc_queue_t *GetNextQueue(void);
+	bool HasTokens(size_t Cost);
 public:
 #ifndef SWIG
-	CFloodControl(void);
+	CFloodControl(CConnection *Owner);
+	~CFloodControl(void);
+
+	void Wakeup(void);
 #endif /* SWIG */
 
 	RESULT<char *> DequeueItem(bool Peek = false);
@@ -64,6 +86,10 @@ public:
 
 	void Enable(void);
 	void Disable(void);
+
+	void SetTokenBucket(unsigned int Rate, unsigned int Burst);
+	unsigned int GetRate(void) const;
+	unsigned int GetBurst(void) const;
 };
 
 #endif /* FLOODCONTROL_H */
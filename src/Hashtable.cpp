@@ -0,0 +1,190 @@
+/*******************************************************************************
+ * shroudBNC - an object-oriented framework for IRC                            *
+ * Copyright (C) 2005-2007,2010 Gunnar Beutner                                 *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or               *
+ * modify it under the terms of the GNU General Public License                 *
+ * as published by the Free Software Foundation; either version 2              *
+ * of the License, or (at your option) any later version.                      *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU General Public License for more details.                                *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License           *
+ * along with this program; if not, write to the Free Software                 *
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA. *
+ *******************************************************************************/
+
+#include "StdAfx.h"
+
+/**
+ * internedstring_t
+ *
+ * A reference-counted string which is shared by all hashtables.
+ */
+typedef struct internedstring_s {
+	unsigned int RefCount; /**< the number of references to the string */
+	hashvalue_t HashValue; /**< the string's (case-sensitive) hash value */
+	char String[1]; /**< the string */
+} internedstring_t;
+
+#define INTERNED_DELETED ((internedstring_t *)1)
+
+static internedstring_t **g_InternedStrings = NULL; /**< the interned strings */
+static unsigned int g_InternedSize = 0; /**< the number of slots in g_InternedStrings */
+static unsigned int g_InternedUsed = 0; /**< the number of used slots */
+static unsigned int g_InternedDeleted = 0; /**< the number of deleted slots */
+
+/**
+ * InternedSlot
+ *
+ * Returns the first slot of the probe sequence for a hash value.
+ *
+ * @param HashValue the hash value
+ */
+static inline unsigned int InternedSlot(hashvalue_t HashValue) {
+	return (unsigned int)(HashValue ^ (HashValue >> 16)) & (g_InternedSize - 1);
+}
+
+/**
+ * ResizeInternedStrings
+ *
+ * Resizes the interned string table and removes deleted slots.
+ */
+static bool ResizeInternedStrings(void) {
+	internedstring_t **OldStrings = g_InternedStrings;
+	unsigned int OldSize = g_InternedSize;
+	unsigned int Size = (OldSize == 0) ? 256 : OldSize;
+
+	while ((g_InternedUsed + 1) * 2 > Size) {
+		Size *= 2;
+	}
+
+	g_InternedStrings = (internedstring_t **)calloc(Size, sizeof(internedstring_t *));
+
+	if (AllocFailed(g_InternedStrings)) {
+		g_InternedStrings = OldStrings;
+
+		return false;
+	}
+
+	g_InternedSize = Size;
+	g_InternedDeleted = 0;
+
+	for (unsigned int i = 0; i < OldSize; i++) {
+		internedstring_t *Entry = OldStrings[i];
+		unsigned int Index;
+
+		if (Entry == NULL || Entry == INTERNED_DELETED) {
+			continue;
+		}
+
+		Index = InternedSlot(Entry->HashValue);
+
+		while (g_InternedStrings[Index] != NULL) {
+			Index = (Index + 1) & (g_InternedSize - 1);
+		}
+
+		g_InternedStrings[Index] = Entry;
+	}
+
+	free(OldStrings);
+
+	return true;
+}
+
+/**
+ * InternString
+ *
+ * Returns a shared copy of a string. The string has to be released
+ * using ReleaseInternedString(). NULL is returned if the string could
+ * not be allocated.
+ *
+ * @param String the string
+ */
+const char *InternString(const char *String) {
+	hashvalue_t HashValue = Hash(String, true);
+	internedstring_t *Entry;
+	unsigned int Index, Free = (unsigned int)-1;
+	size_t Length;
+
+	if ((g_InternedUsed + g_InternedDeleted + 1) * 4 > g_InternedSize * 3) {
+		if (!ResizeInternedStrings()) {
+			return NULL;
+		}
+	}
+
+	Index = InternedSlot(HashValue);
+
+	while ((Entry = g_InternedStrings[Index]) != NULL) {
+		if (Entry == INTERNED_DELETED) {
+			if (Free == (unsigned int)-1) {
+				Free = Index;
+			}
+		} else if (Entry->HashValue == HashValue && strcmp(Entry->String, String) == 0) {
+			Entry->RefCount++;
+
+			return Entry->String;
+		}
+
+		Index = (Index + 1) & (g_InternedSize - 1);
+	}
+
+	Length = strlen(String);
+
+	Entry = (internedstring_t *)malloc(sizeof(internedstring_t) + Length);
+
+	if (AllocFailed(Entry)) {
+		return NULL;
+	}
+
+	Entry->RefCount = 1;
+	Entry->HashValue = HashValue;
+	memcpy(Entry->String, String, Length + 1);
+
+	if (Free != (unsigned int)-1) {
+		Index = Free;
+		g_InternedDeleted--;
+	}
+
+	g_InternedStrings[Index] = Entry;
+	g_InternedUsed++;
+
+	return Entry->String;
+}
+
+/**
+ * ReleaseInternedString
+ *
+ * Releases a string which was returned by InternString().
+ *
+ * @param String the string
+ */
+void ReleaseInternedString(const char *String) {
+	internedstring_t *Entry;
+	unsigned int Index;
+
+	if (String == NULL) {
+		return;
+	}
+
+	Entry = (internedstring_t *)(String - offsetof(internedstring_t, String));
+
+	if (--Entry->RefCount > 0) {
+		return;
+	}
+
+	Index = InternedSlot(Entry->HashValue);
+
+	while (g_InternedStrings[Index] != Entry) {
+		Index = (Index + 1) & (g_InternedSize - 1);
+	}
+
+	g_InternedStrings[Index] = INTERNED_DELETED;
+	g_InternedUsed--;
+	g_InternedDeleted++;
+
+	free(Entry);
+}
@@ -31,19 +31,49 @@ struct hash_t {
 	Type Value; /**< the item in the hashtable */
 };
 
+typedef unsigned long hashvalue_t;
+
 /**
- * hashlist_t
+ * hashslot_state_e
  *
- * A bucket in a hashtable.
+ * The state of a slot in a hashtable.
  */
-template <typename HashListType>
-struct SBNCAPI hashlist_t {
-	int Count;
-	char **Keys;
-	HashListType *Values;
+enum hashslot_state_e {
+	HashSlot_Empty = 0,
+	HashSlot_Used,
+	HashSlot_Deleted
 };
 
-typedef unsigned long hashvalue_t;
+/**
+ * hashslot_t<Type>
+ *
+ * A slot in a hashtable.
+ */
+template <typename Type>
+struct hashslot_t {
+	hash_t<Type> Item; /**< the item */
+	hashvalue_t HashValue; /**< the hash value of the item's name */
+	int State; /**< the slot's state */
+};
+
+/**
+ * hashslots_t<Type>
+ *
+ * An array of hashtable slots.
+ */
+template <typename Type>
+struct hashslots_t {
+	hashslot_t<Type> *Slots; /**< the slots */
+	unsigned int Size; /**< the number of slots, always a power of two */
+	unsigned int Used; /**< the number of used slots */
+	unsigned int Deleted; /**< the number of deleted slots */
+};
+
+#define HASHTABLE_MINSIZE 8
+#define HASHTABLE_MIGRATESTEP 8
+
+SBNCAPI const char *InternString(const char *String);
+SBNCAPI void ReleaseInternedString(const char *String);
 
 /**
  * DestroyObject<Type>
@@ -89,59 +119,246 @@ inline unsigned long Hash(const char *String, bool CaseSensitive) {
 	return HashValue;
 }
 
+template<typename Type, bool CaseSensitive>
+class CHashtableCursor;
+
+/**
+ * CHashtable
+ *
+ * A hashtable which uses open addressing (with linear probing). When the
+ * table has to be grown the items are moved to the new slot array a few at
+ * a time rather than all at once. Keys are interned, i.e. tables which
+ * contain the same keys share the key strings.
+ */
 template<typename Type, bool CaseSensitive>
 class CHashtable {
 private:
-	hashlist_t<Type> *m_Buckets; /**< used for storing the items of the hashtable */
-	int m_BucketCount; /** bucket count */
+	hashslots_t<Type> m_Table; /**< the current slots */
+	hashslots_t<Type> m_Old; /**< the slots which are being migrated to m_Table */
+	unsigned int m_Migrated; /**< the number of migrated slots in m_Old */
 	void (*m_DestructorFunc)(Type Object); /**< the function which should be used for destroying items */
 	int m_LengthCache; /**< (cached) number of items in the hashtable */
+	unsigned int m_Generation; /**< incremented whenever the slots are modified */
+	mutable unsigned int m_Locks; /**< number of cursors which are using the table */
+
+	mutable int m_IterateIndex; /**< the index which was last returned by Iterate() */
+	mutable unsigned int m_IteratePosition; /**< the slot position for m_IterateIndex */
+	mutable unsigned int m_IterateGeneration; /**< m_Generation at the time of the last Iterate() call */
+
+	/**
+	 * KeyEquals
+	 *
+	 * Compares two keys.
+	 *
+	 * @param KeyA the first key
+	 * @param KeyB the second key
+	 */
+	static bool KeyEquals(const char *KeyA, const char *KeyB) {
+		if (KeyA == KeyB) {
+			return true;
+		}
+
+		return (CaseSensitive ? strcmp(KeyA, KeyB) : strcasecmp(KeyA, KeyB)) == 0;
+	}
 
 	/**
-	 * Rehash
+	 * FindSlot
 	 *
-	 * Increases the bucket count and rehashes the hashtable.
+	 * Returns the slot for a key or NULL if there is no such slot.
+	 *
+	 * @param Table the slot array
+	 * @param Key the key
+	 * @param HashValue the key's hash value
+	 */
+	static hashslot_t<Type> *FindSlot(const hashslots_t<Type> *Table, const char *Key, hashvalue_t HashValue) {
+		unsigned int Mask, Index;
+
+		if (Table->Size == 0) {
+			return NULL;
+		}
+
+		Mask = Table->Size - 1;
+		Index = (unsigned int)(HashValue ^ (HashValue >> 16)) & Mask;
+
+		for (unsigned int i = 0; i < Table->Size; i++) {
+			hashslot_t<Type> *Slot = &Table->Slots[Index];
+
+			if (Slot->State == HashSlot_Empty) {
+				return NULL;
+			}
+
+			if (Slot->State == HashSlot_Used && Slot->HashValue == HashValue && KeyEquals(Slot->Item.Name, Key)) {
+				return Slot;
+			}
+
+			Index = (Index + 1) & Mask;
+		}
+
+		return NULL;
+	}
+
+	/**
+	 * InsertSlot
+	 *
+	 * Stores an item in a slot array. The array must have at least
+	 * one free slot and must not already contain the key.
+	 *
+	 * @param Table the slot array
+	 * @param Key the (interned) key
+	 * @param HashValue the key's hash value
+	 * @param Value the item
 	 */
-	void Rehash(void) {
-		hashlist_t<Type> *OldBuckets;
-		int OldBucketCount;
+	static void InsertSlot(hashslots_t<Type> *Table, char *Key, hashvalue_t HashValue, Type Value) {
+		unsigned int Mask, Index;
+		hashslot_t<Type> *Slot;
 
-		OldBuckets = m_Buckets;
-		OldBucketCount = m_BucketCount;
+		Mask = Table->Size - 1;
+		Index = (unsigned int)(HashValue ^ (HashValue >> 16)) & Mask;
 
-		m_BucketCount *= 2;
-		m_Buckets = (hashlist_t<Type> *)malloc(sizeof(hashlist_t<Type>) * m_BucketCount);
+		while (Table->Slots[Index].State == HashSlot_Used) {
+			Index = (Index + 1) & Mask;
+		}
+
+		Slot = &Table->Slots[Index];
+
+		if (Slot->State == HashSlot_Deleted) {
+			Table->Deleted--;
+		}
 
-		if (m_Buckets == NULL) {
-			m_Buckets = OldBuckets;
-			m_BucketCount /= 2;
+		Slot->Item.Name = Key;
+		Slot->Item.Value = Value;
+		Slot->HashValue = HashValue;
+		Slot->State = HashSlot_Used;
 
+		Table->Used++;
+	}
+
+	/**
+	 * Migrate
+	 *
+	 * Moves items from the old slot array to the current one. Migration
+	 * is postponed while the table is locked.
+	 *
+	 * @param Count the number of slots which should be migrated
+	 */
+	void Migrate(unsigned int Count) {
+		if (m_Old.Slots == NULL || m_Locks > 0) {
 			return;
 		}
 
-		m_LengthCache = 0;
+		while (Count > 0 && m_Migrated < m_Old.Size && m_Old.Used > 0) {
+			hashslot_t<Type> *Slot = &m_Old.Slots[m_Migrated++];
 
-		memset(m_Buckets, 0, sizeof(hashlist_t<Type>) * m_BucketCount);
+			if (Slot->State == HashSlot_Used) {
+				InsertSlot(&m_Table, Slot->Item.Name, Slot->HashValue, Slot->Item.Value);
 
-		for (int i = 0; i < OldBucketCount; i++) {
-			hashlist_t<Type> *List = &OldBuckets[i];
+				// keep the probe sequences intact for the remaining items
+				Slot->State = HashSlot_Deleted;
+				m_Old.Used--;
+				m_Old.Deleted++;
+			}
 
-			for (int a = 0; a < List->Count; a++) {
-				if (!Add(List->Keys[a], List->Values[a])) {
-					abort();
-				}
+			Count--;
+		}
+
+		if (m_Migrated >= m_Old.Size || m_Old.Used == 0) {
+			free(m_Old.Slots);
+
+			memset(&m_Old, 0, sizeof(m_Old));
+			m_Migrated = 0;
+		}
+
+		m_Generation++;
+	}
+
+	/**
+	 * Reserve
+	 *
+	 * Makes sure that there is room for at least one more item in
+	 * the current slot array. Returns false if the slot array could
+	 * not be resized.
+	 *
+	 * While the table is locked slots must not move, so an unfinished
+	 * migration cannot be completed. The current slot array is then
+	 * filled up instead of being replaced.
+	 */
+	bool Reserve(void) {
+		hashslots_t<Type> Table;
+		unsigned int Total;
+
+		if ((m_Table.Used + m_Table.Deleted + 1) * 4 <= m_Table.Size * 3) {
+			return true;
+		}
+
+		if (m_Locks > 0 && m_Old.Slots != NULL) {
+			return (m_Table.Used + 1 < m_Table.Size);
+		}
+
+		Total = m_Table.Used + m_Old.Used + 1;
+
+		Table.Size = (m_Table.Size < HASHTABLE_MINSIZE) ? HASHTABLE_MINSIZE : m_Table.Size;
 
-				free(List->Keys[a]);
+		while (Total * 2 > Table.Size) {
+			Table.Size *= 2;
+		}
+
+		Table.Slots = (hashslot_t<Type> *)calloc(Table.Size, sizeof(hashslot_t<Type>));
+		Table.Used = 0;
+		Table.Deleted = 0;
+
+		if (Table.Slots == NULL) {
+			return (m_Table.Used + m_Table.Deleted + 1 < m_Table.Size);
+		}
+
+		if (m_Old.Slots != NULL) {
+			// the previous migration has not finished yet, move the
+			// remaining items right away
+			for (unsigned int i = m_Migrated; i < m_Old.Size; i++) {
+				hashslot_t<Type> *Slot = &m_Old.Slots[i];
+
+				if (Slot->State == HashSlot_Used) {
+					InsertSlot(&Table, Slot->Item.Name, Slot->HashValue, Slot->Item.Value);
+				}
 			}
 
-			free(List->Keys);
-			free(List->Values);
+			free(m_Old.Slots);
+			memset(&m_Old, 0, sizeof(m_Old));
 		}
 
-		free(OldBuckets);
+		// cursors may still refer to the slots of an empty array
+		if (m_Table.Used == 0 && m_Locks == 0) {
+			free(m_Table.Slots);
+		} else {
+			m_Old = m_Table;
+		}
+
+		m_Table = Table;
+		m_Migrated = 0;
+
+		m_Generation++;
+
+		return true;
+	}
+
+	/**
+	 * GetSlot
+	 *
+	 * Returns the slot at the specified position. Positions
+	 * of the old slot array come before the current ones.
+	 *
+	 * @param Position the position
+	 */
+	hashslot_t<Type> *GetSlot(unsigned int Position) const {
+		if (Position < m_Old.Size) {
+			return &m_Old.Slots[Position];
+		} else {
+			return &m_Table.Slots[Position - m_Old.Size];
+		}
 	}
 
 public:
+	typedef class CHashtableCursor<Type, CaseSensitive> Cursor;
+
 #ifndef SWIG
 	/**
 	 * CHashtable
@@ -149,18 +366,19 @@ public:
 	 * Constructs an empty hashtable.
 	 */
 	CHashtable(void) {
-		m_BucketCount = 32;
-		m_Buckets = (hashlist_t<Type> *)malloc(sizeof(hashlist_t<Type>) * m_BucketCount);
-
-		if (m_Buckets == NULL) {
-			abort();
-		}
-
-		memset(m_Buckets, 0, sizeof(hashlist_t<Type>) * m_BucketCount);
+		memset(&m_Table, 0, sizeof(m_Table));
+		memset(&m_Old, 0, sizeof(m_Old));
+		m_Migrated = 0;
 
 		m_DestructorFunc = NULL;
 
 		m_LengthCache = 0;
+		m_Generation = 0;
+		m_Locks = 0;
+
+		m_IterateIndex = -1;
+		m_IteratePosition = 0;
+		m_IterateGeneration = 0;
 	}
 
 	/**
@@ -171,34 +389,67 @@ public:
 	~CHashtable(void) {
 		Clear();
 
-
-		free(m_Buckets);
+		free(m_Table.Slots);
 	}
 #endif /*SWIG */
 	/**
 	 * Clear
 	 *
-	 * Removes all items from the hashtable.
+	 * Removes all items from the hashtable. The slot arrays are only
+	 * reset if the table is not locked.
 	 */
 	void Clear(void) {
-		for (int i = 0; i < m_BucketCount; i++) {
-			hashlist_t<Type> *List = &m_Buckets[i];
+		hashslots_t<Type> *Table;
+		char *Name;
+		Type Value;
 
-			for (int a = 0; a < List->Count; a++) {
-				free(List->Keys[a]);
+		// value destructors may modify the table, so the slots must not move
+		Lock();
 
-				if (m_DestructorFunc != NULL) {
-					m_DestructorFunc(List->Values[a]);
-				}
+		for (unsigned int i = 0; i < m_Old.Size + m_Table.Size; i++) {
+			hashslot_t<Type> *Slot = GetSlot(i);
+
+			if (Slot->State != HashSlot_Used) {
+				continue;
 			}
 
-			free(List->Keys);
-			free(List->Values);
+			Table = (i < m_Old.Size) ? &m_Old : &m_Table;
+
+			Name = Slot->Item.Name;
+			Value = Slot->Item.Value;
+
+			Slot->State = HashSlot_Deleted;
+			Table->Used--;
+			Table->Deleted++;
+
+			m_LengthCache--;
+			m_Generation++;
+
+			ReleaseInternedString(Name);
+
+			if (m_DestructorFunc != NULL) {
+				m_DestructorFunc(Value);
+			}
 		}
 
-		memset(m_Buckets, 0, sizeof(m_Buckets));
+		Unlock();
 
-		m_LengthCache = 0;
+		if (m_Locks > 0 || m_LengthCache > 0) {
+			return;
+		}
+
+		free(m_Old.Slots);
+		memset(&m_Old, 0, sizeof(m_Old));
+		m_Migrated = 0;
+
+		if (m_Table.Slots != NULL) {
+			memset(m_Table.Slots, 0, m_Table.Size * sizeof(hashslot_t<Type>));
+		}
+
+		m_Table.Used = 0;
+		m_Table.Deleted = 0;
+
+		m_Generation++;
 	}
 
 	/**
@@ -210,10 +461,7 @@ public:
 	 * @param Value the item
 	 */
 	RESULT<bool> Add(const char *Key, Type Value) {
-		char *dupKey;
-		char **newKeys;
-		Type *newValues;
-		hashlist_t<Type> *List;
+		const char *InternedKey;
 
 		if (Key == NULL) {
 			THROW(bool, Generic_InvalidArgument, "Key cannot be NULL.");
@@ -222,44 +470,22 @@ public:
 		// Remove any existing item which has the same key
 		Remove(Key);
 
-		List = &m_Buckets[Hash(Key, CaseSensitive) % m_BucketCount];
-
-		dupKey = strdup(Key);
-
-		if (dupKey == NULL) {
-			THROW(bool, Generic_OutOfMemory, "strdup() failed.");
+		if (!Reserve()) {
+			THROW(bool, Generic_OutOfMemory, "calloc() failed.");
 		}
 
-		newKeys = (char **)realloc(List->Keys, (List->Count + 1) * sizeof(char *));
+		InternedKey = InternString(Key);
 
-		if (newKeys == NULL) {
-			free(dupKey);
-
-			THROW(bool, Generic_OutOfMemory, "realloc() failed.");
+		if (InternedKey == NULL) {
+			THROW(bool, Generic_OutOfMemory, "InternString() failed.");
 		}
 
-		List->Keys = newKeys;
-
-		newValues = (Type *)realloc(List->Values, (List->Count + 1) * sizeof(Type));
-
-		if (newValues == NULL) {
-			free(dupKey);
-
-			THROW(bool, Generic_OutOfMemory, "realloc() failed.");
-		}
-
-		List->Count++;
-
-		List->Values = newValues;
-
-		List->Keys[List->Count - 1] = dupKey;
-		List->Values[List->Count -1] = Value;
+		InsertSlot(&m_Table, const_cast<char *>(InternedKey), Hash(Key, CaseSensitive), Value);
 
 		m_LengthCache++;
+		m_Generation++;
 
-		if (List->Count > 3) {
-			Rehash();
-		}
+		Migrate(HASHTABLE_MIGRATESTEP);
 
 		RETURN(bool, true);
 	}
@@ -273,24 +499,25 @@ public:
 	 * @param Key the key
 	 */
 	Type Get(const char *Key) const {
-		const hashlist_t<Type> *List;
+		const hashslot_t<Type> *Slot;
+		hashvalue_t HashValue;
 
-		if (Key == NULL) {
+		if (Key == NULL || m_LengthCache == 0) {
 			return NULL;
 		}
 
-		List = &m_Buckets[Hash(Key, CaseSensitive) % m_BucketCount];
+		HashValue = Hash(Key, CaseSensitive);
 
-		if (List->Count == 0) {
-			return NULL;
-		} else {
-			for (int i = 0; i < List->Count; i++) {
-				if (List->Keys[i] && (CaseSensitive ? strcmp(List->Keys[i], Key) : strcasecmp(List->Keys[i], Key)) == 0) {
-					return List->Values[i];
-				}
-			}
+		Slot = FindSlot(&m_Table, Key, HashValue);
 
+		if (Slot == NULL) {
+			Slot = FindSlot(&m_Old, Key, HashValue);
+		}
+
+		if (Slot == NULL) {
 			return NULL;
+		} else {
+			return Slot->Item.Value;
 		}
 	}
 
@@ -304,51 +531,52 @@ public:
 	 *					  is going to be called for the item
 	 */
 	RESULT<bool> Remove(const char *Key, bool DontDestroy = false) {
-		hashlist_t<Type> *List;
+		hashslots_t<Type> *Table = &m_Table;
+		hashslot_t<Type> *Slot;
+		hashvalue_t HashValue;
+		char *Name;
 
 		if (Key == NULL) {
 			THROW(bool, Generic_InvalidArgument, "Key cannot be NULL.");
 		}
 
-		List = &m_Buckets[Hash(Key, CaseSensitive) % m_BucketCount];
-
-		if (List->Count == 0) {
+		if (m_LengthCache == 0) {
 			RETURN(bool, true);
-		} else if (List->Count == 1 && (CaseSensitive ? strcmp(List->Keys[0], Key) : strcasecmp(List->Keys[0], Key)) == 0) {
-			if (m_DestructorFunc != NULL && DontDestroy == false) {
-				m_DestructorFunc(List->Values[0]);
-			}
+		}
 
-			free(List->Keys[0]);
+		HashValue = Hash(Key, CaseSensitive);
 
-			free(List->Keys);
-			free(List->Values);
-			List->Count = 0;
-			List->Keys = NULL;
-			List->Values = NULL;
+		Slot = FindSlot(Table, Key, HashValue);
 
-			m_LengthCache--;
-		} else {
-			for (int i = 0; i < List->Count; i++) {
-				if (List->Keys[i] && (CaseSensitive ? strcmp(List->Keys[i], Key) : strcasecmp(List->Keys[i], Key)) == 0) {
-					free(List->Keys[i]);
+		if (Slot == NULL) {
+			Table = &m_Old;
+			Slot = FindSlot(Table, Key, HashValue);
+		}
 
-					List->Keys[i] = List->Keys[List->Count - 1];
+		if (Slot == NULL) {
+			RETURN(bool, true);
+		}
 
-					if (m_DestructorFunc != NULL && DontDestroy == false) {
-						m_DestructorFunc(List->Values[i]);
-					}
+		// the slot is marked as deleted before the destructor is called
+		// in case the destructor accesses this hashtable
+		Slot->State = HashSlot_Deleted;
+		Table->Used--;
+		Table->Deleted++;
 
-					List->Values[i] = List->Values[List->Count - 1];
-					List->Count--;
+		m_LengthCache--;
+		m_Generation++;
 
-					m_LengthCache--;
+		// the destructor may add items, which can move the slots
+		Name = Slot->Item.Name;
 
-					break;
-				}
-			}
+		if (m_DestructorFunc != NULL && DontDestroy == false) {
+			m_DestructorFunc(Slot->Item.Value);
 		}
 
+		ReleaseInternedString(Name);
+
+		Migrate(HASHTABLE_MIGRATESTEP);
+
 		RETURN(bool, true);
 	}
 
@@ -375,55 +603,98 @@ public:
 	/**
 	 * Iterate
 	 *
-	 * Returns the Index-th item of the hashtable.
+	 * Returns the Index-th item of the hashtable. Sequential calls are
+	 * fast as long as the hashtable is not modified in between. Use
+	 * CHashtableCursor for nested iterations.
 	 *
 	 * @param Index the index
 	 */
 	hash_t<Type> *Iterate(int Index) const {
-		static void *thisPointer = NULL;
-		static int cache_Index = 0, cache_i = 0, cache_a = 0;
-		int Skip = 0;
-		int i, a;
-		bool first = true;
-
-		if (thisPointer == this && cache_Index == Index - 1) {
-			i = cache_i;
-			a = cache_a;
-			Skip = cache_Index;
+		unsigned int Position, Count;
+		int Current;
+
+		if (Index < 0 || Index >= m_LengthCache) {
+			return NULL;
+		}
+
+		if (m_IterateIndex != -1 && m_IterateGeneration == m_Generation && Index >= m_IterateIndex) {
+			if (Index == m_IterateIndex) {
+				return &(GetSlot(m_IteratePosition)->Item);
+			}
+
+			Current = m_IterateIndex;
+			Position = m_IteratePosition + 1;
 		} else {
-			i = 0;
-			a = 0;
+			Current = -1;
+			Position = 0;
 		}
 
-		for (; i < m_BucketCount; i++) {
-			if (!first) {
-				a = 0;
-			} else {
-				first = false;
+		Count = m_Old.Size + m_Table.Size;
+
+		for (; Position < Count; Position++) {
+			hashslot_t<Type> *Slot = GetSlot(Position);
+
+			if (Slot->State != HashSlot_Used) {
+				continue;
 			}
 
-			for (;a < m_Buckets[i].Count; a++) {
-				if (Skip == Index) {
-					static hash_t<Type> Item;
+			Current++;
 
-					Item.Name = m_Buckets[i].Keys[a];
-					Item.Value = m_Buckets[i].Values[a];
+			if (Current == Index) {
+				m_IterateIndex = Index;
+				m_IteratePosition = Position;
+				m_IterateGeneration = m_Generation;
 
-					cache_Index = Index;
-					cache_i = i;
-					cache_a = a;
-					thisPointer = (void *)this;
+				return &(Slot->Item);
+			}
+		}
 
-					return &Item;
-				}
+		return NULL;
+	}
 
-				Skip++;
+	/**
+	 * IterateFrom
+	 *
+	 * Returns the first item at or after the specified slot position
+	 * and updates the position. NULL is returned if there are no
+	 * further items.
+	 *
+	 * @param Position the slot position
+	 */
+	hash_t<Type> *IterateFrom(unsigned int *Position) const {
+		unsigned int Count = m_Old.Size + m_Table.Size;
+
+		for (; *Position < Count; (*Position)++) {
+			hashslot_t<Type> *Slot = GetSlot(*Position);
+
+			if (Slot->State == HashSlot_Used) {
+				return &(Slot->Item);
 			}
 		}
 
 		return NULL;
 	}
 
+	/**
+	 * Lock
+	 *
+	 * Locks the hashtable so that items are not moved around.
+	 */
+	void Lock(void) const {
+		m_Locks++;
+	}
+
+	/**
+	 * Unlock
+	 *
+	 * Unlocks the hashtable.
+	 */
+	void Unlock(void) const {
+		assert(m_Locks > 0);
+
+		m_Locks--;
+	}
+
 	/**
 	 * GetSortedKeys
 	 *
@@ -431,36 +702,112 @@ public:
 	 * will eventually have to be passed to free().
 	 */
 	char **GetSortedKeys(void) const {
-		char **Keys = NULL;
+		char **Keys;
 		int Count = 0;
+		unsigned int Position = 0;
+		hash_t<Type> *Item;
 
-		for (int i = 0; i < m_BucketCount; i++) {
-			Keys = (char **)realloc(Keys, (Count + m_Buckets[i].Count) * sizeof(char *));
+		Keys = (char **)malloc((m_LengthCache + 1) * sizeof(char *));
 
-			if (Count + m_Buckets[i].Count > 0 && Keys == NULL) {
-				return NULL;
-			}
-
-			for (int a = 0; a < m_Buckets[i].Count; a++) {
-				Keys[Count + a] = m_Buckets[i].Keys[a];
-			}
+		if (Keys == NULL) {
+			return NULL;
+		}
 
-			Count += m_Buckets[i].Count;
+		while ((Item = IterateFrom(&Position)) != NULL) {
+			Keys[Count++] = Item->Name;
+			Position++;
 		}
 
 		assert(Count == m_LengthCache);
 
 		qsort(Keys, Count, sizeof(Keys[0]), CmpStringCase);
 
-		Keys = (char **)realloc(Keys, ++Count * sizeof(char *));
+		Keys[Count] = NULL;
 
-		if (Keys == NULL) {
-			return NULL;
+		return Keys;
+	}
+};
+
+/**
+ * CHashtableCursor
+ *
+ * Used for iterating over CHashtable objects. Unlike Iterate() cursors
+ * can be nested and the current item may be removed from the hashtable.
+ * Items which are added while the cursor is in use may or may not be
+ * returned by the cursor.
+ */
+template<typename Type, bool CaseSensitive>
+class CHashtableCursor {
+private:
+	const CHashtable<Type, CaseSensitive> *m_Table; /**< the hashtable */
+	unsigned int m_Position; /**< the current slot position */
+	hash_t<Type> *m_Current; /**< the current item */
+
+public:
+	/**
+	 * CHashtableCursor
+	 *
+	 * Initializes a new cursor.
+	 *
+	 * @param Table the hashtable
+	 */
+	explicit CHashtableCursor(const CHashtable<Type, CaseSensitive> *Table) {
+		m_Table = Table;
+		m_Position = 0;
+
+		Table->Lock();
+
+		m_Current = Table->IterateFrom(&m_Position);
+	}
+
+	/**
+	 * ~CHashtableCursor
+	 *
+	 * Destroys a cursor.
+	 */
+	~CHashtableCursor(void) {
+		m_Table->Unlock();
+	}
+
+	/**
+	 * operator *
+	 *
+	 * Retrieves the current item.
+	 */
+	hash_t<Type>& operator *(void) {
+		return *m_Current;
+	}
+
+	/**
+	 * operator ->
+	 *
+	 * Retrieves the current item.
+	 */
+	hash_t<Type> *operator ->(void) {
+		return m_Current;
+	}
+
+	/**
+	 * Proceed
+	 *
+	 * Proceeds to the next item.
+	 */
+	void Proceed(void) {
+		if (m_Current == NULL) {
+			return;
 		}
 
-		Keys[Count - 1] = NULL;
+		m_Position++;
+		m_Current = m_Table->IterateFrom(&m_Position);
+	}
 
-		return Keys;
+	/**
+	 * IsValid
+	 *
+	 * Checks whether the end of the hashtable has been reached.
+	 */
+	bool IsValid(void) {
+		return (m_Current != NULL);
 	}
 };
 
@@ -21,6 +21,7 @@
 
 bool DelayJoinTimer(time_t Now, void *IRCConnection);
 bool IRCPingTimer(time_t Now, void *IRCConnection);
+static void DestroyNickData(nickdata_t *NickData);
 
 extern time_t g_LastReconnect;
 
@@ -56,6 +57,8 @@ CIRCConnection::CIRCConnection(const char *Host, unsigned int Port, CUser *Owner
 	m_Usermodes = NULL;
 	m_EatPong = false;
 
+	m_IdentKey = NULL;
+
 	m_QueueHigh = new CQueue();
 
 	if (AllocFailed(m_QueueHigh)) {
@@ -74,7 +77,7 @@ CIRCConnection::CIRCConnection(const char *Host, unsigned int Port, CUser *Owner
 		g_Bouncer->Fatal();
 	}
 
-	m_FloodControl = new CFloodControl();
+	m_FloodControl = new CFloodControl(this);
 
 	if (AllocFailed(m_FloodControl)) {
 		g_Bouncer->Fatal();
@@ -106,6 +109,11 @@ CIRCConnection::CIRCConnection(const char *Host, unsigned int Port, CUser *Owner
 
 	m_Channels->RegisterValueDestructor(DestroyObject<CChannel>);
 
+	m_SortedChannelsValid = false;
+	m_SortFunction = NULL;
+
+	m_Nicks.RegisterValueDestructor(DestroyNickData);
+
 	m_ISupport = new CHashtable<char *, false>();
 
 	if (AllocFailed(m_ISupport)) {
@@ -119,10 +127,17 @@ CIRCConnection::CIRCConnection(const char *Host, unsigned int Port, CUser *Owner
 	m_ISupport->Add("PREFIX", strdup("(ov)@+"));
 	m_ISupport->Add("NAMESX", strdup(""));
 
+	m_PrefixChars[0] = '\0';
+	UpdateModeTables();
+
 	m_FloodControl->AttachInputQueue(m_QueueHigh, 0);
 	m_FloodControl->AttachInputQueue(m_QueueMiddle, 1);
 	m_FloodControl->AttachInputQueue(m_QueueLow, 2);
 
+	if (Owner != NULL && Owner->GetFloodRate() != 0) {
+		m_FloodControl->SetTokenBucket(Owner->GetFloodRate(), Owner->GetFloodBurst());
+	}
+
 	m_PingTimer = g_Bouncer->CreateTimer(180, true, IRCPingTimer, this);
 	m_DelayJoinTimer = NULL;
 	m_NickCatchTimer = NULL;
@@ -134,6 +149,12 @@ CIRCConnection::CIRCConnection(const char *Host, unsigned int Port, CUser *Owner
  * Destructs a connection object.
  */
 CIRCConnection::~CIRCConnection(void) {
+	if (m_IdentKey != NULL) {
+		g_Bouncer->GetIdentSupport()->UnregisterConnection(this, m_IdentKey);
+
+		free(m_IdentKey);
+	}
+
 	free(m_CurrentNick);
 	free(m_Site);
 	free(m_Usermodes);
@@ -164,6 +185,80 @@ CIRCConnection::~CIRCConnection(void) {
 	}
 }
 
+/**
+ * IrcCommand
+ *
+ * Identifiers for the server commands which are processed by ParseLineArgV.
+ */
+enum IrcCommand {
+	Irc_Unknown = 0,
+	Irc_Privmsg,
+	Irc_Notice,
+	Irc_Join,
+	Irc_Part,
+	Irc_Kick,
+	Irc_Nick,
+	Irc_Quit,
+	Irc_Mode,
+	Irc_Topic,
+	Irc_Pong,
+	Irc_Welcome,
+	Irc_ISupport,
+	Irc_ChannelModeIs,
+	Irc_CreationTime,
+	Irc_NoTopic,
+	Irc_TopicReply,
+	Irc_TopicWhoTime,
+	Irc_Version,
+	Irc_WhoReply,
+	Irc_NamesReply,
+	Irc_EndOfNames,
+	Irc_BanList,
+	Irc_EndOfBanList,
+	Irc_EndOfMotd,
+	Irc_HostHidden,
+	Irc_UnknownCommand,
+	Irc_NoMotd,
+	Irc_NickInUse,
+	Irc_YoureBanned
+};
+
+/**
+ * The server commands which are processed by ParseLineArgV.
+ */
+static const dispatchentry_t IrcCommands[] = {
+	{ "PRIVMSG", Irc_Privmsg },
+	{ "NOTICE", Irc_Notice },
+	{ "JOIN", Irc_Join },
+	{ "PART", Irc_Part },
+	{ "KICK", Irc_Kick },
+	{ "NICK", Irc_Nick },
+	{ "QUIT", Irc_Quit },
+	{ "MODE", Irc_Mode },
+	{ "TOPIC", Irc_Topic },
+	{ "PONG", Irc_Pong },
+	{ "001", Irc_Welcome },
+	{ "005", Irc_ISupport },
+	{ "324", Irc_ChannelModeIs },
+	{ "329", Irc_CreationTime },
+	{ "331", Irc_NoTopic },
+	{ "332", Irc_TopicReply },
+	{ "333", Irc_TopicWhoTime },
+	{ "351", Irc_Version },
+	{ "352", Irc_WhoReply },
+	{ "353", Irc_NamesReply },
+	{ "366", Irc_EndOfNames },
+	{ "367", Irc_BanList },
+	{ "368", Irc_EndOfBanList },
+	{ "376", Irc_EndOfMotd },
+	{ "396", Irc_HostHidden },
+	{ "421", Irc_UnknownCommand },
+	{ "422", Irc_NoMotd },
+	{ "433", Irc_NickInUse },
+	{ "465", Irc_YoureBanned },
+	{ NULL, Irc_Unknown }
+};
+
 /**
  * ParseLineArgV
  *
@@ -184,572 +279,797 @@ bool CIRCConnection::ParseLineArgV(int argc, const char **argv) {
 
 	const char *Reply = argv[0];
 	const char *Raw = argv[1];
-	char *Nick = ::NickFromHostmask(Reply);
-	int iRaw = atoi(Raw);
+	const char *ExclamationMark = strchr(Reply, '!');
+	char *Nick;
+	nickdata_t *NickData;
+	static CDispatchTable Commands(IrcCommands);
 
+	// compare the nick in-place rather than using NickFromHostmask()
 	bool b_Me = false;
-	if (m_CurrentNick != NULL && Nick != NULL && strcasecmp(Nick, m_CurrentNick) == 0) {
+	if (m_CurrentNick != NULL && ExclamationMark != NULL &&
+			strncasecmp(Reply, m_CurrentNick, ExclamationMark - Reply) == 0 &&
+			m_CurrentNick[ExclamationMark - Reply] == '\0') {
 		b_Me = true;
 	}
 
-	free(Nick);
-
 	Client = GetOwner()->GetClientConnectionMultiplexer();
 
-	// HASH values
-	CHashCompare hashRaw(argv[1]);
-	static CHashCompare hashPrivmsg("PRIVMSG");
-	static CHashCompare hashNotice("NOTICE");
-	static CHashCompare hashJoin("JOIN");
-	static CHashCompare hashPart("PART");
-	static CHashCompare hashKick("KICK");
-	static CHashCompare hashNick("NICK");
-	static CHashCompare hashQuit("QUIT");
-	static CHashCompare hashMode("MODE");
-	static CHashCompare hashTopic("TOPIC");
-	static CHashCompare hashPong("PONG");
-	// END of HASH values
+	if (strcasecmp(Reply, "ERROR") == 0) {
+		if (strstr(Raw, "throttle") != NULL) {
+			GetOwner()->ScheduleReconnect(120);
+		} else {
+			GetOwner()->ScheduleReconnect(5);
+		}
 
-	if (argc > 3 && iRaw == 433) {
-		bool ReturnValue = ModuleEvent(argc, argv);
+		if (GetCurrentNick() != NULL && GetSite() != NULL) {
+			g_Bouncer->LogUser(GetUser(), "Error received for user %s [%s!%s]: %s",
+				GetOwner()->GetUsername(), GetCurrentNick(), GetSite(), argv[1]);
+		} else {
+			g_Bouncer->LogUser(GetUser(), "Error received for user %s: %s",
+				GetOwner()->GetUsername(), argv[1]);
+		}
 
-		if (ReturnValue) {
-			if (GetCurrentNick() == NULL) {
-				WriteLine("NICK :%s_", argv[3]);
+		return ModuleEvent(argc, argv);
+	}
+
+	switch (Commands.Find(Raw)) {
+		case Irc_NickInUse: {
+			if (argc < 4) {
+				break;
 			}
 
-			if (m_NickCatchTimer == NULL) {
-				m_NickCatchTimer = new CTimer(30, false, NickCatchTimer, this);
+			bool ReturnValue = ModuleEvent(argc, argv);
+
+			if (ReturnValue) {
+				if (GetCurrentNick() == NULL) {
+					WriteLine("NICK :%s_", argv[3]);
+				}
+
+				if (m_NickCatchTimer == NULL) {
+					m_NickCatchTimer = new CTimer(30, false, NickCatchTimer, this);
+				}
 			}
+
+			return ReturnValue;
 		}
 
-		return ReturnValue;
-	} else if (argc > 3 && hashRaw == hashPrivmsg && Client == NULL) {
-		const char *Host;
-		const char *Dest = argv[2];
-		char *Nick = ::NickFromHostmask(Reply);
+		case Irc_Privmsg: {
+			if (argc < 4) {
+				break;
+			}
 
-		Channel = GetChannel(Dest);
+			if (Client != NULL) {
+				Channel = GetChannel(argv[2]);
 
-		if (Channel != NULL) {
-			CNick *User = Channel->GetNames()->Get(Nick);
+				if (Channel != NULL) {
+					Channel->AddBacklogLine(argv[0], argv[3]);
+				}
 
-			if (User != NULL) {
-				User->SetIdleSince(g_CurrentTime);
+				break;
 			}
 
-			Channel->AddBacklogLine(argv[0], argv[3]);
-		}
-
-		if (!ModuleEvent(argc, argv)) {
-			free(Nick);
-			return false;
-		}
+			const char *Host;
+			const char *Dest = argv[2];
+			char *Nick = ::NickFromHostmask(Reply);
 
-		/* don't log ctcp requests */
-		if (argv[3][0] != '\1' && argv[3][strlen(argv[3]) - 1] != '\1' && Dest != NULL &&
-				Nick != NULL && m_CurrentNick != NULL && strcasecmp(Dest, m_CurrentNick) == 0 &&
-				strcasecmp(Nick, m_CurrentNick) != 0) {
-			char *Dup;
-			char *Delim;
+			Channel = GetChannel(Dest);
 
-			Dup = strdup(Reply);
+			if (Channel != NULL) {
+				CNick *User = Channel->GetNames()->Get(Nick);
 
-			if (AllocFailed(Dup)) {
-				free(Nick);
+				if (User != NULL) {
+					User->SetIdleSince(g_CurrentTime);
+				}
 
-				return true;
+				Channel->AddBacklogLine(argv[0], argv[3]);
 			}
 
-			Delim = strchr(Dup, '!');
+			if (!ModuleEvent(argc, argv)) {
+				free(Nick);
+				return false;
+			}
 
-			if (Delim != NULL) {
-				*Delim = '\0';
+			/* don't log ctcp requests */
+			if (argv[3][0] != '\1' && argv[3][strlen(argv[3]) - 1] != '\1' && Dest != NULL &&
+					Nick != NULL && m_CurrentNick != NULL && strcasecmp(Dest, m_CurrentNick) == 0 &&
+					strcasecmp(Nick, m_CurrentNick) != 0) {
+				char *Dup;
+				char *Delim;
 
-				Host = Delim + 1;
-			}
+				Dup = strdup(Reply);
 
-			GetOwner()->Log("%s (%s): %s", Dup, Delim ? Host : "<unknown host>", argv[3]);
+				if (AllocFailed(Dup)) {
+					free(Nick);
 
-			free(Dup);
-		}
+					return true;
+				}
 
-		free(Nick);
+				Delim = strchr(Dup, '!');
 
-		UpdateHostHelper(Reply);
+				if (Delim != NULL) {
+					*Delim = '\0';
 
-		return true;
-	} else if (argc > 3 && hashRaw == hashPrivmsg && Client != NULL) {
-		Channel = GetChannel(argv[2]);
+					Host = Delim + 1;
+				}
 
-		if (Channel != NULL) {
-			Channel->AddBacklogLine(argv[0], argv[3]);
-		}
-	} else if (argc > 3 && hashRaw == hashNotice && Client == NULL) {
-		const char *Dest = argv[2];
-		char *Nick;
-		
-		if (!ModuleEvent(argc, argv)) {
-			return false;
-		}
+				GetOwner()->Log("%s (%s): %s", Dup, Delim ? Host : "<unknown host>", argv[3]);
 
-		Nick = ::NickFromHostmask(Reply);
+				free(Dup);
+			}
 
-		/* don't log ctcp replies */
-		if (argv[3][0] != '\1' && argv[3][strlen(argv[3]) - 1] != '\1' && Dest != NULL &&
-				Nick != NULL && m_CurrentNick != NULL && strcasecmp(Dest, m_CurrentNick) == 0 &&
-				strcasecmp(Nick, m_CurrentNick) != 0) {
-			GetOwner()->Log("%s (notice): %s", Reply, argv[3]);
-		}
+			free(Nick);
 
-		free(Nick);
+			UpdateHostHelper(Reply);
 
-		return true;
-	} else if (argc > 2 && hashRaw == hashJoin) {
-		if (b_Me) {
-			AddChannel(argv[2]);
+			return true;
+		}
 
-			/* GetOwner() can be NULL if AddChannel failed */
-			if (GetOwner() != NULL && Client == NULL) {
-				WriteLine("MODE %s", argv[2]);
+		case Irc_Notice: {
+			if (argc < 4 || Client != NULL) {
+				break;
 			}
-		}
 
-		Channel = GetChannel(argv[2]);
+			const char *Dest = argv[2];
+			char *Nick;
+		
+			if (!ModuleEvent(argc, argv)) {
+				return false;
+			}
 
-		if (Channel != NULL) {
-			Nick = NickFromHostmask(Reply);
+			Nick = ::NickFromHostmask(Reply);
 
-			if (AllocFailed(Nick)) {
-				return false;
+			/* don't log ctcp replies */
+			if (argv[3][0] != '\1' && argv[3][strlen(argv[3]) - 1] != '\1' && Dest != NULL &&
+					Nick != NULL && m_CurrentNick != NULL && strcasecmp(Dest, m_CurrentNick) == 0 &&
+					strcasecmp(Nick, m_CurrentNick) != 0) {
+				GetOwner()->Log("%s (notice): %s", Reply, argv[3]);
 			}
 
-			Channel->AddUser(Nick, '\0');
 			free(Nick);
+
+			return true;
 		}
 
-		UpdateHostHelper(Reply);
-	} else if (argc > 2 && hashRaw == hashPart) {
-		bool bRet = ModuleEvent(argc, argv);
+		case Irc_Join: {
+			if (argc < 3) {
+				break;
+			}
+
+			if (b_Me) {
+				AddChannel(argv[2]);
+
+				/* GetOwner() can be NULL if AddChannel failed */
+				if (GetOwner() != NULL && Client == NULL) {
+					WriteLine("MODE %s", argv[2]);
+				}
+			}
 
-		if (b_Me) {
-			RemoveChannel(argv[2]);
-		} else {
 			Channel = GetChannel(argv[2]);
 
 			if (Channel != NULL) {
-				Nick = ::NickFromHostmask(Reply);
+				Nick = NickFromHostmask(Reply);
 
 				if (AllocFailed(Nick)) {
 					return false;
 				}
 
-				Channel->RemoveUser(Nick);
-
+				Channel->AddUser(Nick, '\0');
 				free(Nick);
 			}
-		}
 
-		UpdateHostHelper(Reply);
+			UpdateHostHelper(Reply);
+
+			break;
+		}
 
-		return bRet;
-	} else if (argc > 3 && hashRaw == hashKick) {
-		bool bRet = ModuleEvent(argc, argv);
+		case Irc_Part: {
+			if (argc < 3) {
+				break;
+			}
 
-		if (m_CurrentNick != NULL && strcasecmp(argv[3], m_CurrentNick) == 0) {
-			RemoveChannel(argv[2]);
+			bool bRet = ModuleEvent(argc, argv);
 
-			if (Client == NULL) {
-				char *Dup = strdup(Reply);
+			if (b_Me) {
+				RemoveChannel(argv[2]);
+			} else {
+				Channel = GetChannel(argv[2]);
 
-				if (AllocFailed(Dup)) {
-					return bRet;
-				}
+				if (Channel != NULL) {
+					Nick = ::NickFromHostmask(Reply);
 
-				char *Delim = strchr(Dup, '!');
-				const char *Host = NULL;
+					if (AllocFailed(Nick)) {
+						return false;
+					}
 
-				if (Delim) {
-					*Delim = '\0';
+					Channel->RemoveUser(Nick);
 
-					Host = Delim + 1;
+					free(Nick);
 				}
+			}
 
-				GetOwner()->Log("%s (%s) kicked you from %s (%s)", Dup, Delim ? Host : "<unknown host>", argv[2], argc > 4 ? argv[4] : "");
+			UpdateHostHelper(Reply);
 
-				free(Dup);
-			}
-		} else {
-			Channel = GetChannel(argv[2]);
+			return bRet;
+		}
 
-			if (Channel != NULL) {
-				Channel->RemoveUser(argv[3]);
+		case Irc_Kick: {
+			if (argc < 4) {
+				break;
 			}
-		}
 
-		UpdateHostHelper(Reply);
+			bool bRet = ModuleEvent(argc, argv);
+
+			if (m_CurrentNick != NULL && strcasecmp(argv[3], m_CurrentNick) == 0) {
+				RemoveChannel(argv[2]);
+
+				if (Client == NULL) {
+					char *Dup = strdup(Reply);
+
+					if (AllocFailed(Dup)) {
+						return bRet;
+					}
+
+					char *Delim = strchr(Dup, '!');
+					const char *Host = NULL;
+
+					if (Delim) {
+						*Delim = '\0';
+
+						Host = Delim + 1;
+					}
+
+					GetOwner()->Log("%s (%s) kicked you from %s (%s)", Dup, Delim ? Host : "<unknown host>", argv[2], argc > 4 ? argv[4] : "");
+
+					free(Dup);
+				}
+			} else {
+				Channel = GetChannel(argv[2]);
 
-		return bRet;
-	} else if (argc > 2 && iRaw == 1) {
-		if (Client != NULL) {
-			if (strcmp(Client->GetNick(), argv[2]) != 0) {
-				Client->WriteLine(":%s!%s NICK :%s", Client->GetNick(), m_Site ? m_Site : "unknown@unknown.host", argv[2]);
+				if (Channel != NULL) {
+					Channel->RemoveUser(argv[3]);
+				}
 			}
+
+			UpdateHostHelper(Reply);
+
+			return bRet;
 		}
 
-		free(m_CurrentNick);
-		m_CurrentNick = strdup(argv[2]);
+		case Irc_Welcome: {
+			if (argc < 3) {
+				break;
+			}
+
+			if (Client != NULL) {
+				if (strcmp(Client->GetNick(), argv[2]) != 0) {
+					Client->WriteLine(":%s!%s NICK :%s", Client->GetNick(), m_Site ? m_Site : "unknown@unknown.host", argv[2]);
+				}
+			}
 
-		free(m_Server);
-		m_Server = strdup(Reply);
-	} else if (argc > 2 && hashRaw == hashNick) {
-		if (b_Me) {
 			free(m_CurrentNick);
 			m_CurrentNick = strdup(argv[2]);
+
+			free(m_Server);
+			m_Server = strdup(Reply);
+
+			break;
 		}
 
-		Nick = NickFromHostmask(argv[0]);
+		case Irc_Nick: {
+			if (argc < 3) {
+				break;
+			}
 
-		int i = 0;
+			if (b_Me) {
+				free(m_CurrentNick);
+				m_CurrentNick = strdup(argv[2]);
+			}
 
-		if (!b_Me && GetOwner()->GetClientConnectionMultiplexer() == NULL) {
-			const char *AwayNick = GetOwner()->GetAwayNick();
+			Nick = NickFromHostmask(argv[0]);
 
-			if (AwayNick != NULL && strcasecmp(AwayNick, Nick) == 0) {
-				WriteLine("NICK %s", AwayNick);
+			if (AllocFailed(Nick)) {
+				return false;
 			}
-		}
 
-		while (hash_t<CChannel *> *ChannelHash = m_Channels->Iterate(i++)) {
-			ChannelHash->Value->RenameUser(Nick, argv[2]);
-		}
+			if (!b_Me && GetOwner()->GetClientConnectionMultiplexer() == NULL) {
+				const char *AwayNick = GetOwner()->GetAwayNick();
+
+				if (AwayNick != NULL && strcasecmp(AwayNick, Nick) == 0) {
+					WriteLine("NICK %s", AwayNick);
+				}
+			}
 
-		free(Nick);
-	} else if (argc > 1 && hashRaw == hashQuit) {
-		bool bRet = ModuleEvent(argc, argv);
+			NickData = m_Nicks.Get(Nick);
 
-		Nick = NickFromHostmask(argv[0]);
+			if (NickData != NULL) {
+				// only the channels this user is on have to be updated
+				NickData->RefCount++;
 
-		int i = 0;
+				for (int i = NickData->Memberships.GetLength() - 1; i >= 0; i--) {
+					if (i < NickData->Memberships.GetLength()) {
+						NickData->Memberships[i]->GetOwner()->RenameUser(Nick, argv[2]);
+					}
+				}
+
+				ReleaseNickData(NickData);
+			}
+
+			free(Nick);
 
-		while (hash_t<CChannel *> *ChannelHash = m_Channels->Iterate(i++)) {
-			ChannelHash->Value->RemoveUser(Nick);
+			break;
 		}
 
-		free(Nick);
+		case Irc_Quit: {
+			bool bRet = ModuleEvent(argc, argv);
 
-		return bRet;
-	} else if (argc > 1 && (iRaw == 422 || iRaw == 376)) {
-		int DelayJoin = GetOwner()->GetDelayJoin();
-		if (m_State != State_Connected) {
-			const CVector<CModule *> *Modules = g_Bouncer->GetModules();
+			Nick = NickFromHostmask(argv[0]);
 
-			for (int i = 0; i < Modules->GetLength(); i++) {
-				(*Modules)[i]->ServerLogon(GetOwner()->GetUsername());
+			if (AllocFailed(Nick)) {
+				return bRet;
 			}
 
-			const char *ClientNick;
+			NickData = m_Nicks.Get(Nick);
 
-			if (Client != NULL) {
-				ClientNick = Client->GetNick();
+			if (NickData != NULL) {
+				NickData->RefCount++;
 
-				if (strcmp(m_CurrentNick, ClientNick) != 0) {
-					Client->ChangeNick(m_CurrentNick);
+				for (int i = NickData->Memberships.GetLength() - 1; i >= 0; i--) {
+					if (i < NickData->Memberships.GetLength()) {
+						NickData->Memberships[i]->GetOwner()->RemoveUser(Nick);
+					}
 				}
+
+				ReleaseNickData(NickData);
 			}
 
-			GetOwner()->Log("You were successfully connected to an IRC server.");
-			g_Bouncer->Log("User %s connected to an IRC server.",
-				GetOwner()->GetUsername());
-		}
+			free(Nick);
 
-		if (DelayJoin == 1) {
-			m_DelayJoinTimer = g_Bouncer->CreateTimer(5, false, DelayJoinTimer, this);
-		} else if (DelayJoin == 0) {
-			JoinChannels();
+			return bRet;
 		}
 
-		if (Client == NULL) {
-			bool AppendTS = (GetOwner()->GetConfig()->ReadInteger("user.ts") != 0);
-			const char *AwayReason = GetOwner()->GetAwayText();
+		case Irc_EndOfMotd:
+		case Irc_NoMotd: {
+			int DelayJoin = GetOwner()->GetDelayJoin();
+			if (m_State != State_Connected) {
+				const CVector<CModule *> *Modules = g_Bouncer->GetModules();
 
-			if (AwayReason != NULL) {
-				WriteLine(AppendTS ? "AWAY :%s (Away since the dawn of time)" : "AWAY :%s", AwayReason);
-			}
-		}
+				for (int i = 0; i < Modules->GetLength(); i++) {
+					(*Modules)[i]->ServerLogon(GetOwner()->GetUsername());
+				}
 
-		const char *AutoModes = GetOwner()->GetAutoModes();
-		const char *DropModes = GetOwner()->GetDropModes();
+				const char *ClientNick;
 
-		if (AutoModes != NULL) {
-			WriteLine("MODE %s +%s", GetCurrentNick(), AutoModes);
-		}
+				if (Client != NULL) {
+					ClientNick = Client->GetNick();
 
-		if (DropModes != NULL && Client == NULL) {
-			WriteLine("MODE %s -%s", GetCurrentNick(), DropModes);
-		}
+					if (strcmp(m_CurrentNick, ClientNick) != 0) {
+						Client->ChangeNick(m_CurrentNick);
+					}
+				}
 
-		m_State = State_Connected;
-	} else if (argc > 1 && strcasecmp(Reply, "ERROR") == 0) {
-		if (strstr(Raw, "throttle") != NULL) {
-			GetOwner()->ScheduleReconnect(120);
-		} else {
-			GetOwner()->ScheduleReconnect(5);
-		}
+				GetOwner()->Log("You were successfully connected to an IRC server.");
+				g_Bouncer->Log("User %s connected to an IRC server.",
+					GetOwner()->GetUsername());
+			}
 
-		if (GetCurrentNick() != NULL && GetSite() != NULL) {
-			g_Bouncer->LogUser(GetUser(), "Error received for user %s [%s!%s]: %s",
-				GetOwner()->GetUsername(), GetCurrentNick(), GetSite(), argv[1]);
-		} else {
-			g_Bouncer->LogUser(GetUser(), "Error received for user %s: %s",
-				GetOwner()->GetUsername(), argv[1]);
-		}
-	} else if (argc > 3 && iRaw == 465) {
-		if (GetCurrentNick() != NULL && GetSite() != NULL) {
-			g_Bouncer->LogUser(GetUser(), "G/K-line reason for user %s [%s!%s]: %s",
-				GetOwner()->GetUsername(), GetCurrentNick(), GetSite(), argv[3]);
-		} else {
-			g_Bouncer->LogUser(GetUser(), "G/K-line reason for user %s: %s",
-				GetOwner()->GetUsername(), argv[3]);
-		}
-	} else if (argc > 5 && iRaw == 351) {
-		free(m_ServerVersion);
-		m_ServerVersion = strdup(argv[3]);
+			if (DelayJoin == 1) {
+				m_DelayJoinTimer = g_Bouncer->CreateTimer(5, false, DelayJoinTimer, this);
+			} else if (DelayJoin == 0) {
+				JoinChannels();
+			}
 
-		free(m_ServerFeat);
-		m_ServerFeat = strdup(argv[5]);
-	} else if (argc > 3 && iRaw == 5) {
-		for (int i = 3; i < argc - 1; i++) {
-			char *Dup = strdup(argv[i]);
+			if (Client == NULL) {
+				bool AppendTS = (GetOwner()->GetConfig()->ReadInteger("user.ts") != 0);
+				const char *AwayReason = GetOwner()->GetAwayText();
 
-			if (AllocFailed(Dup)) {
-				return false;
+				if (AwayReason != NULL) {
+					WriteLine(AppendTS ? "AWAY :%s (Away since the dawn of time)" : "AWAY :%s", AwayReason);
+				}
 			}
 
-			char *Eq = strchr(Dup, '=');
+			const char *AutoModes = GetOwner()->GetAutoModes();
+			const char *DropModes = GetOwner()->GetDropModes();
 
-			if (strcasecmp(Dup, "NAMESX") == 0) {
-				WriteLine("PROTOCTL NAMESX");
+			if (AutoModes != NULL) {
+				WriteLine("MODE %s +%s", GetCurrentNick(), AutoModes);
 			}
 
-			char *Value;
+			if (DropModes != NULL && Client == NULL) {
+				WriteLine("MODE %s -%s", GetCurrentNick(), DropModes);
+			}
 
-			if (Eq) {
-				*Eq = '\0';
+			m_State = State_Connected;
 
-				Value = strdup(++Eq);
-			} else {
-				Value = strdup("");
+			break;
+		}
+
+		case Irc_YoureBanned: {
+			if (argc < 4) {
+				break;
 			}
 
-			m_ISupport->Add(Dup, Value);
+			if (GetCurrentNick() != NULL && GetSite() != NULL) {
+				g_Bouncer->LogUser(GetUser(), "G/K-line reason for user %s [%s!%s]: %s",
+					GetOwner()->GetUsername(), GetCurrentNick(), GetSite(), argv[3]);
+			} else {
+				g_Bouncer->LogUser(GetUser(), "G/K-line reason for user %s: %s",
+					GetOwner()->GetUsername(), argv[3]);
+			}
 
-			free(Dup);
+			break;
 		}
-	} else if (argc > 4 && iRaw == 324) {
-		Channel = GetChannel(argv[3]);
 
-		if (Channel != NULL) {
-			Channel->ClearModes();
-			Channel->ParseModeChange(argv[0], argv[4], argc - 5, &argv[5]);
-			Channel->SetModesValid(true);
+		case Irc_Version: {
+			if (argc < 6) {
+				break;
+			}
+
+			free(m_ServerVersion);
+			m_ServerVersion = strdup(argv[3]);
+
+			free(m_ServerFeat);
+			m_ServerFeat = strdup(argv[5]);
+
+			break;
 		}
-	} else if (argc > 3 && hashRaw == hashMode) {
-		Channel = GetChannel(argv[2]);
 
-		if (Channel != NULL) {
-			Channel->ParseModeChange(argv[0], argv[3], argc - 4, &argv[4]);
-		} else if (strcmp(m_CurrentNick, argv[2]) == 0) {
-			bool Flip = true, WasNull;
-			const char *Modes = argv[3];
-			size_t Length = strlen(Modes) + 1;
+		case Irc_ISupport: {
+			if (argc < 4) {
+				break;
+			}
+
+			for (int i = 3; i < argc - 1; i++) {
+				char *Dup = strdup(argv[i]);
+
+				if (AllocFailed(Dup)) {
+					return false;
+				}
+
+				char *Eq = strchr(Dup, '=');
+
+				if (strcasecmp(Dup, "NAMESX") == 0) {
+					WriteLine("PROTOCTL NAMESX");
+				}
+
+				char *Value;
+
+				if (Eq) {
+					*Eq = '\0';
 
-			if (m_Usermodes != NULL) {
-				Length += strlen(m_Usermodes);
+					Value = strdup(++Eq);
+				} else {
+					Value = strdup("");
+				}
+
+				m_ISupport->Add(Dup, Value);
+
+				free(Dup);
 			}
 
-			WasNull = (m_Usermodes != NULL) ? false : true;
-			m_Usermodes = (char *)realloc(m_Usermodes, Length);
+			UpdateModeTables();
 
-			if (AllocFailed(m_Usermodes)) {
-				return false;
+			break;
+		}
+
+		case Irc_ChannelModeIs: {
+			if (argc < 5) {
+				break;
 			}
 
-			if (WasNull) {
-				m_Usermodes[0] = '\0';
+			Channel = GetChannel(argv[3]);
+
+			if (Channel != NULL) {
+				Channel->ClearModes();
+				Channel->ParseModeChange(argv[0], argv[4], argc - 5, &argv[5]);
+				Channel->SetModesValid(true);
 			}
 
-			while (*Modes != '\0') {
-				if (*Modes == '+') {
-					Flip = true;
-				} else if (*Modes == '-') {
-					Flip = false;
-				} else {
-					if (Flip) {
-						size_t Position = strlen(m_Usermodes);
-						m_Usermodes[Position] = *Modes;
-						m_Usermodes[Position + 1] = '\0';
-					} else {
-						char *CurrentModes = m_Usermodes;
-						size_t a = 0;
+			break;
+		}
 
-						while (*CurrentModes != '\0') {
-							*CurrentModes = m_Usermodes[a];
+		case Irc_Mode: {
+			if (argc < 4) {
+				break;
+			}
 
-							if (*CurrentModes != *Modes) {
-								CurrentModes++;
-							}
+			Channel = GetChannel(argv[2]);
+
+			if (Channel != NULL) {
+				Channel->ParseModeChange(argv[0], argv[3], argc - 4, &argv[4]);
+			} else if (strcmp(m_CurrentNick, argv[2]) == 0) {
+				bool Flip = true, WasNull;
+				const char *Modes = argv[3];
+				size_t Length = strlen(Modes) + 1;
+
+				if (m_Usermodes != NULL) {
+					Length += strlen(m_Usermodes);
+				}
+
+				WasNull = (m_Usermodes != NULL) ? false : true;
+				m_Usermodes = (char *)realloc(m_Usermodes, Length);
+
+				if (AllocFailed(m_Usermodes)) {
+					return false;
+				}
+
+				if (WasNull) {
+					m_Usermodes[0] = '\0';
+				}
 
-							a++;
+				while (*Modes != '\0') {
+					if (*Modes == '+') {
+						Flip = true;
+					} else if (*Modes == '-') {
+						Flip = false;
+					} else {
+						if (Flip) {
+							size_t Position = strlen(m_Usermodes);
+							m_Usermodes[Position] = *Modes;
+							m_Usermodes[Position + 1] = '\0';
+						} else {
+							char *CurrentModes = m_Usermodes;
+							size_t a = 0;
+
+							while (*CurrentModes != '\0') {
+								*CurrentModes = m_Usermodes[a];
+
+								if (*CurrentModes != *Modes) {
+									CurrentModes++;
+								}
+
+								a++;
+							}
 						}
 					}
-				}
 
-				Modes++;
+					Modes++;
+				}
 			}
-		}
 
-		UpdateHostHelper(Reply);
-	} else if (argc > 4 && iRaw == 329) {
-		Channel = GetChannel(argv[3]);
+			UpdateHostHelper(Reply);
 
-		if (Channel != NULL) {
-			Channel->SetCreationTime(atoi(argv[4]));
+			break;
 		}
-	} else if (argc > 4 && iRaw == 332) {
-		Channel = GetChannel(argv[3]);
 
-		if (Channel != NULL) {
-			Channel->SetTopic(argv[4]);
-		}
-	} else if (argc > 5 && iRaw == 333) {
-		Channel = GetChannel(argv[3]);
+		case Irc_CreationTime: {
+			if (argc < 5) {
+				break;
+			}
 
-		if (Channel != NULL) {
-			Channel->SetTopicNick(argv[4]);
-			Channel->SetTopicStamp(atoi(argv[5]));
+			Channel = GetChannel(argv[3]);
+
+			if (Channel != NULL) {
+				Channel->SetCreationTime(atoi(argv[4]));
+			}
+
+			break;
 		}
-	} else if (argc > 3 && iRaw == 331) {
-		Channel = GetChannel(argv[3]);
 
-		if (Channel != NULL) {
-			Channel->SetNoTopic();
+		case Irc_TopicReply: {
+			if (argc < 5) {
+				break;
+			}
+
+			Channel = GetChannel(argv[3]);
+
+			if (Channel != NULL) {
+				Channel->SetTopic(argv[4]);
+			}
+
+			break;
 		}
-	} else if (argc > 3 && hashRaw == hashTopic) {
-		Channel = GetChannel(argv[2]);
 
-		if (Channel != NULL) {
-			Channel->SetTopic(argv[3]);
-			Channel->SetTopicStamp(g_CurrentTime);
-			Channel->SetTopicNick(argv[0]);
+		case Irc_TopicWhoTime: {
+			if (argc < 6) {
+				break;
+			}
+
+			Channel = GetChannel(argv[3]);
+
+			if (Channel != NULL) {
+				Channel->SetTopicNick(argv[4]);
+				Channel->SetTopicStamp(atoi(argv[5]));
+			}
+
+			break;
 		}
 
-		UpdateHostHelper(Reply);
-	} else if (argc > 5 && iRaw == 353) {
-		Channel = GetChannel(argv[4]);
+		case Irc_NoTopic: {
+			if (argc < 4) {
+				break;
+			}
+
+			Channel = GetChannel(argv[3]);
 
-		if (Channel != NULL) {
-			const char *nicks;
-			const char **nickv;
+			if (Channel != NULL) {
+				Channel->SetNoTopic();
+			}
 
-			nicks = ArgTokenize(argv[5]);
+			break;
+		}
 
-			if (AllocFailed(nicks)) {
-				return false;
+		case Irc_Topic: {
+			if (argc < 4) {
+				break;
 			}
 
-			nickv = ArgToArray(nicks);
+			Channel = GetChannel(argv[2]);
 
-			if (AllocFailed(nickv)) {
-				ArgFree(nicks);
+			if (Channel != NULL) {
+				Channel->SetTopic(argv[3]);
+				Channel->SetTopicStamp(g_CurrentTime);
+				Channel->SetTopicNick(argv[0]);
+			}
 
-				return false;
+			UpdateHostHelper(Reply);
+
+			break;
+		}
+
+		case Irc_NamesReply: {
+			if (argc < 6) {
+				break;
 			}
 
-			int nickc = ArgCount(nicks);
+			Channel = GetChannel(argv[4]);
 
-			for (int i = 0; i < nickc; i++) {
-				char *Nick = strdup(nickv[i]);
-				char *BaseNick = Nick;
+			if (Channel != NULL) {
+				const char *nicks;
+				const char **nickv;
 
-				if (AllocFailed(Nick)) {
-					ArgFree(nicks);
+				nicks = ArgTokenize(argv[5]);
 
+				if (AllocFailed(nicks)) {
 					return false;
 				}
 
-				StrTrim(Nick, ' ');
+				nickv = ArgToArray(nicks);
+
+				if (AllocFailed(nickv)) {
+					ArgFree(nicks);
 
-				while (IsNickPrefix(*Nick)) {
-					Nick++;
+					return false;
 				}
 
-				char *Modes = NULL;
+				int nickc = ArgCount(nicks);
+
+				for (int i = 0; i < nickc; i++) {
+					char *Nick = strdup(nickv[i]);
+					char *BaseNick = Nick;
 
-				if (BaseNick != Nick) {
-					Modes = (char *)malloc(Nick - BaseNick + 1);
+					if (AllocFailed(Nick)) {
+						ArgFree(nicks);
 
-					if (!AllocFailed(Modes)) {
-						strmcpy(Modes, BaseNick, Nick - BaseNick + 1);
+						return false;
 					}
+
+					StrTrim(Nick, ' ');
+
+					while (IsNickPrefix(*Nick)) {
+						Nick++;
+					}
+
+					char *Modes = NULL;
+
+					if (BaseNick != Nick) {
+						Modes = (char *)malloc(Nick - BaseNick + 1);
+
+						if (!AllocFailed(Modes)) {
+							strmcpy(Modes, BaseNick, Nick - BaseNick + 1);
+						}
+					}
+
+					Channel->AddUser(Nick, Modes);
+
+					free(BaseNick);
+					free(Modes);
 				}
 
-				Channel->AddUser(Nick, Modes);
+				ArgFreeArray(nickv);
+				ArgFree(nicks);
+			}
+
+			break;
+		}
+
+		case Irc_EndOfNames: {
+			if (argc < 4) {
+				break;
+			}
+
+			Channel = GetChannel(argv[3]);
+
+			if (Channel != NULL) {
+				Channel->SetHasNames();
+			}
+
+			break;
+		}
+
+		case Irc_WhoReply: {
+			if (argc < 10) {
+				break;
+			}
+
+			const char *Ident = argv[4];
+			const char *Host = argv[5];
+			const char *Server = argv[6];
+			const char *Nick = argv[7];
+			const char *Realname = argv[9];
+			char *Mask;
+
+			int rc = asprintf(&Mask, "%s!%s@%s", Nick, Ident, Host);
+
+			if (!RcFailed(rc)) {
+				UpdateHostHelper(Mask);
+				UpdateWhoHelper(Nick, Realname, Server);
+
+				free(Mask);
+			}
+
+			break;
+		}
+
+		case Irc_BanList: {
+			if (argc < 7) {
+				break;
+			}
+
+			Channel = GetChannel(argv[3]);
+
+			if (Channel != NULL) {
+				Channel->GetBanlist()->SetBan(argv[4], argv[5], atoi(argv[6]));
+			}
+
+			break;
+		}
+
+		case Irc_EndOfBanList: {
+			if (argc < 4) {
+				break;
+			}
+
+			Channel = GetChannel(argv[3]);
 
-				free(BaseNick);
-				free(Modes);
+			if (Channel != NULL) {
+				Channel->SetHasBans();
 			}
 
-			ArgFreeArray(nickv);
-			ArgFree(nicks);
+			break;
 		}
-	} else if (argc > 3 && iRaw == 366) {
-		Channel = GetChannel(argv[3]);
 
-		if (Channel != NULL) {
-			Channel->SetHasNames();
-		}
-	} else if (argc > 9 && iRaw == 352) {
-		const char *Ident = argv[4];
-		const char *Host = argv[5];
-		const char *Server = argv[6];
-		const char *Nick = argv[7];
-		const char *Realname = argv[9];
-		char *Mask;
+		case Irc_HostHidden: {
+			if (argc < 4) {
+				break;
+			}
 
-		int rc = asprintf(&Mask, "%s!%s@%s", Nick, Ident, Host);
+			free(m_Site);
+			m_Site = strdup(argv[3]);
 
-		if (!RcFailed(rc)) {
-			UpdateHostHelper(Mask);
-			UpdateWhoHelper(Nick, Realname, Server);
+			if (AllocFailed(m_Site)) {}
 
-			free(Mask);
+			break;
 		}
-	} else if (argc > 6 && iRaw == 367) {
-		Channel = GetChannel(argv[3]);
 
-		if (Channel != NULL) {
-			Channel->GetBanlist()->SetBan(argv[4], argv[5], atoi(argv[6]));
-		}
-	} else if (argc > 3 && iRaw == 368) {
-		Channel = GetChannel(argv[3]);
+		case Irc_Pong: {
+			if (argc < 4 || m_Server == NULL || strcasecmp(argv[2], m_Server) != 0 || !m_EatPong) {
+				break;
+			}
 
-		if (Channel != NULL) {
-			Channel->SetHasBans();
+			m_EatPong = false;
+
+			return false;
 		}
-	} else if (argc > 3 && iRaw == 396) {
-		free(m_Site);
-		m_Site = strdup(argv[3]);
 
-		if (AllocFailed(m_Site)) {}
-	} else if (argc > 3 && hashRaw == hashPong && m_Server != NULL && strcasecmp(argv[2], m_Server) == 0 && m_EatPong) {
-		m_EatPong = false;
+		case Irc_UnknownCommand: {
+			if (argc < 4) {
+				break;
+			}
 
-		return false;
-	} else if (argc > 3 && iRaw == 421) {
-		m_FloodControl->Unplug();
+			m_FloodControl->Unplug();
 
-		return false;
+			return false;
+		}
 	}
 
 	if (GetOwner() != NULL) {
@@ -801,14 +1121,14 @@ void CIRCConnection::ParseLine(const char *Line) {
 	}
 
 	tokendata_t Args = ArgTokenize2(RealLine);
-	const char **argv = ArgToArray2(Args);
+	const char *argv[33];
 	int argc = ArgCount2(Args);
 
-	if (argv == NULL) {
-		g_Bouncer->Log("ArgToArray2 returned NULL. Could not parse line (%s).", Line);
+	ArgToArray2(Args, argv);
 
-		return;
-	}
+	// clients which are still receiving their channels must see a channel
+	// before anything else the server sends about it
+	GetOwner()->FlushAttachReplayChannels(NULL, argc, argv);
 
 	if (ParseLineArgV(argc, argv)) {
 		if (strcasecmp(argv[0], "ping") == 0 && argc > 1) {
@@ -849,8 +1169,6 @@ void CIRCConnection::ParseLine(const char *Line) {
 #endif
 
 	//puts(Line);
-
-	ArgFreeArray(argv);
 }
 
 /**
@@ -889,6 +1207,7 @@ CChannel *CIRCConnection::AddChannel(const char *Channel) {
 	}
 
 	m_Channels->Add(Channel, ChannelObj);
+	m_SortedChannelsValid = false;
 
 	UpdateChannelConfig();
 
@@ -904,10 +1223,44 @@ CChannel *CIRCConnection::AddChannel(const char *Channel) {
  */
 void CIRCConnection::RemoveChannel(const char *Channel) {
 	m_Channels->Remove(Channel);
+	m_SortedChannelsValid = false;
 
 	UpdateChannelConfig();
 }
 
+/**
+ * GetSortedChannels
+ *
+ * Returns the channels sorted using the specified function. The result is
+ * cached until the list of channels or the sort function changes.
+ *
+ * @param SortFunction the compare function (e.g. ChannelTSCompare)
+ */
+const CVector<CChannel *> *CIRCConnection::GetSortedChannels(int (*SortFunction)(const void *p1, const void *p2)) {
+	if (m_SortedChannelsValid && m_SortFunction == SortFunction) {
+		return &m_SortedChannels;
+	}
+
+	m_SortedChannels.Clear();
+
+	int i = 0;
+
+	while (hash_t<CChannel *> *ChannelHash = m_Channels->Iterate(i++)) {
+		if (IsError(m_SortedChannels.Insert(ChannelHash->Value))) {
+			m_SortedChannels.Clear();
+
+			return &m_SortedChannels;
+		}
+	}
+
+	qsort(m_SortedChannels.GetList(), m_SortedChannels.GetLength(), sizeof(CChannel *), SortFunction);
+
+	m_SortFunction = SortFunction;
+	m_SortedChannelsValid = true;
+
+	return &m_SortedChannels;
+}
+
 /**
  * GetServer
  *
@@ -974,17 +1327,22 @@ bool CIRCConnection::HasQueuedData(void) const {
  * Writes data for the socket.
  */
 int CIRCConnection::Write(void) {
-	char *Line = m_FloodControl->DequeueItem();
+	char *Line;
 
-	if (Line != NULL) {
-		CConnection::WriteUnformattedLine(Line);
+	// the socket becomes writable once the connection has been established,
+	// which is when the ident server is going to ask about it
+	if (m_IdentKey == NULL) {
+		m_IdentKey = g_Bouncer->GetIdentSupport()->RegisterConnection(this);
 	}
 
-	int ReturnValue = CConnection::Write();
+	// send as many lines as the flood control allows
+	while ((Line = m_FloodControl->DequeueItem()) != NULL) {
+		CConnection::WriteUnformattedLine(Line);
 
-	free(Line);
+		free(Line);
+	}
 
-	return ReturnValue;
+	return CConnection::Write();
 }
 
 /**
@@ -1008,6 +1366,115 @@ const char *CIRCConnection::GetISupport(const char *Feature) const {
  */
 void CIRCConnection::SetISupport(const char *Feature, const char *Value) {
 	m_ISupport->Add(Feature, strdup(Value));
+
+	UpdateModeTables();
+}
+
+/**
+ * GetModeType
+ *
+ * Determines the parameter type of a channel mode from the
+ * CHANMODES feature (see RequiresParameter).
+ *
+ * @param Modes the value of the CHANMODES feature
+ * @param Mode the channel mode
+ */
+static int GetModeType(const char *Modes, char Mode) {
+	int ReturnValue = 3;
+
+	for (size_t i = 0; Modes[i] != '\0'; i++) {
+		if (Modes[i] == Mode) {
+			return ReturnValue;
+		} else if (Modes[i] == ',') {
+			ReturnValue--;
+		}
+
+		if (ReturnValue == 0) {
+			return 0;
+		}
+	}
+
+	return ReturnValue;
+}
+
+/**
+ * UpdateModeTables
+ *
+ * Rebuilds the lookup tables for nick prefixes and channel modes from
+ * the PREFIX and CHANMODES features. Nick prefixes are stored as bits in
+ * the order in which the server lists them, so existing channel members
+ * are converted if that order changes.
+ */
+void CIRCConnection::UpdateModeTables(void) {
+	const char *Prefixes = GetISupport("PREFIX");
+	const char *Modes = GetISupport("CHANMODES");
+	const char *ActualPrefixes;
+	char OldPrefixChars[MAXPREFIXES + 1];
+	unsigned int Count = 0;
+
+	strmcpy(OldPrefixChars, m_PrefixChars, sizeof(OldPrefixChars));
+
+	memset(m_PrefixModeIndex, -1, sizeof(m_PrefixModeIndex));
+	memset(m_PrefixCharIndex, -1, sizeof(m_PrefixCharIndex));
+
+	if (Prefixes != NULL && Prefixes[0] == '(' && (ActualPrefixes = strchr(Prefixes, ')')) != NULL) {
+		Prefixes++;
+		ActualPrefixes++;
+
+		while (*Prefixes != ')' && *ActualPrefixes != '\0' && Count < MAXPREFIXES) {
+			m_PrefixModes[Count] = *Prefixes;
+			m_PrefixChars[Count] = *ActualPrefixes;
+
+			if (m_PrefixModeIndex[(unsigned char)*Prefixes] == -1) {
+				m_PrefixModeIndex[(unsigned char)*Prefixes] = Count;
+			}
+
+			if (m_PrefixCharIndex[(unsigned char)*ActualPrefixes] == -1) {
+				m_PrefixCharIndex[(unsigned char)*ActualPrefixes] = Count;
+			}
+
+			Count++;
+			Prefixes++;
+			ActualPrefixes++;
+		}
+	}
+
+	m_PrefixModes[Count] = '\0';
+	m_PrefixChars[Count] = '\0';
+
+	if (Modes == NULL) {
+		Modes = "";
+	}
+
+	for (unsigned int i = 0; i < sizeof(m_ModeTypes); i++) {
+		m_ModeTypes[i] = GetModeType(Modes, (char)i);
+	}
+
+	if (strcmp(OldPrefixChars, m_PrefixChars) == 0 || m_Channels == NULL) {
+		return;
+	}
+
+	int a = 0;
+
+	while (hash_t<CChannel *> *ChannelHash = m_Channels->Iterate(a++)) {
+		int b = 0;
+
+		while (hash_t<CNick *> *NickHash = ChannelHash->Value->GetNames()->Iterate(b++)) {
+			unsigned int OldBits = NickHash->Value->GetPrefixBits();
+			char Old[MAXPREFIXES + 1];
+			unsigned int Length = 0;
+
+			for (unsigned int i = 0; OldPrefixChars[i] != '\0'; i++) {
+				if (OldBits & (1U << i)) {
+					Old[Length++] = OldPrefixChars[i];
+				}
+			}
+
+			Old[Length] = '\0';
+
+			NickHash->Value->SetPrefixes(Old);
+		}
+	}
 }
 
 /**
@@ -1031,23 +1498,7 @@ bool CIRCConnection::IsChanMode(char Mode) const {
  * @param Mode the channel mode
  */
 int CIRCConnection::RequiresParameter(char Mode) const {
-	int ReturnValue = 3;
-	const char *Modes = GetISupport("CHANMODES");
-	size_t Len = strlen(Modes);
-
-	for (size_t i = 0; i < Len; i++) {
-		if (Modes[i] == Mode) {
-			return ReturnValue;
-		} else if (Modes[i] == ',') {
-			ReturnValue--;
-		}
-
-		if (ReturnValue == 0) {
-			return 0;
-		}
-	}
-
-	return ReturnValue;
+	return m_ModeTypes[(unsigned char)Mode];
 }
 
 /**
@@ -1069,24 +1520,7 @@ CChannel *CIRCConnection::GetChannel(const char *Name) {
  * @param Char the nick prefix
  */
 bool CIRCConnection::IsNickPrefix(char Char) const {
-	const char *Prefixes = GetISupport("PREFIX");
-	bool flip = false;
-
-	if (Prefixes == NULL) {
-		return false;
-	}
-
-	for (size_t i = 0; i < strlen(Prefixes); i++) {
-		if (flip) {
-			if (Prefixes[i] == Char) {
-				return true;
-			}
-		} else if (Prefixes[i] == ')') {
-			flip = true;
-		}
-	}
-
-	return false;
+	return m_PrefixCharIndex[(unsigned char)Char] != -1;
 }
 
 /**
@@ -1098,17 +1532,7 @@ bool CIRCConnection::IsNickPrefix(char Char) const {
  * @param Char the channelmode
  */
 bool CIRCConnection::IsNickMode(char Char) const {
-	const char *Prefixes = GetISupport("PREFIX");
-
-	while (*Prefixes != '\0' && *Prefixes != ')') {
-		if (*Prefixes == Char && *Prefixes != '(') {
-			return true;
-		} else {
-			Prefixes++;
-		}
-	}
-
-	return false;
+	return m_PrefixModeIndex[(unsigned char)Char] != -1;
 }
 
 /**
@@ -1119,27 +1543,13 @@ bool CIRCConnection::IsNickMode(char Char) const {
  * @param Mode the mode character
  */
 char CIRCConnection::PrefixForChanMode(char Mode) const {
-	const char *Prefixes = GetISupport("PREFIX");
-	const char *ActualPrefixes = strchr(Prefixes, ')');
-
-	Prefixes++;
+	int Index = m_PrefixModeIndex[(unsigned char)Mode];
 
-	if (ActualPrefixes != NULL) {
-		ActualPrefixes++;
-	} else {
+	if (Index == -1) {
 		return '\0';
 	}
 
-	while (*ActualPrefixes != '\0') {
-		if (*Prefixes == Mode) {
-			return *ActualPrefixes;
-		}
-
-		Prefixes++;
-		ActualPrefixes++;
-	}
-
-	return '\0';
+	return m_PrefixChars[Index];
 }
 
 /**
@@ -1169,6 +1579,124 @@ const CHashtable<char *, false> *CIRCConnection::GetISupportAll(void) const {
 	return m_ISupport;
 }
 
+/**
+ * DestroyNickData
+ *
+ * Frees a nick record.
+ *
+ * @param NickData the nick record
+ */
+static void DestroyNickData(nickdata_t *NickData) {
+	free(NickData->Nick);
+	free(NickData->Site);
+	free(NickData->Realname);
+	free(NickData->Server);
+
+	for (int i = 0; i < NickData->Tags.GetLength(); i++) {
+		free(NickData->Tags[i].Name);
+		free(NickData->Tags[i].Value);
+	}
+
+	delete NickData;
+}
+
+/**
+ * AcquireNickData
+ *
+ * Returns the record for the specified nick and increases its reference
+ * count. A new record is created if necessary. NULL is returned if the
+ * record could not be created.
+ *
+ * @param Nick the nick
+ */
+nickdata_t *CIRCConnection::AcquireNickData(const char *Nick) {
+	nickdata_t *NickData = m_Nicks.Get(Nick);
+
+	if (NickData == NULL) {
+		NickData = new nickdata_t;
+
+		if (AllocFailed(NickData)) {
+			return NULL;
+		}
+
+		NickData->Nick = strdup(Nick);
+		NickData->Site = NULL;
+		NickData->Realname = NULL;
+		NickData->Server = NULL;
+		NickData->RefCount = 0;
+
+		if (AllocFailed(NickData->Nick)) {
+			DestroyNickData(NickData);
+
+			return NULL;
+		}
+
+		if (IsError(m_Nicks.Add(Nick, NickData))) {
+			DestroyNickData(NickData);
+
+			return NULL;
+		}
+	}
+
+	NickData->RefCount++;
+
+	return NickData;
+}
+
+/**
+ * ReleaseNickData
+ *
+ * Decreases the reference count of a nick record and removes the record
+ * once it is no longer used.
+ *
+ * @param NickData the nick record
+ */
+void CIRCConnection::ReleaseNickData(nickdata_t *NickData) {
+	NickData->RefCount--;
+
+	if (NickData->RefCount > 0) {
+		return;
+	}
+
+	if (m_Nicks.Get(NickData->Nick) == NickData) {
+		m_Nicks.Remove(NickData->Nick);
+	} else {
+		DestroyNickData(NickData);
+	}
+}
+
+/**
+ * RenameNickData
+ *
+ * Changes the nick of a nick record.
+ *
+ * @param NickData the nick record
+ * @param NewNick the new nick
+ */
+bool CIRCConnection::RenameNickData(nickdata_t *NickData, const char *NewNick) {
+	char *Copy = strdup(NewNick);
+
+	if (AllocFailed(Copy)) {
+		return false;
+	}
+
+	if (m_Nicks.Get(NickData->Nick) == NickData) {
+		m_Nicks.Remove(NickData->Nick, true);
+	}
+
+	free(NickData->Nick);
+	NickData->Nick = Copy;
+
+	// a stale record for the new nick is destroyed once it is no longer used
+	m_Nicks.Remove(NewNick, true);
+
+	if (IsError(m_Nicks.Add(NewNick, NickData))) {
+		return false;
+	}
+
+	return true;
+}
+
 /**
  * UpdateWhoHelper
  *
@@ -1179,23 +1707,17 @@ const CHashtable<char *, false> *CIRCConnection::GetISupportAll(void) const {
  * @param Server the servername for the user
  */
 void CIRCConnection::UpdateWhoHelper(const char *Nick, const char *Realname, const char *Server) {
-	int a = 0;
+	nickdata_t *NickData;
 
 	if (GetOwner()->GetLeanMode() > 0) {
 		return;
 	}
 
-	while (hash_t<CChannel *> *Chan = m_Channels->Iterate(a++)) {
-		if (!Chan->Value->HasNames()) {
-			return;
-		}
-
-		CNick *NickObj = Chan->Value->GetNames()->Get(Nick);
+	NickData = m_Nicks.Get(Nick);
 
-		if (NickObj) {
-			NickObj->SetRealname(Realname);
-			NickObj->SetServer(Server);
-		}
+	if (NickData != NULL && NickData->Memberships.GetLength() > 0) {
+		NickData->Memberships[0]->SetRealname(Realname);
+		NickData->Memberships[0]->SetServer(Server);
 	}
 }
 
@@ -1210,6 +1732,7 @@ void CIRCConnection::UpdateHostHelper(const char *Host) {
 	const char *NickEnd;
 	size_t Offset;
 	char *Copy;
+	nickdata_t *NickData;
 
 	if (GetOwner() != NULL && GetOwner()->GetLeanMode() > 0 && m_Site != NULL) {
 		return;
@@ -1248,18 +1771,10 @@ void CIRCConnection::UpdateHostHelper(const char *Host) {
 		return;
 	}
 
-	int i = 0;
-
-	while (hash_t<CChannel *> *Chan = m_Channels->Iterate(i++)) {
-		if (!Chan->Value || !Chan->Value->HasNames()) {
-			continue;
-		}
-
-		CNick *NickObj = Chan->Value->GetNames()->Get(Nick);
+	NickData = m_Nicks.Get(Nick);
 
-		if (NickObj && NickObj->GetSite() == NULL) {
-			NickObj->SetSite(Site);
-		}
+	if (NickData != NULL && NickData->Memberships.GetLength() > 0 && NickData->Site == NULL) {
+		NickData->Memberships[0]->SetSite(Site);
 	}
 
 	free(Copy);
@@ -1574,24 +2089,89 @@ void CIRCConnection::Kill(const char *Error) {
  */
 /* TODO: check comment, does it actually make sense (is it really @, +?) */
 char CIRCConnection::GetHighestUserFlag(const char *Modes) const {
-	bool Flip = false;
-	const char *Prefixes = GetISupport("PREFIX");
-
-	if (Modes == NULL || Prefixes == NULL) {
+	if (Modes == NULL) {
 		return '\0';
 	}
 
-	for (size_t i = 0; i < strlen(Prefixes); i++) {
-		if (Flip == false) {
-			if (Prefixes[i] == ')') {
-				Flip = true;
-			}
+	return GetHighestPrefix(ParsePrefixes(Modes));
+}
+
+/**
+ * GetPrefixBit
+ *
+ * Returns the bit which represents a nick prefix in a prefix
+ * bitmask, or 0 if the character is not a nick prefix.
+ *
+ * @param Prefix the prefix (e.g. @, +)
+ */
+unsigned int CIRCConnection::GetPrefixBit(char Prefix) const {
+	int Index = m_PrefixCharIndex[(unsigned char)Prefix];
+
+	if (Index == -1) {
+		return 0;
+	}
+
+	return 1U << Index;
+}
+
+/**
+ * ParsePrefixes
+ *
+ * Converts a string of nick prefixes into a prefix bitmask. Unknown
+ * prefixes are ignored.
+ *
+ * @param Prefixes the prefixes (e.g. @+)
+ */
+unsigned int CIRCConnection::ParsePrefixes(const char *Prefixes) const {
+	unsigned int Bits = 0;
+
+	if (Prefixes == NULL) {
+		return 0;
+	}
+
+	while (*Prefixes != '\0') {
+		Bits |= GetPrefixBit(*Prefixes);
+		Prefixes++;
+	}
+
+	return Bits;
+}
+
+/**
+ * FormatPrefixes
+ *
+ * Converts a prefix bitmask into a string, highest prefix first.
+ *
+ * @param Prefixes the prefix bitmask
+ * @param Buffer a buffer of at least MAXPREFIXES + 1 bytes which
+ *               receives the string
+ */
+const char *CIRCConnection::FormatPrefixes(unsigned int Prefixes, char *Buffer) const {
+	unsigned int Length = 0;
 
-			continue;
+	for (unsigned int i = 0; m_PrefixChars[i] != '\0'; i++) {
+		if (Prefixes & (1U << i)) {
+			Buffer[Length++] = m_PrefixChars[i];
 		}
+	}
+
+	Buffer[Length] = '\0';
+
+	return Buffer;
+}
 
-		if (strchr(Modes, Prefixes[i]) != NULL) {
-			return Prefixes[i];
+/**
+ * GetHighestPrefix
+ *
+ * Returns the highest prefix in a prefix bitmask, or 0 if the
+ * bitmask is empty.
+ *
+ * @param Prefixes the prefix bitmask
+ */
+char CIRCConnection::GetHighestPrefix(unsigned int Prefixes) const {
+	for (unsigned int i = 0; m_PrefixChars[i] != '\0'; i++) {
+		if (Prefixes & (1U << i)) {
+			return m_PrefixChars[i];
 		}
 	}
 
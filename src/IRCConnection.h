@@ -37,6 +37,13 @@ class CChannel;
 class CQueue;
 class CFloodControl;
 class CTimer;
+struct nickdata_s;
+
+/**
+ * The maximum number of nick prefixes (e.g. @, +) which are tracked
+ * for channel members.
+ */
+#define MAXPREFIXES 32
 
 #ifdef SWIGINTERFACE
 %template(COwnedObjectCUser) COwnedObject<class CUser>;
@@ -69,11 +76,21 @@ private:
 	char *m_Usermodes; /**< the usermodes */
 
 	CHashtable<CChannel *, false> *m_Channels; /**< the channels this IRC user is on */
+	CVector<CChannel *> m_SortedChannels; /**< the channels, sorted by m_SortFunction */
+	bool m_SortedChannelsValid; /**< whether m_SortedChannels is up to date */
+	int (*m_SortFunction)(const void *p1, const void *p2); /**< the sort function for m_SortedChannels */
+	CHashtable<struct nickdata_s *, false> m_Nicks; /**< the users who share a
+													  channel with this IRC user */
 
 	char *m_ServerVersion; /**< the version from the 351 reply */
 	char *m_ServerFeat; /**< the server features from the 351 reply */
 
 	CHashtable<char *, false> *m_ISupport; /**< the key/value pairs from the 005 replies */
+	char m_PrefixModes[MAXPREFIXES + 1]; /**< nick modes from the PREFIX feature, highest first */
+	char m_PrefixChars[MAXPREFIXES + 1]; /**< the prefixes for m_PrefixModes */
+	signed char m_PrefixModeIndex[256]; /**< prefix bit for each nick mode, or -1 */
+	signed char m_PrefixCharIndex[256]; /**< prefix bit for each prefix, or -1 */
+	unsigned char m_ModeTypes[256]; /**< RequiresParameter() for each channel mode */
 	
 	CTimer *m_DelayJoinTimer; /**< timer for delay-joining channels */
 	CTimer *m_PingTimer; /**< timer for sending regular PINGs to the server */
@@ -88,10 +105,13 @@ private:
 
 	bool m_EatPong; /**< whether to ignore the next PONG event from the IRC server */
 
+	char *m_IdentKey; /**< the key in the ident index, NULL if the connection is not indexed yet */
+
 	CChannel *AddChannel(const char *Channel);
 	void RemoveChannel(const char *Channel);
 
 	void UpdateChannelConfig(void);
+	void UpdateModeTables(void);
 	void UpdateHostHelper(const char *Host);
 	void UpdateWhoHelper(const char *Nick, const char *Realname, const char *Server);
 
@@ -117,6 +137,15 @@ public:
 
 	CChannel *GetChannel(const char *Name);
 	CHashtable<CChannel *, false> *GetChannels(void);
+#ifndef SWIG
+	const CVector<CChannel *> *GetSortedChannels(int (*SortFunction)(const void *p1, const void *p2));
+#endif /* SWIG */
+
+#ifndef SWIG
+	struct nickdata_s *AcquireNickData(const char *Nick);
+	void ReleaseNickData(struct nickdata_s *NickData);
+	bool RenameNickData(struct nickdata_s *NickData, const char *NewNick);
+#endif /* SWIG */
 
 	const char *GetCurrentNick(void) const;
 	const char *GetSite(void) /* const */;
@@ -141,6 +170,13 @@ public:
 	char PrefixForChanMode(char Mode) const;
 	char GetHighestUserFlag(const char *Modes) const;
 
+#ifndef SWIG
+	unsigned int GetPrefixBit(char Prefix) const;
+	unsigned int ParsePrefixes(const char *Prefixes) const;
+	const char *FormatPrefixes(unsigned int Prefixes, char *Buffer) const;
+	char GetHighestPrefix(unsigned int Prefixes) const;
+#endif /* SWIG */
+
 	void ParseLine(const char *Line);
 
 	void JoinChannels(void);
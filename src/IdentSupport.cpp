@@ -19,6 +19,59 @@
 
 #include "StdAfx.h"
 
+#define IDENTKEYLEN 64 /**< enough for two ports and an IPv6 address in hex */
+
+/**
+ * AddressPort
+ *
+ * Returns the port of an address in host byte order.
+ *
+ * @param Address the address
+ */
+static unsigned short AddressPort(const sockaddr *Address) {
+	if (Address->sa_family == AF_INET) {
+		return ntohs(((const sockaddr_in *)Address)->sin_port);
+	} else {
+		return ntohs(((const sockaddr_in6 *)Address)->sin6_port);
+	}
+}
+
+/**
+ * FormatIdentKey
+ *
+ * Builds the key which is used for looking up IRC connections.
+ *
+ * @param Buffer the buffer for the key, at least IDENTKEYLEN bytes
+ * @param LocalPort the local port
+ * @param RemotePort the remote port
+ * @param RemoteAddress the remote address, or NULL if only the ports
+ *                      should be used
+ */
+static void FormatIdentKey(char *Buffer, unsigned short LocalPort, unsigned short RemotePort, const sockaddr *RemoteAddress) {
+	const unsigned char *Address;
+	size_t Length, Offset;
+
+	Offset = snprintf(Buffer, IDENTKEYLEN, "%u,%u", LocalPort, RemotePort);
+
+	if (RemoteAddress == NULL) {
+		return;
+	}
+
+	if (RemoteAddress->sa_family == AF_INET) {
+		Address = (const unsigned char *)&(((const sockaddr_in *)RemoteAddress)->sin_addr);
+	} else {
+		Address = (const unsigned char *)&(((const sockaddr_in6 *)RemoteAddress)->sin6_addr);
+	}
+
+	Length = INADDR_LEN(RemoteAddress->sa_family);
+
+	Buffer[Offset++] = ',';
+
+	for (size_t i = 0; i < Length; i++) {
+		Offset += snprintf(Buffer + Offset, IDENTKEYLEN - Offset, "%02x", Address[i]);
+	}
+}
+
 /**
  * CIdentSupport
  *
@@ -118,3 +171,120 @@ void CIdentSupport::SetIdent(const char *Ident) {
 const char *CIdentSupport::GetIdent(void) const {
 	return m_Ident;
 }
+
+/**
+ * RegisterConnection
+ *
+ * Adds an IRC connection to the index. This only succeeds once the
+ * connection has been established. Returns the key which has to be
+ * passed to UnregisterConnection() (and free()'d by the caller), or
+ * NULL if the connection could not be added.
+ *
+ * @param Connection the IRC connection
+ */
+char *CIdentSupport::RegisterConnection(CIRCConnection *Connection) {
+	char Key[IDENTKEYLEN], PortKey[IDENTKEYLEN];
+	sockaddr *LocalAddress, *RemoteAddress;
+	unsigned short LocalPort, RemotePort;
+	char *Result;
+
+	LocalAddress = Connection->GetLocalAddress();
+
+	if (LocalAddress == NULL) {
+		return NULL;
+	}
+
+	LocalPort = AddressPort(LocalAddress);
+
+	RemoteAddress = Connection->GetRemoteAddress();
+
+	if (RemoteAddress == NULL) {
+		return NULL;
+	}
+
+	RemotePort = AddressPort(RemoteAddress);
+
+	FormatIdentKey(Key, LocalPort, RemotePort, RemoteAddress);
+	FormatIdentKey(PortKey, LocalPort, RemotePort, NULL);
+
+	Result = strdup(Key);
+
+	if (AllocFailed(Result)) {
+		return NULL;
+	}
+
+	if (IsError(m_Connections.Add(Key, Connection))) {
+		free(Result);
+
+		return NULL;
+	}
+
+	m_Ports.Add(PortKey, Connection);
+
+	return Result;
+}
+
+/**
+ * UnregisterConnection
+ *
+ * Removes an IRC connection from the index.
+ *
+ * @param Connection the IRC connection
+ * @param Key the key which was returned by RegisterConnection()
+ */
+void CIdentSupport::UnregisterConnection(CIRCConnection *Connection, const char *Key) {
+	char PortKey[IDENTKEYLEN];
+	const char *Separator;
+
+	if (m_Connections.Get(Key) == Connection) {
+		m_Connections.Remove(Key);
+	}
+
+	// the ports are followed by the address
+	Separator = strchr(Key, ',');
+
+	if (Separator != NULL) {
+		Separator = strchr(Separator + 1, ',');
+	}
+
+	if (Separator == NULL) {
+		return;
+	}
+
+	snprintf(PortKey, sizeof(PortKey), "%.*s", (int)(Separator - Key), Key);
+
+	if (m_Ports.Get(PortKey) == Connection) {
+		m_Ports.Remove(PortKey);
+	}
+}
+
+/**
+ * FindConnection
+ *
+ * Returns the IRC connection for an ident request or NULL if there is no
+ * such connection. Connections are matched by their ports only if the
+ * remote address does not match (e.g. because the IRC server sent the
+ * ident request from another address).
+ *
+ * @param LocalPort the local port of the IRC connection
+ * @param RemotePort the remote port of the IRC connection
+ * @param RemoteAddress the address of the ident client, can be NULL
+ */
+CIRCConnection *CIdentSupport::FindConnection(unsigned short LocalPort, unsigned short RemotePort, const sockaddr *RemoteAddress) const {
+	char Key[IDENTKEYLEN];
+	CIRCConnection *Connection;
+
+	if (RemoteAddress != NULL) {
+		FormatIdentKey(Key, LocalPort, RemotePort, RemoteAddress);
+
+		Connection = m_Connections.Get(Key);
+
+		if (Connection != NULL) {
+			return Connection;
+		}
+	}
+
+	FormatIdentKey(Key, LocalPort, RemotePort, NULL);
+
+	return m_Ports.Get(Key);
+}
@@ -20,13 +20,19 @@
 #ifndef IDENTSUPPORT_H
 #define IDENTSUPPORT_H
 
+class CIRCConnection;
+
 /**
  * CIdentSupport
  *
- * Used for "communicating" with ident daemons.
+ * Used for "communicating" with ident daemons. Also keeps an index of
+ * the IRC connections so that ident daemons which run as modules can
+ * answer requests without looking at every user.
  */
 class SBNCAPI CIdentSupport {
 	char *m_Ident; /**< the ident */
+	CHashtable<CIRCConnection *, true> m_Connections; /**< IRC connections by local port, remote port and remote address */
+	CHashtable<CIRCConnection *, true> m_Ports; /**< IRC connections by local and remote port */
 public:
 #ifndef SWIG
 	CIdentSupport(void);
@@ -35,6 +41,10 @@ public:
 
 	void SetIdent(const char *Ident);
 	const char *GetIdent(void) const;
+
+	char *RegisterConnection(CIRCConnection *Connection);
+	void UnregisterConnection(CIRCConnection *Connection, const char *Key);
+	CIRCConnection *FindConnection(unsigned short LocalPort, unsigned short RemotePort, const sockaddr *RemoteAddress) const;
 };
 
 #endif /* IDENTSUPPORT_H */
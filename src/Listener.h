@@ -25,22 +25,57 @@
  *
  * Implements a generic socket listener.
  */
+#define LISTENERBATCHSIZE 32 /**< the maximum number of clients which are accepted at once */
+
 template<typename InheritedClass>
 class CListenerBase : public CSocketEvents {
 private:
 	SOCKET m_Listener; /**< the listening socket */
+	bool *m_Destroyed; /**< set when the listener is destroyed while accepting clients */
 
 	virtual int Read(bool DontProcess) {
 		sockaddr_storage PeerAddress;
-		socklen_t PeerSize = sizeof(PeerAddress);
+		socklen_t PeerSize;
 		SOCKET Client;
+		bool Destroyed = false;
+
+		m_Destroyed = &Destroyed;
+
+		// drain the backlog, but give other sockets a chance after a while
+		for (int i = 0; i < LISTENERBATCHSIZE; i++) {
+			PeerSize = sizeof(PeerAddress);
+
+#ifdef HAVE_ACCEPT4
+			Client = accept4(m_Listener, (sockaddr *)&PeerAddress, &PeerSize, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else /* HAVE_ACCEPT4 */
+			Client = accept(m_Listener, (sockaddr *)&PeerAddress, &PeerSize);
 
-		Client = accept(m_Listener, (sockaddr *)&PeerAddress, &PeerSize);
+			if (Client != INVALID_SOCKET) {
+				unsigned long lTrue = 1;
+
+				ioctlsocket(Client, FIONBIO, &lTrue);
+			}
+#endif /* HAVE_ACCEPT4 */
+
+			if (Client == INVALID_SOCKET) {
+				break;
+			}
+
+			if (!Admit((sockaddr *)&PeerAddress)) {
+				Refuse(Client);
+
+				continue;
+			}
 
-		if (Client != INVALID_SOCKET) {
 			Accept(Client, (sockaddr *)&PeerAddress);
+
+			if (Destroyed) {
+				return 0;
+			}
 		}
 
+		m_Destroyed = NULL;
+
 		return 0;
 	}
 
@@ -54,6 +89,29 @@ private:
 protected:
 	virtual void Accept(SOCKET Client, const sockaddr *PeerAddress) = 0;
 
+	/**
+	 * Admit
+	 *
+	 * Decides whether a new client is accepted. Rejected clients are
+	 * disconnected before Accept() is called.
+	 *
+	 * @param PeerAddress the remote address of the client
+	 */
+	virtual bool Admit(const sockaddr *PeerAddress) {
+		return true;
+	}
+
+	/**
+	 * Refuse
+	 *
+	 * Disconnects a client which was rejected by Admit().
+	 *
+	 * @param Client the client socket
+	 */
+	virtual void Refuse(SOCKET Client) {
+		closesocket(Client);
+	}
+
 public:
 	/**
 	 * CListenerBase
@@ -66,6 +124,7 @@ public:
 	 */
 	CListenerBase(unsigned int Port, const char *BindIp = NULL, int Family = AF_INET) {
 		m_Listener = INVALID_SOCKET;
+		m_Destroyed = NULL;
 
 		if (m_Listener == INVALID_SOCKET) {
 			m_Listener = g_Bouncer->CreateListener(Port, BindIp, Family);
@@ -89,6 +148,10 @@ public:
 		if (m_Listener != INVALID_SOCKET) {
 			closesocket(m_Listener);
 		}
+
+		if (m_Destroyed != NULL) {
+			*m_Destroyed = true;
+		}
 	}
 
 	/**
@@ -181,14 +244,43 @@ public:
 	 */
 	virtual void Accept(SOCKET Client, const sockaddr *PeerAddress) {
 		CClientConnection *ClientObject;
-		unsigned long lTrue = 1;
-
-		ioctlsocket(Client, FIONBIO, &lTrue);
 
 		// destruction is controlled by the main loop
 		ClientObject = new CClientConnection(Client, m_SSL);
 	}
 
+	/**
+	 * Admit
+	 *
+	 * Checks the client's address against the bouncer's admission
+	 * limits before any DNS lookups are done for it.
+	 *
+	 * @param PeerAddress the remote address of the client
+	 */
+	virtual bool Admit(const sockaddr *PeerAddress) {
+		return g_Bouncer->GetAdmission()->Admit(PeerAddress);
+	}
+
+	/**
+	 * Refuse
+	 *
+	 * Tells a rejected client why it is disconnected (unless it expects
+	 * an SSL handshake) and closes the socket.
+	 *
+	 * @param Client the client socket
+	 */
+	virtual void Refuse(SOCKET Client) {
+		static const char Message[] = "ERROR :Closing Link: Too many connections or failed logins from your address.\r\n";
+
+		if (!m_SSL) {
+			// the socket is non-blocking and the message is small enough for
+			// the socket buffer, so there is no need to queue it
+			send(Client, Message, sizeof(Message) - 1, 0);
+		}
+
+		closesocket(Client);
+	}
+
 	/**
 	 * SetSSL
 	 *
@@ -19,6 +19,57 @@
 
 #include "StdAfx.h"
 
+static CLog *g_OpenLogsHead = NULL; /**< the most recently used open log */
+static CLog *g_OpenLogsTail = NULL; /**< the least recently used open log */
+static unsigned int g_OpenLogCount = 0; /**< the number of open logs */
+static CTimer *g_LogFlushTimer = NULL; /**< used for flushing the logs */
+static time_t g_LogTimestampTime = 0; /**< the time for g_LogTimestamp */
+static char g_LogTimestamp[100]; /**< the formatted timestamp */
+
+/**
+ * LogFlushTimer
+ *
+ * Writes buffered log entries to disk.
+ *
+ * @param Now the current time
+ * @param Cookie not used
+ */
+bool LogFlushTimer(time_t Now, void *Cookie) {
+	g_LogFlushTimer = NULL;
+
+	for (CLog *Log = g_OpenLogsHead; Log != NULL; Log = Log->m_NextOpen) {
+		Log->Flush();
+	}
+
+	return false;
+}
+
+/**
+ * WriteScrubbedLine
+ *
+ * Writes a line to a file and leaves out any line breaks.
+ *
+ * @param File the file
+ * @param Line the line
+ */
+static void WriteScrubbedLine(FILE *File, const char *Line) {
+	size_t Length;
+
+	while (*Line != '\0') {
+		Length = strcspn(Line, "\r\n");
+
+		fwrite(Line, 1, Length, File);
+
+		Line += Length;
+
+		if (*Line != '\0') {
+			Line++;
+		}
+	}
+
+	fputc('\n', File);
+}
+
 /**
  * CLog
  *
@@ -27,8 +78,9 @@
  * @param Filename the filename of the log, can be NULL to indicate that
  *                 any log messages should be discarded
  * @param KeepOpen whether to keep the file open
+ * @param Echo whether log entries should also be written to stdout
  */
-CLog::CLog(const char *Filename, bool KeepOpen) {
+CLog::CLog(const char *Filename, bool KeepOpen, bool Echo) {
 	if (Filename != NULL) {
 		m_Filename = strdup(Filename);
 
@@ -38,7 +90,12 @@ CLog::CLog(const char *Filename, bool KeepOpen) {
 	}
 
 	m_KeepOpen = KeepOpen;
+	m_Echo = Echo;
 	m_File = NULL;
+	m_Dirty = false;
+	m_LastCheck = 0;
+	m_PreviousOpen = NULL;
+	m_NextOpen = NULL;
 
 #ifndef _WIN32
 	m_Inode = 0;
@@ -52,11 +109,166 @@ CLog::CLog(const char *Filename, bool KeepOpen) {
  * Destructs a log object.
  */
 CLog::~CLog(void) {
+	Close();
+
 	free(m_Filename);
+}
+
+/**
+ * Open
+ *
+ * Opens the log file unless it is already open. The least recently used
+ * log is closed if too many logs are open.
+ */
+bool CLog::Open(void) {
+#ifndef _WIN32
+	struct stat StatBuf;
+#endif
 
 	if (m_File != NULL) {
-		fclose(m_File);
+		Touch();
+
+		return true;
+	}
+
+	if (m_Filename == NULL) {
+		return false;
+	}
+
+	if (g_OpenLogCount >= LOGMAXOPENFILES) {
+		for (CLog *Log = g_OpenLogsTail; Log != NULL; Log = Log->m_PreviousOpen) {
+			if (!Log->m_KeepOpen) {
+				Log->Close();
+
+				break;
+			}
+		}
+	}
+
+	m_File = fopen(m_Filename, "a");
+
+	if (m_File == NULL) {
+		return false;
+	}
+
+	SetPermissions(m_Filename, S_IRUSR | S_IWUSR);
+
+#ifndef _WIN32
+	if (fstat(fileno(m_File), &StatBuf) == 0) {
+		m_Inode = StatBuf.st_ino;
+		m_Dev = StatBuf.st_dev;
+	}
+#endif
+
+	m_LastCheck = g_CurrentTime;
+
+	m_PreviousOpen = NULL;
+	m_NextOpen = g_OpenLogsHead;
+
+	if (g_OpenLogsHead != NULL) {
+		g_OpenLogsHead->m_PreviousOpen = this;
+	} else {
+		g_OpenLogsTail = this;
+	}
+
+	g_OpenLogsHead = this;
+	g_OpenLogCount++;
+
+	return true;
+}
+
+/**
+ * Close
+ *
+ * Writes buffered log entries to disk and closes the log file.
+ */
+void CLog::Close(void) {
+	if (m_File == NULL) {
+		return;
+	}
+
+	Unlink();
+
+	fclose(m_File);
+	m_File = NULL;
+	m_Dirty = false;
+}
+
+/**
+ * Flush
+ *
+ * Writes buffered log entries to disk.
+ */
+void CLog::Flush(void) const {
+	if (m_File != NULL && m_Dirty) {
+		fflush(m_File);
+		m_Dirty = false;
+	}
+}
+
+/**
+ * Touch
+ *
+ * Marks the log as the most recently used open log.
+ */
+void CLog::Touch(void) {
+	if (g_OpenLogsHead == this) {
+		return;
 	}
+
+	Unlink();
+
+	m_NextOpen = g_OpenLogsHead;
+	g_OpenLogsHead->m_PreviousOpen = this;
+	g_OpenLogsHead = this;
+	g_OpenLogCount++;
+}
+
+/**
+ * Unlink
+ *
+ * Removes the log from the list of open logs.
+ */
+void CLog::Unlink(void) {
+	if (m_PreviousOpen != NULL) {
+		m_PreviousOpen->m_NextOpen = m_NextOpen;
+	} else {
+		g_OpenLogsHead = m_NextOpen;
+	}
+
+	if (m_NextOpen != NULL) {
+		m_NextOpen->m_PreviousOpen = m_PreviousOpen;
+	} else {
+		g_OpenLogsTail = m_PreviousOpen;
+	}
+
+	m_PreviousOpen = NULL;
+	m_NextOpen = NULL;
+
+	g_OpenLogCount--;
+}
+
+/**
+ * CheckRotated
+ *
+ * Closes the log file if it has been moved or deleted (e.g. by logrotate)
+ * so that a new file is created. This is checked at most once every
+ * LOGROTATECHECK seconds.
+ */
+void CLog::CheckRotated(void) {
+#ifndef _WIN32
+	struct stat StatBuf;
+
+	if (m_File == NULL || (g_CurrentTime >= m_LastCheck && g_CurrentTime - m_LastCheck < LOGROTATECHECK)) {
+		return;
+	}
+
+	m_LastCheck = g_CurrentTime;
+
+	if (lstat(m_Filename, &StatBuf) < 0 || StatBuf.st_ino != m_Inode || StatBuf.st_dev != m_Dev) {
+		Close();
+	}
+#endif
 }
 
 /**
@@ -77,9 +289,7 @@ void CLog::PlayToUser(CClientConnection *Client, LogType Type) const {
 	const char *Nick = NULL;
 	const char *Server = NULL;
 
-	if (m_File != NULL) {
-		fclose(m_File);
-	}
+	Flush();
 
 	if (m_Filename != NULL && (LogFile = fopen(m_Filename, "r")) != NULL) {
 		char Line[500];
@@ -122,7 +332,6 @@ void CLog::PlayToUser(CClientConnection *Client, LogType Type) const {
 		}
 
 		fclose(LogFile);
-		m_File = NULL;
 	}
 
 	if (Type == Log_Motd && Client != NULL && Nick != NULL && Server != NULL) {
@@ -138,93 +347,46 @@ void CLog::PlayToUser(CClientConnection *Client, LogType Type) const {
  * @param Line the log entry
  */
 void CLog::WriteUnformattedLine(const char *Line) {
-	char *Out = NULL, *dupLine;
-	size_t StringLength;
-	unsigned int a;
 	tm Now;
-	char strNow[100];
-	FILE *LogFile;
-#ifndef _WIN32
-	struct stat StatBuf;
-#endif
-	int rc;
 
 	if (Line == NULL) {
 		return;
 	}
 
-	LogFile = m_File;
-
-#ifndef _WIN32
-	if (m_Filename != NULL) {
-		rc = lstat(m_Filename, &StatBuf);
-
-		if (m_File != NULL && (rc < 0 || StatBuf.st_ino != m_Inode || StatBuf.st_dev != m_Dev)) {
-			fclose(m_File);
-			m_File = NULL;
-		}
-
-		if (rc == 0) {
-			m_Inode = StatBuf.st_ino;
-			m_Dev = StatBuf.st_dev;
-		}
-	}
-#endif
+	CheckRotated();
 
-	if (m_Filename == NULL || (m_File == NULL && (LogFile = fopen(m_Filename, "a")) == NULL)) {
+	if (!Open()) {
 		return;
 	}
 
-	SetPermissions(m_Filename, S_IRUSR | S_IWUSR);
-
-	Now = *localtime(&g_CurrentTime);
+	if (g_LogTimestampTime != g_CurrentTime) {
+		Now = *localtime(&g_CurrentTime);
 
 #ifdef _WIN32
-	strftime(strNow, sizeof(strNow), "%#c" , &Now);
+		strftime(g_LogTimestamp, sizeof(g_LogTimestamp), "%#c" , &Now);
 #else
-	strftime(strNow, sizeof(strNow), "%a %B %d %Y %H:%M:%S" , &Now);
+		strftime(g_LogTimestamp, sizeof(g_LogTimestamp), "%a %B %d %Y %H:%M:%S" , &Now);
 #endif
 
-	dupLine = strdup(Line);
-
-	if (AllocFailed(dupLine)) {
-		return;
+		g_LogTimestampTime = g_CurrentTime;
 	}
 
-	StringLength = strlen(dupLine);
-
-	a = 0;
+	fprintf(m_File, "[%s]: ", g_LogTimestamp);
+	WriteScrubbedLine(m_File, Line);
 
-	for (unsigned int i = 0; i <= StringLength; i++) {
-		if (dupLine[i] == '\r' || dupLine[i] == '\n') {
-			continue;
-		}
-
-		dupLine[a] = dupLine[i];
-		a++;
+	if (m_Echo) {
+		printf("[%s]: ", g_LogTimestamp);
+		WriteScrubbedLine(stdout, Line);
 	}
 
-	rc = asprintf(&Out, "[%s]: %s\n", strNow, dupLine);
+	m_Dirty = true;
 
-	free(dupLine);
+	if (g_LogFlushTimer == NULL) {
+		g_LogFlushTimer = new CTimer(LOGFLUSHINTERVAL, false, LogFlushTimer, NULL);
 
-	if (rc < 0) {
-		perror("asprintf() failed");
-
-		return;
-	}
-
-	fputs(Out, LogFile);
-	printf("%s", Out);
-
-	free(Out);
-
-	if (!m_KeepOpen) {
-		fclose(LogFile);
-	} else {
-		m_File = LogFile;
-
-		fflush(m_File);
+		if (AllocFailed(g_LogFlushTimer)) {
+			Flush();
+		}
 	}
 }
 
@@ -263,18 +425,12 @@ void CLog::WriteLine(const char *Format, ...) {
 void CLog::Clear(void) {
 	FILE *LogFile;
 
-	if (m_File != NULL) {
-		fclose(m_File);
-	}
+	Close();
 
 	if (m_Filename != NULL && (LogFile = fopen(m_Filename, "w")) != NULL) {
 		SetPermissions(m_Filename, S_IRUSR | S_IWUSR);
 
-		if (!m_KeepOpen) {
-			fclose(LogFile);
-		} else {
-			m_File = LogFile;
-		}
+		fclose(LogFile);
 	}
 }
 
@@ -287,7 +443,13 @@ bool CLog::IsEmpty(void) const {
 	char Line[500];
 	FILE *LogFile;
 
-	if (m_Filename == NULL || (LogFile = fopen(m_Filename, "r")) == NULL) {
+	if (m_Filename == NULL) {
+		return true;
+	}
+
+	Flush();
+
+	if ((LogFile = fopen(m_Filename, "r")) == NULL) {
 		return true;
 	}
 
@@ -319,3 +481,23 @@ const char *CLog::GetFilename(void) const {
 		return NULL;
 	}
 }
+
+/**
+ * SetEcho
+ *
+ * Sets whether log entries should also be written to stdout.
+ *
+ * @param Echo a boolean flag
+ */
+void CLog::SetEcho(bool Echo) {
+	m_Echo = Echo;
+}
+
+/**
+ * GetEcho
+ *
+ * Returns whether log entries are also written to stdout.
+ */
+bool CLog::GetEcho(void) const {
+	return m_Echo;
+}
@@ -31,22 +31,47 @@ typedef enum {
 	Log_Motd,
 } LogType;
 
+#define LOGMAXOPENFILES 64 /**< maximum number of log files which are kept
+							     open at the same time */
+#define LOGFLUSHINTERVAL 1 /**< number of seconds after which buffered log
+							    entries are written to disk */
+#define LOGROTATECHECK 5 /**< number of seconds between checks whether a
+						      log file has been moved or deleted */
+
 /**
  * CLog
  *
- * A log file.
+ * A log file. Log entries are buffered and written to disk at most
+ * LOGFLUSHINTERVAL seconds later. Up to LOGMAXOPENFILES log files are kept
+ * open, the least recently used ones are closed first.
  */
 class SBNCAPI CLog {
+#ifndef SWIG
+	friend bool LogFlushTimer(time_t Now, void *Cookie);
+#endif /* SWIG */
+
 	char *m_Filename; /**< the filename of the log, can be an empty string */
 	bool m_KeepOpen; /**< should we keep the file open? */
+	bool m_Echo; /**< whether log entries are also written to stdout */
 	mutable FILE *m_File; /**< the file */
+	mutable bool m_Dirty; /**< whether there are unflushed log entries */
+	time_t m_LastCheck; /**< when we last checked whether the file was rotated */
+	CLog *m_PreviousOpen; /**< the previous (more recently used) open log */
+	CLog *m_NextOpen; /**< the next (less recently used) open log */
 #ifndef _WIN32
 	ino_t m_Inode;
 	dev_t m_Dev;
 #endif
+
+	bool Open(void);
+	void Close(void);
+	void Flush(void) const;
+	void Touch(void);
+	void Unlink(void);
+	void CheckRotated(void);
 public:
 #ifndef SWIG
-	CLog(const char *Filename, bool KeepOpen = false);
+	CLog(const char *Filename, bool KeepOpen = false, bool Echo = false);
 	virtual ~CLog(void);
 #endif /* SWIG */
 
@@ -56,6 +81,9 @@ public:
 	void PlayToUser(CClientConnection *Client, LogType Type) const;
 	bool IsEmpty(void) const;
 	const char *GetFilename(void) const;
+
+	void SetEcho(bool Echo);
+	bool GetEcho(void) const;
 };
 
 #endif /* LOG_H */
@@ -30,6 +30,7 @@ CModule::CModule(const char *Filename) {
 
 	m_Far = NULL;
 	m_Image = NULL;
+	m_Subscription = NULL;
 	m_File = strdup(Filename);
 
 	Result = InternalLoad(g_Bouncer->BuildPathModule(Filename));
@@ -151,6 +152,10 @@ CModuleFar *CModule::GetModule(void) {
 		if (pfGetObject) {
 			m_Far = pfGetObject();
 
+			if (m_Far != NULL) {
+				m_Subscription = m_Far->GetSubscription();
+			}
+
 			return m_Far;
 		} else {
 			return NULL;
@@ -183,10 +188,18 @@ void CModule::Init(CCore *Root) {
 }
 
 bool CModule::InterceptIRCMessage(CIRCConnection *Connection, int argc, const char **argv) {
+	if (m_Subscription != NULL && !m_Subscription->IsSubscribed(Subscription_Server, argc, argv)) {
+		return true;
+	}
+
 	return m_Far->InterceptIRCMessage(Connection, argc, argv);
 }
 
 bool CModule::InterceptClientMessage(CClientConnection *Connection, int argc, const char **argv) {
+	if (m_Subscription != NULL && !m_Subscription->IsSubscribed(Subscription_Client, argc, argv)) {
+		return true;
+	}
+
 	return m_Far->InterceptClientMessage(Connection, argc, argv);
 }
 
@@ -245,3 +258,7 @@ void CModule::UserTagModified(const char *Tag, const char *Value) {
 bool CModule::MainLoop(void) {
 	return m_Far->MainLoop();
 }
+
+const CModuleSubscription *CModule::GetSubscription(void) {
+	return m_Subscription;
+}
@@ -36,6 +36,7 @@ class SBNCAPI CModule : public CModuleFar {
 	char *m_File; /**< the filename of the module */
 	CModuleFar *m_Far; /**< the module's implementation of the CModuleFar class */
 	char *m_Error; /**< the last error */
+	const CModuleSubscription *m_Subscription; /**< the lines the module is interested in */
 
 	bool InternalLoad(const char *Path);
 public:
@@ -76,6 +77,8 @@ public:
 	void UserTagModified(const char *Tag, const char *Value);
 
 	bool MainLoop(void);
+
+	const CModuleSubscription *GetSubscription(void);
 };
 
 #endif /* MODULE_H */
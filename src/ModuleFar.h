@@ -23,6 +23,7 @@
 class CCore;
 class CIRCConnection;
 class CClientConnection;
+class CModuleSubscription;
 
 /**
  * CModuleFar
@@ -214,6 +215,19 @@ struct SBNCAPI CModuleFar {
 	 * Called in every mainloop iteration. Returns "true" if the module had something to do.
 	 */
 	virtual bool MainLoop(void) = 0;
+
+	/**
+	 * GetSubscription
+	 *
+	 * Returns the lines the module wants to see in InterceptIRCMessage and
+	 * InterceptClientMessage, or NULL if the module wants to see every line.
+	 * This is called once when the module is loaded; the module may update
+	 * the subscription later on but it must stay valid until the module is
+	 * destroyed.
+	 */
+	virtual const CModuleSubscription *GetSubscription(void) {
+		return NULL;
+	}
 };
 
 /**
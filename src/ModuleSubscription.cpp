@@ -0,0 +1,122 @@
+/*******************************************************************************
+ * shroudBNC - an object-oriented framework for IRC                            *
+ * Copyright (C) 2005-2007,2010 Gunnar Beutner                                 *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or               *
+ * modify it under the terms of the GNU General Public License                 *
+ * as published by the Free Software Foundation; either version 2              *
+ * of the License, or (at your option) any later version.                      *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU General Public License for more details.                                *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License           *
+ * along with this program; if not, write to the Free Software                 *
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA. *
+ *******************************************************************************/
+
+#include "StdAfx.h"
+
+/**
+ * CModuleSubscription
+ *
+ * Constructs an empty subscription.
+ */
+CModuleSubscription::CModuleSubscription(void) {
+	for (int i = 0; i < Subscription_Count; i++) {
+		m_Everything[i] = 0;
+		m_Tokens[i].RegisterValueDestructor(DestroyObject<int>);
+	}
+}
+
+/**
+ * Subscribe
+ *
+ * Adds a reference to a token.
+ *
+ * @param Type the kind of lines
+ * @param Token the token, NULL or "*" subscribes to every line
+ */
+RESULT<bool> CModuleSubscription::Subscribe(subscription_type_t Type, const char *Token) {
+	int *Count;
+
+	if (Token == NULL || strcmp(Token, "*") == 0) {
+		m_Everything[Type]++;
+
+		RETURN(bool, true);
+	}
+
+	Count = m_Tokens[Type].Get(Token);
+
+	if (Count != NULL) {
+		(*Count)++;
+
+		RETURN(bool, true);
+	}
+
+	Count = new int;
+
+	if (AllocFailed(Count)) {
+		THROW(bool, Generic_OutOfMemory, "new operator failed.");
+	}
+
+	*Count = 1;
+
+	return m_Tokens[Type].Add(Token, Count);
+}
+
+/**
+ * Unsubscribe
+ *
+ * Removes a reference to a token which was previously added
+ * using Subscribe().
+ *
+ * @param Type the kind of lines
+ * @param Token the token, NULL or "*" for every line
+ */
+void CModuleSubscription::Unsubscribe(subscription_type_t Type, const char *Token) {
+	int *Count;
+
+	if (Token == NULL || strcmp(Token, "*") == 0) {
+		if (m_Everything[Type] > 0) {
+			m_Everything[Type]--;
+		}
+
+		return;
+	}
+
+	Count = m_Tokens[Type].Get(Token);
+
+	if (Count != NULL && --(*Count) == 0) {
+		m_Tokens[Type].Remove(Token);
+	}
+}
+
+/**
+ * IsSubscribed
+ *
+ * Checks whether a line should be delivered to the module.
+ *
+ * @param Type the kind of line
+ * @param argc number of tokens
+ * @param argv the tokens
+ */
+bool CModuleSubscription::IsSubscribed(subscription_type_t Type, int argc, const char **argv) const {
+	if (m_Everything[Type] > 0) {
+		return true;
+	}
+
+	if (m_Tokens[Type].GetLength() == 0) {
+		return false;
+	}
+
+	for (int i = 0; i < argc; i++) {
+		if (m_Tokens[Type].Get(argv[i]) != NULL) {
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,56 @@
+/*******************************************************************************
+ * shroudBNC - an object-oriented framework for IRC                            *
+ * Copyright (C) 2005-2007,2010 Gunnar Beutner                                 *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or               *
+ * modify it under the terms of the GNU General Public License                 *
+ * as published by the Free Software Foundation; either version 2              *
+ * of the License, or (at your option) any later version.                      *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU General Public License for more details.                                *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License           *
+ * along with this program; if not, write to the Free Software                 *
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA. *
+ *******************************************************************************/
+
+#ifndef MODULESUBSCRIPTION_H
+#define MODULESUBSCRIPTION_H
+
+/**
+ * subscription_type_e
+ *
+ * The kinds of lines a module can subscribe to.
+ */
+typedef enum subscription_type_e {
+	Subscription_Server, /**< lines from IRC servers (InterceptIRCMessage) */
+	Subscription_Client, /**< lines from clients (InterceptClientMessage) */
+	Subscription_Count /**< the number of subscription types */
+} subscription_type_t;
+
+/**
+ * CModuleSubscription
+ *
+ * The set of tokens (usually commands like "PRIVMSG" or "433") a module
+ * is interested in. A line is delivered to the module if any of its tokens
+ * is in the set. Subscriptions are reference-counted so that a module can
+ * map them directly onto its own handlers.
+ */
+class SBNCAPI CModuleSubscription {
+	int m_Everything[Subscription_Count]; /**< number of subscriptions to every line */
+	CHashtable<int *, false> m_Tokens[Subscription_Count]; /**< reference counts for the tokens */
+public:
+#ifndef SWIG
+	CModuleSubscription(void);
+#endif /* SWIG */
+
+	RESULT<bool> Subscribe(subscription_type_t Type, const char *Token);
+	void Unsubscribe(subscription_type_t Type, const char *Token);
+
+	bool IsSubscribed(subscription_type_t Type, int argc, const char **argv) const;
+};
+
+#endif /* MODULESUBSCRIPTION_H */
@@ -32,14 +32,15 @@ CNick::CNick(const char *Nick, CChannel *Owner) {
 
 	SetOwner(Owner);
 
-	m_Nick = strdup(Nick);
+	m_Data = Owner->GetOwner()->AcquireNickData(Nick);
 
-	if (AllocFailed(m_Nick)) {}
+	if (m_Data != NULL && IsError(m_Data->Memberships.Insert(this))) {
+		Owner->GetOwner()->ReleaseNickData(m_Data);
+		m_Data = NULL;
+	}
 
-	m_Prefixes = NULL;
-	m_Site = NULL;
-	m_Realname = NULL;
-	m_Server = NULL;
+	m_Prefixes = 0;
+	m_PrefixString[0] = '\0';
 	m_Creation = g_CurrentTime;
 	m_IdleSince = m_Creation;
 }
@@ -50,40 +51,32 @@ CNick::CNick(const char *Nick, CChannel *Owner) {
  * Destroys a nick object.
  */
 CNick::~CNick() {
-	free(m_Nick);
-	free(m_Prefixes);
-	free(m_Site);
-	free(m_Realname);
-	free(m_Server);
-
-	for (int i = 0; i < m_Tags.GetLength(); i++) {
-		free(m_Tags[i].Name);
-		free(m_Tags[i].Value);
+	if (m_Data != NULL) {
+		m_Data->Memberships.Remove(this);
+
+		GetOwner()->GetOwner()->ReleaseNickData(m_Data);
 	}
 }
 
 /**
  * SetNick
  *
- * Sets the user's nickname.
+ * Sets the user's nickname. This affects all channels the user is on.
  *
  * @param Nick the new nickname
  */
 bool CNick::SetNick(const char *Nick) {
-	char *NewNick;
-
 	assert(Nick != NULL);
 
-	NewNick = strdup(Nick);
-
-	if (AllocFailed(m_Nick)) {
+	if (m_Data == NULL) {
 		return false;
 	}
 
-	free(m_Nick);
-	m_Nick = NewNick;
+	if (strcmp(m_Data->Nick, Nick) == 0) {
+		return true;
+	}
 
-	return true;
+	return GetOwner()->GetOwner()->RenameNickData(m_Data, Nick);
 }
 
 /**
@@ -92,7 +85,11 @@ bool CNick::SetNick(const char *Nick) {
  * Returns the current nick of the user.
  */
 const char *CNick::GetNick(void) const {
-	return m_Nick;
+	if (m_Data == NULL) {
+		return NULL;
+	}
+
+	return m_Data->Nick;
 }
 
 /**
@@ -130,43 +127,17 @@ bool CNick::IsHalfop(void) const {
  * @param Prefix the prefix (e.g. @, +)
  */
 bool CNick::HasPrefix(char Prefix) const {
-	if (m_Prefixes != NULL && strchr(m_Prefixes, Prefix) != NULL) {
-		return true;
-	} else {
-		return false;
-	}
+	return (m_Prefixes & GetOwner()->GetOwner()->GetPrefixBit(Prefix)) != 0;
 }
 
 /**
  * SortPrefixes
  *
- * Sorts the nick's prefixes (highest prefix first).
+ * Sorts the nick's prefixes (highest prefix first). The prefixes are stored
+ * in the order given by the server's PREFIX feature, so there is nothing
+ * left to do here.
  */
 void CNick::SortPrefixes(void) {
-	CIRCConnection *IRC = GetOwner()->GetOwner();
-
-	if (IRC == NULL) {
-		return;
-	}
-
-	int PrefixCount = strlen(m_Prefixes);
-
-	for (int i = 0; i < PrefixCount; i++) {
-		char Highest = IRC->GetHighestUserFlag(m_Prefixes + i);
-
-		if (m_Prefixes[i] != Highest) {
-			for (int p = i; p < PrefixCount; p++) {
-				if (m_Prefixes[p] == Highest) {
-					char Temp;
-					Temp = m_Prefixes[p];
-					m_Prefixes[p] = m_Prefixes[i];
-					m_Prefixes[i] = Temp;
-
-					break;
-				}
-			}
-		}
-	}
 }
 
 /**
@@ -177,24 +148,13 @@ void CNick::SortPrefixes(void) {
  * @param Prefix the new prefix
  */
 bool CNick::AddPrefix(char Prefix) {
-	char *Prefixes;
-	size_t LengthPrefixes = m_Prefixes ? strlen(m_Prefixes) : 0;
-
-	if (HasPrefix(Prefix)) {
-		return true;
-	}
+	unsigned int Bit = GetOwner()->GetOwner()->GetPrefixBit(Prefix);
 
-	Prefixes = (char *)realloc(m_Prefixes, LengthPrefixes + 2);
-
-	if (AllocFailed(Prefixes)) {
+	if (Bit == 0) {
 		return false;
 	}
 
-	m_Prefixes = Prefixes;
-	m_Prefixes[LengthPrefixes] = Prefix;
-	m_Prefixes[LengthPrefixes + 1] = '\0';
-
-	SortPrefixes();
+	m_Prefixes |= Bit;
 
 	return true;
 }
@@ -207,31 +167,7 @@ bool CNick::AddPrefix(char Prefix) {
  * @param Prefix the prefix
  */
 bool CNick::RemovePrefix(char Prefix) {
-	int a = 0;
-	size_t LengthPrefixes;
-
-	if (m_Prefixes == NULL) {
-		return true;
-	}
-
-	LengthPrefixes = strlen(m_Prefixes);
-
-	char *Copy = (char *)malloc(LengthPrefixes + 1);
-
-	if (AllocFailed(Copy)) {
-		return false;
-	}
-
-	for (size_t i = 0; i < LengthPrefixes; i++) {
-		if (m_Prefixes[i] != Prefix) {
-			Copy[a++] = m_Prefixes[i];
-		}
-	}
-
-	Copy[a] = '\0';
-
-	free(m_Prefixes);
-	m_Prefixes = Copy;
+	m_Prefixes &= ~GetOwner()->GetOwner()->GetPrefixBit(Prefix);
 
 	return true;
 }
@@ -244,20 +180,7 @@ bool CNick::RemovePrefix(char Prefix) {
  * @param Prefixes the new prefixes
  */
 bool CNick::SetPrefixes(const char *Prefixes) {
-	char *dupPrefixes;
-
-	if (Prefixes) {
-		dupPrefixes = strdup(Prefixes);
-
-		if (AllocFailed(dupPrefixes)) {
-			return false;
-		}
-	} else {
-		dupPrefixes = NULL;
-	}
-
-	free(m_Prefixes);
-	m_Prefixes = dupPrefixes;
+	m_Prefixes = GetOwner()->GetOwner()->ParsePrefixes(Prefixes);
 
 	return true;
 }
@@ -265,12 +188,31 @@ bool CNick::SetPrefixes(const char *Prefixes) {
 /**
  * GetPrefixes
  *
- * Returns all prefixes for a user.
+ * Returns all prefixes for a user. The returned string belongs to the
+ * nick object and is valid until its prefixes change.
  */
 const char *CNick::GetPrefixes(void) const {
+	return GetOwner()->GetOwner()->FormatPrefixes(m_Prefixes, m_PrefixString);
+}
+
+/**
+ * GetPrefixBits
+ *
+ * Returns the user's prefixes as a bitmask (see CIRCConnection::ParsePrefixes).
+ */
+unsigned int CNick::GetPrefixBits(void) const {
 	return m_Prefixes;
 }
 
+/**
+ * GetHighestPrefix
+ *
+ * Returns the user's highest prefix, or 0 if the user has no prefixes.
+ */
+char CNick::GetHighestPrefix(void) const {
+	return GetOwner()->GetOwner()->GetHighestPrefix(m_Prefixes);
+}
+
 /**
  * IMPL_NICKSET
  *
@@ -284,7 +226,7 @@ const char *CNick::GetPrefixes(void) const {
 #define IMPL_NICKSET(Name, NewValue, Static) \
 	char *DuplicateValue; \
 \
-	if ((Static && Name != NULL) || NewValue == NULL) { \
+	if (m_Data == NULL || (Static && m_Data->Name != NULL) || NewValue == NULL) { \
 		return false; \
 	} \
 \
@@ -293,8 +235,8 @@ const char *CNick::GetPrefixes(void) const {
 	if (AllocFailed(DuplicateValue)) { \
 		return false; \
 	} \
-	free(Name); \
-	Name = DuplicateValue; \
+	free(m_Data->Name); \
+	m_Data->Name = DuplicateValue; \
 \
 	return true;
 
@@ -307,7 +249,7 @@ const char *CNick::GetPrefixes(void) const {
  * @param Site the user's new site
  */
 bool CNick::SetSite(const char *Site) {
-	IMPL_NICKSET(m_Site, Site, false);
+	IMPL_NICKSET(Site, Site, false);
 }
 
 /**
@@ -318,7 +260,7 @@ bool CNick::SetSite(const char *Site) {
  * @param Realname the new realname
  */
 bool CNick::SetRealname(const char *Realname) {
-	IMPL_NICKSET(m_Realname, Realname, true);
+	IMPL_NICKSET(Realname, Realname, true);
 }
 
 /**
@@ -329,93 +271,39 @@ bool CNick::SetRealname(const char *Realname) {
  * @param Server the server which the user is using
  */
 bool CNick::SetServer(const char *Server) {
-	IMPL_NICKSET(m_Server, Server, true);
+	IMPL_NICKSET(Server, Server, true);
 }
 
 /**
- * InternalGetSite
+ * GetSite
  *
- * Returns the user's site without querying other nick
- * objects if the information is not available.
+ * Returns the user's site.
  */
-const char *CNick::InternalGetSite(void) const {
-	if (m_Site == NULL) {
+const char *CNick::GetSite(void) const {
+	if (m_Data == NULL || m_Data->Site == NULL) {
 		return NULL;
 	}
 
-	char *Host = strchr(m_Site, '!');
+	char *Host = strchr(m_Data->Site, '!');
 
 	if (Host) {
 		return Host + 1;
 	} else {
-		return m_Site;
+		return m_Data->Site;
 	}
 }
 
-/**
- * InternalGetRealname
- *
- * Returns the user's realname without querying other nick
- * objects if the information is not available.
- */
-const char *CNick::InternalGetRealname(void) const {
-	return m_Realname;
-}
-
-/**
- * InternalGetServer
- *
- * Returns the user's server without querying other nick
- * objects if the information is not available.
- */
-const char *CNick::InternalGetServer(void) const {
-	return m_Server;
-}
-
-/**
- * IMPL_NICKACCESSOR
- *
- * Implements a Get*() function
- *
- * @param Name the name of the attribute
- */
-#define IMPL_NICKACCESSOR(Name) \
-	const char *Value; \
-	int a = 0; \
-\
-	if ((Value = Name()) != NULL) { \
-		return Value; \
-	} \
-\
-	while (hash_t<CChannel *> *Chan = GetOwner()->GetOwner()->GetChannels()->Iterate(a++)) { \
-		if (!Chan->Value->HasNames()) \
-			continue; \
-\
-		CNick *NickObj = Chan->Value->GetNames()->Get(m_Nick); \
-\
-		if (NickObj && NickObj->GetNick() != NULL && m_Nick != NULL && \
-				 strcasecmp(NickObj->GetNick(), m_Nick) == 0 && NickObj->Name() != NULL) \
-			return NickObj->Name(); \
-	} \
-\
-	return NULL;
-
-/**
- * GetSite
- *
- * Returns the user's site.
- */
-const char *CNick::GetSite(void) const {
-	IMPL_NICKACCESSOR(InternalGetSite)
-}
-
 /**
  * GetRealname
  *
  * Returns the user's realname.
  */
 const char *CNick::GetRealname(void) const {
-	IMPL_NICKACCESSOR(InternalGetRealname)
+	if (m_Data == NULL) {
+		return NULL;
+	}
+
+	return m_Data->Realname;
 }
 
 /**
@@ -424,7 +312,11 @@ const char *CNick::GetRealname(void) const {
  * Returns the user's server.
  */
 const char *CNick::GetServer(void) const {
-	IMPL_NICKACCESSOR(InternalGetServer)
+	if (m_Data == NULL) {
+		return NULL;
+	}
+
+	return m_Data->Server;
 }
 
 /**
@@ -468,9 +360,13 @@ bool CNick::SetIdleSince(time_t Time) {
  * @param Name the name of the tag
  */
 const char *CNick::GetTag(const char *Name) const {
-	for (int i = 0; i < m_Tags.GetLength(); i++) {
-		if (strcasecmp(m_Tags[i].Name, Name) == 0) {
-			return m_Tags[i].Value;
+	if (m_Data == NULL) {
+		return NULL;
+	}
+
+	for (int i = 0; i < m_Data->Tags.GetLength(); i++) {
+		if (strcasecmp(m_Data->Tags[i].Name, Name) == 0) {
+			return m_Data->Tags[i].Value;
 		}
 	}
 
@@ -480,7 +376,7 @@ const char *CNick::GetTag(const char *Name) const {
 /**
  * SetTag
  *
- * Sets a user-specific tag.
+ * Sets a user-specific tag. Tags are shared by all channels the user is on.
  *
  * @param Name the name of the tag
  * @param Value the value of the tag
@@ -488,16 +384,16 @@ const char *CNick::GetTag(const char *Name) const {
 bool CNick::SetTag(const char *Name, const char *Value) {
 	nicktag_t NewTag;
 
-	if (Name == NULL) {
+	if (Name == NULL || m_Data == NULL) {
 		return false;
 	}
 
-	for (int i = 0; i < m_Tags.GetLength(); i++) {
-		if (strcasecmp(m_Tags[i].Name, Name) == 0) {
-			free(m_Tags[i].Name);
-			free(m_Tags[i].Value);
+	for (int i = 0; i < m_Data->Tags.GetLength(); i++) {
+		if (strcasecmp(m_Data->Tags[i].Name, Name) == 0) {
+			free(m_Data->Tags[i].Name);
+			free(m_Data->Tags[i].Value);
 
-			m_Tags.Remove(i);
+			m_Data->Tags.Remove(i);
 
 			break;
 		}
@@ -521,5 +417,5 @@ bool CNick::SetTag(const char *Name, const char *Value) {
 		return false;
 	}
 
-	return m_Tags.Insert(NewTag);
+	return m_Data->Tags.Insert(NewTag);
 }
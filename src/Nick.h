@@ -21,6 +21,7 @@
 #define NICK_H
 
 class CChannel;
+class CNick;
 
 /**
  * nicktag_t
@@ -32,24 +33,33 @@ typedef struct nicktag_s {
 	char *Value; /**< the value of the tag */
 } nicktag_t;
 
+/**
+ * nickdata_t
+ *
+ * Information about an IRC user which is shared by all channels the user
+ * is on. These records are managed by CIRCConnection.
+ */
+typedef struct nickdata_s {
+	char *Nick; /**< the nickname of the user */
+	char *Site; /**< the ident\@host of the user */
+	char *Realname; /**< the realname of the user */
+	char *Server; /**< the server this user is using */
+	CVector<nicktag_t> Tags; /**< any tags which belong to this user */
+	CVector<CNick *> Memberships; /**< the user's channel memberships */
+	unsigned int RefCount; /**< the number of references to this record */
+} nickdata_t;
+
 /**
  * CNick
  *
  * Represents a user on a single channel.
  */
 class SBNCAPI CNick : public CObject<CNick, CChannel> {
-	char *m_Nick; /**< the nickname of the user */
-	char *m_Prefixes; /**< the user's prefixes (e.g. @, +) */
-	char *m_Site; /**< the ident\@host of the user */
-	char *m_Realname; /**< the realname of the user */
-	char *m_Server; /**< the server this user is using */
+	nickdata_t *m_Data; /**< information about the user */
+	unsigned int m_Prefixes; /**< the user's prefixes as a bitmask */
+	mutable char m_PrefixString[MAXPREFIXES + 1]; /**< used by GetPrefixes() */
 	time_t m_Creation; /**< a timestamp, when this user object was created */
 	time_t m_IdleSince; /**< a timestamp, when the user last said something */
-	CVector<nicktag_t> m_Tags; /**< any tags which belong to this nick object */
-
-	const char *InternalGetSite(void) const;
-	const char *InternalGetRealname(void) const;
-	const char *InternalGetServer(void) const;
 public:
 #ifndef SWIG
 	CNick(const char *Nick, CChannel *Owner);
@@ -69,6 +79,10 @@ public:
 	bool RemovePrefix(char Prefix);
 	bool SetPrefixes(const char *Prefixes);
 	const char *GetPrefixes(void) const;
+	char GetHighestPrefix(void) const;
+#ifndef SWIG
+	unsigned int GetPrefixBits(void) const;
+#endif /* SWIG */
 
 	bool SetSite(const char *Site);
 	const char *GetSite(void) const;
@@ -0,0 +1,355 @@
+/*******************************************************************************
+ * shroudBNC - an object-oriented framework for IRC                            *
+ * Copyright (C) 2005-2007,2010 Gunnar Beutner                                 *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or               *
+ * modify it under the terms of the GNU General Public License                 *
+ * as published by the Free Software Foundation; either version 2              *
+ * of the License, or (at your option) any later version.                      *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU General Public License for more details.                                *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License           *
+ * along with this program; if not, write to the Free Software                 *
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA. *
+ *******************************************************************************/
+
+
+#include "StdAfx.h"
+
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_EPOLL_CREATE)
+#	include <sys/epoll.h>
+#	define USE_EPOLL
+#endif /* defined(HAVE_SYS_EPOLL_H) && defined(HAVE_EPOLL_CREATE) */
+
+/**
+ * CPollPoller
+ *
+ * A poller which uses poll(). The pollfd array is shared with the core
+ * so the events for each socket only have to be written when they change.
+ */
+class CPollPoller : public CPoller {
+private:
+	CVector<pollfd> *m_PollFds; /**< the core's pollfd structures */
+	socket_t **m_Sockets; /**< the socket for each pollfd slot */
+	socket_t **m_Ready; /**< sockets which were reported by the last poll() call */
+	int m_ReadyCount; /**< number of entries in m_Ready */
+
+	/**
+	 * GetSlot
+	 *
+	 * Returns the index of a socket's pollfd structure.
+	 *
+	 * @param Socket the socket
+	 */
+	int GetSlot(socket_t *Socket) const {
+		return Socket->PollFd - m_PollFds->GetList();
+	}
+
+public:
+	/**
+	 * CPollPoller
+	 *
+	 * Constructs a new poll() backend.
+	 *
+	 * @param PollFds the pollfd structures (must have been preallocated
+	 *				  with SFD_SETSIZE elements)
+	 */
+	explicit CPollPoller(CVector<pollfd> *PollFds) {
+		m_PollFds = PollFds;
+		m_Sockets = (socket_t **)calloc(SFD_SETSIZE, sizeof(socket_t *));
+		m_Ready = (socket_t **)malloc(SFD_SETSIZE * sizeof(socket_t *));
+		m_ReadyCount = 0;
+
+		if (AllocFailed(m_Sockets) || AllocFailed(m_Ready)) {
+			g_Bouncer->Fatal();
+		}
+	}
+
+	/**
+	 * ~CPollPoller
+	 *
+	 * Destroys the poll() backend.
+	 */
+	virtual ~CPollPoller(void) {
+		free(m_Sockets);
+		free(m_Ready);
+	}
+
+	virtual bool Add(socket_t *Socket) {
+		m_Sockets[GetSlot(Socket)] = Socket;
+
+		return true;
+	}
+
+	virtual bool Modify(socket_t *Socket, short Events) {
+		Socket->PollFd->events = Events;
+
+		return true;
+	}
+
+	virtual void Remove(socket_t *Socket) {
+		m_Sockets[GetSlot(Socket)] = NULL;
+
+		for (int i = 0; i < m_ReadyCount; i++) {
+			if (m_Ready[i] == Socket) {
+				m_Ready[i] = NULL;
+			}
+		}
+	}
+
+	virtual int Poll(int Timeout) {
+		pollfd *PollFds = m_PollFds->GetList();
+		int Count = m_PollFds->GetLength();
+		int Result;
+
+		m_ReadyCount = 0;
+
+		Result = poll(PollFds, Count, Timeout);
+
+		if (Result <= 0) {
+			return Result;
+		}
+
+		for (int i = 0; i < Count && m_ReadyCount < Result; i++) {
+			if (PollFds[i].fd == INVALID_SOCKET || PollFds[i].revents == 0 || m_Sockets[i] == NULL) {
+				continue;
+			}
+
+			m_Ready[m_ReadyCount++] = m_Sockets[i];
+		}
+
+		return m_ReadyCount;
+	}
+
+	virtual socket_t *GetReadySocket(int Index) const {
+		return m_Ready[Index];
+	}
+
+	virtual const char *GetName(void) const {
+		return "poll";
+	}
+};
+
+#ifdef USE_EPOLL
+/**
+ * CEpollPoller
+ *
+ * A poller which uses Linux' epoll interface. The kernel keeps the interest
+ * set, so sockets are only touched when their events change and epoll_wait()
+ * only returns sockets which are actually ready.
+ */
+class CEpollPoller : public CPoller {
+private:
+	enum {
+		MaxEvents = 256 /**< maximum number of events per epoll_wait() call */
+	};
+
+	int m_Epoll; /**< the epoll descriptor */
+	epoll_event m_Events[MaxEvents]; /**< events returned by epoll_wait() */
+	socket_t *m_Ready[MaxEvents]; /**< sockets which were reported by the last call */
+	int m_ReadyCount; /**< number of entries in m_Ready */
+
+	/**
+	 * ToEpollEvents
+	 *
+	 * Converts poll() events to epoll events.
+	 *
+	 * @param Events the poll() events
+	 */
+	static uint32_t ToEpollEvents(short Events) {
+		uint32_t Result = 0;
+
+		if (Events & POLLIN) {
+			Result |= EPOLLIN;
+		}
+
+		if (Events & POLLPRI) {
+			Result |= EPOLLPRI;
+		}
+
+		if (Events & POLLOUT) {
+			Result |= EPOLLOUT;
+		}
+
+		return Result;
+	}
+
+	/**
+	 * FromEpollEvents
+	 *
+	 * Converts epoll events to poll() events.
+	 *
+	 * @param Events the epoll events
+	 */
+	static short FromEpollEvents(uint32_t Events) {
+		short Result = 0;
+
+		if (Events & EPOLLIN) {
+			Result |= POLLIN;
+		}
+
+		if (Events & EPOLLPRI) {
+			Result |= POLLPRI;
+		}
+
+		if (Events & EPOLLOUT) {
+			Result |= POLLOUT;
+		}
+
+		if (Events & EPOLLERR) {
+			Result |= POLLERR;
+		}
+
+		if (Events & EPOLLHUP) {
+			Result |= POLLHUP;
+		}
+
+		return Result;
+	}
+
+	/**
+	 * Control
+	 *
+	 * Adds or modifies the epoll registration for a socket.
+	 *
+	 * @param Operation EPOLL_CTL_ADD or EPOLL_CTL_MOD
+	 * @param Socket the socket
+	 */
+	bool Control(int Operation, socket_t *Socket) {
+		epoll_event Event;
+
+		memset(&Event, 0, sizeof(Event));
+		Event.events = ToEpollEvents(Socket->PollFd->events);
+		Event.data.ptr = Socket;
+
+		if (epoll_ctl(m_Epoll, Operation, Socket->PollFd->fd, &Event) == 0) {
+			return true;
+		}
+
+		// a previous owner of this descriptor might have closed it without
+		// unregistering it first
+		if (Operation == EPOLL_CTL_ADD && errno == EEXIST) {
+			return epoll_ctl(m_Epoll, EPOLL_CTL_MOD, Socket->PollFd->fd, &Event) == 0;
+		} else if (Operation == EPOLL_CTL_MOD && errno == ENOENT) {
+			return epoll_ctl(m_Epoll, EPOLL_CTL_ADD, Socket->PollFd->fd, &Event) == 0;
+		}
+
+		return false;
+	}
+
+public:
+	/**
+	 * CEpollPoller
+	 *
+	 * Constructs a new epoll backend. IsValid() should be used to
+	 * check whether the kernel supports epoll.
+	 */
+	CEpollPoller(void) {
+		m_Epoll = epoll_create(SFD_SETSIZE);
+		m_ReadyCount = 0;
+
+		if (m_Epoll != -1) {
+			fcntl(m_Epoll, F_SETFD, FD_CLOEXEC);
+		}
+	}
+
+	/**
+	 * ~CEpollPoller
+	 *
+	 * Destroys the epoll backend.
+	 */
+	virtual ~CEpollPoller(void) {
+		if (m_Epoll != -1) {
+			close(m_Epoll);
+		}
+	}
+
+	/**
+	 * IsValid
+	 *
+	 * Checks whether the epoll descriptor could be created.
+	 */
+	bool IsValid(void) const {
+		return (m_Epoll != -1);
+	}
+
+	virtual bool Add(socket_t *Socket) {
+		return Control(EPOLL_CTL_ADD, Socket);
+	}
+
+	virtual bool Modify(socket_t *Socket, short Events) {
+		Socket->PollFd->events = Events;
+
+		return Control(EPOLL_CTL_MOD, Socket);
+	}
+
+	virtual void Remove(socket_t *Socket) {
+		epoll_event Event;
+
+		// errors are ignored here, the descriptor might already have
+		// been closed (which implicitly removes it from the epoll set)
+		epoll_ctl(m_Epoll, EPOLL_CTL_DEL, Socket->PollFd->fd, &Event);
+
+		for (int i = 0; i < m_ReadyCount; i++) {
+			if (m_Ready[i] == Socket) {
+				m_Ready[i] = NULL;
+			}
+		}
+	}
+
+	virtual int Poll(int Timeout) {
+		int Result;
+
+		m_ReadyCount = 0;
+
+		Result = epoll_wait(m_Epoll, m_Events, MaxEvents, Timeout);
+
+		if (Result <= 0) {
+			return Result;
+		}
+
+		for (int i = 0; i < Result; i++) {
+			socket_t *Socket = (socket_t *)m_Events[i].data.ptr;
+
+			Socket->PollFd->revents = FromEpollEvents(m_Events[i].events);
+			m_Ready[m_ReadyCount++] = Socket;
+		}
+
+		return m_ReadyCount;
+	}
+
+	virtual socket_t *GetReadySocket(int Index) const {
+		return m_Ready[Index];
+	}
+
+	virtual const char *GetName(void) const {
+		return "epoll";
+	}
+};
+#endif /* USE_EPOLL */
+
+/**
+ * CreatePoller
+ *
+ * Creates the best available poller. The poll() backend is used as
+ * a fallback when no other backend is available.
+ *
+ * @param PollFds the pollfd structures used by the core
+ */
+CPoller *CreatePoller(CVector<pollfd> *PollFds) {
+#ifdef USE_EPOLL
+	CEpollPoller *EpollPoller = new CEpollPoller();
+
+	if (EpollPoller->IsValid()) {
+		return EpollPoller;
+	}
+
+	delete EpollPoller;
+#endif /* USE_EPOLL */
+
+	return new CPollPoller(PollFds);
+}
@@ -0,0 +1,104 @@
+/*******************************************************************************
+ * shroudBNC - an object-oriented framework for IRC                            *
+ * Copyright (C) 2005-2007,2010 Gunnar Beutner                                 *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or               *
+ * modify it under the terms of the GNU General Public License                 *
+ * as published by the Free Software Foundation; either version 2              *
+ * of the License, or (at your option) any later version.                      *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU General Public License for more details.                                *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License           *
+ * along with this program; if not, write to the Free Software                 *
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA. *
+ *******************************************************************************/
+
+
+#ifndef POLLER_H
+#define POLLER_H
+
+struct socket_s;
+
+/**
+ * CPoller
+ *
+ * An interface for socket readiness backends. The main loop registers
+ * sockets with the poller once and only updates their interest set when
+ * it actually changes; after Poll() returns only the sockets which are
+ * ready have to be visited.
+ */
+class CPoller {
+public:
+	/**
+	 * ~CPoller
+	 *
+	 * Destructor.
+	 */
+	virtual ~CPoller(void) {}
+
+	/**
+	 * Add
+	 *
+	 * Starts monitoring a socket using the events in its pollfd structure.
+	 *
+	 * @param Socket the socket
+	 */
+	virtual bool Add(struct socket_s *Socket) = 0;
+
+	/**
+	 * Modify
+	 *
+	 * Changes the events which are monitored for a socket.
+	 *
+	 * @param Socket the socket
+	 * @param Events the new events (POLLIN, POLLOUT, etc.)
+	 */
+	virtual bool Modify(struct socket_s *Socket, short Events) = 0;
+
+	/**
+	 * Remove
+	 *
+	 * Stops monitoring a socket. The socket is also removed from the
+	 * list of ready sockets so it is not dispatched after it has been
+	 * unregistered.
+	 *
+	 * @param Socket the socket
+	 */
+	virtual void Remove(struct socket_s *Socket) = 0;
+
+	/**
+	 * Poll
+	 *
+	 * Waits for sockets to become ready and returns the number of entries
+	 * in the ready list (or -1 if an error occured).
+	 *
+	 * @param Timeout the timeout (in milliseconds)
+	 */
+	virtual int Poll(int Timeout) = 0;
+
+	/**
+	 * GetReadySocket
+	 *
+	 * Returns an entry from the ready list, or NULL if that socket
+	 * has been removed in the meantime. The pollfd's revents field
+	 * contains the events that were reported for the socket.
+	 *
+	 * @param Index the index of the entry
+	 */
+	virtual struct socket_s *GetReadySocket(int Index) const = 0;
+
+	/**
+	 * GetName
+	 *
+	 * Returns the name of the backend.
+	 */
+	virtual const char *GetName(void) const = 0;
+};
+
+CPoller *CreatePoller(CVector<pollfd> *PollFds);
+
+#endif /* POLLER_H */
@@ -20,54 +20,115 @@
 #include "StdAfx.h"
 
 /**
- * PeekItems
+ * CQueue
  *
- * Retrieves the next item from the queue without removing it.
+ * Constructs an empty queue.
+ */
+CQueue::CQueue(void) {
+	m_Items = NULL;
+	m_Size = 0;
+	m_Head = 0;
+	m_Length = 0;
+	m_FloodControl = NULL;
+}
+
+/**
+ * ~CQueue
+ *
+ * Destructs a queue.
+ */
+CQueue::~CQueue(void) {
+	Clear();
+
+	free(m_Items);
+}
+
+/**
+ * Grow
+ *
+ * Makes room for at least one more item. Returns false if the queue
+ * is full or if the ring buffer could not be resized.
  */
-RESULT<const char *> CQueue::PeekItem(void) const {
-	int LowestPriority = 99999;
-	queue_item_t *ThatItem = NULL;
+bool CQueue::Grow(void) {
+	queue_item_t *NewItems;
+	int NewSize;
 
-	for (int i = 0; i < m_Items.GetLength(); i++) {
-		if (m_Items[i].Priority < LowestPriority) {
-			LowestPriority = m_Items[i].Priority;
-			ThatItem = m_Items.GetAddressOf(i);
-		}
+	if (m_Length >= MAX_QUEUE_SIZE) {
+		return false;
 	}
 
-	if (ThatItem != NULL) {
-		RETURN(const char *, ThatItem->Line);
-	} else {
+	if (m_Length < m_Size) {
+		return true;
+	}
+
+	NewSize = (m_Size == 0) ? 16 : m_Size * 2;
+
+	if (NewSize > MAX_QUEUE_SIZE) {
+		NewSize = MAX_QUEUE_SIZE;
+	}
+
+	NewItems = (queue_item_t *)malloc(NewSize * sizeof(queue_item_t));
+
+	if (AllocFailed(NewItems)) {
+		return false;
+	}
+
+	for (int i = 0; i < m_Length; i++) {
+		NewItems[i] = m_Items[(m_Head + i) % m_Size];
+	}
+
+	free(m_Items);
+
+	m_Items = NewItems;
+	m_Size = NewSize;
+	m_Head = 0;
+
+	return true;
+}
+
+/**
+ * PeekItem
+ *
+ * Retrieves the next item from the queue without removing it.
+ *
+ * @param Length receives the length of the item (optional)
+ */
+RESULT<const char *> CQueue::PeekItem(size_t *Length) const {
+	if (m_Length == 0) {
 		THROW(const char *, Generic_Unknown, "The queue is empty.");
 	}
+
+	if (Length != NULL) {
+		*Length = m_Items[m_Head].Length;
+	}
+
+	RETURN(const char *, m_Items[m_Head].Line);
 }
 
 /**
  * DequeueItem
  *
  * Retrieves the next item from the queue and removes it.
+ *
+ * @param Length receives the length of the item (optional)
  */
-RESULT<char *> CQueue::DequeueItem(void) {
-	int Index = 0;
-	queue_item_t *Item = NULL;
+RESULT<char *> CQueue::DequeueItem(size_t *Length) {
 	char *Line;
 
-	for (int i = 0; i < m_Items.GetLength(); i++) {
-		if (Item == NULL || m_Items[i].Priority < Item->Priority) {
-			Item = m_Items.GetAddressOf(i);
-			Index = i;
-		}
+	if (m_Length == 0) {
+		THROW(char *, Generic_Unknown, "The queue is empty.");
 	}
 
-	if (Item != NULL) {
-		Line = Item->Line;
-
-		m_Items.Remove(Index);
+	Line = m_Items[m_Head].Line;
 
-		RETURN(char *, Line);
-	} else {
-		THROW(char *, Generic_Unknown, "The queue is empty.");
+	if (Length != NULL) {
+		*Length = m_Items[m_Head].Length;
 	}
+
+	m_Head = (m_Head + 1) % m_Size;
+	m_Length--;
+
+	RETURN(char *, Line);
 }
 
 /**
@@ -78,30 +139,41 @@ RESULT<char *> CQueue::DequeueItem(void) {
  * @param Line the item which is to be inserted
  */
 RESULT<bool> CQueue::QueueItem(const char *Line) {
-	queue_item_t Item;
+	queue_item_t *Item;
+	char *dupLine;
 
 	if (Line == NULL) {
 		THROW(bool, Generic_InvalidArgument, "Line cannot be NULL.");
 	}
 
 	// ignore new items if the queue is full
-	if (m_Items.GetLength() >= MAX_QUEUE_SIZE) {
+	if (m_Length >= MAX_QUEUE_SIZE) {
 		THROW(bool, Generic_Unknown, "The queue is full.");
 	}
 
-	Item.Line = strdup(Line);
+	dupLine = strdup(Line);
 
-	if (AllocFailed(Item.Line)) {
+	if (AllocFailed(dupLine)) {
 		THROW(bool, Generic_OutOfMemory, "strdup() failed.");
 	}
 
-	Item.Priority = 0;
+	if (!Grow()) {
+		free(dupLine);
+
+		THROW(bool, Generic_OutOfMemory, "Grow() failed.");
+	}
+
+	Item = &m_Items[(m_Head + m_Length) % m_Size];
+	Item->Line = dupLine;
+	Item->Length = strlen(dupLine);
 
-	for (int i = 0; i < m_Items.GetLength(); i++) {
-		m_Items[i].Priority--;
+	m_Length++;
+
+	if (m_FloodControl != NULL) {
+		m_FloodControl->Wakeup();
 	}
 
-	return m_Items.Insert(Item);
+	RETURN(bool, true);
 }
 
 /**
@@ -112,11 +184,42 @@ RESULT<bool> CQueue::QueueItem(const char *Line) {
  * @param Line the item which is to be inserted
  */
 RESULT<bool> CQueue::QueueItemNext(const char *Line) {
-	for (int i = 0; i < m_Items.GetLength(); i++) {
-		m_Items[i].Priority += 2;
+	queue_item_t *Item;
+	char *dupLine;
+
+	if (Line == NULL) {
+		THROW(bool, Generic_InvalidArgument, "Line cannot be NULL.");
+	}
+
+	if (m_Length >= MAX_QUEUE_SIZE) {
+		THROW(bool, Generic_Unknown, "The queue is full.");
+	}
+
+	dupLine = strdup(Line);
+
+	if (AllocFailed(dupLine)) {
+		THROW(bool, Generic_OutOfMemory, "strdup() failed.");
+	}
+
+	if (!Grow()) {
+		free(dupLine);
+
+		THROW(bool, Generic_OutOfMemory, "Grow() failed.");
+	}
+
+	m_Head = (m_Head + m_Size - 1) % m_Size;
+
+	Item = &m_Items[m_Head];
+	Item->Line = dupLine;
+	Item->Length = strlen(dupLine);
+
+	m_Length++;
+
+	if (m_FloodControl != NULL) {
+		m_FloodControl->Wakeup();
 	}
 
-	return QueueItem(Line);
+	RETURN(bool, true);
 }
 
 /**
@@ -125,7 +228,7 @@ RESULT<bool> CQueue::QueueItemNext(const char *Line) {
  * Returns the number of items which are in the queue.
  */
 int CQueue::GetLength(void) const {
-	return m_Items.GetLength();
+	return m_Length;
 }
 
 /**
@@ -134,9 +237,10 @@ int CQueue::GetLength(void) const {
  * Removes all items from the queue.
  */
 void CQueue::Clear(void) {
-	for (int i = 0; i < m_Items.GetLength(); i++) {
-		free(m_Items[i].Line);
+	for (int i = 0; i < m_Length; i++) {
+		free(m_Items[(m_Head + i) % m_Size].Line);
 	}
 
-	m_Items.Clear();
+	m_Head = 0;
+	m_Length = 0;
 }
@@ -23,26 +23,46 @@
 /** Defines how many items can be stored in a single queue */
 #define MAX_QUEUE_SIZE 500
 
+class CFloodControl;
+
 /**
  * queue_item_t
  *
  * An item from a queue.
  */
 typedef struct queue_item_s {
-	int Priority; /**< the priority of this item; 0 is the highest priority */
 	char *Line; /**< the string which is associated with this item */
+	size_t Length; /**< the length of the string */
 } queue_item_t;
 
 /**
  * CQueue
  *
- * A queue which can be used for storing strings.
+ * A queue which can be used for storing strings. Items are kept in a
+ * ring buffer so they can be added to and removed from either end of
+ * the queue in constant time.
  */
 class SBNCAPI CQueue {
-	CVector<queue_item_t> m_Items; /**< the items which are in the queue */
+#ifndef SWIG
+	friend class CFloodControl;
+#endif /* SWIG */
+
+	queue_item_t *m_Items; /**< the items which are in the queue */
+	int m_Size; /**< the number of allocated items */
+	int m_Head; /**< the index of the first item */
+	int m_Length; /**< the number of items in the queue */
+	CFloodControl *m_FloodControl; /**< the flood control object this queue
+									has been attached to, or NULL */
+
+	bool Grow(void);
 public:
-	RESULT<char *> DequeueItem(void);
-	RESULT<const char *> PeekItem(void) const;
+#ifndef SWIG
+	CQueue(void);
+	virtual ~CQueue(void);
+#endif /* SWIG */
+
+	RESULT<char *> DequeueItem(size_t *Length = NULL);
+	RESULT<const char *> PeekItem(size_t *Length = NULL) const;
 	RESULT<bool> QueueItem(const char *Line);
 	RESULT<bool> QueueItemNext(const char *Line);
 	int GetLength(void) const;
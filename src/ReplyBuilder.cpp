@@ -0,0 +1,131 @@
+/*******************************************************************************
+ * shroudBNC - an object-oriented framework for IRC                            *
+ * Copyright (C) 2005-2007,2010 Gunnar Beutner                                 *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or               *
+ * modify it under the terms of the GNU General Public License                 *
+ * as published by the Free Software Foundation; either version 2              *
+ * of the License, or (at your option) any later version.                      *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU General Public License for more details.                                *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License           *
+ * along with this program; if not, write to the Free Software                 *
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA. *
+ *******************************************************************************/
+
+#include "StdAfx.h"
+
+/**
+ * CReplyBuilder
+ *
+ * Constructs a new reply builder. The prefix is repeated at the start
+ * of every line.
+ *
+ * @param Connection the connection which should receive the replies
+ * @param Format a format string for the prefix
+ * @param ... parameters for the format string
+ */
+CReplyBuilder::CReplyBuilder(CConnection *Connection, const char *Format, ...) {
+	va_list Marker;
+	int rc;
+
+	m_Connection = Connection;
+
+	va_start(Marker, Format);
+	rc = vsnprintf(m_Line, sizeof(m_Line), Format, Marker);
+	va_end(Marker);
+
+	if (rc < 0) {
+		rc = 0;
+	} else if ((size_t)rc > MAXREPLYLENGTH) {
+		rc = MAXREPLYLENGTH;
+	}
+
+	m_PrefixLength = rc;
+	m_Length = m_PrefixLength;
+}
+
+/**
+ * Append
+ *
+ * Appends text to the current line. The text is truncated if the line
+ * would become too long.
+ *
+ * @param Text the text
+ * @param Length the length of the text
+ */
+void CReplyBuilder::Append(const char *Text, size_t Length) {
+	if (Length > MAXREPLYLENGTH - m_Length) {
+		Length = MAXREPLYLENGTH - m_Length;
+	}
+
+	memcpy(m_Line + m_Length, Text, Length);
+	m_Length += Length;
+}
+
+/**
+ * Append
+ *
+ * Appends a string to the current line.
+ *
+ * @param Text the string
+ */
+void CReplyBuilder::Append(const char *Text) {
+	Append(Text, strlen(Text));
+}
+
+/**
+ * AppendItem
+ *
+ * Appends a space-separated item (e.g. a nick for a 353 reply) to the
+ * current line. The current line is sent first if the item would not
+ * fit anymore.
+ *
+ * @param ItemPrefix a string which is prepended to the item, can be NULL
+ * @param Item the item
+ */
+void CReplyBuilder::AppendItem(const char *ItemPrefix, const char *Item) {
+	size_t PrefixLength = (ItemPrefix != NULL) ? strlen(ItemPrefix) : 0;
+	size_t ItemLength = strlen(Item);
+
+	if (HasText() && m_Length + 1 + PrefixLength + ItemLength > MAXREPLYLENGTH) {
+		Send();
+	}
+
+	if (HasText()) {
+		Append(" ", 1);
+	}
+
+	if (ItemPrefix != NULL) {
+		Append(ItemPrefix, PrefixLength);
+	}
+
+	Append(Item, ItemLength);
+}
+
+/**
+ * HasText
+ *
+ * Checks whether any text has been appended to the prefix since the
+ * last line was sent.
+ */
+bool CReplyBuilder::HasText(void) const {
+	return m_Length > m_PrefixLength;
+}
+
+/**
+ * Send
+ *
+ * Sends the current line and starts a new line.
+ */
+void CReplyBuilder::Send(void) {
+	m_Line[m_Length] = '\0';
+
+	m_Connection->WriteUnformattedLine(m_Line);
+
+	m_Length = m_PrefixLength;
+}
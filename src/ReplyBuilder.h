@@ -0,0 +1,54 @@
+/*******************************************************************************
+ * shroudBNC - an object-oriented framework for IRC                            *
+ * Copyright (C) 2005-2007,2010 Gunnar Beutner                                 *
+ *                                                                             *
+ * This program is free software; you can redistribute it and/or               *
+ * modify it under the terms of the GNU General Public License                 *
+ * as published by the Free Software Foundation; either version 2              *
+ * of the License, or (at your option) any later version.                      *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ * GNU General Public License for more details.                                *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License           *
+ * along with this program; if not, write to the Free Software                 *
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA. *
+ *******************************************************************************/
+
+#ifndef REPLYBUILDER_H
+#define REPLYBUILDER_H
+
+/** The maximum length of an IRC line, not including the CR/LF */
+#define MAXREPLYLENGTH 510
+
+class CConnection;
+
+/**
+ * CReplyBuilder
+ *
+ * Builds replies (e.g. 353 or 352 numerics) for a connection in a fixed
+ * buffer. The reply's prefix is formatted once, and further text is
+ * appended while keeping track of the line's length, so no line has to be
+ * re-scanned or re-allocated.
+ */
+class SBNCAPI CReplyBuilder {
+	CConnection *m_Connection; /**< the connection which receives the replies */
+	char m_Line[MAXREPLYLENGTH + 1]; /**< the current line */
+	size_t m_PrefixLength; /**< the length of the prefix */
+	size_t m_Length; /**< the length of the current line */
+
+public:
+#ifndef SWIG
+	CReplyBuilder(CConnection *Connection, const char *Format, ...);
+#endif /* SWIG */
+
+	void Append(const char *Text, size_t Length);
+	void Append(const char *Text);
+	void AppendItem(const char *ItemPrefix, const char *Item);
+	bool HasText(void) const;
+	void Send(void);
+};
+
+#endif /* REPLYBUILDER_H */
@@ -71,7 +71,9 @@ public:
 	 * HasQueuedData
 	 *
 	 * Called to determine whether the object wants to write
-	 * data for the socket.
+	 * data for the socket. This is only checked after the socket has
+	 * been registered, after it was ready and after
+	 * CCore::UpdateSocketEvents() has been called for it.
 	 */
 	virtual bool HasQueuedData(void) const = 0;
 
@@ -79,6 +81,8 @@ public:
 	 * ShouldDestroy
 	 *
 	 * Called to determine whether the event object should be destroyed.
+	 * This is only checked for objects which have been passed to
+	 * CCore::ScheduleDestroy().
 	 */
 	virtual bool ShouldDestroy(void) const = 0;
 
@@ -88,6 +92,17 @@ public:
 	 * Called to get the class' name.
 	 */
 	virtual const char *GetClassName(void) const = 0;
+
+	/**
+	 * ReadsOwnErrors
+	 *
+	 * Called to determine whether the object reads pending socket errors
+	 * itself in Destroy(). Otherwise the error is fetched and passed to
+	 * Error() before Destroy() is called.
+	 */
+	virtual bool ReadsOwnErrors(void) const {
+		return false;
+	}
 };
 
 #endif /* SOCKETEVENTS_H */
@@ -90,6 +90,7 @@ typedef lt_dlhandle HMODULE;
 typedef void SSL;
 typedef void BIO;
 typedef void SSL_CTX;
+typedef void SSL_SESSION;
 typedef void X509;
 typedef void X509_STORE_CTX;
 #endif /* HAVE_LIBSSL */
@@ -115,22 +116,28 @@ typedef void X509_STORE_CTX;
 #	include "Vector.h"
 #	include "List.h"
 #	include "Hashtable.h"
+#	include "DispatchTable.h"
 #	include "utility.h"
 #	include "SocketEvents.h"
 #	include "DnsSocket.h"
 #	include "DnsEvents.h"
+#	include "DnsCache.h"
 #	include "Timer.h"
 #	include "FIFOBuffer.h"
 #	include "Queue.h"
 #	include "Connection.h"
+#	include "ReplyBuilder.h"
 #	include "Config.h"
 #	include "Cache.h"
+#	include "Poller.h"
 #	include "Core.h"
 #	include "ClientConnection.h"
 #	include "ClientConnectionMultiplexer.h"
 #	include "IRCConnection.h"
 #	include "User.h"
 #	include "Log.h"
+#	include "Backlog.h"
+#	include "ModuleSubscription.h"
 #	include "ModuleFar.h"
 #	include "Module.h"
 #	include "Banlist.h"
@@ -138,6 +145,7 @@ typedef void X509_STORE_CTX;
 #	include "Nick.h"
 #	include "Keyring.h"
 #	include "IdentSupport.h"
+#	include "Admission.h"
 #	include "TrafficStats.h"
 #	include "FloodControl.h"
 #	include "Listener.h"
@@ -19,8 +19,13 @@
 
 #include "StdAfx.h"
 
-static time_t g_NextCall = 0;
-static CList<CTimer *> *g_Timers = NULL;
+static CTimer **g_Timers = NULL; /**< the timer heap */
+static int g_TimerCount = 0; /**< number of timers in the heap */
+static int g_TimerAlloc = 0; /**< number of allocated slots in the heap */
+
+static CTimer **g_DueTimers = NULL; /**< timers which are currently being called */
+static int g_DueCount = 0; /**< number of entries in g_DueTimers */
+static int g_DueAlloc = 0; /**< number of allocated slots in g_DueTimers */
 
 /**
  * CTimer
@@ -37,14 +42,10 @@ CTimer::CTimer(unsigned int Interval, bool Repeat, TimerProc Function, void *Coo
 	m_Repeat = Repeat;
 	m_Proc = Function;
 	m_Cookie = Cookie;
+	m_Next = 0;
+	m_Index = -1;
 
-	Reschedule(g_CurrentTime + Interval);
-
-	if (g_Timers == NULL) {
-		g_Timers = new CList<CTimer *>();
-	}
-
-	m_Link = g_Timers->Insert(this);
+	RescheduleMs(GetCurrentTimeMs() + (int64_t)Interval * 1000);
 }
 
 /**
@@ -53,9 +54,14 @@ CTimer::CTimer(unsigned int Interval, bool Repeat, TimerProc Function, void *Coo
  * Destroys a timer.
  */
 CTimer::~CTimer(void) {
-	g_Timers->Remove(m_Link);
+	Unschedule();
 
-	RescheduleTimers();
+	// the timer might be destroyed while CallTimers() is running
+	for (int i = 0; i < g_DueCount; i++) {
+		if (g_DueTimers[i] == this) {
+			g_DueTimers[i] = NULL;
+		}
+	}
 }
 
 /**
@@ -72,20 +78,21 @@ void CTimer::Destroy(void) {
  *
  * Calls the timer's function
  *
- * @param Now the current time
+ * @param Now the current time (in milliseconds)
  */
-bool CTimer::Call(time_t Now) {
+bool CTimer::Call(int64_t Now) {
 	time_t ThisCall;
 	bool ReturnValue;
 
-	ThisCall = m_Next;
+	ThisCall = (time_t)(m_Next / 1000);
 
-	if (m_Interval != 0 && m_Repeat) {
-		Reschedule(Now + m_Interval);
+	if (m_Repeat) {
+		// timers without an interval are called at most once per second
+		RescheduleMs(Now + (m_Interval != 0 ? (int64_t)m_Interval * 1000 : 1000));
 	}
 
 	if (m_Proc == NULL) {
-		if (m_Interval == 0) {
+		if (m_Interval == 0 || !m_Repeat) {
 			Destroy();
 
 			return false;
@@ -111,10 +118,19 @@ bool CTimer::Call(time_t Now) {
  * Returns the next scheduled time of execution.
  */
 time_t CTimer::GetNextCall(void) {
-	if (g_NextCall == 0) {
-		return g_CurrentTime + 120;
+	return (time_t)((GetNextCallMs() + 999) / 1000);
+}
+
+/**
+ * GetNextCallMs
+ *
+ * Returns the next scheduled time of execution (in milliseconds).
+ */
+int64_t CTimer::GetNextCallMs(void) {
+	if (g_TimerCount == 0) {
+		return GetCurrentTimeMs() + 120 * 1000;
 	} else {
-		return g_NextCall;
+		return g_Timers[0]->m_Next;
 	}
 }
 
@@ -144,41 +160,201 @@ bool CTimer::GetRepeat(void) const {
  * @param Next the next call
  */
 void CTimer::Reschedule(time_t Next) {
+	RescheduleMs((int64_t)Next * 1000);
+}
+
+/**
+ * RescheduleMs
+ *
+ * Reschedules the next call for the timer.
+ *
+ * @param Next the next call (in milliseconds)
+ */
+void CTimer::RescheduleMs(int64_t Next) {
+	int64_t Previous = m_Next;
+
 	m_Next = Next;
 
-	if (Next < g_NextCall || g_NextCall == 0) {
-		g_NextCall = Next;
+	if (m_Index != -1) {
+		if (Next < Previous) {
+			SiftUp(m_Index);
+		} else {
+			SiftDown(m_Index);
+		}
+
+		return;
+	}
+
+	if (g_TimerCount == g_TimerAlloc) {
+		int NewAlloc = (g_TimerAlloc != 0) ? g_TimerAlloc * 2 : 64;
+		CTimer **NewTimers = (CTimer **)realloc(g_Timers, NewAlloc * sizeof(CTimer *));
+
+		if (AllocFailed(NewTimers)) {
+			g_Bouncer->Fatal();
+		}
+
+		g_Timers = NewTimers;
+		g_TimerAlloc = NewAlloc;
 	}
+
+	m_Index = g_TimerCount++;
+	g_Timers[m_Index] = this;
+
+	SiftUp(m_Index);
 }
 
-void CTimer::DestroyAllTimers(void) {
-	for (CListCursor<CTimer *> TimerCursor(g_Timers); TimerCursor.IsValid(); TimerCursor.Proceed()) {
-		delete *TimerCursor;
+/**
+ * Unschedule
+ *
+ * Removes the timer from the timer heap.
+ */
+void CTimer::Unschedule(void) {
+	int Index = m_Index;
+
+	if (Index == -1) {
+		return;
 	}
+
+	m_Index = -1;
+	g_TimerCount--;
+
+	if (Index == g_TimerCount) {
+		return;
+	}
+
+	g_Timers[Index] = g_Timers[g_TimerCount];
+	g_Timers[Index]->m_Index = Index;
+
+	SiftUp(Index);
+	SiftDown(g_Timers[Index]->m_Index);
 }
 
-void CTimer::CallTimers(void) {
-	g_NextCall = 0;
+/**
+ * SiftUp
+ *
+ * Moves a timer towards the root of the heap until the heap
+ * property is restored.
+ *
+ * @param Index the timer's index
+ */
+void CTimer::SiftUp(int Index) {
+	CTimer *Timer = g_Timers[Index];
+
+	while (Index > 0) {
+		int Parent = (Index - 1) / 2;
 
-	for (CListCursor<CTimer *> TimerCursor(g_Timers); TimerCursor.IsValid(); TimerCursor.Proceed()) {
-		if (g_CurrentTime >= (*TimerCursor)->m_Next) {
-			(*TimerCursor)->Call(g_CurrentTime);
-		} else if ((*TimerCursor)->m_Next < g_NextCall || g_NextCall == 0) {
-			g_NextCall = (*TimerCursor)->m_Next;
+		if (g_Timers[Parent]->m_Next <= Timer->m_Next) {
+			break;
 		}
+
+		g_Timers[Index] = g_Timers[Parent];
+		g_Timers[Index]->m_Index = Index;
+
+		Index = Parent;
+	}
+
+	g_Timers[Index] = Timer;
+	Timer->m_Index = Index;
+}
+
+/**
+ * SiftDown
+ *
+ * Moves a timer away from the root of the heap until the heap
+ * property is restored.
+ *
+ * @param Index the timer's index
+ */
+void CTimer::SiftDown(int Index) {
+	CTimer *Timer = g_Timers[Index];
+
+	while (true) {
+		int Child = Index * 2 + 1;
+
+		if (Child >= g_TimerCount) {
+			break;
+		}
+
+		if (Child + 1 < g_TimerCount && g_Timers[Child + 1]->m_Next < g_Timers[Child]->m_Next) {
+			Child++;
+		}
+
+		if (Timer->m_Next <= g_Timers[Child]->m_Next) {
+			break;
+		}
+
+		g_Timers[Index] = g_Timers[Child];
+		g_Timers[Index]->m_Index = Index;
+
+		Index = Child;
+	}
+
+	g_Timers[Index] = Timer;
+	Timer->m_Index = Index;
+}
+
+/**
+ * DestroyAllTimers
+ *
+ * Destroys all timers.
+ */
+void CTimer::DestroyAllTimers(void) {
+	while (g_TimerCount > 0) {
+		delete g_Timers[g_TimerCount - 1];
 	}
+
+	free(g_Timers);
+	g_Timers = NULL;
+	g_TimerAlloc = 0;
 }
 
-void CTimer::RescheduleTimers(void) {
-	time_t Best;
+/**
+ * CallTimers
+ *
+ * Calls all timers which are due. Only timers at the top of the heap
+ * have to be looked at.
+ */
+void CTimer::CallTimers(void) {
+	int64_t Now = GetCurrentTimeMs();
+
+	if (g_DueCount > 0) {
+		// CallTimers() was called from within a timer function
+		return;
+	}
+
+	while (g_TimerCount > 0 && g_Timers[0]->m_Next <= Now) {
+		CTimer *Timer = g_Timers[0];
+
+		Timer->Unschedule();
 
-	Best = g_CurrentTime + 120;
+		if (g_DueCount == g_DueAlloc) {
+			int NewAlloc = (g_DueAlloc != 0) ? g_DueAlloc * 2 : 16;
+			CTimer **NewDueTimers = (CTimer **)realloc(g_DueTimers, NewAlloc * sizeof(CTimer *));
 
-	for (CListCursor<CTimer *> TimerCursor(g_Timers); TimerCursor.IsValid(); TimerCursor.Proceed()) {
-		if ((*TimerCursor)->m_Next < Best) {
-			Best = (*TimerCursor)->m_Next;
+			if (AllocFailed(NewDueTimers)) {
+				g_Bouncer->Fatal();
+			}
+
+			g_DueTimers = NewDueTimers;
+			g_DueAlloc = NewAlloc;
 		}
+
+		g_DueTimers[g_DueCount++] = Timer;
+	}
+
+	// timers are collected first so that repeating timers which are
+	// rescheduled by Call() are not called again in this pass
+	for (int i = 0; i < g_DueCount; i++) {
+		CTimer *Timer = g_DueTimers[i];
+
+		if (Timer == NULL) {
+			continue;
+		}
+
+		g_DueTimers[i] = NULL;
+
+		Timer->Call(Now);
 	}
 
-	g_NextCall = Best;
+	g_DueCount = 0;
 }
@@ -25,7 +25,8 @@ typedef bool (*TimerProc)(time_t CurrentTime, void *Cookie);
 /**
  * CTimer
  *
- * A timer.
+ * A timer. Timers are kept in a binary heap which is ordered by their
+ * next scheduled time of execution (in milliseconds).
  */
 class SBNCAPI CTimer {
 private:
@@ -33,11 +34,14 @@ private:
 	void *m_Cookie; /**< a user-specific pointer which is passed to the timer's function */
 	unsigned int m_Interval; /**< the timer's interval */
 	bool m_Repeat; /**< determines whether the timer is executed repeatedly */
-	time_t m_Next; /**< the next scheduled time of execution */
-	link_t<CTimer *> *m_Link; /**< link in the timer list */
+	int64_t m_Next; /**< the next scheduled time of execution (in milliseconds) */
+	int m_Index; /**< the timer's index in the timer heap, or -1 */
 
-	bool Call(time_t Now);
-	static void RescheduleTimers(void);
+	bool Call(int64_t Now);
+	void Unschedule(void);
+
+	static void SiftUp(int Index);
+	static void SiftDown(int Index);
 
 public:
 #ifndef SWIG
@@ -46,6 +50,7 @@ public:
 #endif /* SWIG */
 
 	static time_t GetNextCall(void);
+	static int64_t GetNextCallMs(void);
 	static void DestroyAllTimers(void);
 	static void CallTimers(void);
 
@@ -53,6 +58,7 @@ public:
 	bool GetRepeat(void) const;
 
 	void Reschedule(time_t Next);
+	void RescheduleMs(int64_t Next);
 
 	void Destroy(void);
 };
@@ -23,19 +23,24 @@ extern time_t g_LastReconnect;
 
 CTimer *g_ReconnectTimer = NULL;
 
+static CUser **g_ReconnectQueue = NULL; /**< users without an IRC connection, ordered by m_ReconnectTime */
+static int g_ReconnectCount = 0; /**< number of users in the reconnect queue */
+static int g_ReconnectAlloc = 0; /**< number of allocated slots in the reconnect queue */
+static CUser *g_ConnectingUser = NULL; /**< the user who made the last connect() attempt */
+static CTimer *g_LoadTimer = NULL; /**< loads users which have not been needed yet */
+static int g_LoadIndex = 0; /**< the next user the load timer looks at */
+
 /**
  * CUser
  *
- * Constructs a new user object.
+ * Constructs a new user object. Only the parts which are needed to list
+ * the user are set up here, everything else is loaded by Load() once the
+ * user actually needs it.
  *
  * @param Name the name of the user
  */
 CUser::CUser(const char *Name) {
 	char *Out;
-#ifdef HAVE_LIBSSL
-	X509 *Cert;
-	FILE *ClientCert;
-#endif
 	int rc;
 
 	m_PrimaryClient = NULL;
@@ -67,6 +72,7 @@ CUser::CUser(const char *Name) {
 
 	m_ReconnectTime = 0;
 	m_LastReconnect = 0;
+	m_ReconnectIndex = -1;
 	m_NextProtocolFamily = AF_UNSPEC;
 
 	rc = asprintf(&Out, "users/%s.log", Name);
@@ -83,15 +89,50 @@ CUser::CUser(const char *Name) {
 		g_Bouncer->Fatal();
 	}
 
+	m_Backlog = NULL;
+	m_Loaded = false;
+
 	m_ClientStats = new CTrafficStats();
 	m_IRCStats = new CTrafficStats();
 
 	m_Keys = new CKeyring(m_Config, this);
 
-	m_BadLoginPulse = new CTimer(200, true, BadLoginTimer, this);
+	m_BadLoginPulse = NULL;
+	m_AttachReplayTimer = NULL;
+
+	// the reconnect timer loads the user when it gets to this entry
+	m_ReconnectTime = g_CurrentTime;
+	QueueReconnect();
+
+	if (g_LoadTimer == NULL) {
+		g_LoadIndex = 0;
+		g_LoadTimer = new CTimer(1, true, UserLoadTimer, NULL);
+	}
+}
+
+/**
+ * Load
+ *
+ * Reads the user's configuration file and client certificates and
+ * registers admins with the bouncer. This is done when the user first
+ * needs an IRC connection or a client connection.
+ */
+void CUser::Load(void) {
+#ifdef HAVE_LIBSSL
+	char *Out;
+	X509 *Cert;
+	FILE *ClientCert;
+	int rc;
+#endif
+
+	if (m_Loaded) {
+		return;
+	}
+
+	m_Loaded = true;
 
 #ifdef HAVE_LIBSSL
-	rc = asprintf(&Out, "users/%s.pem", Name);
+	rc = asprintf(&Out, "users/%s.pem", m_Name);
 
 	if (RcFailed(rc)) {
 		g_Bouncer->Fatal();
@@ -108,11 +149,10 @@ CUser::CUser(const char *Name) {
 
 		fclose(ClientCert);
 	}
-
 #endif
 
 	if (IsQuitted() != 2) {
-		ScheduleReconnect();
+		CacheSetInteger(m_ConfigCache, quitted, 0);
 	}
 
 	if (IsAdmin()) {
@@ -120,6 +160,15 @@ CUser::CUser(const char *Name) {
 	}
 }
 
+/**
+ * IsLoaded
+ *
+ * Returns whether Load() has been called for the user.
+ */
+bool CUser::IsLoaded(void) const {
+	return m_Loaded;
+}
+
 /**
  * ~CUser
  *
@@ -132,9 +181,19 @@ CUser::~CUser(void) {
 		m_IRC->Kill("-)(- If you can't see the fnords, they can't eat you.");
 	}
 
+	UnqueueReconnect();
+
+	if (g_ConnectingUser == this) {
+		g_ConnectingUser = NULL;
+	}
+
 	m_Config->Destroy();
 	delete m_Log;
 
+	if (m_Backlog != NULL) {
+		delete m_Backlog;
+	}
+
 	delete m_ClientStats;
 	delete m_IRCStats;
 
@@ -146,6 +205,10 @@ CUser::~CUser(void) {
 		m_BadLoginPulse->Destroy();
 	}
 
+	if (m_AttachReplayTimer != NULL) {
+		m_AttachReplayTimer->Destroy();
+	}
+
 #ifdef HAVE_LIBSSL
 	for (int i = 0; i < m_ClientCertificates.GetLength(); i++) {
 		X509_free(m_ClientCertificates[i]);
@@ -214,9 +277,9 @@ void CUser::Attach(CClientConnection *Client) {
 	char *Out;
 	const char *Reason, *AutoModes, *IrcNick, *MotdText;
 	CLog *Motd;
-	int i;
 	bool Added = false;
 	bool FirstClient;
+	time_t LastSeen;
 	int rc;
 
 	if (IsLocked()) {
@@ -242,6 +305,7 @@ void CUser::Attach(CClientConnection *Client) {
 	}
 
 	FirstClient = (m_Clients.GetLength() == 0);
+	LastSeen = GetLastSeen();
 
 	Client->SetOwner(this);
 
@@ -285,77 +349,44 @@ void CUser::Attach(CClientConnection *Client) {
 			AddClientConnection(Client);
 			Added = true;
 
-			CChannel **Channels;
-
-			Channels = (CChannel **)malloc(sizeof(CChannel *) * m_IRC->GetChannels()->GetLength());
-
-			if (AllocFailed(Channels)) {
-				delete Motd;
-
-				return;
-			}
-
-			i = 0;
-			while (hash_t<CChannel *> *ChannelHash = m_IRC->GetChannels()->Iterate(i++)) {
-				Channels[i - 1] = ChannelHash->Value;
-			}
-
-			int (*SortFunction)(const void *p1, const void *p2) = NULL;
+			const CVector<CChannel *> *Channels = GetAttachChannels();
+			attachreplay_t Replay;
 
-			const char *SortMode = CacheGetString(m_ConfigCache, channelsort);
+			Replay.Client = Client;
+			Replay.Channels = (char **)malloc(Channels->GetLength() * sizeof(char *) + 1);
+			Replay.Count = 0;
+			Replay.Next = 0;
+			Replay.BacklogSince = LastSeen;
 
-			if (SortMode == NULL || strcasecmp(SortMode, "cts") == 0 || strcasecmp(SortMode, "") == 0) {
-				SortFunction = ChannelTSCompare;
-			} else if (strcasecmp(SortMode, "alpha") == 0) {
-				SortFunction = ChannelNameCompare;
-			} else if (strcasecmp(SortMode, "custom") == 0) {
-				const CVector<CModule *> *Modules = g_Bouncer->GetModules();
+			if (!AllocFailed(Replay.Channels)) {
+				for (int i = 0; i < Channels->GetLength(); i++) {
+					Replay.Channels[i] = strdup((*Channels)[i]->GetName());
 
-				for (i = 0; i < Modules->GetLength(); i++) {
-					SortFunction = (int (*)(const void *p1, const void *p2))(*Modules)[i]->Command("sorthandler", GetUsername());
-
-					if (SortFunction != NULL) {
+					if (AllocFailed(Replay.Channels[i])) {
 						break;
 					}
-				}
-			}
 
-			if (SortFunction == NULL) {
-				SortFunction = ChannelTSCompare;
+					Replay.Count++;
+				}
 			}
 
-			qsort(Channels, m_IRC->GetChannels()->GetLength(), sizeof(Channels[0]), SortFunction);
-
-			const char *Site = m_IRC->GetSite();
-
-			i = 0;
-			for (i = 0; i < m_IRC->GetChannels()->GetLength(); i++) {
-				Client->WriteLine(":%s!%s JOIN %s", m_IRC->GetCurrentNick(), Site ? Site : "unknown@unknown.host", Channels[i]->GetName());
-
-				rc = asprintf(&Out, "TOPIC %s", Channels[i]->GetName());
+			if (Replay.Channels == NULL || Replay.Count < Channels->GetLength() || IsError(m_AttachReplays.Insert(Replay))) {
+				if (Replay.Channels != NULL) {
+					for (int i = 0; i < Replay.Count; i++) {
+						free(Replay.Channels[i]);
+					}
 
-				if (RcFailed(rc)) {
-					Client->Kill("Internal error.");
-				} else {
-					Client->ParseLine(Out);
-					free(Out);
+					free(Replay.Channels);
 				}
 
-				rc = asprintf(&Out, "NAMES %s", Channels[i]->GetName());
+				Client->Kill("Internal error.");
+			} else if (!ContinueAttachReplay(Client, ATTACHREPLAYCHANNELS) && m_AttachReplayTimer == NULL) {
+				m_AttachReplayTimer = new CTimer(0, false, AttachReplayTimer, this);
 
-				if (RcFailed(rc)) {
-					Client->Kill("Internal error.");
-				} else {
-					Client->ParseLine(Out);
-					free(Out);
-				}
-
-				if (GetAutoBacklog() != NULL && strcasecmp(GetAutoBacklog(), "off") != 0) {
-					Channels[i]->PlayBacklog(Client);
+				if (AllocFailed(m_AttachReplayTimer)) {
+					FlushAttachReplays(Client);
 				}
 			}
-
-			free(Channels);
 		}
 	} else {
 		Client->WriteLine(":shroudbnc.info 001 %s :Welcome to the Internet Relay Network %s", Client->GetNick(), Client->GetNick());
@@ -408,6 +439,247 @@ void CUser::Attach(CClientConnection *Client) {
 	}
 }
 
+/**
+ * GetAttachChannels
+ *
+ * Returns the user's channels in the order in which they are sent to
+ * attaching clients (see the "channelsort" setting).
+ */
+const CVector<CChannel *> *CUser::GetAttachChannels(void) {
+	int (*SortFunction)(const void *p1, const void *p2) = NULL;
+
+	const char *SortMode = CacheGetString(m_ConfigCache, channelsort);
+
+	if (SortMode == NULL || strcasecmp(SortMode, "cts") == 0 || strcasecmp(SortMode, "") == 0) {
+		SortFunction = ChannelTSCompare;
+	} else if (strcasecmp(SortMode, "alpha") == 0) {
+		SortFunction = ChannelNameCompare;
+	} else if (strcasecmp(SortMode, "custom") == 0) {
+		const CVector<CModule *> *Modules = g_Bouncer->GetModules();
+
+		for (int i = 0; i < Modules->GetLength(); i++) {
+			SortFunction = (int (*)(const void *p1, const void *p2))(*Modules)[i]->Command("sorthandler", GetUsername());
+
+			if (SortFunction != NULL) {
+				break;
+			}
+		}
+	}
+
+	if (SortFunction == NULL) {
+		SortFunction = ChannelTSCompare;
+	}
+
+	return m_IRC->GetSortedChannels(SortFunction);
+}
+
+/**
+ * ReplayChannel
+ *
+ * Sends a channel's JOIN, topic, nicklist and backlog to a client
+ * which has attached to the user.
+ *
+ * @param Client the client
+ * @param Channel the channel
+ * @param BacklogSince the timestamp of the oldest backlog line which is sent
+ */
+void CUser::ReplayChannel(CClientConnection *Client, CChannel *Channel, time_t BacklogSince) {
+	const char *Site = m_IRC->GetSite();
+
+	Client->WriteLine(":%s!%s JOIN %s", m_IRC->GetCurrentNick(), Site ? Site : "unknown@unknown.host", Channel->GetName());
+
+	Channel->SendTopicReply(Client);
+	Channel->SendNamesReply(Client);
+
+	if (GetAutoBacklog() != NULL && strcasecmp(GetAutoBacklog(), "off") != 0) {
+		Channel->PlayBacklog(Client, BacklogSince);
+	}
+}
+
+/**
+ * ContinueAttachReplay
+ *
+ * Sends up to Count channels to a client which has attached to the
+ * user. Returns true if the client has received all channels (or is gone).
+ *
+ * @param Client the client
+ * @param Count the maximum number of channels
+ */
+bool CUser::ContinueAttachReplay(CClientConnection *Client, int Count) {
+	while (true) {
+		int Index = -1;
+		char *Name;
+		CChannel *Channel;
+
+		// the client might have been removed while sending the last channel
+		for (int i = 0; i < m_AttachReplays.GetLength(); i++) {
+			if (m_AttachReplays[i].Client == Client) {
+				Index = i;
+
+				break;
+			}
+		}
+
+		if (Index == -1) {
+			return true;
+		}
+
+		attachreplay_t *Replay = m_AttachReplays.GetAddressOf(Index);
+
+		// channels which were sent out of order are skipped
+		while (Replay->Next < Replay->Count && Replay->Channels[Replay->Next] == NULL) {
+			Replay->Next++;
+		}
+
+		if (m_IRC == NULL || Replay->Next >= Replay->Count) {
+			RemoveAttachReplay(Index);
+
+			return true;
+		}
+
+		if (Count == 0) {
+			return false;
+		}
+
+		Count--;
+
+		Name = Replay->Channels[Replay->Next];
+		Replay->Channels[Replay->Next++] = NULL;
+
+		Channel = m_IRC->GetChannel(Name);
+
+		free(Name);
+
+		if (Channel != NULL) {
+			ReplayChannel(Client, Channel, Replay->BacklogSince);
+		}
+	}
+}
+
+/**
+ * RemoveAttachReplay
+ *
+ * Removes a client from the list of clients which are still receiving
+ * their channels.
+ *
+ * @param Index the index of the client in m_AttachReplays
+ */
+void CUser::RemoveAttachReplay(int Index) {
+	attachreplay_t *Replay = m_AttachReplays.GetAddressOf(Index);
+
+	for (int i = 0; i < Replay->Count; i++) {
+		free(Replay->Channels[i]);
+	}
+
+	free(Replay->Channels);
+
+	m_AttachReplays.Remove(Index);
+}
+
+/**
+ * ContinueAttachReplays
+ *
+ * Sends the next few channels to all clients which are still receiving
+ * their channels.
+ */
+void CUser::ContinueAttachReplays(void) {
+	for (int i = m_AttachReplays.GetLength() - 1; i >= 0; i--) {
+		if (i < m_AttachReplays.GetLength()) {
+			ContinueAttachReplay(m_AttachReplays[i].Client, ATTACHREPLAYCHANNELS);
+		}
+	}
+
+	if (m_AttachReplays.GetLength() > 0 && m_AttachReplayTimer == NULL) {
+		m_AttachReplayTimer = new CTimer(0, false, AttachReplayTimer, this);
+
+		if (AllocFailed(m_AttachReplayTimer)) {
+			FlushAttachReplays();
+		}
+	}
+}
+
+/**
+ * FlushAttachReplays
+ *
+ * Sends all remaining channels to clients which are still receiving
+ * their channels.
+ *
+ * @param Client the client, or NULL for all clients
+ */
+void CUser::FlushAttachReplays(CClientConnection *Client) {
+	for (int i = m_AttachReplays.GetLength() - 1; i >= 0; i--) {
+		if (i < m_AttachReplays.GetLength() && (Client == NULL || m_AttachReplays[i].Client == Client)) {
+			ContinueAttachReplay(m_AttachReplays[i].Client, INT_MAX);
+		}
+	}
+}
+
+/**
+ * FlushAttachReplayChannels
+ *
+ * Sends those of the specified channels which have not been sent yet to
+ * clients which are still receiving their channels. This has to happen
+ * before a line which refers to these channels is passed on to the
+ * clients.
+ *
+ * @param Client the client, or NULL for all clients
+ * @param argc the number of arguments
+ * @param argv the arguments of the line, which may contain lists of
+ *             channels separated by commas
+ */
+void CUser::FlushAttachReplayChannels(CClientConnection *Client, int argc, const char **argv) {
+	if (m_AttachReplays.GetLength() == 0 || m_IRC == NULL) {
+		return;
+	}
+
+	for (int a = 0; a < argc; a++) {
+		const char *Token = argv[a];
+
+		while (*Token != '\0') {
+			const char *Comma = strchr(Token, ',');
+			size_t Length = (Comma != NULL) ? (size_t)(Comma - Token) : strlen(Token);
+
+			for (int i = m_AttachReplays.GetLength() - 1; i >= 0; i--) {
+				if (i >= m_AttachReplays.GetLength()) {
+					continue;
+				}
+
+				attachreplay_t *Replay = m_AttachReplays.GetAddressOf(i);
+
+				if (Client != NULL && Replay->Client != Client) {
+					continue;
+				}
+
+				for (int c = Replay->Next; c < Replay->Count; c++) {
+					char *Name = Replay->Channels[c];
+
+					if (Name == NULL || strncasecmp(Name, Token, Length) != 0 || Name[Length] != '\0') {
+						continue;
+					}
+
+					Replay->Channels[c] = NULL;
+
+					CChannel *Channel = m_IRC->GetChannel(Name);
+
+					free(Name);
+
+					if (Channel != NULL) {
+						ReplayChannel(Replay->Client, Channel, Replay->BacklogSince);
+					}
+
+					break;
+				}
+			}
+
+			if (Comma == NULL) {
+				break;
+			}
+
+			Token = Comma + 1;
+		}
+	}
+}
+
 /**
  * CheckPassword
  *
@@ -595,7 +867,9 @@ bool CUser::IsRegisteredClientConnection(CClientConnection *Client) {
  */
 void CUser::Reconnect(void) {
 	const char *Server;
-	int Port, i;
+	int Port;
+
+	Load();
 
 	if (m_IRC != NULL) {
 		m_IRC->Kill("Reconnecting.");
@@ -614,15 +888,11 @@ void CUser::Reconnect(void) {
 
 	g_Bouncer->LogUser(this, "Trying to reconnect to [%s]:%d for user %s", Server, Port, m_Name);
 
-	i = 0;
-	while (hash_t<CUser *> *UserHash = g_Bouncer->GetUsers()->Iterate(i++)) {
-		CIRCConnection *IRC;
-
-		IRC = UserHash->Value->GetIRCConnection();
-
-		if (IRC != NULL && IRC->GetState() != State_Connected) {
-			IRC->Kill("Timed out.");
-		}
+	// all other connection attempts were given up when the last one was
+	// made, so that is the only one which might still be in progress
+	if (g_ConnectingUser != NULL && g_ConnectingUser->GetIRCConnection() != NULL &&
+			g_ConnectingUser->GetIRCConnection()->GetState() != State_Connected) {
+		g_ConnectingUser->GetIRCConnection()->Kill("Timed out.");
 	}
 
 	m_LastReconnect = g_CurrentTime;
@@ -651,6 +921,8 @@ void CUser::Reconnect(void) {
 
 	SetIRCConnection(Connection);
 
+	g_ConnectingUser = this;
+
 	RescheduleReconnectTimer();
 }
 
@@ -713,6 +985,7 @@ void CUser::ScheduleReconnect(int Delay) {
 	if (m_ReconnectTime < g_CurrentTime + MaxDelay) {
 		m_ReconnectTime = g_CurrentTime + MaxDelay;
 
+		QueueReconnect();
 		RescheduleReconnectTimer();
 	}
 
@@ -750,6 +1023,33 @@ CLog *CUser::GetLog(void) {
 	return m_Log;
 }
 
+/**
+ * GetBacklog
+ *
+ * Returns the channel backlog for the user.
+ */
+CBacklog *CUser::GetBacklog(void) {
+	char *Out;
+
+	if (m_Backlog == NULL) {
+		int rc = asprintf(&Out, "users/%s.backlog", m_Name);
+
+		if (RcFailed(rc)) {
+			g_Bouncer->Fatal();
+		}
+
+		m_Backlog = new CBacklog(g_Bouncer->BuildPathConfig(Out), g_Bouncer->GetBacklogSize());
+
+		free(Out);
+
+		if (AllocFailed(m_Backlog)) {
+			g_Bouncer->Fatal();
+		}
+	}
+
+	return m_Backlog;
+}
+
 /**
  * Log
  *
@@ -807,6 +1107,8 @@ void CUser::SetIRCConnection(CIRCConnection *IRC) {
 	CIRCConnection *OldIRC;
 	bool WasNull;
 
+	FlushAttachReplays();
+
 	if (GetClientConnectionMultiplexer() != NULL && m_IRC != NULL) {
 		GetClientConnectionMultiplexer()->SetNick(m_IRC->GetCurrentNick());
 	}
@@ -830,6 +1132,12 @@ void CUser::SetIRCConnection(CIRCConnection *IRC) {
 	OldIRC = m_IRC;
 	m_IRC = IRC;
 
+	if (IRC == NULL) {
+		QueueReconnect();
+	} else {
+		UnqueueReconnect();
+	}
+
 	Modules = g_Bouncer->GetModules();
 
 	if (IRC == NULL && !WasNull) {
@@ -887,6 +1195,8 @@ void CUser::AddClientConnection(CClientConnection *Client, bool Silent) {
 	client_t OldestClient = {};
 	time_t ThisTimestamp;
 
+	Load();
+
 	ThisTimestamp = g_CurrentTime;
 
 	for (i = 0; i < m_Clients.GetLength(); i++) {
@@ -980,6 +1290,14 @@ void CUser::RemoveClientConnection(CClientConnection *Client, bool Silent) {
 
 	LastClient = (m_Clients.GetLength() == 1);
 
+	for (i = 0; i < m_AttachReplays.GetLength(); i++) {
+		if (m_AttachReplays[i].Client == Client) {
+			RemoveAttachReplay(i);
+
+			break;
+		}
+	}
+
 	if (!Silent) {
 		const char *Plural = "s";
 
@@ -1110,6 +1428,8 @@ CVector<client_t> *CUser::GetClientConnections(void) {
  * @param Admin a boolean flag
  */
 void CUser::SetAdmin(bool Admin) {
+	Load();
+
 	CacheSetInteger(m_ConfigCache, admin, Admin ? 1 : 0);
 
 	if (Admin) {
@@ -1254,6 +1574,8 @@ void CUser::MarkQuitted(bool RequireManualJump) {
  */
 void CUser::UnmarkQuitted(void) {
 	CacheSetInteger(m_ConfigCache, quitted, 0);
+
+	QueueReconnect();
 }
 
 /**
@@ -1293,6 +1615,10 @@ void CUser::LogBadLogin(sockaddr *Peer) {
 	memcpy(BadLogin.Address, Peer, SOCKADDR_LEN(Peer->sa_family));
 
 	m_BadLogins.Insert(BadLogin);
+
+	if (m_BadLoginPulse == NULL) {
+		m_BadLoginPulse = new CTimer(200, true, BadLoginTimer, this);
+	}
 }
 
 /**
@@ -1372,9 +1698,30 @@ CKeyring *CUser::GetKeyring(void) {
 bool BadLoginTimer(time_t Now, void *User) {
 	((CUser *)User)->BadLoginPulse();
 
+	if (((CUser *)User)->m_BadLogins.GetLength() == 0) {
+		((CUser *)User)->m_BadLoginPulse = NULL;
+
+		return false;
+	}
+
 	return true;
 }
 
+/**
+ * AttachReplayTimer
+ *
+ * Continues sending channels to clients which have attached.
+ *
+ * @param Now the current time
+ * @param User a CUser object
+ */
+bool AttachReplayTimer(time_t Now, void *User) {
+	((CUser *)User)->m_AttachReplayTimer = NULL;
+	((CUser *)User)->ContinueAttachReplays();
+
+	return false;
+}
+
 /**
  * UserReconnectTimer
  *
@@ -1403,6 +1750,7 @@ bool UserReconnectTimer(time_t Now, void *User) {
 	}
 
 	((CUser *)User)->m_ReconnectTime = g_CurrentTime;
+	((CUser *)User)->QueueReconnect();
 
 	return false;
 }
@@ -1605,6 +1953,8 @@ void CUser::SetDropModes(const char *DropModes) {
  */
 const CVector<X509 *> *CUser::GetClientCertificates(void) const {
 #ifdef HAVE_LIBSSL
+	const_cast<CUser *>(this)->Load();
+
 	return &m_ClientCertificates;
 #else
 	return NULL;
@@ -1622,6 +1972,8 @@ bool CUser::AddClientCertificate(const X509 *Certificate) {
 #ifdef HAVE_LIBSSL
 	X509 *DuplicateCertificate;
 
+	Load();
+
 	for (int i = 0; i < m_ClientCertificates.GetLength(); i++) {
 		if (X509_cmp(m_ClientCertificates[i], Certificate) == 0) {
 			return true;
@@ -1647,6 +1999,8 @@ bool CUser::AddClientCertificate(const X509 *Certificate) {
  */
 bool CUser::RemoveClientCertificate(const X509 *Certificate) {
 #ifdef HAVE_LIBSSL
+	Load();
+
 	for (int i = 0; i < m_ClientCertificates.GetLength(); i++) {
 		if (X509_cmp(m_ClientCertificates[i], Certificate) == 0) {
 			X509_free(m_ClientCertificates[i]);
@@ -1718,6 +2072,8 @@ bool CUser::PersistCertificates(void) {
  */
 bool CUser::FindClientCertificate(const X509 *Certificate) const {
 #ifdef HAVE_LIBSSL
+	const_cast<CUser *>(this)->Load();
+
 	for (int i = 0; i < m_ClientCertificates.GetLength(); i++) {
 		if (X509_cmp(m_ClientCertificates[i], Certificate) == 0) {
 			return true;
@@ -1991,47 +2347,230 @@ const char *CUser::SimulateWithResult(const char *Command) {
 	return FakeClient->GetData();
 }
 
-bool GlobalUserReconnectTimer(time_t Now, void *Null) {
-	int i = 0;
+/**
+ * UserLoadTimer
+ *
+ * Loads up to USERLOADBATCH users which have not been loaded on demand yet.
+ *
+ * @param Now the current time
+ * @param Null not used
+ */
+bool UserLoadTimer(time_t Now, void *Null) {
+	hash_t<CUser *> *User = NULL;
+	int Count = 0;
 
-	while (hash_t<CUser *> *UserHash = g_Bouncer->GetUsers()->Iterate(i++)) {
-		if (UserHash->Value->ShouldReconnect() && g_Bouncer->GetStatus() == Status_Running) {
-			UserHash->Value->Reconnect();
+	while (Count < USERLOADBATCH && (User = g_Bouncer->GetUsers()->Iterate(g_LoadIndex)) != NULL) {
+		g_LoadIndex++;
 
-			break;
+		if (!User->Value->IsLoaded()) {
+			User->Value->Load();
+
+			Count++;
 		}
 	}
 
+	if (User == NULL) {
+		g_LoadTimer = NULL;
+
+		return false;
+	}
+
+	return true;
+}
+
+bool GlobalUserReconnectTimer(time_t Now, void *Null) {
 	CUser::RescheduleReconnectTimer();
 
 	return true;
 }
 
+/**
+ * RescheduleReconnectTimer
+ *
+ * Reconnects the first user in the reconnect queue if that user is due
+ * and schedules the reconnect timer for the next one.
+ */
 void CUser::RescheduleReconnectTimer(void) {
-	int i = 0;
 	time_t ReconnectTime;
+	int Interval;
 
 	if (g_ReconnectTimer == NULL) {
 		g_ReconnectTimer = new CTimer(20, true, GlobalUserReconnectTimer, NULL);
 	}
 
-	ReconnectTime = g_ReconnectTimer->GetNextCall();
+	Interval = g_Bouncer->GetInterval();
 
-	if (g_Bouncer->GetStatus() == Status_Running) {
-		while (hash_t<CUser *> *UserHash = g_Bouncer->GetUsers()->Iterate(i++)) {
-			if (UserHash->Value->m_ReconnectTime >= g_CurrentTime &&
-					UserHash->Value->m_ReconnectTime < ReconnectTime &&
-					UserHash->Value->GetIRCConnection() == NULL) {
-				ReconnectTime = UserHash->Value->m_ReconnectTime;
-			} else if (UserHash->Value->ShouldReconnect()) {
-				UserHash->Value->Reconnect();
-			}
+	if (Interval == 0) {
+		Interval = 25;
+	}
+
+	while (g_ReconnectCount > 0 && g_Bouncer->GetStatus() == Status_Running) {
+		CUser *User = g_ReconnectQueue[0];
+
+		if (User->m_ReconnectTime > g_CurrentTime || g_CurrentTime - g_LastReconnect <= Interval) {
+			break;
+		}
+
+		User->Load();
+
+		// SetServer() and UnmarkQuitted() queue the user again
+		if (User->GetServer() == NULL || User->IsQuitted() != 0) {
+			User->UnqueueReconnect();
+
+			continue;
+		}
+
+		if (!User->IsAdmin() && g_CurrentTime - User->m_LastReconnect <= 120) {
+			User->m_ReconnectTime = User->m_LastReconnect + 121;
+			SiftReconnectDown(User->m_ReconnectIndex);
+
+			continue;
 		}
+
+		User->Reconnect();
+
+		break;
+	}
+
+	if (g_ReconnectCount == 0) {
+		return;
+	}
+
+	ReconnectTime = g_ReconnectQueue[0]->m_ReconnectTime;
+
+	if (ReconnectTime <= g_LastReconnect + Interval) {
+		ReconnectTime = g_LastReconnect + Interval + 1;
 	}
 
 	g_ReconnectTimer->Reschedule(ReconnectTime);
 }
 
+/**
+ * QueueReconnect
+ *
+ * Adds the user to the reconnect queue, or moves the user to the right
+ * position if the reconnect time has changed.
+ */
+void CUser::QueueReconnect(void) {
+	if (m_IRC != NULL) {
+		return;
+	}
+
+	if (m_ReconnectIndex != -1) {
+		SiftReconnectUp(m_ReconnectIndex);
+		SiftReconnectDown(m_ReconnectIndex);
+
+		return;
+	}
+
+	if (g_ReconnectCount == g_ReconnectAlloc) {
+		int NewAlloc = (g_ReconnectAlloc != 0) ? g_ReconnectAlloc * 2 : 64;
+		CUser **NewQueue = (CUser **)realloc(g_ReconnectQueue, NewAlloc * sizeof(CUser *));
+
+		if (AllocFailed(NewQueue)) {
+			g_Bouncer->Fatal();
+		}
+
+		g_ReconnectQueue = NewQueue;
+		g_ReconnectAlloc = NewAlloc;
+	}
+
+	m_ReconnectIndex = g_ReconnectCount++;
+	g_ReconnectQueue[m_ReconnectIndex] = this;
+
+	SiftReconnectUp(m_ReconnectIndex);
+}
+
+/**
+ * UnqueueReconnect
+ *
+ * Removes the user from the reconnect queue.
+ */
+void CUser::UnqueueReconnect(void) {
+	int Index = m_ReconnectIndex;
+
+	if (Index == -1) {
+		return;
+	}
+
+	m_ReconnectIndex = -1;
+	g_ReconnectCount--;
+
+	if (Index == g_ReconnectCount) {
+		return;
+	}
+
+	g_ReconnectQueue[Index] = g_ReconnectQueue[g_ReconnectCount];
+	g_ReconnectQueue[Index]->m_ReconnectIndex = Index;
+
+	SiftReconnectUp(Index);
+	SiftReconnectDown(g_ReconnectQueue[Index]->m_ReconnectIndex);
+}
+
+/**
+ * SiftReconnectUp
+ *
+ * Moves a user towards the root of the reconnect queue until the heap
+ * property is restored.
+ *
+ * @param Index the user's index
+ */
+void CUser::SiftReconnectUp(int Index) {
+	CUser *User = g_ReconnectQueue[Index];
+
+	while (Index > 0) {
+		int Parent = (Index - 1) / 2;
+
+		if (g_ReconnectQueue[Parent]->m_ReconnectTime <= User->m_ReconnectTime) {
+			break;
+		}
+
+		g_ReconnectQueue[Index] = g_ReconnectQueue[Parent];
+		g_ReconnectQueue[Index]->m_ReconnectIndex = Index;
+
+		Index = Parent;
+	}
+
+	g_ReconnectQueue[Index] = User;
+	User->m_ReconnectIndex = Index;
+}
+
+/**
+ * SiftReconnectDown
+ *
+ * Moves a user away from the root of the reconnect queue until the heap
+ * property is restored.
+ *
+ * @param Index the user's index
+ */
+void CUser::SiftReconnectDown(int Index) {
+	CUser *User = g_ReconnectQueue[Index];
+
+	while (true) {
+		int Child = Index * 2 + 1;
+
+		if (Child >= g_ReconnectCount) {
+			break;
+		}
+
+		if (Child + 1 < g_ReconnectCount && g_ReconnectQueue[Child + 1]->m_ReconnectTime < g_ReconnectQueue[Child]->m_ReconnectTime) {
+			Child++;
+		}
+
+		if (User->m_ReconnectTime <= g_ReconnectQueue[Child]->m_ReconnectTime) {
+			break;
+		}
+
+		g_ReconnectQueue[Index] = g_ReconnectQueue[Child];
+		g_ReconnectQueue[Index]->m_ReconnectIndex = Index;
+
+		Index = Child;
+	}
+
+	g_ReconnectQueue[Index] = User;
+	User->m_ReconnectIndex = Index;
+}
+
 void CUser::SetUseQuitReason(bool Value) {
 	CacheSetInteger(m_ConfigCache, quitaway, Value ? 1 : 0);
 }
@@ -2059,3 +2598,59 @@ void CUser::SetAutoBacklog(const char *Value) {
 const char *CUser::GetAutoBacklog(void) {
 	return CacheGetString(m_ConfigCache, autobacklog);
 }
+
+/**
+ * SetFloodRate
+ *
+ * Sets the rate (in bytes per second) of the token bucket which is used
+ * for flood control. A rate of 0 selects the default flood control.
+ *
+ * @param Rate the rate
+ */
+void CUser::SetFloodRate(unsigned int Rate) {
+	CacheSetInteger(m_ConfigCache, floodrate, Rate);
+
+	if (m_IRC != NULL) {
+		m_IRC->GetFloodControl()->SetTokenBucket(Rate, GetFloodBurst());
+	}
+}
+
+/**
+ * GetFloodRate
+ *
+ * Returns the rate of the token bucket which is used for flood control.
+ */
+unsigned int CUser::GetFloodRate(void) {
+	return CacheGetInteger(m_ConfigCache, floodrate);
+}
+
+/**
+ * SetFloodBurst
+ *
+ * Sets the size (in bytes) of the token bucket which is used for
+ * flood control.
+ *
+ * @param Burst the size
+ */
+void CUser::SetFloodBurst(unsigned int Burst) {
+	CacheSetInteger(m_ConfigCache, floodburst, Burst);
+
+	if (m_IRC != NULL) {
+		m_IRC->GetFloodControl()->SetTokenBucket(GetFloodRate(), Burst);
+	}
+}
+
+/**
+ * GetFloodBurst
+ *
+ * Returns the size of the token bucket which is used for flood control.
+ */
+unsigned int CUser::GetFloodBurst(void) {
+	int Burst = CacheGetInteger(m_ConfigCache, floodburst);
+
+	if (Burst <= 0) {
+		return FLOODBYTES;
+	} else {
+		return Burst;
+	}
+}
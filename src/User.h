@@ -24,6 +24,7 @@ class CClientConnection;
 class CIRCConnection;
 class CConfig;
 class CLog;
+class CBacklog;
 class CTrafficStats;
 class CKeyring;
 class CTimer;
@@ -42,6 +43,8 @@ DEFINE_CACHE(User)
 	DEFINE_OPTION_INT(ignsysnotices);
 	DEFINE_OPTION_INT(lean);
 	DEFINE_OPTION_INT(quitaway);
+	DEFINE_OPTION_INT(floodrate);
+	DEFINE_OPTION_INT(floodburst);
 
 	DEFINE_OPTION_STRING(automodes);
 	DEFINE_OPTION_STRING(dropmodes);
@@ -82,9 +85,31 @@ typedef struct badlogin_s {
 							 incorrect password */
 } badlogin_t;
 
+/**
+ * attachreplay_t
+ *
+ * A client which is still receiving the state of the user's channels
+ * after it has attached.
+ */
+typedef struct attachreplay_s {
+	CClientConnection *Client; /**< the client */
+	char **Channels; /**< the names of the channels, NULL for channels which have been sent */
+	int Count; /**< the number of channels */
+	int Next; /**< the index of the next channel which is sent to the client */
+	time_t BacklogSince; /**< the timestamp of the oldest backlog line which is sent to the client */
+} attachreplay_t;
+
+/** The number of channels which are sent to an attaching client at once */
+#define ATTACHREPLAYCHANNELS 10
+
+/** The number of users which are loaded in the background per second */
+#define USERLOADBATCH 64
+
 #ifndef SWIG
 bool BadLoginTimer(time_t Now, void *User);
 bool UserReconnectTimer(time_t Now, void *User);
+bool AttachReplayTimer(time_t Now, void *User);
+bool UserLoadTimer(time_t Now, void *Null);
 #endif /* SWIG */
 
 /**
@@ -122,6 +147,7 @@ class SBNCAPI CUser {
 #ifndef SWIG
 	friend bool BadLoginTimer(time_t Now, void *User);
 	friend bool UserReconnectTimer(time_t Now, void *User);
+	friend bool AttachReplayTimer(time_t Now, void *User);
 #endif /* SWIG */
 
 	char *m_Name; /**< the name of the user */
@@ -133,9 +159,12 @@ class SBNCAPI CUser {
 	CConfig *m_Config; /**< the user's configuration object */
 	mutable CACHE(User) m_ConfigCache; /**< config cache */
 	CLog *m_Log; /**< the user's log file */
+	CBacklog *m_Backlog; /**< the user's channel backlog, created on first use */
+	bool m_Loaded; /**< whether Load() has been called */
 
 	time_t m_ReconnectTime; /**< when the next connect() attempt is going to be made */
 	time_t m_LastReconnect; /**< when the last connect() attempt was made for this user */
+	int m_ReconnectIndex; /**< the user's index in the reconnect queue, or -1 */
 
 	CVector<badlogin_t> m_BadLogins; /**< a list of failed login attempts for this user */
 
@@ -146,6 +175,9 @@ class SBNCAPI CUser {
 
 	CTimer *m_BadLoginPulse; /**< a timer which will remove "bad logins" */
 
+	CVector<attachreplay_t> m_AttachReplays; /**< clients which are still receiving their channels */
+	CTimer *m_AttachReplayTimer; /**< timer for continuing m_AttachReplays */
+
 	CVector<X509 *> m_ClientCertificates; /**< the client certificates for the user */
 
 	int m_NextProtocolFamily; /**< which protocol family to try next */
@@ -153,6 +185,18 @@ class SBNCAPI CUser {
 	bool PersistCertificates(void);
 
 	void BadLoginPulse(void);
+
+	const CVector<CChannel *> *GetAttachChannels(void);
+	void ReplayChannel(CClientConnection *Client, CChannel *Channel, time_t BacklogSince);
+	bool ContinueAttachReplay(CClientConnection *Client, int Count);
+	void ContinueAttachReplays(void);
+	void RemoveAttachReplay(int Index);
+
+	void QueueReconnect(void);
+	void UnqueueReconnect(void);
+
+	static void SiftReconnectUp(int Index);
+	static void SiftReconnectDown(int Index);
 public:
 #ifndef SWIG
 	CUser(const char *Name);
@@ -161,6 +205,9 @@ public:
 
 	static void RescheduleReconnectTimer(void);
 
+	void Load(void);
+	bool IsLoaded(void) const;
+
 	CClientConnection *GetPrimaryClientConnection(void);
 	CClientConnection *GetClientConnectionMultiplexer(void);
 	CVector<client_t> *GetClientConnections(void);
@@ -169,6 +216,10 @@ public:
 
 	bool CheckPassword(const char *Password);
 	void Attach(CClientConnection *Client);
+#ifndef SWIG
+	void FlushAttachReplays(CClientConnection *Client = NULL);
+	void FlushAttachReplayChannels(CClientConnection *Client, int argc, const char **argv);
+#endif /* SWIG */
 
 	const char *GetNick(void) const;
 	void SetNick(const char *Nick);
@@ -190,6 +241,7 @@ public:
 	unsigned int GetIRCUptime(void) const;
 
 	CLog *GetLog(void);
+	CBacklog *GetBacklog(void);
 	void Log(const char *Format, ...);
 
 	void Lock(void);
@@ -293,6 +345,11 @@ public:
 
 	void SetAutoBacklog(const char *Value);
 	const char *GetAutoBacklog(void);
+
+	void SetFloodRate(unsigned int Rate);
+	unsigned int GetFloodRate(void);
+	void SetFloodBurst(unsigned int Burst);
+	unsigned int GetFloodBurst(void);
 };
 
 #endif /* USER_H */
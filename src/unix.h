@@ -33,8 +33,10 @@
 #include <sys/ioctl.h>
 #include <sys/wait.h>
 #include <sys/file.h>
+#include <sys/mman.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <arpa/inet.h>
 #include <arpa/nameser.h>
 #include <errno.h>
@@ -50,6 +52,10 @@ typedef int SOCKET;
 #define INVALID_SOCKET (-1)
 #define ioctlsocket ioctl
 
+#ifndef O_BINARY
+#	define O_BINARY 0
+#endif /* O_BINARY */
+
 typedef int BOOL;
 typedef int DWORD;
 
@@ -245,16 +245,20 @@ void ArgFreeArray(const char **Array) {
 tokendata_t ArgTokenize2(const char *String) {
 	tokendata_t tokens;
 	register unsigned int a = 1;
-	size_t Len = min(strlen(String), sizeof(tokens.String) - 1);
+	size_t Len;
 
-	memset(tokens.String, 0, sizeof(tokens.String));
-	strmcpy(tokens.String, String, sizeof(tokens.String));
+	// only the part of the buffer which is actually used is initialized
+	for (Len = 0; Len < sizeof(tokens.String) - 1 && String[Len] != '\0'; Len++) {
+		tokens.String[Len] = String[Len];
+	}
+
+	tokens.String[Len] = '\0';
 
 	tokens.Pointers[0] = 0;
 
 	for (unsigned int i = 0; i < Len; i++) {
-		if (String[i] == ' ' && String[i + 1] != ' ') {
-			if (String[i + 1] == '\0') {
+		if (tokens.String[i] == ' ' && tokens.String[i + 1] != ' ') {
+			if (tokens.String[i + 1] == '\0') {
 				tokens.String[i] = '\0';
 
 				continue;
@@ -269,7 +273,7 @@ tokendata_t ArgTokenize2(const char *String) {
 				break;
 			}
 
-			if (String[i + 1] == ':') {
+			if (tokens.String[i + 1] == ':') {
 				tokens.Pointers[a - 1]++;
 
 				break;
@@ -299,13 +303,30 @@ const char **ArgToArray2(const tokendata_t& Tokens) {
 		return NULL;
 	}
 
-	memset(Pointers, 0, sizeof(const char *) * 33);
+	ArgToArray2(Tokens, Pointers);
+
+	return Pointers;
+}
 
-	for (unsigned int i = 0; i < min(Tokens.Count, (unsigned int)32); i++) {
+/**
+ * ArgToArray2
+ *
+ * Fills a caller-supplied pointer array for a tokendata_t structure. The
+ * array must have room for at least 33 pointers.
+ *
+ * @param Tokens the tokenized string
+ * @param Pointers the array
+ */
+void ArgToArray2(const tokendata_t& Tokens, const char **Pointers) {
+	unsigned int Count = min(Tokens.Count, (unsigned int)32);
+
+	for (unsigned int i = 0; i < Count; i++) {
 		Pointers[i] = Tokens.Pointers[i] + Tokens.String;
 	}
 
-	return Pointers;
+	for (unsigned int i = Count; i < 33; i++) {
+		Pointers[i] = NULL;
+	}
 }
 
 /**
@@ -501,6 +522,7 @@ SOCKET CreateListener(unsigned int Port, const char *BindIp, int Family) {
 	sockaddr_in6 sin6;
 #endif /* HAVE_IPV6 */
 	const int optTrue = 1;
+	unsigned long lTrue = 1;
 	bool Bound = false;
 	SOCKET Listener;
 	hostent *hent;
@@ -584,6 +606,9 @@ SOCKET CreateListener(unsigned int Port, const char *BindIp, int Family) {
 		return INVALID_SOCKET;
 	}
 
+	// listeners accept clients until the backlog is empty
+	ioctlsocket(Listener, FIONBIO, &lTrue);
+
 	return Listener;
 }
 
@@ -1278,6 +1303,41 @@ bool AllocFailedInternal(const void *Ptr, const char *File, int Line) {
 	return true;
 }
 
+/**
+ * GetCurrentTimeMs
+ *
+ * Returns the current time in milliseconds since the epoch.
+ */
+int64_t GetCurrentTimeMs(void) {
+	return GetCurrentTimeUs() / 1000;
+}
+
+/**
+ * GetCurrentTimeUs
+ *
+ * Returns the current time in microseconds since the epoch.
+ */
+int64_t GetCurrentTimeUs(void) {
+#ifndef _WIN32
+	timeval Now;
+
+	gettimeofday(&Now, NULL);
+
+	return (int64_t)Now.tv_sec * 1000000 + Now.tv_usec;
+#else
+	FILETIME Now;
+	ULARGE_INTEGER Ticks;
+
+	GetSystemTimeAsFileTime(&Now);
+
+	Ticks.LowPart = Now.dwLowDateTime;
+	Ticks.HighPart = Now.dwHighDateTime;
+
+	// FILETIME uses 100ns intervals since 1601-01-01
+	return (int64_t)((Ticks.QuadPart - 116444736000000000ULL) / 10);
+#endif
+}
+
 #ifndef _WIN32
 lt_dlhandle sbncLoadLibrary(const char *Filename) {
 	lt_dlhandle handle = 0;
@@ -62,6 +62,7 @@ typedef struct tokendata_s {
  */
 tokendata_t ArgTokenize2(const char *String);
 const char **ArgToArray2(const tokendata_t& Tokens);
+void ArgToArray2(const tokendata_t& Tokens, const char **Pointers);
 const char *ArgGet2(const tokendata_t& Tokens, unsigned int Arg);
 unsigned int ArgCount2(const tokendata_t& Tokens);
 
@@ -84,7 +85,7 @@ SBNCAPI void DeleteCommand(commandlist_t *Commands, const char *Name);
 SBNCAPI int CmpCommandT(const void *pA, const void *pB);
 
 #define BNCVERSION SBNC_VERSION
-#define INTERFACEVERSION 25
+#define INTERFACEVERSION 26
 
 extern const char *g_ErrorFile;
 extern unsigned int g_ErrorLine;
@@ -140,6 +141,9 @@ int poll(struct pollfd *fds, unsigned long nfds, int timo);
 int sn_getline(char *buf, size_t size);
 int sn_getline_passwd(char *buf, size_t size);
 
+SBNCAPI int64_t GetCurrentTimeMs(void);
+SBNCAPI int64_t GetCurrentTimeUs(void);
+
 SBNCAPI bool RcFailedInternal(int ReturnCode, const char *File, int Line);
 SBNCAPI bool AllocFailedInternal(const void *Ptr, const char *File, int Line);
 
@@ -69,6 +69,9 @@ typedef int socklen_t;
 #undef strcasecmp
 #define strcasecmp strcmpi
 
+#undef strncasecmp
+#define strncasecmp strnicmp
+
 #define EXPORT __declspec(dllexport)
 
 #ifndef _MSC_VER